@@ -1,52 +1,1129 @@
 #include <gtk/gtk.h>
 #include <cairo.h>
+#include <cairo-pdf.h>
+#include <cairo-svg.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <time.h>
 #include <math.h>
+#include <limits.h>
+#include <stdint.h>
+#include <getopt.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <stdarg.h>
+#include <errno.h>
+#include <ctype.h>
+#include <signal.h>
+#include <poll.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <dlfcn.h>
+#include "scheduler_plugin.h"
 
 #define MAX_PROCESSES 50
 #define MAX_NAME_LEN 20
+#define REPLICATION_METRICS 6
+#define RESULT_CACHE_BUCKETS 256
+#define RESULT_CACHE_BUDGET (16 * 1024 * 1024)
+#define RESULT_CACHE_MAGIC "CPUSCHC5"
+#define CHECKPOINT_LIMIT 64
+#define PLAYBACK_MIN_INTERVAL 256
+#define PLAYBACK_FRAME_MS 33
+#define PLAYBACK_FRAME_EVENTS 50000
+#define PLAYBACK_READY_SHOWN 16
+#define TRACE_LINE_MAX 4096
+#define TRACE_SLICES_PER_JOB 16
+#define TRACE_REPORT_TASKS 200
+#define SERVICE_MAX_CLIENTS 256
+#define SERVICE_BATCH 32
+#define SERVICE_SMALL_REQUEST 256
+#define SERVICE_LATENCY_BUCKETS 40
+#define SERVICE_ID_LEN 64
+#define SERVICE_MAX_PENDING (4 * 1024 * 1024)
+#define STREAM_MAX_BUCKETS 4096
+#define STREAM_LATENCY_BUCKETS 1920     // 32 per power of two up to 2^63
+#define GANTT_CHUNK_BLOCKS 4096
+#define GANTT_LOD_PIXELS 2.0
+#define MAX_IO_BURSTS 8
+#define MAX_IO_DEVICES 4
+#define ALGORITHM_COUNT 8
+#define MAX_WEIGHT 100
+#define STRIDE_ONE 65536
+#define STRIDE_REBASE (1 << 30)
+#define MAX_STRIDE_QUANTUM 10000    // keeps a quantum's pass step inside a key
+#define MAX_GROUPS 16
+#define MAX_GROUP_PATH 64
+#define DEFAULT_GROUP_WEIGHT 10
+#define MAX_LOCKS 4
+#define MAX_RESOURCES 8
+#define MAX_RESOURCE_NAME 16
+#define MAX_PLUGINS 8
+#define MAX_SIM_TIME (INT64_C(1) << 60)   // largest time a workload may give, so sums of them cannot overflow
+
+// Simulated time, in ticks of the configured time unit. 64 bits, so a trace
+// kept to the nanosecond can span years.
+typedef int64_t SimTime;
+
+// A ready-set key: a time or rank above a 32-bit table index, so that ties
+// resolve to the lowest index. The rank needs the full range of SimTime.
+typedef __int128 SchedKey;
+
+// What one tick of simulated time stands for
+typedef enum {
+    TIME_UNIT_NONE,         // abstract time units
+    TIME_UNIT_NS,
+    TIME_UNIT_US,
+    TIME_UNIT_MS,
+    TIME_UNITS
+} TimeUnit;
+
+// One I/O request a process makes part way through its CPU demand
+typedef struct {
+    SimTime after;          // CPU time the process has had when it issues the request
+    SimTime length;         // device service time
+    int device;
+} IoBurst;
+
+// A shared resource a process holds over part of its CPU demand
+typedef struct {
+    int resource;           // index into the simulation's resource names
+    SimTime acquire;        // CPU time the process has had when it takes the resource
+    SimTime release;        // CPU time it has had when it lets go
+} LockSpan;
 
 typedef struct {
     char name[MAX_NAME_LEN];
-    int arrival_time;
-    int burst_time;
+    SimTime arrival_time;
+    SimTime burst_time;     // total CPU demand, over all of its CPU bursts
     int priority;
-    int remaining_time;
-    int start_time;
-    int completion_time;
-    int waiting_time;
-    int turnaround_time;
-    int response_time;
+    int weight;             // CPU share under Stride and Lottery, 0 to derive it from priority
+    SimTime remaining_time;
+    SimTime start_time;
+    SimTime completion_time;
+    SimTime waiting_time;
+    SimTime turnaround_time;
+    SimTime response_time;
     int process_id;
+    SimTime last_run_end;   // end of its latest slice, -1 until it first runs
+    int io_count;           // I/O requests, in the order they are issued
+    int io_next;            // first request not issued yet
+    SimTime blocked_time;   // time spent queued for or using a device
+    int group;              // bandwidth group, 0 for none
+    SimTime throttled_time; // part of the waiting time its group was throttled
+    int lock_count;         // resources it takes, Preemptive Priority only
+    SimTime lock_wait_time; // part of the waiting time it was blocked on a held resource
+    IoBurst io[MAX_IO_BURSTS];
+    LockSpan locks[MAX_LOCKS];
     GdkRGBA color;
 } Process;
 
 typedef struct {
     char process_name[MAX_NAME_LEN];
-    int start_time;
-    int end_time;
+    SimTime start_time;
+    SimTime end_time;
+    int process_index;
+    int overhead;           // leading time units spent switching to the process
     GdkRGBA color;
 } GanttBlock;
 
+// Finds the position in a process array that holds an id or a name. Both
+// maps are open addressing with linear probing over positions + 1, 0 marking
+// an empty bucket, kept at most half full, so a lookup, add or delete takes
+// O(1) probes. Where a name repeats only its first position is found by name.
+typedef struct {
+    int* by_id;
+    int* by_name;
+    int bucket_count;           // a power of two
+    int count;                  // positions indexed
+} ProcessIndex;
+
+// A slot map of processes with the table order kept in a linked list
+typedef struct {
+    Process slot[MAX_PROCESSES];
+    int next[MAX_PROCESSES];    // following slot in table order, -1 for the last
+    int prev[MAX_PROCESSES];
+    int head;                   // first slot in table order, -1 when empty
+    int tail;
+    int free_slots[MAX_PROCESSES];
+    int free_count;
+    int count;
+    int next_id;                // ids are never handed out twice, even after a delete
+    ProcessIndex lookup;        // id and name -> slot
+} ProcessTable;
+
 typedef enum {
     FCFS = 1,
     SJF,
     SRTF,
     PRIORITY,
     ROUND_ROBIN,
-    PREEMPTIVE_PRIORITY
+    PREEMPTIVE_PRIORITY,
+    STRIDE,
+    LOTTERY
 } SchedulingAlgorithm;
 
+// Sparse time index entry for one spilled chunk of a Gantt log
+typedef struct {
+    SimTime start_time;     // of the chunk's first block
+    SimTime end_time;       // of its last block
+} GanttChunk;
+
+// Full chunks of GANTT_CHUNK_BLOCKS blocks, appended to an unlinked temporary
+// file. The owner's in-memory array keeps only the blocks after the last full
+// chunk, so a log can outgrow RAM while its last block stays in memory.
+typedef struct {
+    int fd;
+    int failed;             // a write failed (disk full); the tail just grows from then on
+    GanttChunk* chunks;
+    int chunk_count;
+    int chunk_capacity;
+} GanttSpill;
+
+// Draws Gantt blocks onto a cairo context; blocks too narrow to see are
+// accumulated per pixel column instead of drawn one by one
+typedef struct {
+    cairo_t* cr;
+    int y;
+    int height;
+    double origin;          // time at the left edge of the chart (x = 50)
+    double time_scale;      // pixels per time unit
+    int column;             // pixel column being accumulated, INT_MIN if none
+    double column_busy;
+    double column_longest;
+    GdkRGBA column_color;
+} GanttPainter;
+
+// Time units charged when the CPU is handed to a different process: a fixed
+// dispatch cost plus a cache penalty that grows linearly with the time since
+// the process last ran, reaching cache_penalty after cache_decay units away
+// (and on a process's first run).
+typedef struct {
+    int dispatch;
+    int cache_penalty;
+    int cache_decay;
+} SwitchCost;
+
+// Order in which a device serves its queue
+typedef enum {
+    IO_FCFS,
+    IO_SJF,                 // shortest request first
+    IO_PRIORITY             // by the process's priority
+} IoDiscipline;
+
+// Simulated I/O devices, each serving one request at a time from its own
+// queue. Devices a workload uses beyond device_count serve FCFS.
+typedef struct {
+    int device_count;
+    IoDiscipline discipline[MAX_IO_DEVICES];
+} IoConfig;
+
+// Busy interval of the CPU (device -1) or of a device
+typedef struct {
+    SimTime start;
+    SimTime end;
+    int device;
+} IoSpan;
+
+typedef struct {
+    SimTime time;
+    int delta;              // +1 where a span starts, -1 where it ends
+    int device;
+} IoEdge;
+
+// What the devices did in a run with I/O
+typedef struct {
+    int device_count;
+    GanttBlock* gantt[MAX_IO_DEVICES];  // service intervals, when the run records a Gantt log
+    int gantt_count[MAX_IO_DEVICES];
+    int gantt_capacity[MAX_IO_DEVICES];
+    long busy_time[MAX_IO_DEVICES];
+    long requests[MAX_IO_DEVICES];
+    long queue_time[MAX_IO_DEVICES];    // requests spent waiting for the device
+    long cpu_busy;                      // including switch overhead
+    long device_busy;                   // at least one device busy
+    long overlap_time;                  // CPU and at least one device busy at once
+    long elapsed;                       // first arrival to last completion
+    IoSpan* spans;                      // only kept until the run ends
+    long span_count;
+    long span_capacity;
+} IoLog;
+
+// A node of the bandwidth group tree, like a cgroup with cpu.max and
+// cpu.weight: its processes, and those of the groups below it, may use
+// `quota` units of CPU time per period, periods starting at multiples of
+// `period`. A group that has used its quota is throttled until the next
+// period begins.
+typedef struct {
+    char path[MAX_GROUP_PATH];  // "/batch/nightly"
+    int parent;                 // group number, 0 for the root
+    int quota;                  // 0 for no limit
+    int period;
+    int weight;                 // share against its siblings under Stride and Lottery
+} CpuGroup;
+
+// Groups are numbered from 1, each after its parent. Group 0 is the root: it
+// has no limit and holds the processes that name no group.
+typedef struct {
+    int count;
+    CpuGroup group[MAX_GROUPS + 1];
+} GroupConfig;
+
+// One period's throttled stretch of a group
+typedef struct {
+    SimTime start;
+    SimTime end;
+    int group;
+} ThrottleSpan;
+
+// What the groups did in a run of a grouped workload; each group counts its
+// own processes and those of the groups below it
+typedef struct {
+    int group_count;
+    long used[MAX_GROUPS + 1];          // CPU time, switch overhead excluded
+    long throttles[MAX_GROUPS + 1];
+    long throttled_time[MAX_GROUPS + 1];
+    GanttBlock* gantt[MAX_GROUPS + 1];  // slices, when the run records a Gantt log
+    int gantt_count[MAX_GROUPS + 1];
+    int gantt_capacity[MAX_GROUPS + 1];
+    ThrottleSpan* spans;                // likewise
+    long span_count;
+    long span_capacity;
+} GroupLog;
+
+// How a process holding a resource ranks while others want it
+typedef enum {
+    LOCK_NONE,              // its own priority
+    LOCK_INHERIT,           // the best rank of the processes blocked behind it
+    LOCK_CEILING,           // at least the best priority of any process that uses the resource
+    LOCK_PROTOCOLS
+} LockProtocol;
+
+typedef struct {
+    int count;
+    char name[MAX_RESOURCES][MAX_RESOURCE_NAME];
+} ResourceTable;
+
+// A stretch of time a process was blocked on a resource another one held.
+// The chain is the holders it waited behind, nearest first, at the point
+// in the wait where there were most of them.
+typedef struct {
+    int process;
+    int resource;
+    SimTime start;
+    SimTime end;
+    SimTime inverted;       // time in it that a process of lower priority ran
+    SimTime unbounded;          // of that, time run by a process outside the chain that did not outrank the waiter
+    int depth;
+    int chain_holder[MAX_RESOURCES];
+    int chain_resource[MAX_RESOURCES];
+} LockWait;
+
+// Who held each resource and who waited for it, in a Preemptive Priority
+// run of a workload with locks
+typedef struct {
+    int resource_count;
+    long holds[MAX_RESOURCES];
+    long contended[MAX_RESOURCES];      // waits for it
+    long wait_time[MAX_RESOURCES];
+    GanttBlock* gantt[MAX_RESOURCES];   // holders, when the run records a Gantt log
+    int gantt_count[MAX_RESOURCES];
+    int gantt_capacity[MAX_RESOURCES];
+    LockWait* waits;
+    long wait_count;
+    long wait_capacity;
+} LockLog;
+
+// One scheduling run: the workload it operates on and the Gantt log it produces.
+// Schedulers only touch the Simulation they are given, so independent runs can
+// execute concurrently on different threads.
+typedef struct {
+    Process* processes;
+    int process_count;
+    GanttBlock* gantt;
+    int gantt_count;
+    int gantt_capacity;
+    int record_gantt;
+    int time_quantum;
+    SimTime current_time;
+    int* arrival_order;     // indices by (arrival_time, index), built on first use
+    GanttSpill* spill;      // when set, gantt holds only the blocks not spilled yet
+    SwitchCost cost;
+    int last_process;       // index of the process that last held the CPU, -1 for none
+    long switches;          // dispatches of a different process than the last one
+    long overhead_time;     // time units spent switching
+    IoConfig io;            // devices the processes' I/O bursts go to
+    IoLog* io_log;          // device activity of the last run, NULL unless it had I/O
+    int aging_interval;     // priority policies: units of waiting per priority level gained, 0 for none
+    uint64_t seed;          // Lottery's draws
+    GroupConfig groups;     // bandwidth groups the processes' group numbers refer to
+    GroupLog* group_log;    // what the groups did in the last run, NULL unless it had any
+    ResourceTable resources;    // names the processes' lock spans refer to
+    LockProtocol lock_protocol;
+    LockLog* lock_log;      // holds and waits of the last run, NULL unless it honoured locks
+} Simulation;
+
+// xoshiro256** generator state; each replication seeds its own stream
+typedef struct {
+    uint64_t s[4];
+} RngState;
+
+typedef struct {
+    SchedulingAlgorithm algo;
+    int replications;
+    int jobs;
+    int threads;
+    int time_quantum;
+    uint64_t seed;
+    double arrival_rate;
+    double mean_burst;
+    SwitchCost cost;
+    double io_mix;          // share of generated jobs that are I/O-bound
+    IoConfig io;
+    int aging_interval;
+    LockProtocol lock_protocol;
+} ReplicationConfig;
+
+// Welford accumulator for mean and variance
+typedef struct {
+    long count;
+    double mean;
+    double m2;
+} RunningStat;
+
+typedef struct {
+    RunningStat metrics[REPLICATION_METRICS];
+    int threads_used;
+    double elapsed_seconds;
+} ReplicationResult;
+
+typedef struct {
+    const ReplicationConfig* config;
+    int first_replication;
+    int last_replication;
+    RunningStat metrics[REPLICATION_METRICS];
+} ReplicationWorker;
+
+// What the autotuner minimises
+typedef enum {
+    OBJECTIVE_P99_RESPONSE,
+    OBJECTIVE_MEAN_RESPONSE,
+    OBJECTIVE_P99_WAITING,
+    OBJECTIVE_MEAN_WAITING,
+    OBJECTIVE_MEAN_TURNAROUND,
+    OBJECTIVES
+} TuneObjective;
+
+typedef struct {
+    int candidates;             // configurations sampled for the first rung
+    TuneObjective objective;
+    double min_throughput;      // processes per 100 time units a configuration must reach
+} TuneConfig;
+
+// One configuration and what it scored on the last rung it reached
+typedef struct {
+    SchedulingAlgorithm algo;
+    int time_quantum;           // 0 for the policies without slices
+    int aging_interval;         // 0 for none, and for the policies without priorities
+    int rung;
+    double metrics[OBJECTIVES];
+    double throughput;
+} TuneCandidate;
+
+// The evaluations of one rung, shared by the worker threads
+typedef struct {
+    const ReplicationConfig* config;
+    const Process* procs;       // the workload in arrival order
+    int jobs;                   // length of the prefix this rung runs
+    int rung;
+    TuneCandidate* candidates;
+    const int* batch;           // candidates to evaluate
+    int batch_count;
+    int next;                   // first entry of batch not yet taken
+    pthread_mutex_t lock;
+} TunePool;
+
+// First two moments of a workload's interarrival gaps and service times
+typedef struct {
+    int count;
+    double span;            // first to last arrival
+    double arrival_rate;
+    double gap_scv;         // squared coefficient of variation of the gaps
+    double mean_service;
+    double service_m2;      // second moment of the service time
+    double service_scv;
+    double load;            // arrival rate times mean service time
+} QueueFit;
+
+typedef struct {
+    SchedulingAlgorithm algo;
+    const char* model;
+    double waiting;         // mean waiting time
+    double seconds;         // time the estimate took
+} QueueEstimate;
+
+// Scheduling inputs of one process; a cached result is only reused when every
+// one of these matches
+typedef struct {
+    char name[MAX_NAME_LEN];
+    SimTime arrival_time;
+    SimTime burst_time;
+    int priority;
+    int weight;
+    GdkRGBA color;
+} WorkloadEntry;
+
+typedef struct CacheEntry {
+    uint64_t hash;
+    SchedulingAlgorithm algo;
+    int time_quantum;
+    SwitchCost cost;
+    int aging_interval;
+    long switches;
+    long overhead_time;
+    int process_count;
+    int gantt_count;
+    size_t bytes;
+    WorkloadEntry* input;
+    Process* processes;
+    GanttBlock* gantt;
+    struct CacheEntry* bucket_next;
+    struct CacheEntry* lru_prev;
+    struct CacheEntry* lru_next;
+} CacheEntry;
+
+// Hash table of finished runs with an LRU list (head = most recently used)
+typedef struct {
+    CacheEntry* buckets[RESULT_CACHE_BUCKETS];
+    CacheEntry* lru_head;
+    CacheEntry* lru_tail;
+    size_t bytes;
+    size_t budget;
+    int entries;
+    long hits;
+    long misses;
+    long evictions;
+} ResultCache;
+
+// Loop state of an event-driven engine
+typedef struct {
+    int* order;         // process indices by (arrival_time, index)
+    int next;           // first entry of order not yet admitted
+    int completed;
+    long dispatches;    // scheduling decisions made so far
+    SchedKey* heap;     // ready set of the keyed engines
+    int heap_size;
+    int* queue;         // circular ready queue of Round Robin
+    int front;
+    int rear;
+    int capacity;
+} EngineState;
+
+// The rules that set one policy apart in the event-driven core
+typedef struct {
+    SchedulingAlgorithm algo;   // orders the ready heap, by scheduling_key
+    int preemptive;             // an arrival, or aging under priorities, ends a slice
+    int sliced;                 // slices end at the quantum and the ready set is a FIFO queue
+} SchedPolicy;
+
+// The ready processes of one bandwidth group (set 0 holds those of no group)
+// and the group's quota state. Under Stride the heap also holds the group's
+// runnable child groups, keyed by their pass, and under Lottery the group
+// draws between its own processes' tickets and its runnable children.
+typedef struct {
+    int parent;
+    int members;            // ready processes of this group
+    int runnable;           // a process here or below may run: nothing on the way is throttled
+    SchedKey* heap;         // ready processes' keys, every policy but Round Robin and Lottery
+    int heap_size;
+    int* queue;             // Round Robin: circular ready queue
+    int front;
+    int rear;
+    int capacity;
+    int64_t* tree;          // Lottery: Fenwick tree of the ready processes' tickets
+    int64_t tickets;
+    int64_t base;           // Stride: pass value of key primary 0
+    int64_t pass;           // Stride: pass of the last entry dispatched from the heap
+    int64_t own_pass;       // Stride: the group's pass in its parent's heap
+    int queued;             // Stride: in its parent's heap
+    SimTime used;           // CPU time used in the current period
+    SimTime period_start;
+    int throttled;
+    SimTime throttled_since;
+    int blocked;            // it or a group above it is throttled
+    SimTime blocked_from;
+    SimTime blocked_area;   // time spent blocked before blocked_from
+} ReadySet;
+
+// Loop state of the I/O engine. A process is in the ready set of its group,
+// running, in a device queue or being served, and moves between them at the
+// end of each CPU burst and each I/O request.
+typedef struct {
+    Simulation* sim;
+    SchedulingAlgorithm algo;
+    const int* order;           // process indices by (arrival_time, index)
+    int next;                   // first entry of order not yet admitted
+    int completed;
+    int set_count;              // bandwidth groups plus the root
+    ReadySet* sets;
+    int* set_of;                // each process's group
+    SimTime* mark;              // its set's blocked time when it last became ready
+    int64_t* pass;              // Stride: each process's pass value
+    SchedKey* ready_key;        // each process's key in its set; Round Robin: its place in the queues
+    int64_t enqueued;
+    int* batch;                 // Round Robin: ready since the last enqueue
+    int batch_count;
+    SchedKey* releases;         // throttled groups by (end of period, group)
+    int release_count;
+    RngState rng;               // Lottery's draws
+    int device_count;
+    SchedKey* device_queue[MAX_IO_DEVICES];
+    int device_queued[MAX_IO_DEVICES];
+    int device_busy[MAX_IO_DEVICES];    // process being served, -1 if idle
+    SimTime device_until[MAX_IO_DEVICES];
+    SimTime* requested;         // when each process issued its pending request
+} IoEngine;
+
+// Lock state of a Preemptive Priority run, beside the reference loop's own
+typedef struct {
+    Simulation* sim;
+    int holder[MAX_RESOURCES];          // process holding each resource, -1 when free
+    SimTime held_since[MAX_RESOURCES];
+    int ceiling[MAX_RESOURCES];         // best priority of the processes that use it
+    int* blocked_on;                    // resource each process waits for, -1 if none
+    SimTime* rank;                      // rank under the protocol, lower first
+    long* wait;                         // its open LockWait in the log, -1 if none
+} LockState;
+
+// Where the CPU's time went in a finished run
+typedef struct {
+    long switches;
+    long overhead_time;
+    long useful_time;       // sum of the bursts
+    long elapsed;           // first arrival to last completion
+} SwitchSummary;
+
+// Waiting-time distribution of a finished run
+typedef struct {
+    double mean;
+    SimTime p50;
+    SimTime p99;
+    SimTime p999;
+    SimTime max;
+} TailLatency;
+
+// Achieved against target CPU share of the processes of one weight
+typedef struct {
+    int weight;
+    int processes;
+    double target;          // CPU time the class was entitled to over the run
+    double achieved;        // CPU time it got
+    double error_sum;       // over the windows counted, in points of share
+    double error_max;
+    int windows;            // windows counted in which the class was ready
+    int worst_window;
+} ShareClass;
+
+// Arrival or completion of a process, for the share report's sweep
+typedef struct {
+    SimTime time;
+    int share_class;
+    int weight;             // negative on completion
+} ShareEvent;
+
+typedef struct {
+    const Process* processes;
+    const int* class_of_weight;
+    int class_count;
+    int window;
+    double* achieved;       // [window * class_count + class]
+} ShareVisit;
+
+typedef struct {
+    GroupLog* log;
+    const Simulation* sim;
+} GroupVisit;
+
+typedef struct {
+    int index;
+    SimTime remaining_time;
+    SimTime start_time;
+    SimTime completion_time;
+    SimTime last_run_end;
+} ProcessProgress;
+
+// Engine state at one point of a run
+typedef struct {
+    SimTime time;
+    int completed;
+    long dispatches;
+    int admitted;
+    int gantt_count;
+    SimTime last_gantt_end;
+    int last_process;
+    long switches;
+    long overhead_time;
+    int ready_count;
+    SchedKey* ready;            // heap keys, or queue indices front to back
+    ProcessProgress* progress;  // admitted processes, in arrival order
+} Checkpoint;
+
+// Checkpoints of the last computed run plus the edits made since
+typedef struct {
+    int valid;
+    SchedulingAlgorithm algo;
+    int time_quantum;
+    SwitchCost cost;
+    int aging_interval;
+    int process_count;          // processes in the run the checkpoints describe
+    int* run_ids;               // run index -> process id, matched to rows again on resume
+    WorkloadEntry* input;       // run index -> the workload the run saw
+    GanttBlock* gantt;
+    int gantt_count;
+    long interval;
+    long next_checkpoint;
+    long total_dispatches;
+    int count;
+    Checkpoint items[CHECKPOINT_LIMIT];
+} CheckpointLog;
+
+typedef struct {
+    int resumed;
+    SimTime resume_time;
+    long skipped_dispatches;
+    long total_dispatches;
+} IncrementalReport;
+
+// Sort order of simultaneous events matters: a slice ends before a new one starts
+typedef enum {
+    EVENT_PREEMPT,
+    EVENT_COMPLETE,
+    EVENT_ARRIVE,
+    EVENT_RUN
+} PlaybackEventKind;
+
+typedef struct {
+    SimTime time;
+    int kind;
+    int index;
+} PlaybackEvent;
+
+// Replay state after applying the first event_pos events
+typedef struct {
+    SimTime time;
+    int event_pos;
+    int running;
+    SimTime running_since;
+    int completed;
+    double total_tat;
+    double total_wt;
+    long busy_time;
+    long ready_offset;  // into the timeline's ready pool
+    int ready_count;
+} PlaybackSnapshot;
+
+typedef struct {
+    const Process* processes;
+    int process_count;
+    SimTime end_time;
+    PlaybackEvent* events;
+    int event_count;
+    PlaybackSnapshot* snapshots;
+    int snapshot_count;
+    int snapshot_capacity;
+    int* ready_pool;
+    long ready_pool_size;
+    long ready_pool_capacity;
+
+    // Cursor
+    SimTime time;
+    int event_pos;
+    int running;
+    SimTime running_since;
+    int completed;
+    double total_tat;
+    double total_wt;
+    long busy_time;
+    int* ready;         // unordered ready set
+    int ready_count;
+    int* ready_pos;     // position in ready, -1 if absent
+} PlaybackTimeline;
+
+typedef enum {
+    TRACE_FORMAT_AUTO,
+    TRACE_FORMAT_PERF,      // perf sched timehist text output
+    TRACE_FORMAT_FTRACE     // ftrace sched_switch / sched_wakeup events
+} TraceFormat;
+
+typedef struct {
+    TraceFormat format;
+    int cpu;            // CPU to replay, -1 for the first one in the trace
+    int tick_us;        // microseconds per simulated time unit, when ticks are abstract units
+    double start;       // ignore events before this trace timestamp (seconds)
+    int max_jobs;       // stop reading once this many jobs were seen
+} TraceConfig;
+
+// One wakeup-to-sleep episode of a task, as it ran on the replayed CPU
+typedef struct {
+    int task;
+    int64_t arrival_us;
+    int64_t first_run_us;
+    int64_t end_us;
+    int64_t run_us;
+} TraceJob;
+
+typedef struct {
+    int pid;
+    char comm[MAX_NAME_LEN];
+    int priority;
+    int job;                // open job, -1 while the task sleeps
+    int64_t wakeup_us;      // pending wakeup, -1 if none
+    int64_t run_start_us;   // running on the replayed CPU since, -1 if not
+    int jobs;
+    double recorded_latency_us;
+    double simulated_latency_us;
+} TraceTask;
+
+// Importer state and the replay built from it. Memory grows with the number
+// of distinct tasks and the job limit, never with the size of the trace file.
+typedef struct {
+    TraceConfig config;
+    TraceFormat format;
+    int cpu;
+    int64_t base_us;        // trace time of simulated time 0, -1 until known
+    int64_t last_us;
+    int64_t tick_ns;        // nanoseconds per simulated time unit
+    long lines;
+    long long bytes;
+    int truncated;
+    int has_state;          // perf timehist was run with --state
+
+    TraceTask* tasks;
+    int task_count;
+    int task_capacity;
+    int* task_slots;        // open-addressed pid -> task index, -1 if empty
+    int slot_capacity;
+
+    TraceJob* jobs;
+    int job_count;
+    int job_capacity;
+    GanttBlock* recorded;   // what the kernel ran, in simulated time units
+    int recorded_count;
+    int recorded_capacity;
+    GanttSpill* recorded_spill;
+
+    SchedulingAlgorithm algo;
+    Process* workload;
+    Simulation simulated;
+} TraceReplay;
+
+typedef struct {
+    char* data;
+    size_t length;
+    size_t capacity;
+} TextBuffer;
+
+typedef struct {
+    const char* p;
+    const char* end;
+} JsonReader;
+
+typedef struct {
+    const char* socket_path;
+    int threads;
+    int max_queue;              // requests waiting for a worker
+    int max_request_jobs;       // processes in one request
+    size_t max_request_bytes;   // length of one request line
+} ServiceConfig;
+
+// Shared by the I/O loop and every request it queued; the socket is closed
+// when the last reference goes, so workers never write to a reused fd
+typedef struct {
+    int fd;
+    int refs;
+    pthread_mutex_t write_lock;
+    TextBuffer pending;         // replies the socket did not take yet
+    char* buffer;
+    size_t length;
+    size_t capacity;
+} ServiceClient;
+
+typedef struct ServiceRequest {
+    struct ServiceRequest* next;
+    ServiceClient* client;
+    char id[SERVICE_ID_LEN];    // echoed back as given (raw JSON)
+    SchedulingAlgorithm algo;
+    int quantum;
+    int detail;
+    Process* processes;
+    int process_count;
+    int64_t received_us;
+} ServiceRequest;
+
+typedef struct {
+    long accepted;
+    long rejected;
+    long invalid;
+    long completed;
+    long batches;
+    long batched_requests;
+    long long processes_simulated;
+    long latency_buckets[SERVICE_LATENCY_BUCKETS];  // by log2 of microseconds
+    double latency_total_us;
+    int64_t latency_max_us;
+} ServiceCounters;
+
+typedef struct {
+    ServiceConfig config;
+    pthread_mutex_t lock;
+    pthread_cond_t ready;
+    ServiceRequest* head;
+    ServiceRequest* tail;
+    int queued;
+    int stopping;
+    int wake_pipe[2];           // workers poke the I/O loop when output is pending
+    int64_t started_us;
+    ServiceCounters counters;
+} Service;
+
+typedef enum {
+    STREAM_EVENTS_ALL,
+    STREAM_EVENTS_COMPLETIONS,
+    STREAM_EVENTS_NONE
+} StreamEvents;
+
+// What a full system does with an arrival
+typedef enum {
+    OVERFLOW_REJECT_NEW,        // turns the arrival away
+    OVERFLOW_DROP_OLDEST,       // sheds the job that has waited longest to make room
+    OVERFLOW_POLICIES
+} OverflowPolicy;
+
+typedef struct {
+    int queue_limit;            // admitted jobs in the system, the one on the CPU included; 0 for no limit
+    OverflowPolicy overflow;
+    double token_rate;          // tokens added per time unit, 0 for no rate limit
+    double token_burst;         // bucket size; the bucket starts full
+} AdmissionConfig;
+
+typedef struct {
+    SchedulingAlgorithm algo;
+    int time_quantum;
+    int64_t window;             // width of the sliding statistics window
+    int64_t report_every;       // time between window reports
+    int max_live;               // arrivals beyond this many unfinished jobs are dropped
+    StreamEvents events;
+    AdmissionConfig admission;
+} StreamConfig;
+
+typedef enum {
+    EXPORT_GANTT,
+    EXPORT_PERFORMANCE
+} ExportChart;
+
+typedef struct {
+    const char* path;           // .png, .svg, .pdf, or .json for trace events
+    ExportChart chart;
+    int width;
+    int height;                 // 0 picks one to suit the chart
+    int tiles;                  // the timeline is split into this many pages or files
+} ExportConfig;
+
+// Streams Chrome trace-event JSON; one visit_gantt_log pass per lane
+typedef struct {
+    FILE* file;
+    long events;
+    double unit_us;             // microseconds per simulated time unit
+    int decimals;               // digits of timestamps after the point, for ticks under 1 us
+    int pid;
+    int tid;
+    const Process* processes;   // the run's table, whose ids name the processes
+    const Process* lifecycle;   // the lane's processes, NULL for no per-process tracks
+    SimTime* cpu_used;          // CPU time each lifecycle process has had so far
+} TraceEventWriter;
+
+// The ways a schedule can be produced besides the reference loops
+typedef enum {
+    VERIFY_EVENT_DRIVEN,
+    VERIFY_RESUME_ADD,          // resumed from a checkpoint after the last process was added
+    VERIFY_RESUME_DELETE,       // resumed from a checkpoint after a process was deleted
+    VERIFY_IO,                  // the I/O engine, on a workload without I/O
+    VERIFY_GROUPS,              // the I/O engine, with groups whose quotas never bind
+    VERIFY_THROTTLING,          // the I/O engine, with binding quotas; checked for invariants
+    VERIFY_LOCKS,               // with resource locks, which only Preemptive Priority honours; checked for invariants
+    VERIFY_ENGINES
+} VerifyEngine;
+
+typedef struct {
+    Process* processes;
+    int count;
+    SchedulingAlgorithm algo;
+    int time_quantum;
+    VerifyEngine engine;
+    SwitchCost cost;
+    int aging_interval;
+    LockProtocol lock_protocol;
+} VerifyCase;
+
+typedef struct {
+    int cases;                  // random workloads, each checked with every algorithm and engine
+    int max_jobs;               // processes in one workload
+    uint64_t seed;
+    SwitchCost cost;            // used for a workload file; random workloads draw their own
+    int aging_interval;         // likewise
+} VerifyConfig;
+
+// One unfinished job; the slot is reused once it completes
+typedef struct {
+    char name[MAX_NAME_LEN];
+    int64_t arrival;
+    int64_t burst;
+    int64_t remaining;
+    int64_t first_run;          // -1 until dispatched
+    int priority;
+    uint64_t seq;               // arrival order, the tie-break
+} StreamJob;
+
+typedef struct {
+    int* items;
+    int head;
+    int count;
+    int capacity;
+} IntRing;
+
+typedef struct {
+    int64_t completed;
+    double turnaround;
+    double waiting;
+    double response;
+    int64_t max_turnaround;
+    int64_t busy;
+    int64_t rejected;
+    int64_t shed;
+} StreamBucket;
+
+typedef struct {
+    StreamConfig config;
+    StreamJob* jobs;
+    int job_capacity;
+    int* free_slots;
+    int free_count;
+    int live;
+    int peak_live;
+    IntRing pending;            // read but not yet arrived, in arrival order
+    IntRing queue;              // Round Robin ready queue
+    int* heap;                  // ready set for the other policies
+    int heap_size;
+    int held;                   // RR job preempted at `now`, requeued after arrivals
+    int64_t now;                // scheduler time
+    int64_t horizon;            // latest arrival read; later input cannot arrive before it
+    uint64_t next_seq;
+    int running;                // job of the open Gantt segment, or -1
+    int64_t segment_start;
+    StreamBucket* buckets;      // ring covering the window, bucket_width units each
+    int bucket_count;
+    int64_t bucket_width;
+    int64_t clock;              // statistics are complete up to here
+    int64_t last_activity;      // last busy time or completion
+    int64_t next_report;
+    StreamBucket total;
+    long arrivals;
+    long late;
+    long dropped;
+    long malformed;
+    double tokens;              // admission: the token bucket's level at token_time
+    int64_t token_time;
+    int64_t wasted;             // CPU time given to jobs that were shed
+    int64_t* departures;        // completion times not yet passed by an admitted arrival
+    int departure_head;
+    int departure_count;
+    int departure_capacity;
+    int64_t latency[STREAM_LATENCY_BUCKETS];    // completed jobs' turnaround, see stream_latency_bucket
+    FILE* out;                  // NULL for none
+} StreamScheduler;
+
+// Plugin hooks whose time is measured, in SchedPluginOps order
+typedef enum {
+    HOOK_INIT,
+    HOOK_ARRIVAL,
+    HOOK_PICK_NEXT,
+    HOOK_SLICE_END,
+    HOOK_COMPLETE,
+    HOOK_FINISH,
+    PLUGIN_HOOKS
+} PluginHook;
+
+// Calls made to a plugin's hooks and the time spent in them
+typedef struct {
+    long calls[PLUGIN_HOOKS];
+    int64_t ns[PLUGIN_HOOKS];
+    long runs;
+    long invalid_picks;
+} PluginTiming;
+
+// A loaded plugin. It runs as algorithm ALGORITHM_COUNT + 1 + its slot.
+typedef struct {
+    void* handle;
+    const SchedPluginOps* ops;
+    PluginTiming timing;        // every run so far, on any thread; under plugin_lock
+} Plugin;
+
+// Loop state of a plugin run
+typedef struct {
+    const SchedPluginOps* ops;
+    void* run;                  // what init returned
+    const int* order;           // process indices by (arrival_time, index)
+    int next;                   // first entry of order not yet arrived
+    unsigned char* ready;       // per process: arrived, not running and not finished
+    int ready_count;
+    ProcessIndex lookup;        // picked id -> process index
+    PluginTiming timing;        // this run only
+} PluginRun;
+
 // Global variables
-Process processes[MAX_PROCESSES];
-GanttBlock gantt_chart[MAX_PROCESSES * 10];
+ProcessTable process_table;     // the processes being edited
+Process processes[MAX_PROCESSES];   // the last run's copy of the table, in table order
+Simulation gui_sim = { processes, 0, NULL, 0, 0, 1, 2, 0, NULL, NULL, { 0, 0, 0 }, -1, 0, 0 };
 int process_count = 0;
-int gantt_count = 0;
 int time_quantum = 2;
-int current_time = 0;
+SwitchCost switch_cost = { 0, 0, 0 };
+IoConfig io_config = { 1, { IO_FCFS } };
+int aging_interval = 0;
+TimeUnit time_unit = TIME_UNIT_NONE;
+GroupConfig group_config = { 0 };
+ResourceTable resource_table = { 0 };
+LockProtocol lock_protocol = LOCK_NONE;
+ResultCache result_cache = { { NULL }, NULL, NULL, 0, RESULT_CACHE_BUDGET, 0, 0, 0, 0 };
+int persist_result_cache = 0;
+int last_run_from_cache = 0;
+SchedulingAlgorithm last_run_algo = FCFS;
+CheckpointLog checkpoint_log;
+IncrementalReport last_incremental;
+
+// Plugins take the entries after the built-in algorithms as they load
+const char* algorithm_keys[ALGORITHM_COUNT + MAX_PLUGINS] = {
+    "fcfs", "sjf", "srtf", "priority", "rr", "preemptive-priority", "stride", "lottery"
+};
+const char* algorithm_names[ALGORITHM_COUNT + MAX_PLUGINS] = {
+    "FCFS", "SJF", "SRTF", "Priority", "Round Robin", "Preemptive Priority", "Stride", "Lottery"
+};
+int algorithm_count = ALGORITHM_COUNT;
+Plugin plugins[MAX_PLUGINS];
+int plugin_count = 0;
+pthread_mutex_t plugin_lock = PTHREAD_MUTEX_INITIALIZER;
+const char* plugin_hook_names[] = { "init", "arrival", "pick_next", "slice_end", "complete", "finish" };
+const char* io_discipline_keys[] = { "fcfs", "sjf", "priority" };
+const char* time_unit_keys[] = { "units", "ns", "us", "ms" };
+const int64_t time_unit_ns[] = { 1, 1, 1000, 1000000 };     // per tick; abstract units have no length
+const char* lock_protocol_keys[] = { "none", "inherit", "ceiling" };
+const char* lock_protocol_names[] = { "No protocol", "Priority inheritance", "Priority ceiling" };
+const char* replication_metric_names[REPLICATION_METRICS] = {
+    "Average Turnaround Time", "Average Waiting Time", "Average Response Time",
+    "Throughput (per 100 units)", "Effective Utilization (%)", "Switch Overhead (%)"
+};
 
 // GTK widgets
 GtkWidget* main_window;
@@ -58,6 +1135,21 @@ GtkWidget* statistics_text_view;
 GtkWidget* algorithm_info_text_view;
 GtkWidget* comparison_text_view;
 GtkListStore* process_list_store;
+GtkWidget* playback_scale;
+GtkWidget* playback_state_label;
+GtkWidget* trace_scroll;
+GtkWidget* trace_text_view;
+
+// Playback
+PlaybackTimeline playback;
+guint playback_source = 0;
+gint64 playback_last_tick = 0;
+double playback_position = 0;
+int playback_slider_guard = 0;
+
+// Trace replay
+TraceReplay trace_replay;
+int trace_replay_active = 0;
 
 // Function prototypes
 void setup_gui();
@@ -68,24 +1160,454 @@ void on_reset_clicked(GtkButton* button, gpointer user_data);
 void on_load_sample_clicked(GtkButton* button, gpointer user_data);
 void on_show_info_clicked(GtkButton* button, gpointer user_data);
 void on_compare_algorithms_clicked(GtkButton* button, gpointer user_data);
+void on_monte_carlo_clicked(GtkButton* button, gpointer user_data);
+void on_import_trace_clicked(GtkButton* button, gpointer user_data);
+void on_export_clicked(GtkButton* button, gpointer user_data);
+void leave_trace_replay();
+void on_persist_cache_toggled(GtkToggleButton* button, gpointer user_data);
+void on_switch_cost_clicked(GtkButton* button, gpointer user_data);
+void on_io_devices_clicked(GtkButton* button, gpointer user_data);
+void on_aging_clicked(GtkButton* button, gpointer user_data);
+void on_time_unit_clicked(GtkButton* button, gpointer user_data);
+void on_groups_clicked(GtkButton* button, gpointer user_data);
+void on_locks_clicked(GtkButton* button, gpointer user_data);
+void on_main_window_destroy(GtkWidget* widget, gpointer user_data);
 gboolean on_gantt_draw(GtkWidget* widget, cairo_t* cr, gpointer user_data);
+void gantt_painter_init(GanttPainter* painter, cairo_t* cr, int y, int height, double origin, double time_scale);
+void flush_gantt_column(GanttPainter* painter);
+void draw_gantt_blocks(GanttPainter* painter, const GanttBlock* blocks, int count);
+void draw_gantt_chunk(const GanttBlock* blocks, int count, void* data);
+void draw_gantt_log(GanttPainter* painter, const GanttSpill* spill, const GanttBlock* blocks, int count);
+void draw_gantt_lane(cairo_t* cr, const GanttSpill* spill, const GanttBlock* blocks, int count,
+    double from, double to, int y, int lane_height, int chart_width);
+void render_gantt_chart(cairo_t* cr, const Simulation* sim, const char* title, double from, double to,
+    int width, int height);
+int gantt_chart_height(const Simulation* sim);
+SimTime trace_replay_end(const TraceReplay* tr);
+void render_trace_gantt(cairo_t* cr, const TraceReplay* tr, double from, double to, int width, int height);
+void on_playback_play_clicked(GtkButton* button, gpointer user_data);
+void on_playback_pause_clicked(GtkButton* button, gpointer user_data);
+void on_playback_step_clicked(GtkButton* button, gpointer user_data);
+void on_playback_scale_changed(GtkRange* range, gpointer user_data);
+gboolean on_playback_tick(gpointer user_data);
+void stop_playback();
+void clear_playback();
+void refresh_playback(SimTime previous_time);
+void reload_playback();
 gboolean on_performance_draw(GtkWidget* widget, cairo_t* cr, gpointer user_data);
+void render_performance_chart(cairo_t* cr, const Process* procs, int count, int width, int height);
 void update_process_list();
+void append_process_row(const Process* p);
 void update_statistics();
 void simulate_scheduling(SchedulingAlgorithm algo);
-void fcfs_scheduling();
-void sjf_scheduling();
-void srtf_scheduling();
-void priority_scheduling();
-void round_robin_scheduling();
-void preemptive_priority_scheduling();
-void calculate_times();
+void store_run_results();
+void run_scheduler(Simulation* sim, SchedulingAlgorithm algo);
+void fcfs_scheduling(Simulation* sim);
+void sjf_scheduling(Simulation* sim);
+void srtf_scheduling(Simulation* sim);
+void priority_scheduling(Simulation* sim);
+void round_robin_scheduling(Simulation* sim);
+void preemptive_priority_scheduling(Simulation* sim);
+void stride_scheduling(Simulation* sim);
+void lottery_scheduling(Simulation* sim);
+void calculate_times(Simulation* sim);
 void reset_simulation();
 void load_sample_processes();
 void assign_process_colors();
 void show_algorithm_info(SchedulingAlgorithm algo);
 void compare_algorithms();
 
+// Simulation helpers
+void init_simulation(Simulation* sim, Process* procs, int count, int quantum);
+void reset_process_state(Process* procs, int count);
+void free_simulation(Simulation* sim);
+void add_gantt_block(Simulation* sim, const Process* p, SimTime start, SimTime end, int overhead);
+int extends_last_block(const Simulation* sim, const Process* p);
+int switch_overhead(Simulation* sim, int index);
+SimTime aged_priority(const Simulation* sim, const Process* p);
+int process_weight(const Process* p);
+int process_stride(const Process* p);
+void begin_run(Simulation* sim);
+void summarize_switching(const Simulation* sim, SwitchSummary* out);
+
+// Process ids
+uint32_t hash_name(const char* name);
+uint32_t process_bucket(const ProcessIndex* index, const Process* p, int by_name);
+void process_index_free(ProcessIndex* index);
+void process_index_put(ProcessIndex* index, const Process* procs, int pos);
+void process_index_resize(ProcessIndex* index, const Process* procs, int bucket_count);
+void process_index_build(ProcessIndex* index, const Process* procs, int count);
+void process_index_add(ProcessIndex* index, const Process* procs, int pos);
+void process_index_unlink(ProcessIndex* index, const Process* procs, int* buckets, uint32_t b, int by_name);
+void process_index_delete(ProcessIndex* index, const Process* procs, int pos);
+int process_index_find_id(const ProcessIndex* index, const Process* procs, int id);
+int process_index_find_name(const ProcessIndex* index, const Process* procs, const char* name);
+void process_table_clear(ProcessTable* table);
+int process_table_add(ProcessTable* table, const Process* p);
+int process_table_delete(ProcessTable* table, int id);
+Process* process_table_find(ProcessTable* table, int id);
+Process* process_table_find_name(ProcessTable* table, const char* name);
+int process_table_pack(const ProcessTable* table, Process* out);
+void format_switch_summary(const Simulation* sim, char* out, size_t out_len);
+int* build_arrival_order(const Process* procs, int count);
+const int* simulation_arrival_order(Simulation* sim);
+void invalidate_arrival_order(Simulation* sim);
+
+// Gantt spill
+GanttSpill* gantt_spill_create();
+void gantt_spill_free(GanttSpill* spill);
+void gantt_spill_chunk(GanttSpill* spill, GanttBlock* blocks, int* count);
+long gantt_log_length(const GanttSpill* spill, int count);
+void visit_gantt_log(const GanttSpill* spill, const GanttBlock* blocks, int count, double from, double to,
+    void (*visit)(const GanttBlock* blocks, int count, void* data), void* data);
+
+// Event-driven engines for large workloads
+int compare_int64(const void* a, const void* b);
+int compare_int(const void* a, const void* b);
+int compare_double(const void* a, const void* b);
+SchedKey make_key(SimTime primary, int index);
+int key_index(SchedKey key);
+SimTime key_primary(SchedKey key);
+int compare_key(const void* a, const void* b);
+void heap_push(SchedKey* heap, int* size, SchedKey key);
+SchedKey heap_pop(SchedKey* heap, int* size);
+SchedKey scheduling_key(const Simulation* sim, const Process* p, int index, SchedulingAlgorithm algo);
+SimTime aging_preemption_time(const Simulation* sim, const SchedKey* heap, int heap_size, const Process* p, int index);
+SchedKey preempted_key(const Simulation* sim, const SchedKey* heap, int heap_size, const Process* p, int index,
+    SchedKey key);
+void run_fast_scheduler(Simulation* sim, SchedulingAlgorithm algo);
+void engine_init(EngineState* state, Simulation* sim);
+void engine_free(EngineState* state);
+void run_engine(Simulation* sim, SchedulingAlgorithm algo, EngineState* state, CheckpointLog* log);
+void enqueue_arrivals(Simulation* sim, EngineState* state);
+void fast_fcfs_scheduling(Simulation* sim, EngineState* state, CheckpointLog* log);
+void fast_sjf_scheduling(Simulation* sim, EngineState* state, CheckpointLog* log);
+void fast_priority_scheduling(Simulation* sim, EngineState* state, CheckpointLog* log);
+void fast_srtf_scheduling(Simulation* sim, EngineState* state, CheckpointLog* log);
+void fast_preemptive_priority_scheduling(Simulation* sim, EngineState* state, CheckpointLog* log);
+void fast_round_robin_scheduling(Simulation* sim, EngineState* state, CheckpointLog* log);
+int run_bench(const ReplicationConfig* config, const char* workload_path, int runs);
+
+// Proportional share
+int proportional_share(SchedulingAlgorithm algo);
+void stride_rebase(SchedKey* heap, int heap_size, int64_t shift);
+void fast_stride_scheduling(Simulation* sim, EngineState* state);
+void fenwick_add(int64_t* tree, int n, int row, int64_t amount);
+int fenwick_find(const int64_t* tree, int n, int64_t ticket);
+void fast_lottery_scheduling(Simulation* sim, EngineState* state);
+int compare_share_events(const void* a, const void* b);
+void add_share_block(const GanttBlock* blocks, int count, void* data);
+void format_share_report(const Simulation* sim, SchedulingAlgorithm algo, int window, char* out, size_t out_len);
+int run_share_report(const ReplicationConfig* config, const char* workload_path, int window);
+
+// Scheduler plugins
+int load_plugin(const char* path, char* error, size_t error_len);
+int load_plugins_from_args(int* argc, char* argv[]);
+Plugin* algorithm_plugin(SchedulingAlgorithm algo);
+int64_t plugin_clock();
+void plugin_view(const Process* p, int index, SchedPluginProcess* view);
+void plugin_admit(Simulation* sim, PluginRun* pr);
+void run_plugin_scheduler(Simulation* sim, Plugin* plugin);
+void format_plugin_timing(Plugin* plugin, char* out, size_t out_len);
+void format_plugin_comparison(const Process* procs, int count, int quantum, const SwitchCost* cost,
+    char* out, size_t out_len);
+int run_plugin_compare(const ReplicationConfig* config, const char* workload_path);
+int run_plugin_match(const ReplicationConfig* config, const char* workload_path, SchedulingAlgorithm expected);
+
+// Time units
+SimTime parse_time(const char* text, char** end);
+void format_time(double t, int decimals, char* out, size_t out_len);
+
+// I/O bursts and devices
+int parse_burst_sequence(const char* text, Process* p);
+int parse_io_devices(const char* text, IoConfig* out);
+void format_io_devices(const IoConfig* io, int device_count, char* out, size_t out_len);
+IoDiscipline io_discipline(const IoConfig* io, int device);
+int workload_has_io(const Process* procs, int count);
+SimTime io_total(const Process* p);
+SimTime cpu_burst_left(const Process* p);
+void io_log_free(IoLog* log);
+void io_log_span(IoLog* log, SimTime start, SimTime end, int device);
+int compare_io_edges(const void* a, const void* b);
+void io_log_finish(IoLog* log, const Simulation* sim);
+SchedKey io_ready_key(const Simulation* sim, const Process* p, int index, SchedulingAlgorithm algo, SimTime time);
+void io_sets_init(IoEngine* e);
+void io_sets_free(IoEngine* e);
+SimTime io_blocked_area(const ReadySet* set, SimTime time);
+void io_mark_ready(IoEngine* e, int index, SimTime time);
+void io_update_blocked(IoEngine* e, SimTime time);
+void io_sync_sets(IoEngine* e);
+void io_enqueue(IoEngine* e, int index, SchedKey key);
+void io_make_ready(IoEngine* e, int index, SimTime time);
+int io_best_set(const IoEngine* e);
+int io_pick(IoEngine* e);
+void io_stride_advance(IoEngine* e, int index, SimTime ran);
+void io_refresh_period(ReadySet* set, const CpuGroup* group, SimTime time);
+SimTime io_budget_end(IoEngine* e, int index, SimTime now);
+void io_throttle(IoEngine* e, int group, SimTime time);
+void io_release(IoEngine* e, int group, SimTime time);
+void io_charge(IoEngine* e, int index, SimTime from, SimTime to);
+void io_start_request(IoEngine* e, int device, SimTime time);
+void io_issue(IoEngine* e, int index);
+void io_advance_devices(IoEngine* e, SimTime now);
+void io_admit(IoEngine* e);
+SimTime io_next_event(const IoEngine* e);
+void io_end_burst(IoEngine* e, int index);
+void io_scheduling(Simulation* sim, SchedulingAlgorithm algo);
+void run_io_scheduler(Simulation* sim, SchedulingAlgorithm algo);
+void format_io_summary(const Simulation* sim, char* out, size_t out_len);
+void format_io_comparison(const Process* procs, int count, int quantum, const SwitchCost* cost,
+    const IoConfig* io, char* out, size_t out_len);
+int run_io_compare(const ReplicationConfig* config, const char* workload_path);
+
+// CPU bandwidth groups
+int find_group(const GroupConfig* groups, const char* path);
+int group_within(const GroupConfig* groups, int group, int ancestor);
+int process_group(const Simulation* sim, const Process* p);
+int workload_has_groups(const Simulation* sim);
+int parse_group(const char* line, GroupConfig* groups, char* error, size_t error_len);
+int parse_groups(const char* text, GroupConfig* out, char* error, size_t error_len);
+void format_groups(const GroupConfig* groups, char* out, size_t out_len);
+void group_log_free(GroupLog* log);
+void group_log_span(GroupLog* log, SimTime start, SimTime end, int group);
+void add_group_blocks(const GanttBlock* blocks, int count, void* data);
+void group_log_finish(GroupLog* log, const Simulation* sim);
+void format_group_report(const Simulation* sim, SchedulingAlgorithm algo, char* out, size_t out_len);
+int run_group_report(const ReplicationConfig* config, const char* workload_path);
+
+// Shared resources and priority inversion
+int find_resource(const ResourceTable* resources, const char* name);
+int parse_lock_spans(const char* text, Process* p, ResourceTable* resources, char* error, size_t error_len);
+int parse_process_bursts(const char* text, Process* p, ResourceTable* resources, char* error, size_t error_len);
+void format_lock_spans(const Process* p, const ResourceTable* resources, char* out, size_t out_len);
+int workload_has_locks(const Process* procs, int count);
+int locks_apply(const Simulation* sim, SchedulingAlgorithm algo);
+void lock_log_free(LockLog* log);
+void lock_state_init(LockState* locks, Simulation* sim);
+void lock_state_free(LockState* locks);
+void lock_update(LockState* locks, const SimTime* own, const int* active);
+void lock_acquire(LockState* locks, int index, SimTime time);
+void lock_release(LockState* locks, int index, SimTime time);
+void lock_account(LockState* locks, int runner, SimTime from, SimTime to);
+void lock_waits_describe(const Simulation* sim, const LockWait* wait, char* out, size_t out_len);
+int compare_lock_waits(const void* a, const void* b);
+void sum_lock_waits(const LockLog* log, long* wait, long* inverted, long* unbounded, int* depth);
+void format_lock_report(const Simulation* sim, char* out, size_t out_len);
+int run_lock_report(const ReplicationConfig* config, const char* workload_path);
+
+// Starvation aging
+void measure_waiting_tail(const Process* procs, int count, TailLatency* out);
+void format_tail_latency(const Simulation* sim, char* out, size_t out_len);
+void format_aging_sweep(const Process* procs, int count, const SwitchCost* cost, char* out, size_t out_len);
+int run_aging_sweep(const ReplicationConfig* config, const char* workload_path);
+
+// Incremental re-simulation
+void checkpoint_free(Checkpoint* cp);
+void checkpoint_log_reset(CheckpointLog* log);
+void checkpoint_log_start(CheckpointLog* log, const Simulation* sim, SchedulingAlgorithm algo);
+void record_checkpoint(CheckpointLog* log, const Simulation* sim, const EngineState* state);
+void checkpoint_log_finish(CheckpointLog* log, const Simulation* sim, const EngineState* state);
+SimTime match_run_processes(const CheckpointLog* log, const Simulation* sim, int* index_map);
+void remap_checkpoint(Checkpoint* cp, const int* index_map, SchedulingAlgorithm algo);
+int find_resume_checkpoint(const CheckpointLog* log, const Simulation* sim, SchedulingAlgorithm algo);
+void restore_checkpoint(Simulation* sim, EngineState* state, CheckpointLog* log, int which);
+void run_incremental(Simulation* sim, SchedulingAlgorithm algo, CheckpointLog* log, IncrementalReport* report);
+
+// Monte Carlo replication
+uint64_t splitmix64(uint64_t* state);
+void rng_seed(RngState* rng, uint64_t seed, uint64_t stream);
+uint64_t rng_next(RngState* rng);
+double rng_uniform(RngState* rng);
+double rng_exponential(RngState* rng, double mean);
+void generate_workload(Process* out, int count, RngState* rng, const ReplicationConfig* config);
+void generate_process(Process* p, int i, double* clock, RngState* rng, const ReplicationConfig* config);
+void running_stat_add(RunningStat* stat, double value);
+void running_stat_merge(RunningStat* into, const RunningStat* from);
+double t_critical_95(long samples);
+void* replication_worker(void* arg);
+int run_replications(const ReplicationConfig* config, ReplicationResult* result);
+void format_replication_report(const ReplicationConfig* config, const ReplicationResult* result,
+    char* out, size_t out_len);
+int default_thread_count();
+int algorithm_from_key(const char* key);
+
+// Autotuner
+SimTime nearest_rank(SimTime* values, int count, double q);
+void tune_evaluate(const TunePool* pool, TuneCandidate* candidate, Process* scratch);
+void* tune_worker(void* arg);
+void tune_run_rung(TunePool* pool, int threads);
+int tune_sample(TuneCandidate* out, const TuneCandidate* taken, int count, RngState* rng);
+int tune_better(const TuneCandidate* a, const TuneCandidate* b, const TuneConfig* tune);
+void tune_describe(const TuneCandidate* c, char* out, size_t out_len);
+int run_tune(const ReplicationConfig* config, const TuneConfig* tune, const char* workload_path);
+
+// Queueing model
+double elapsed_seconds(const struct timespec* since);
+void format_duration(double seconds, char* out, size_t out_len);
+void queue_fit(const SimTime* arrival, const SimTime* service, int count, QueueFit* fit);
+void queue_family(double scv, char* out, size_t out_len);
+double estimate_pk(const QueueFit* fit);
+double estimate_kingman(const QueueFit* fit);
+double estimate_ps(const QueueFit* fit);
+double estimate_srpt(const QueueFit* fit, SimTime* sizes, int count);
+double kingman_theta(const SimTime* arrival, const SimTime* service, int count);
+void format_queue_estimates(const SimTime* arrival, const SimTime* service, int count, const Process* procs,
+    int quantum, const SwitchCost* cost, char* out, size_t out_len);
+void format_queueing_model(const Process* procs, int count, int quantum, const SwitchCost* cost,
+    int simulate, char* out, size_t out_len);
+int run_estimate(const ReplicationConfig* config, const char* workload_path, int simulate);
+
+// Result cache
+void snapshot_workload(const Process* procs, int count, WorkloadEntry* out);
+uint64_t hash_workload(const WorkloadEntry* input, int count);
+CacheEntry* cache_lookup(ResultCache* cache, const WorkloadEntry* input, int count,
+    SchedulingAlgorithm algo, int quantum, const SwitchCost* cost, int aging);
+void cache_store(ResultCache* cache, const WorkloadEntry* input, SchedulingAlgorithm algo,
+    int quantum, const Simulation* sim);
+void cache_unlink(ResultCache* cache, CacheEntry* entry);
+void cache_push_front(ResultCache* cache, CacheEntry* entry);
+void cache_remove(ResultCache* cache, CacheEntry* entry);
+void cache_free_entry(CacheEntry* entry);
+void cache_clear(ResultCache* cache);
+int cache_save(const ResultCache* cache, const char* path);
+int cache_load(ResultCache* cache, const char* path);
+void result_cache_path(char* out, size_t out_len);
+void copy_gantt(Simulation* sim, const GanttBlock* blocks, int count);
+void copy_process_results(Process* dst, const Process* src);
+
+// Playback timeline
+int compare_playback_events(const void* a, const void* b);
+void playback_ready_add(PlaybackTimeline* tl, int index);
+void playback_ready_remove(PlaybackTimeline* tl, int index);
+void playback_apply_event(PlaybackTimeline* tl, const PlaybackEvent* e);
+void playback_take_snapshot(PlaybackTimeline* tl);
+void playback_restore_snapshot(PlaybackTimeline* tl, const PlaybackSnapshot* snap);
+void playback_free(PlaybackTimeline* tl);
+void build_playback_timeline(PlaybackTimeline* tl, const Process* procs, int count,
+    const GanttBlock* gantt, int gantt_count);
+int playback_advance(PlaybackTimeline* tl, SimTime target, long max_events);
+void playback_seek(PlaybackTimeline* tl, SimTime target);
+SimTime playback_next_event_time(const PlaybackTimeline* tl);
+void format_playback_state(const PlaybackTimeline* tl, char* out, size_t out_len);
+
+// Trace import
+int trace_parse_timestamp(const char* text, int64_t* out_us);
+int trace_find_task(TraceReplay* tr, int pid, const char* comm);
+int trace_priority(int kernel_prio);
+SimTime trace_ticks(const TraceReplay* tr, int64_t us);
+int trace_open_job(TraceReplay* tr, int task, int64_t arrival_us, int64_t run_us);
+void trace_add_slice(TraceReplay* tr, int task, int64_t start_us, int64_t end_us);
+void trace_close_job(TraceReplay* tr, int task);
+int trace_accept_time(TraceReplay* tr, int64_t t_us);
+int trace_field(const char* line, const char* key, char* out, size_t out_len);
+int parse_perf_timehist_line(TraceReplay* tr, const char* line);
+int parse_ftrace_line(TraceReplay* tr, const char* line);
+int import_trace(TraceReplay* tr, const char* path, const TraceConfig* config, char* error, size_t error_len);
+void replay_trace(TraceReplay* tr, SchedulingAlgorithm algo, int quantum);
+int compare_trace_tasks(const void* a, const void* b);
+void format_trace_report(const TraceReplay* tr, char* out, size_t out_len);
+void trace_replay_free(TraceReplay* tr);
+
+// Service mode
+int64_t monotonic_us();
+void text_append(TextBuffer* text, const char* format, ...);
+void json_append_string(TextBuffer* text, const char* value);
+void json_skip_space(JsonReader* json);
+int json_consume(JsonReader* json, char c);
+int json_read_string(JsonReader* json, char* out, size_t out_len);
+int json_read_number(JsonReader* json, double* out);
+int json_read_time(JsonReader* json, SimTime* out);
+int json_skip_value(JsonReader* json);
+int json_read_process(JsonReader* json, Process* p, int index);
+int parse_service_request(const char* line, size_t length, const ServiceConfig* config,
+    ServiceRequest* request, char* error, size_t error_len);
+void format_service_result(const ServiceRequest* request, const Simulation* sim, int64_t latency_us, TextBuffer* out);
+void format_service_stats(Service* service, TextBuffer* out);
+void service_send(Service* service, ServiceClient* client, const char* data, size_t length);
+void service_send_error(Service* service, ServiceClient* client, const char* id, const char* error);
+int service_flush_client(ServiceClient* client);
+void service_release_client(Service* service, ServiceClient* client);
+void service_record_latency(ServiceCounters* counters, int64_t latency_us);
+void* service_worker(void* arg);
+void service_handle_line(Service* service, ServiceClient* client, const char* line, size_t length);
+int service_read_client(Service* service, ServiceClient* client);
+void on_service_signal(int signum);
+int run_service(const ServiceConfig* config);
+
+// Online streaming
+void int_ring_push(IntRing* ring, int value);
+int int_ring_pop(IntRing* ring);
+int int_ring_front(const IntRing* ring);
+int64_t stream_bucket_width(int64_t window, int64_t report_every);
+void stream_init(StreamScheduler* s, const StreamConfig* config, FILE* out);
+void stream_free(StreamScheduler* s);
+StreamBucket* stream_bucket(StreamScheduler* s, int64_t t);
+int stream_before(const StreamScheduler* s, int a, int b);
+void stream_heap_push(StreamScheduler* s, int slot);
+int stream_heap_pop(StreamScheduler* s);
+void stream_make_ready(StreamScheduler* s, int slot);
+void stream_bucket_add(StreamBucket* into, const StreamBucket* from);
+void stream_report(StreamScheduler* s, int64_t at);
+void stream_advance_clock(StreamScheduler* s, int64_t to, int busy);
+void stream_close_segment(StreamScheduler* s);
+void stream_run(StreamScheduler* s, int slot, int64_t until);
+void stream_complete(StreamScheduler* s, int slot);
+int stream_submit(StreamScheduler* s, const char* name, int64_t arrival, int64_t burst, int priority);
+void stream_advance(StreamScheduler* s, int final);
+int stream_read_line(StreamScheduler* s, char* line);
+void format_stream_summary(StreamScheduler* s, FILE* out);
+int run_stream(const StreamConfig* config, const char* path);
+
+// Admission control
+int stream_admit(StreamScheduler* s, int slot);
+void stream_turn_away(StreamScheduler* s, int slot, const char* reason);
+int stream_shed_oldest(StreamScheduler* s, int64_t time);
+void stream_note_departure(StreamScheduler* s);
+void stream_heap_remove(StreamScheduler* s, int position);
+int stream_latency_bucket(int64_t value);
+int64_t stream_latency_percentile(const StreamScheduler* s, double q);
+void stream_workload(StreamScheduler* s, const Process* procs, int count);
+void format_admission_sweep(const Process* procs, int count, const StreamConfig* config, char* out, size_t out_len);
+int run_admission_sweep(const ReplicationConfig* replication, const StreamConfig* config, const char* workload_path);
+
+// Chart export
+int load_workload(const char* path, Process** out, int* count, GroupConfig* groups, ResourceTable* resources,
+    char* error, size_t error_len);
+void export_tile_path(const char* path, int tile, int tiles, char* out, size_t out_len);
+void render_export_page(cairo_t* cr, const ExportConfig* config, const Simulation* sim,
+    const TraceReplay* tr, int tile, int width, int height);
+int export_chart(const ExportConfig* config, const Simulation* sim, const TraceReplay* tr,
+    char* error, size_t error_len);
+int run_export(const ExportConfig* config, const ReplicationConfig* replication, const char* trace_path,
+    const TraceConfig* trace_config, const char* workload_path);
+
+// Trace-event export
+void json_write_string(FILE* file, const char* value);
+void trace_event_begin(TraceEventWriter* w);
+void trace_event_metadata(TraceEventWriter* w, int pid, int tid, const char* kind, const char* name);
+void write_trace_event_blocks(const GanttBlock* blocks, int count, void* data);
+void write_process_lifecycle(TraceEventWriter* w, const Process* processes, int count);
+int export_trace_events(const char* path, const Simulation* sim, SchedulingAlgorithm algo,
+    const TraceReplay* tr, char* error, size_t error_len);
+
+// Differential checking
+void generate_verify_workload(Process* out, int count, RngState* rng);
+void verify_groups(const VerifyCase* c, Process* procs, GroupConfig* groups);
+void run_reference(const VerifyCase* c, Simulation* sim);
+void run_verify_engine(const VerifyCase* c, Simulation* sim);
+int compare_schedules(const Simulation* expected, const Simulation* actual, char* diff, size_t diff_len);
+int check_throttling(const Simulation* sim, char* diff, size_t diff_len);
+void verify_locks(const VerifyCase* c, Process* procs, ResourceTable* resources);
+int check_locking(const Simulation* sim, char* diff, size_t diff_len);
+int verify_case(const VerifyCase* c, char* diff, size_t diff_len);
+void shrink_verify_case(VerifyCase* c);
+void format_verify_case(const VerifyCase* c, FILE* out);
+int run_verify(const VerifyConfig* config, const char* workload_path);
+
+// Headless mode
+int headless_mode_requested(int argc, char* argv[]);
+int run_headless(int argc, char* argv[]);
+
 // Color palette for processes
 GdkRGBA process_colors[] = {
     {0.8, 0.2, 0.2, 1.0}, // Red
@@ -101,9 +1623,17 @@ GdkRGBA process_colors[] = {
 };
 
 int main(int argc, char* argv[]) {
+    if (!load_plugins_from_args(&argc, argv)) {
+        return 1;
+    }
+    if (headless_mode_requested(argc, argv)) {
+        return run_headless(argc, argv);
+    }
+
     gtk_init(&argc, &argv);
     srand(time(NULL));
 
+    process_table_clear(&process_table);
     setup_gui();
     assign_process_colors();
 
@@ -119,7 +1649,7 @@ void setup_gui() {
     gtk_window_set_title(GTK_WINDOW(main_window), "CPU Scheduling Simulator");
     gtk_window_set_default_size(GTK_WINDOW(main_window), 1200, 800);
     gtk_container_set_border_width(GTK_CONTAINER(main_window), 10);
-    g_signal_connect(main_window, "destroy", G_CALLBACK(gtk_main_quit), NULL);
+    g_signal_connect(main_window, "destroy", G_CALLBACK(on_main_window_destroy), NULL);
 
     // Main container
     GtkWidget* main_box = gtk_box_new(GTK_ORIENTATION_VERTICAL, 5);
@@ -141,6 +1671,9 @@ void setup_gui() {
     GtkWidget* reset_btn = gtk_button_new_with_label("Reset");
     GtkWidget* info_btn = gtk_button_new_with_label("Algorithm Information");
     GtkWidget* compare_btn = gtk_button_new_with_label("Compare Algorithms");
+    GtkWidget* monte_carlo_btn = gtk_button_new_with_label("Monte Carlo");
+    GtkWidget* trace_btn = gtk_button_new_with_label("Import Trace");
+    GtkWidget* export_btn = gtk_button_new_with_label("Export");
     // Set button colors to grey
     GtkCssProvider* css_provider = gtk_css_provider_new();
     gtk_css_provider_load_from_data(css_provider,
@@ -164,12 +1697,24 @@ void setup_gui() {
 
     context = gtk_widget_get_style_context(compare_btn);
     gtk_style_context_add_provider(context, GTK_STYLE_PROVIDER(css_provider), GTK_STYLE_PROVIDER_PRIORITY_USER);
+
+    context = gtk_widget_get_style_context(monte_carlo_btn);
+    gtk_style_context_add_provider(context, GTK_STYLE_PROVIDER(css_provider), GTK_STYLE_PROVIDER_PRIORITY_USER);
+
+    context = gtk_widget_get_style_context(trace_btn);
+    gtk_style_context_add_provider(context, GTK_STYLE_PROVIDER(css_provider), GTK_STYLE_PROVIDER_PRIORITY_USER);
+
+    context = gtk_widget_get_style_context(export_btn);
+    gtk_style_context_add_provider(context, GTK_STYLE_PROVIDER(css_provider), GTK_STYLE_PROVIDER_PRIORITY_USER);
     gtk_box_pack_start(GTK_BOX(button_box), add_btn, FALSE, FALSE, 5);
     gtk_box_pack_start(GTK_BOX(button_box), delete_btn, FALSE, FALSE, 5);
     gtk_box_pack_start(GTK_BOX(button_box), sample_btn, FALSE, FALSE, 5);
     gtk_box_pack_start(GTK_BOX(button_box), reset_btn, FALSE, FALSE, 5);
     gtk_box_pack_start(GTK_BOX(button_box), info_btn, FALSE, FALSE, 5);
     gtk_box_pack_start(GTK_BOX(button_box), compare_btn, FALSE, FALSE, 5);
+    gtk_box_pack_start(GTK_BOX(button_box), monte_carlo_btn, FALSE, FALSE, 5);
+    gtk_box_pack_start(GTK_BOX(button_box), trace_btn, FALSE, FALSE, 5);
+    gtk_box_pack_start(GTK_BOX(button_box), export_btn, FALSE, FALSE, 5);
 
     g_signal_connect(add_btn, "clicked", G_CALLBACK(on_add_process_clicked), NULL);
     g_signal_connect(delete_btn, "clicked", G_CALLBACK(on_delete_process_clicked), NULL);
@@ -177,6 +1722,9 @@ void setup_gui() {
     g_signal_connect(reset_btn, "clicked", G_CALLBACK(on_reset_clicked), NULL);
     g_signal_connect(info_btn, "clicked", G_CALLBACK(on_show_info_clicked), NULL);
     g_signal_connect(compare_btn, "clicked", G_CALLBACK(on_compare_algorithms_clicked), NULL);
+    g_signal_connect(monte_carlo_btn, "clicked", G_CALLBACK(on_monte_carlo_clicked), NULL);
+    g_signal_connect(trace_btn, "clicked", G_CALLBACK(on_import_trace_clicked), NULL);
+    g_signal_connect(export_btn, "clicked", G_CALLBACK(on_export_clicked), NULL);
 
     // Algorithm selection
     GtkWidget* algo_box = gtk_box_new(GTK_ORIENTATION_HORIZONTAL, 5);
@@ -185,9 +1733,8 @@ void setup_gui() {
     GtkWidget* algo_label = gtk_label_new("Algorithm:");
     gtk_box_pack_start(GTK_BOX(algo_box), algo_label, FALSE, FALSE, 5);
 
-    const char* algorithms[] = { "FCFS", "SJF", "SRTF", "Priority", "Round Robin", "Preemptive Priority" };
-    for (int i = 0; i < 6; i++) {
-        GtkWidget* algo_btn = gtk_button_new_with_label(algorithms[i]);
+    for (int i = 0; i < algorithm_count; i++) {
+        GtkWidget* algo_btn = gtk_button_new_with_label(algorithm_names[i]);
         // Set algorithm button color to grey
         context = gtk_widget_get_style_context(algo_btn);
         gtk_style_context_add_provider(context, GTK_STYLE_PROVIDER(css_provider), GTK_STYLE_PROVIDER_PRIORITY_USER);
@@ -196,6 +1743,46 @@ void setup_gui() {
         g_signal_connect(algo_btn, "clicked", G_CALLBACK(on_run_algorithm_clicked), GINT_TO_POINTER(i + 1));
     }
 
+    GtkWidget* persist_check = gtk_check_button_new_with_label("Persist Cache");
+    gtk_box_pack_start(GTK_BOX(algo_box), persist_check, FALSE, FALSE, 10);
+    g_signal_connect(persist_check, "toggled", G_CALLBACK(on_persist_cache_toggled), NULL);
+
+    GtkWidget* switch_cost_btn = gtk_button_new_with_label("Switch Cost");
+    context = gtk_widget_get_style_context(switch_cost_btn);
+    gtk_style_context_add_provider(context, GTK_STYLE_PROVIDER(css_provider), GTK_STYLE_PROVIDER_PRIORITY_USER);
+    gtk_box_pack_start(GTK_BOX(algo_box), switch_cost_btn, FALSE, FALSE, 5);
+    g_signal_connect(switch_cost_btn, "clicked", G_CALLBACK(on_switch_cost_clicked), NULL);
+
+    GtkWidget* io_devices_btn = gtk_button_new_with_label("I/O Devices");
+    context = gtk_widget_get_style_context(io_devices_btn);
+    gtk_style_context_add_provider(context, GTK_STYLE_PROVIDER(css_provider), GTK_STYLE_PROVIDER_PRIORITY_USER);
+    gtk_box_pack_start(GTK_BOX(algo_box), io_devices_btn, FALSE, FALSE, 5);
+    g_signal_connect(io_devices_btn, "clicked", G_CALLBACK(on_io_devices_clicked), NULL);
+
+    GtkWidget* aging_btn = gtk_button_new_with_label("Aging");
+    context = gtk_widget_get_style_context(aging_btn);
+    gtk_style_context_add_provider(context, GTK_STYLE_PROVIDER(css_provider), GTK_STYLE_PROVIDER_PRIORITY_USER);
+    gtk_box_pack_start(GTK_BOX(algo_box), aging_btn, FALSE, FALSE, 5);
+    g_signal_connect(aging_btn, "clicked", G_CALLBACK(on_aging_clicked), NULL);
+
+    GtkWidget* time_unit_btn = gtk_button_new_with_label("Time Unit");
+    context = gtk_widget_get_style_context(time_unit_btn);
+    gtk_style_context_add_provider(context, GTK_STYLE_PROVIDER(css_provider), GTK_STYLE_PROVIDER_PRIORITY_USER);
+    gtk_box_pack_start(GTK_BOX(algo_box), time_unit_btn, FALSE, FALSE, 5);
+    g_signal_connect(time_unit_btn, "clicked", G_CALLBACK(on_time_unit_clicked), NULL);
+
+    GtkWidget* groups_btn = gtk_button_new_with_label("Groups");
+    context = gtk_widget_get_style_context(groups_btn);
+    gtk_style_context_add_provider(context, GTK_STYLE_PROVIDER(css_provider), GTK_STYLE_PROVIDER_PRIORITY_USER);
+    gtk_box_pack_start(GTK_BOX(algo_box), groups_btn, FALSE, FALSE, 5);
+    g_signal_connect(groups_btn, "clicked", G_CALLBACK(on_groups_clicked), NULL);
+
+    GtkWidget* locks_btn = gtk_button_new_with_label("Locks");
+    context = gtk_widget_get_style_context(locks_btn);
+    gtk_style_context_add_provider(context, GTK_STYLE_PROVIDER(css_provider), GTK_STYLE_PROVIDER_PRIORITY_USER);
+    gtk_box_pack_start(GTK_BOX(algo_box), locks_btn, FALSE, FALSE, 5);
+    g_signal_connect(locks_btn, "clicked", G_CALLBACK(on_locks_clicked), NULL);
+
     // Notebook for tabs
     notebook = gtk_notebook_new();
     gtk_box_pack_start(GTK_BOX(main_box), notebook, TRUE, TRUE, 5);
@@ -205,12 +1792,14 @@ void setup_gui() {
     gtk_scrolled_window_set_policy(GTK_SCROLLED_WINDOW(process_tab),
         GTK_POLICY_AUTOMATIC, GTK_POLICY_AUTOMATIC);
 
-    process_list_store = gtk_list_store_new(7, G_TYPE_STRING, G_TYPE_INT, G_TYPE_INT,
-        G_TYPE_INT, G_TYPE_INT, G_TYPE_INT, G_TYPE_INT);
+    process_list_store = gtk_list_store_new(12, G_TYPE_INT, G_TYPE_STRING, G_TYPE_INT64, G_TYPE_INT64,
+        G_TYPE_INT64, G_TYPE_INT, G_TYPE_INT, G_TYPE_STRING, G_TYPE_STRING, G_TYPE_INT64, G_TYPE_INT64, G_TYPE_INT64);
     process_list_view = gtk_tree_view_new_with_model(GTK_TREE_MODEL(process_list_store));
 
-    const char* column_titles[] = { "Process", "Arrival", "Burst", "Priority", "Start", "Complete", "TAT" };
-    for (int i = 0; i < 7; i++) {
+    const char* column_titles[] = {
+        "ID", "Process", "Arrival", "Burst", "I/O", "Priority", "Weight", "Group", "Locks", "Start", "Complete", "TAT"
+    };
+    for (int i = 0; i < 12; i++) {
         GtkCellRenderer* renderer = gtk_cell_renderer_text_new();
         GtkTreeViewColumn* column = gtk_tree_view_column_new_with_attributes(
             column_titles[i], renderer, "text", i, NULL);
@@ -229,7 +1818,39 @@ void setup_gui() {
     gtk_scrolled_window_set_policy(GTK_SCROLLED_WINDOW(gantt_scroll),
         GTK_POLICY_AUTOMATIC, GTK_POLICY_AUTOMATIC);
     gtk_container_add(GTK_CONTAINER(gantt_scroll), gantt_drawing_area);
-    gtk_notebook_append_page(GTK_NOTEBOOK(notebook), gantt_scroll, gtk_label_new("Gantt Chart"));
+
+    // Playback controls above the chart, state at time t below it
+    GtkWidget* gantt_tab = gtk_box_new(GTK_ORIENTATION_VERTICAL, 5);
+    GtkWidget* playback_box = gtk_box_new(GTK_ORIENTATION_HORIZONTAL, 5);
+    GtkWidget* play_btn = gtk_button_new_with_label("Play");
+    GtkWidget* pause_btn = gtk_button_new_with_label("Pause");
+    GtkWidget* step_btn = gtk_button_new_with_label("Step");
+    playback_scale = gtk_scale_new_with_range(GTK_ORIENTATION_HORIZONTAL, 0, 1, 1);
+    playback_state_label = gtk_label_new("Run an algorithm to enable playback.");
+
+    gtk_box_pack_start(GTK_BOX(playback_box), play_btn, FALSE, FALSE, 2);
+    gtk_box_pack_start(GTK_BOX(playback_box), pause_btn, FALSE, FALSE, 2);
+    gtk_box_pack_start(GTK_BOX(playback_box), step_btn, FALSE, FALSE, 2);
+    gtk_box_pack_start(GTK_BOX(playback_box), playback_scale, TRUE, TRUE, 5);
+    gtk_box_pack_start(GTK_BOX(gantt_tab), playback_box, FALSE, FALSE, 5);
+    gtk_box_pack_start(GTK_BOX(gantt_tab), gantt_scroll, TRUE, TRUE, 0);
+    gtk_box_pack_start(GTK_BOX(gantt_tab), playback_state_label, FALSE, FALSE, 5);
+
+    // Per-task latency diff, only shown while a trace is replayed
+    trace_text_view = gtk_text_view_new();
+    gtk_text_view_set_editable(GTK_TEXT_VIEW(trace_text_view), FALSE);
+    gtk_text_view_set_monospace(GTK_TEXT_VIEW(trace_text_view), TRUE);
+    trace_scroll = gtk_scrolled_window_new(NULL, NULL);
+    gtk_widget_set_size_request(trace_scroll, -1, 180);
+    gtk_container_add(GTK_CONTAINER(trace_scroll), trace_text_view);
+    gtk_box_pack_start(GTK_BOX(gantt_tab), trace_scroll, FALSE, FALSE, 5);
+    gtk_widget_set_no_show_all(trace_scroll, TRUE);
+
+    g_signal_connect(play_btn, "clicked", G_CALLBACK(on_playback_play_clicked), NULL);
+    g_signal_connect(pause_btn, "clicked", G_CALLBACK(on_playback_pause_clicked), NULL);
+    g_signal_connect(step_btn, "clicked", G_CALLBACK(on_playback_step_clicked), NULL);
+    g_signal_connect(playback_scale, "value-changed", G_CALLBACK(on_playback_scale_changed), NULL);
+    gtk_notebook_append_page(GTK_NOTEBOOK(notebook), gantt_tab, gtk_label_new("Gantt Chart"));
 
     // Performance Matrix Tab
     performance_drawing_area = gtk_drawing_area_new();
@@ -277,10 +1898,9 @@ void on_show_info_clicked(GtkButton* button, gpointer user_data) {
     GtkWidget* label = gtk_label_new("Select an algorithm to view information:");
     gtk_box_pack_start(GTK_BOX(box), label, FALSE, FALSE, 5);
 
-    const char* algorithms[] = { "FCFS", "SJF", "SRTF", "Priority", "Round Robin", "Preemptive Priority" };
     GtkWidget* combo = gtk_combo_box_text_new();
-    for (int i = 0; i < 6; i++) {
-        gtk_combo_box_text_append_text(GTK_COMBO_BOX_TEXT(combo), algorithms[i]);
+    for (int i = 0; i < ALGORITHM_COUNT; i++) {
+        gtk_combo_box_text_append_text(GTK_COMBO_BOX_TEXT(combo), algorithm_names[i]);
     }
     gtk_combo_box_set_active(GTK_COMBO_BOX(combo), 0);
     gtk_box_pack_start(GTK_BOX(box), combo, FALSE, FALSE, 5);
@@ -301,86 +1921,604 @@ void on_compare_algorithms_clicked(GtkButton* button, gpointer user_data) {
     gtk_notebook_set_current_page(GTK_NOTEBOOK(notebook), 5); // Switch to Comparison tab
 }
 
-void show_algorithm_info(SchedulingAlgorithm algo) {
-    GtkTextBuffer* buffer = gtk_text_view_get_buffer(GTK_TEXT_VIEW(algorithm_info_text_view));
-    gtk_text_buffer_set_text(buffer, "", -1);
+void on_monte_carlo_clicked(GtkButton* button, gpointer user_data) {
+    GtkWidget* dialog = gtk_dialog_new_with_buttons("Monte Carlo Replication",
+        GTK_WINDOW(main_window), GTK_DIALOG_MODAL,
+        "Cancel", GTK_RESPONSE_CANCEL,
+        "Run", GTK_RESPONSE_OK, NULL);
 
-    GtkTextIter iter;
-    gtk_text_buffer_get_start_iter(buffer, &iter);
+    GtkWidget* content_area = gtk_dialog_get_content_area(GTK_DIALOG(dialog));
+    GtkWidget* grid = gtk_grid_new();
+    gtk_grid_set_row_spacing(GTK_GRID(grid), 5);
+    gtk_grid_set_column_spacing(GTK_GRID(grid), 5);
+    gtk_container_add(GTK_CONTAINER(content_area), grid);
 
-    const char* title = NULL;
-    const char* description = NULL;
-    const char* characteristics = NULL;
-    const char* advantages = NULL;
-    const char* disadvantages = NULL;
+    GtkWidget* combo = gtk_combo_box_text_new();
+    for (int i = 0; i < algorithm_count; i++) {
+        gtk_combo_box_text_append_text(GTK_COMBO_BOX_TEXT(combo), algorithm_names[i]);
+    }
+    gtk_combo_box_set_active(GTK_COMBO_BOX(combo), 0);
 
-    switch (algo) {
-    case FCFS:
-        title = "First-Come, First-Served (FCFS) Scheduling\n\n";
-        description = "Description:\n"
-            "FCFS is the simplest CPU scheduling algorithm. The process that requests the CPU first "
-            "gets the CPU first. It is implemented using a FIFO queue. When a process enters the "
-            "ready queue, its PCB is linked to the tail of the queue. When the CPU is free, it is "
-            "allocated to the process at the head of the queue.\n\n";
-        characteristics = "Characteristics:\n"
-            "- Non-preemptive algorithm\n"
-            "- Simple to understand and implement\n"
-            "- Uses FIFO queue\n"
-            "- Performance is poor as average waiting time is high\n\n";
-        advantages = "Advantages:\n"
-            "- Simple to understand and implement\n"
-            "- No starvation as every process gets chance to execute\n\n";
-        disadvantages = "Disadvantages:\n"
-            "- Not suitable for time-sharing systems\n"
-            "- Poor performance as average waiting time is high\n"
-            "- Not optimal for minimizing turnaround time\n";
-        break;
+    GtkWidget* replications_entry = gtk_entry_new();
+    GtkWidget* jobs_entry = gtk_entry_new();
+    GtkWidget* rate_entry = gtk_entry_new();
+    GtkWidget* burst_entry = gtk_entry_new();
+    GtkWidget* seed_entry = gtk_entry_new();
+    GtkWidget* threads_entry = gtk_entry_new();
+    GtkWidget* io_mix_entry = gtk_entry_new();
+
+    gtk_grid_attach(GTK_GRID(grid), gtk_label_new("Algorithm:"), 0, 0, 1, 1);
+    gtk_grid_attach(GTK_GRID(grid), combo, 1, 0, 1, 1);
+    gtk_grid_attach(GTK_GRID(grid), gtk_label_new("Replications:"), 0, 1, 1, 1);
+    gtk_grid_attach(GTK_GRID(grid), replications_entry, 1, 1, 1, 1);
+    gtk_grid_attach(GTK_GRID(grid), gtk_label_new("Processes per Workload:"), 0, 2, 1, 1);
+    gtk_grid_attach(GTK_GRID(grid), jobs_entry, 1, 2, 1, 1);
+    gtk_grid_attach(GTK_GRID(grid), gtk_label_new("Arrival Rate:"), 0, 3, 1, 1);
+    gtk_grid_attach(GTK_GRID(grid), rate_entry, 1, 3, 1, 1);
+    gtk_grid_attach(GTK_GRID(grid), gtk_label_new("Mean Burst Time:"), 0, 4, 1, 1);
+    gtk_grid_attach(GTK_GRID(grid), burst_entry, 1, 4, 1, 1);
+    gtk_grid_attach(GTK_GRID(grid), gtk_label_new("Seed:"), 0, 5, 1, 1);
+    gtk_grid_attach(GTK_GRID(grid), seed_entry, 1, 5, 1, 1);
+    gtk_grid_attach(GTK_GRID(grid), gtk_label_new("Threads (0 = all CPUs):"), 0, 6, 1, 1);
+    gtk_grid_attach(GTK_GRID(grid), threads_entry, 1, 6, 1, 1);
+    gtk_grid_attach(GTK_GRID(grid), gtk_label_new("I/O-bound Share (0-1):"), 0, 7, 1, 1);
+    gtk_grid_attach(GTK_GRID(grid), io_mix_entry, 1, 7, 1, 1);
+
+    gtk_entry_set_text(GTK_ENTRY(replications_entry), "1000");
+    gtk_entry_set_text(GTK_ENTRY(jobs_entry), "1000");
+    gtk_entry_set_text(GTK_ENTRY(rate_entry), "0.09");
+    gtk_entry_set_text(GTK_ENTRY(burst_entry), "10");
+    gtk_entry_set_text(GTK_ENTRY(seed_entry), "1");
+    gtk_entry_set_text(GTK_ENTRY(threads_entry), "0");
+    gtk_entry_set_text(GTK_ENTRY(io_mix_entry), "0");
 
-    case SJF:
-        title = "Shortest Job First (SJF) Scheduling\n\n";
-        description = "Description:\n"
-            "This algorithm associates with each process the length of its next CPU burst. When the CPU "
-            "is available, it is assigned to the process that has the smallest next CPU burst. If two "
-            "processes have the same length next CPU burst, FCFS scheduling is used to break the tie.\n\n";
-        characteristics = "Characteristics:\n"
-            "- Can be either preemptive or non-preemptive\n"
-            "- Optimal for minimizing average waiting time\n"
-            "- Requires knowledge of next CPU burst length\n"
-            "- Difficult to implement in practice\n\n";
-        advantages = "Advantages:\n"
-            "- Optimal for minimizing average waiting time\n"
-            "- Better than FCFS in terms of turnaround time\n\n";
-        disadvantages = "Disadvantages:\n"
-            "- Difficult to know the length of next CPU request\n"
-            "- May starve long processes\n"
-            "- Not suitable for interactive systems\n";
-        break;
+    gtk_widget_show_all(dialog);
 
-    case SRTF:
-        title = "Shortest Remaining Time First (SRTF) Scheduling\n\n";
-        description = "Description:\n"
-            "This is the preemptive version of SJF scheduling. In SRTF, the execution of the process "
-            "can be stopped after certain amount of time. At arrival of every process, the short term "
-            "scheduler schedules the process with the least remaining burst time among the list of "
-            "available processes and the running process.\n\n";
-        characteristics = "Characteristics:\n"
-            "- Preemptive version of SJF\n"
-            "- More context switches than SJF\n"
-            "- Optimal for minimizing average waiting time\n"
-            "- Requires knowledge of remaining CPU burst length\n\n";
-        advantages = "Advantages:\n"
-            "- Optimal for minimizing average waiting time\n"
-            "- Better than SJF for interactive systems\n\n";
-        disadvantages = "Disadvantages:\n"
-            "- Difficult to predict remaining burst time\n"
-            "- High overhead due to frequent context switches\n"
-            "- May starve long processes\n";
-        break;
+    if (gtk_dialog_run(GTK_DIALOG(dialog)) == GTK_RESPONSE_OK) {
+        ReplicationConfig config;
+        config.algo = gtk_combo_box_get_active(GTK_COMBO_BOX(combo)) + 1;
+        config.replications = atoi(gtk_entry_get_text(GTK_ENTRY(replications_entry)));
+        config.jobs = atoi(gtk_entry_get_text(GTK_ENTRY(jobs_entry)));
+        config.arrival_rate = atof(gtk_entry_get_text(GTK_ENTRY(rate_entry)));
+        config.mean_burst = atof(gtk_entry_get_text(GTK_ENTRY(burst_entry)));
+        config.seed = strtoull(gtk_entry_get_text(GTK_ENTRY(seed_entry)), NULL, 10);
+        config.threads = atoi(gtk_entry_get_text(GTK_ENTRY(threads_entry)));
+        config.time_quantum = time_quantum;
+        config.cost = switch_cost;
+        config.io_mix = atof(gtk_entry_get_text(GTK_ENTRY(io_mix_entry)));
+        config.io = io_config;
+
+        if (config.replications < 1) config.replications = 1;
+        if (config.jobs < 1) config.jobs = 1;
+        if (config.arrival_rate <= 0) config.arrival_rate = 0.09;
+        if (config.mean_burst <= 0) config.mean_burst = 10;
+        if (config.io_mix < 0) config.io_mix = 0;
+        if (config.io_mix > 1) config.io_mix = 1;
+
+        ReplicationResult result;
+        char report[4096];
+        run_replications(&config, &result);
+        format_replication_report(&config, &result, report, sizeof(report));
+
+        GtkTextBuffer* buffer = gtk_text_view_get_buffer(GTK_TEXT_VIEW(statistics_text_view));
+        gtk_text_buffer_set_text(buffer, report, -1);
+        gtk_notebook_set_current_page(GTK_NOTEBOOK(notebook), 3); // Switch to Statistics tab
+    }
 
-    case PRIORITY:
-        title = "Priority Scheduling\n\n";
-        description = "Description:\n"
-            "A priority is associated with each process, and the CPU is allocated to the process with "
+    gtk_widget_destroy(dialog);
+}
+
+void on_import_trace_clicked(GtkButton* button, gpointer user_data) {
+    GtkWidget* dialog = gtk_dialog_new_with_buttons("Import Scheduling Trace",
+        GTK_WINDOW(main_window), GTK_DIALOG_MODAL,
+        "Cancel", GTK_RESPONSE_CANCEL,
+        "Replay", GTK_RESPONSE_OK, NULL);
+
+    GtkWidget* content_area = gtk_dialog_get_content_area(GTK_DIALOG(dialog));
+    GtkWidget* grid = gtk_grid_new();
+    gtk_grid_set_row_spacing(GTK_GRID(grid), 5);
+    gtk_grid_set_column_spacing(GTK_GRID(grid), 5);
+    gtk_container_add(GTK_CONTAINER(content_area), grid);
+
+    GtkWidget* file_button = gtk_file_chooser_button_new("Select Trace", GTK_FILE_CHOOSER_ACTION_OPEN);
+
+    GtkWidget* format_combo = gtk_combo_box_text_new();
+    gtk_combo_box_text_append_text(GTK_COMBO_BOX_TEXT(format_combo), "Detect");
+    gtk_combo_box_text_append_text(GTK_COMBO_BOX_TEXT(format_combo), "perf sched timehist");
+    gtk_combo_box_text_append_text(GTK_COMBO_BOX_TEXT(format_combo), "ftrace sched_switch");
+    gtk_combo_box_set_active(GTK_COMBO_BOX(format_combo), 0);
+
+    GtkWidget* algo_combo = gtk_combo_box_text_new();
+    for (int i = 0; i < algorithm_count; i++) {
+        gtk_combo_box_text_append_text(GTK_COMBO_BOX_TEXT(algo_combo), algorithm_names[i]);
+    }
+    gtk_combo_box_set_active(GTK_COMBO_BOX(algo_combo), 2);
+
+    GtkWidget* cpu_entry = gtk_entry_new();
+    GtkWidget* tick_entry = gtk_entry_new();
+    GtkWidget* start_entry = gtk_entry_new();
+    GtkWidget* max_jobs_entry = gtk_entry_new();
+
+    gtk_grid_attach(GTK_GRID(grid), gtk_label_new("Trace File:"), 0, 0, 1, 1);
+    gtk_grid_attach(GTK_GRID(grid), file_button, 1, 0, 1, 1);
+    gtk_grid_attach(GTK_GRID(grid), gtk_label_new("Format:"), 0, 1, 1, 1);
+    gtk_grid_attach(GTK_GRID(grid), format_combo, 1, 1, 1, 1);
+    gtk_grid_attach(GTK_GRID(grid), gtk_label_new("Algorithm:"), 0, 2, 1, 1);
+    gtk_grid_attach(GTK_GRID(grid), algo_combo, 1, 2, 1, 1);
+    gtk_grid_attach(GTK_GRID(grid), gtk_label_new("CPU (-1 = first in trace):"), 0, 3, 1, 1);
+    gtk_grid_attach(GTK_GRID(grid), cpu_entry, 1, 3, 1, 1);
+    gtk_grid_attach(GTK_GRID(grid), gtk_label_new("Time Unit (us):"), 0, 4, 1, 1);
+    gtk_grid_attach(GTK_GRID(grid), tick_entry, 1, 4, 1, 1);
+    gtk_grid_attach(GTK_GRID(grid), gtk_label_new("Start at (s):"), 0, 5, 1, 1);
+    gtk_grid_attach(GTK_GRID(grid), start_entry, 1, 5, 1, 1);
+    gtk_grid_attach(GTK_GRID(grid), gtk_label_new("Maximum Jobs:"), 0, 6, 1, 1);
+    gtk_grid_attach(GTK_GRID(grid), max_jobs_entry, 1, 6, 1, 1);
+
+    gtk_entry_set_text(GTK_ENTRY(cpu_entry), "-1");
+    gtk_entry_set_text(GTK_ENTRY(tick_entry), "100");
+    gtk_entry_set_text(GTK_ENTRY(start_entry), "0");
+    gtk_entry_set_text(GTK_ENTRY(max_jobs_entry), "100000");
+
+    gtk_widget_show_all(dialog);
+
+    if (gtk_dialog_run(GTK_DIALOG(dialog)) == GTK_RESPONSE_OK) {
+        char* path = gtk_file_chooser_get_filename(GTK_FILE_CHOOSER(file_button));
+        TraceConfig config;
+        config.format = gtk_combo_box_get_active(GTK_COMBO_BOX(format_combo));
+        config.cpu = atoi(gtk_entry_get_text(GTK_ENTRY(cpu_entry)));
+        config.tick_us = atoi(gtk_entry_get_text(GTK_ENTRY(tick_entry)));
+        config.start = atof(gtk_entry_get_text(GTK_ENTRY(start_entry)));
+        config.max_jobs = atoi(gtk_entry_get_text(GTK_ENTRY(max_jobs_entry)));
+        SchedulingAlgorithm algo = gtk_combo_box_get_active(GTK_COMBO_BOX(algo_combo)) + 1;
+
+        char error[1200];
+        if (!path || import_trace(&trace_replay, path, &config, error, sizeof(error)) != 0) {
+            GtkWidget* message = gtk_message_dialog_new(GTK_WINDOW(main_window),
+                GTK_DIALOG_MODAL, GTK_MESSAGE_ERROR, GTK_BUTTONS_OK,
+                "%s", path ? error : "Please select a trace file.");
+            gtk_dialog_run(GTK_DIALOG(message));
+            gtk_widget_destroy(message);
+            trace_replay_free(&trace_replay);
+        }
+        else {
+            replay_trace(&trace_replay, algo, time_quantum);
+            trace_replay_active = 1;
+
+            size_t report_len = 4096 + TRACE_REPORT_TASKS * 80;
+            char* report = malloc(report_len);
+            format_trace_report(&trace_replay, report, report_len);
+            GtkTextBuffer* buffer = gtk_text_view_get_buffer(GTK_TEXT_VIEW(trace_text_view));
+            gtk_text_buffer_set_text(buffer, report, -1);
+            free(report);
+
+            // Playback follows the process table, not the trace
+            clear_playback();
+            gtk_label_set_text(GTK_LABEL(playback_state_label), "Playback is not available for trace replays.");
+            gtk_widget_show_all(trace_scroll);
+            gtk_widget_queue_draw(gantt_drawing_area);
+            gtk_notebook_set_current_page(GTK_NOTEBOOK(notebook), 1); // Switch to Gantt Chart tab
+        }
+        g_free(path);
+    }
+
+    gtk_widget_destroy(dialog);
+}
+
+// Saves the run on screen: .json as trace events, otherwise the chart on the
+// current tab (the performance matrix, or the Gantt chart) as png, svg or pdf
+void on_export_clicked(GtkButton* button, gpointer user_data) {
+    if (!trace_replay_active && gui_sim.gantt_count == 0) {
+        GtkWidget* message = gtk_message_dialog_new(GTK_WINDOW(main_window),
+            GTK_DIALOG_MODAL, GTK_MESSAGE_INFO, GTK_BUTTONS_OK,
+            "Run a simulation or import a trace first.");
+        gtk_dialog_run(GTK_DIALOG(message));
+        gtk_widget_destroy(message);
+        return;
+    }
+
+    GtkWidget* dialog = gtk_file_chooser_dialog_new("Export",
+        GTK_WINDOW(main_window), GTK_FILE_CHOOSER_ACTION_SAVE,
+        "Cancel", GTK_RESPONSE_CANCEL,
+        "Export", GTK_RESPONSE_ACCEPT, NULL);
+    gtk_file_chooser_set_do_overwrite_confirmation(GTK_FILE_CHOOSER(dialog), TRUE);
+    gtk_file_chooser_set_current_name(GTK_FILE_CHOOSER(dialog), "schedule.json");
+
+    if (gtk_dialog_run(GTK_DIALOG(dialog)) == GTK_RESPONSE_ACCEPT) {
+        char* path = gtk_file_chooser_get_filename(GTK_FILE_CHOOSER(dialog));
+        const char* dot = strrchr(path, '.');
+        const TraceReplay* tr = trace_replay_active ? &trace_replay : NULL;
+        char error[1200];
+        int status;
+
+        if (dot && strcasecmp(dot + 1, "json") == 0) {
+            status = export_trace_events(path, &gui_sim, last_run_algo, tr, error, sizeof(error));
+        }
+        else {
+            ExportConfig config = { path, EXPORT_GANTT, 1200, 0, 1 };
+            if (gtk_notebook_get_current_page(GTK_NOTEBOOK(notebook)) == 2) {
+                config.chart = EXPORT_PERFORMANCE;
+                tr = NULL;
+            }
+            const Simulation* sim = trace_replay_active ? &trace_replay.simulated : &gui_sim;
+            status = export_chart(&config, sim, tr, error, sizeof(error));
+        }
+
+        if (status != 0) {
+            GtkWidget* message = gtk_message_dialog_new(GTK_WINDOW(main_window),
+                GTK_DIALOG_MODAL, GTK_MESSAGE_ERROR, GTK_BUTTONS_OK, "%s", error);
+            gtk_dialog_run(GTK_DIALOG(message));
+            gtk_widget_destroy(message);
+        }
+        g_free(path);
+    }
+
+    gtk_widget_destroy(dialog);
+}
+
+// Back to charting the process table
+void leave_trace_replay() {
+    if (!trace_replay_active) return;
+
+    trace_replay_active = 0;
+    trace_replay_free(&trace_replay);
+    gtk_widget_hide(trace_scroll);
+    gtk_widget_queue_draw(gantt_drawing_area);
+}
+
+// Sets the cost charged for context switches in the runs that follow
+void on_switch_cost_clicked(GtkButton* button, gpointer user_data) {
+    GtkWidget* dialog = gtk_dialog_new_with_buttons("Context Switch Cost",
+        GTK_WINDOW(main_window), GTK_DIALOG_MODAL,
+        "Cancel", GTK_RESPONSE_CANCEL,
+        "OK", GTK_RESPONSE_OK, NULL);
+
+    GtkWidget* content_area = gtk_dialog_get_content_area(GTK_DIALOG(dialog));
+    GtkWidget* grid = gtk_grid_new();
+    gtk_grid_set_row_spacing(GTK_GRID(grid), 5);
+    gtk_grid_set_column_spacing(GTK_GRID(grid), 5);
+    gtk_container_add(GTK_CONTAINER(content_area), grid);
+
+    GtkWidget* dispatch_entry = gtk_entry_new();
+    GtkWidget* penalty_entry = gtk_entry_new();
+    GtkWidget* decay_entry = gtk_entry_new();
+
+    gtk_grid_attach(GTK_GRID(grid), gtk_label_new("Dispatch Cost:"), 0, 0, 1, 1);
+    gtk_grid_attach(GTK_GRID(grid), dispatch_entry, 1, 0, 1, 1);
+    gtk_grid_attach(GTK_GRID(grid), gtk_label_new("Cold Cache Penalty:"), 0, 1, 1, 1);
+    gtk_grid_attach(GTK_GRID(grid), penalty_entry, 1, 1, 1, 1);
+    gtk_grid_attach(GTK_GRID(grid), gtk_label_new("Time to Go Cold:"), 0, 2, 1, 1);
+    gtk_grid_attach(GTK_GRID(grid), decay_entry, 1, 2, 1, 1);
+
+    char value[16];
+    snprintf(value, sizeof(value), "%d", switch_cost.dispatch);
+    gtk_entry_set_text(GTK_ENTRY(dispatch_entry), value);
+    snprintf(value, sizeof(value), "%d", switch_cost.cache_penalty);
+    gtk_entry_set_text(GTK_ENTRY(penalty_entry), value);
+    snprintf(value, sizeof(value), "%d", switch_cost.cache_decay);
+    gtk_entry_set_text(GTK_ENTRY(decay_entry), value);
+
+    gtk_widget_show_all(dialog);
+
+    if (gtk_dialog_run(GTK_DIALOG(dialog)) == GTK_RESPONSE_OK) {
+        switch_cost.dispatch = atoi(gtk_entry_get_text(GTK_ENTRY(dispatch_entry)));
+        switch_cost.cache_penalty = atoi(gtk_entry_get_text(GTK_ENTRY(penalty_entry)));
+        switch_cost.cache_decay = atoi(gtk_entry_get_text(GTK_ENTRY(decay_entry)));
+
+        if (switch_cost.dispatch < 0) switch_cost.dispatch = 0;
+        if (switch_cost.cache_penalty < 0) switch_cost.cache_penalty = 0;
+        if (switch_cost.cache_decay < 0) switch_cost.cache_decay = 0;
+    }
+
+    gtk_widget_destroy(dialog);
+}
+
+// Sets how fast waiting processes gain priority under the priority policies
+void on_aging_clicked(GtkButton* button, gpointer user_data) {
+    GtkWidget* dialog = gtk_dialog_new_with_buttons("Priority Aging",
+        GTK_WINDOW(main_window), GTK_DIALOG_MODAL,
+        "Cancel", GTK_RESPONSE_CANCEL,
+        "OK", GTK_RESPONSE_OK, NULL);
+
+    GtkWidget* content_area = gtk_dialog_get_content_area(GTK_DIALOG(dialog));
+    GtkWidget* grid = gtk_grid_new();
+    gtk_grid_set_row_spacing(GTK_GRID(grid), 5);
+    gtk_grid_set_column_spacing(GTK_GRID(grid), 5);
+    gtk_container_add(GTK_CONTAINER(content_area), grid);
+
+    GtkWidget* interval_entry = gtk_entry_new();
+    gtk_grid_attach(GTK_GRID(grid), gtk_label_new("Wait per Priority Level (0 = off):"), 0, 0, 1, 1);
+    gtk_grid_attach(GTK_GRID(grid), interval_entry, 1, 0, 1, 1);
+
+    char value[16];
+    snprintf(value, sizeof(value), "%d", aging_interval);
+    gtk_entry_set_text(GTK_ENTRY(interval_entry), value);
+
+    gtk_widget_show_all(dialog);
+
+    if (gtk_dialog_run(GTK_DIALOG(dialog)) == GTK_RESPONSE_OK) {
+        aging_interval = atoi(gtk_entry_get_text(GTK_ENTRY(interval_entry)));
+        if (aging_interval < 0) aging_interval = 0;
+        if (aging_interval > 10000) aging_interval = 10000;
+    }
+
+    gtk_widget_destroy(dialog);
+}
+
+// Sets what one tick of simulated time stands for. Stored times stay in ticks;
+// the unit only changes how they are read from text and labelled.
+void on_time_unit_clicked(GtkButton* button, gpointer user_data) {
+    GtkWidget* dialog = gtk_dialog_new_with_buttons("Time Unit",
+        GTK_WINDOW(main_window), GTK_DIALOG_MODAL,
+        "Cancel", GTK_RESPONSE_CANCEL,
+        "OK", GTK_RESPONSE_OK, NULL);
+
+    GtkWidget* content_area = gtk_dialog_get_content_area(GTK_DIALOG(dialog));
+    GtkWidget* grid = gtk_grid_new();
+    gtk_grid_set_row_spacing(GTK_GRID(grid), 5);
+    gtk_grid_set_column_spacing(GTK_GRID(grid), 5);
+    gtk_container_add(GTK_CONTAINER(content_area), grid);
+
+    GtkWidget* combo = gtk_combo_box_text_new();
+    gtk_combo_box_text_append_text(GTK_COMBO_BOX_TEXT(combo), "Abstract units");
+    gtk_combo_box_text_append_text(GTK_COMBO_BOX_TEXT(combo), "Nanoseconds");
+    gtk_combo_box_text_append_text(GTK_COMBO_BOX_TEXT(combo), "Microseconds");
+    gtk_combo_box_text_append_text(GTK_COMBO_BOX_TEXT(combo), "Milliseconds");
+    gtk_combo_box_set_active(GTK_COMBO_BOX(combo), time_unit);
+    gtk_grid_attach(GTK_GRID(grid), gtk_label_new("One Tick Is:"), 0, 0, 1, 1);
+    gtk_grid_attach(GTK_GRID(grid), combo, 1, 0, 1, 1);
+
+    gtk_widget_show_all(dialog);
+
+    if (gtk_dialog_run(GTK_DIALOG(dialog)) == GTK_RESPONSE_OK) {
+        int active = gtk_combo_box_get_active(GTK_COMBO_BOX(combo));
+        if (active >= 0 && active < TIME_UNITS) time_unit = (TimeUnit)active;
+        update_statistics();
+        gtk_widget_queue_draw(gantt_drawing_area);
+        gtk_widget_queue_draw(performance_drawing_area);
+    }
+
+    gtk_widget_destroy(dialog);
+}
+
+// Edits the bandwidth groups as workload-file group lines. Processes keep
+// their group by path; those whose group is gone move to the root.
+void on_groups_clicked(GtkButton* button, gpointer user_data) {
+    GtkWidget* dialog = gtk_dialog_new_with_buttons("Bandwidth Groups",
+        GTK_WINDOW(main_window), GTK_DIALOG_MODAL,
+        "Cancel", GTK_RESPONSE_CANCEL,
+        "OK", GTK_RESPONSE_OK, NULL);
+
+    GtkWidget* content_area = gtk_dialog_get_content_area(GTK_DIALOG(dialog));
+    GtkWidget* label = gtk_label_new("One group per line: group PATH QUOTA|max PERIOD [WEIGHT]\n"
+        "for example group /batch 30 100 2. A parent comes before its children.");
+    gtk_container_add(GTK_CONTAINER(content_area), label);
+
+    GtkWidget* scroll = gtk_scrolled_window_new(NULL, NULL);
+    gtk_widget_set_size_request(scroll, 420, 200);
+    GtkWidget* text_view = gtk_text_view_new();
+    gtk_text_view_set_monospace(GTK_TEXT_VIEW(text_view), TRUE);
+    gtk_container_add(GTK_CONTAINER(scroll), text_view);
+    gtk_container_add(GTK_CONTAINER(content_area), scroll);
+
+    char text[MAX_GROUPS * (MAX_GROUP_PATH + 48)];
+    GtkTextBuffer* buffer = gtk_text_view_get_buffer(GTK_TEXT_VIEW(text_view));
+    format_groups(&group_config, text, sizeof(text));
+    gtk_text_buffer_set_text(buffer, text, -1);
+
+    gtk_widget_show_all(dialog);
+
+    if (gtk_dialog_run(GTK_DIALOG(dialog)) == GTK_RESPONSE_OK) {
+        GtkTextIter start, end;
+        GroupConfig groups;
+        char error[512];
+        gtk_text_buffer_get_bounds(buffer, &start, &end);
+        gchar* lines = gtk_text_buffer_get_text(buffer, &start, &end, FALSE);
+
+        if (parse_groups(lines, &groups, error, sizeof(error))) {
+            for (int slot = process_table.head; slot >= 0; slot = process_table.next[slot]) {
+                Process* p = &process_table.slot[slot];
+                int g = p->group;
+                p->group = g > 0 && g <= group_config.count ? find_group(&groups, group_config.group[g].path) : 0;
+                if (p->group < 0) p->group = 0;
+            }
+            group_config = groups;
+            clear_playback();
+            update_process_list();
+        }
+        else {
+            GtkWidget* message = gtk_message_dialog_new(GTK_WINDOW(main_window),
+                GTK_DIALOG_MODAL, GTK_MESSAGE_ERROR, GTK_BUTTONS_OK, "%s", error);
+            gtk_dialog_run(GTK_DIALOG(message));
+            gtk_widget_destroy(message);
+        }
+        g_free(lines);
+    }
+
+    gtk_widget_destroy(dialog);
+}
+
+// Picks the protocol Preemptive Priority runs locks under. The resources
+// themselves come from the processes' bursts.
+void on_locks_clicked(GtkButton* button, gpointer user_data) {
+    GtkWidget* dialog = gtk_dialog_new_with_buttons("Resource Locks",
+        GTK_WINDOW(main_window), GTK_DIALOG_MODAL,
+        "Cancel", GTK_RESPONSE_CANCEL,
+        "OK", GTK_RESPONSE_OK, NULL);
+
+    GtkWidget* content_area = gtk_dialog_get_content_area(GTK_DIALOG(dialog));
+    GtkWidget* label = gtk_label_new("Processes take resources with bursts like 8[db:2-5]: db is held\n"
+        "from 2 to 5 units of CPU time. Only Preemptive Priority honours locks.");
+    gtk_container_add(GTK_CONTAINER(content_area), label);
+
+    GtkWidget* combo = gtk_combo_box_text_new();
+    for (int k = 0; k < LOCK_PROTOCOLS; k++) {
+        gtk_combo_box_text_append_text(GTK_COMBO_BOX_TEXT(combo), lock_protocol_names[k]);
+    }
+    gtk_combo_box_set_active(GTK_COMBO_BOX(combo), lock_protocol);
+    gtk_container_add(GTK_CONTAINER(content_area), combo);
+
+    gtk_widget_show_all(dialog);
+
+    if (gtk_dialog_run(GTK_DIALOG(dialog)) == GTK_RESPONSE_OK) {
+        lock_protocol = (LockProtocol)gtk_combo_box_get_active(GTK_COMBO_BOX(combo));
+        clear_playback();
+    }
+
+    gtk_widget_destroy(dialog);
+}
+
+// Sets how many I/O devices there are and the order each serves its queue in
+void on_io_devices_clicked(GtkButton* button, gpointer user_data) {
+    GtkWidget* dialog = gtk_dialog_new_with_buttons("I/O Devices",
+        GTK_WINDOW(main_window), GTK_DIALOG_MODAL,
+        "Cancel", GTK_RESPONSE_CANCEL,
+        "OK", GTK_RESPONSE_OK, NULL);
+
+    GtkWidget* content_area = gtk_dialog_get_content_area(GTK_DIALOG(dialog));
+    GtkWidget* grid = gtk_grid_new();
+    gtk_grid_set_row_spacing(GTK_GRID(grid), 5);
+    gtk_grid_set_column_spacing(GTK_GRID(grid), 5);
+    gtk_container_add(GTK_CONTAINER(content_area), grid);
+
+    const char* disciplines[] = { "FCFS", "Shortest Request First", "Priority" };
+    GtkWidget* count_entry = gtk_entry_new();
+    GtkWidget* combos[MAX_IO_DEVICES];
+
+    gtk_grid_attach(GTK_GRID(grid), gtk_label_new("Devices (1-4):"), 0, 0, 1, 1);
+    gtk_grid_attach(GTK_GRID(grid), count_entry, 1, 0, 1, 1);
+    for (int d = 0; d < MAX_IO_DEVICES; d++) {
+        char label[32];
+        snprintf(label, sizeof(label), "Device %d Queue:", d + 1);
+        combos[d] = gtk_combo_box_text_new();
+        for (int k = 0; k < 3; k++) {
+            gtk_combo_box_text_append_text(GTK_COMBO_BOX_TEXT(combos[d]), disciplines[k]);
+        }
+        gtk_combo_box_set_active(GTK_COMBO_BOX(combos[d]), io_config.discipline[d]);
+        gtk_grid_attach(GTK_GRID(grid), gtk_label_new(label), 0, d + 1, 1, 1);
+        gtk_grid_attach(GTK_GRID(grid), combos[d], 1, d + 1, 1, 1);
+    }
+
+    char value[16];
+    snprintf(value, sizeof(value), "%d", io_config.device_count);
+    gtk_entry_set_text(GTK_ENTRY(count_entry), value);
+
+    gtk_widget_show_all(dialog);
+
+    if (gtk_dialog_run(GTK_DIALOG(dialog)) == GTK_RESPONSE_OK) {
+        io_config.device_count = atoi(gtk_entry_get_text(GTK_ENTRY(count_entry)));
+        if (io_config.device_count < 1) io_config.device_count = 1;
+        if (io_config.device_count > MAX_IO_DEVICES) io_config.device_count = MAX_IO_DEVICES;
+        for (int d = 0; d < MAX_IO_DEVICES; d++) {
+            io_config.discipline[d] = (IoDiscipline)gtk_combo_box_get_active(GTK_COMBO_BOX(combos[d]));
+        }
+    }
+
+    gtk_widget_destroy(dialog);
+}
+
+void on_persist_cache_toggled(GtkToggleButton* button, gpointer user_data) {
+    persist_result_cache = gtk_toggle_button_get_active(button);
+
+    // Pick up results saved by earlier sessions
+    if (persist_result_cache) {
+        char path[1024];
+        result_cache_path(path, sizeof(path));
+        cache_load(&result_cache, path);
+    }
+}
+
+void on_main_window_destroy(GtkWidget* widget, gpointer user_data) {
+    if (persist_result_cache) {
+        char path[1024];
+        result_cache_path(path, sizeof(path));
+        if (cache_save(&result_cache, path) != 0) {
+            fprintf(stderr, "Could not save result cache to %s\n", path);
+        }
+    }
+    cache_clear(&result_cache);
+    gtk_main_quit();
+}
+
+void show_algorithm_info(SchedulingAlgorithm algo) {
+    GtkTextBuffer* buffer = gtk_text_view_get_buffer(GTK_TEXT_VIEW(algorithm_info_text_view));
+    gtk_text_buffer_set_text(buffer, "", -1);
+
+    GtkTextIter iter;
+    gtk_text_buffer_get_start_iter(buffer, &iter);
+
+    const char* title = NULL;
+    const char* description = NULL;
+    const char* characteristics = NULL;
+    const char* advantages = NULL;
+    const char* disadvantages = NULL;
+
+    switch (algo) {
+    case FCFS:
+        title = "First-Come, First-Served (FCFS) Scheduling\n\n";
+        description = "Description:\n"
+            "FCFS is the simplest CPU scheduling algorithm. The process that requests the CPU first "
+            "gets the CPU first. It is implemented using a FIFO queue. When a process enters the "
+            "ready queue, its PCB is linked to the tail of the queue. When the CPU is free, it is "
+            "allocated to the process at the head of the queue.\n\n";
+        characteristics = "Characteristics:\n"
+            "- Non-preemptive algorithm\n"
+            "- Simple to understand and implement\n"
+            "- Uses FIFO queue\n"
+            "- Performance is poor as average waiting time is high\n\n";
+        advantages = "Advantages:\n"
+            "- Simple to understand and implement\n"
+            "- No starvation as every process gets chance to execute\n\n";
+        disadvantages = "Disadvantages:\n"
+            "- Not suitable for time-sharing systems\n"
+            "- Poor performance as average waiting time is high\n"
+            "- Not optimal for minimizing turnaround time\n";
+        break;
+
+    case SJF:
+        title = "Shortest Job First (SJF) Scheduling\n\n";
+        description = "Description:\n"
+            "This algorithm associates with each process the length of its next CPU burst. When the CPU "
+            "is available, it is assigned to the process that has the smallest next CPU burst. If two "
+            "processes have the same length next CPU burst, FCFS scheduling is used to break the tie.\n\n";
+        characteristics = "Characteristics:\n"
+            "- Can be either preemptive or non-preemptive\n"
+            "- Optimal for minimizing average waiting time\n"
+            "- Requires knowledge of next CPU burst length\n"
+            "- Difficult to implement in practice\n\n";
+        advantages = "Advantages:\n"
+            "- Optimal for minimizing average waiting time\n"
+            "- Better than FCFS in terms of turnaround time\n\n";
+        disadvantages = "Disadvantages:\n"
+            "- Difficult to know the length of next CPU request\n"
+            "- May starve long processes\n"
+            "- Not suitable for interactive systems\n";
+        break;
+
+    case SRTF:
+        title = "Shortest Remaining Time First (SRTF) Scheduling\n\n";
+        description = "Description:\n"
+            "This is the preemptive version of SJF scheduling. In SRTF, the execution of the process "
+            "can be stopped after certain amount of time. At arrival of every process, the short term "
+            "scheduler schedules the process with the least remaining burst time among the list of "
+            "available processes and the running process.\n\n";
+        characteristics = "Characteristics:\n"
+            "- Preemptive version of SJF\n"
+            "- More context switches than SJF\n"
+            "- Optimal for minimizing average waiting time\n"
+            "- Requires knowledge of remaining CPU burst length\n\n";
+        advantages = "Advantages:\n"
+            "- Optimal for minimizing average waiting time\n"
+            "- Better than SJF for interactive systems\n\n";
+        disadvantages = "Disadvantages:\n"
+            "- Difficult to predict remaining burst time\n"
+            "- High overhead due to frequent context switches\n"
+            "- May starve long processes\n";
+        break;
+
+    case PRIORITY:
+        title = "Priority Scheduling\n\n";
+        description = "Description:\n"
+            "A priority is associated with each process, and the CPU is allocated to the process with "
             "the highest priority. Equal priority processes are scheduled in FCFS order. Priority can "
             "be defined internally (by system) or externally (by user). Lower numbers typically "
             "represent higher priority.\n\n";
@@ -440,16 +2578,61 @@ void show_algorithm_info(SchedulingAlgorithm algo) {
             "- High overhead due to frequent context switches\n"
             "- Not optimal for minimizing turnaround time\n";
         break;
-    }
 
-    gtk_text_buffer_insert(buffer, &iter, title, -1);
-    gtk_text_buffer_insert(buffer, &iter, description, -1);
-    gtk_text_buffer_insert(buffer, &iter, characteristics, -1);
-    gtk_text_buffer_insert(buffer, &iter, advantages, -1);
-    gtk_text_buffer_insert(buffer, &iter, disadvantages, -1);
-}
-
-void compare_algorithms() {
+    case STRIDE:
+        title = "Stride Scheduling\n\n";
+        description = "Description:\n"
+            "Stride scheduling shares the CPU among ready processes in proportion to their weights. "
+            "Each process has a pass value that advances by a stride, inversely proportional to its "
+            "weight, for every unit it runs. The process with the lowest pass runs next for one time "
+            "quantum, so a process with twice the weight runs twice as often. A process without a "
+            "weight gets 11 minus its priority.\n\n";
+        characteristics = "Characteristics:\n"
+            "- Preemptive at the end of each time quantum\n"
+            "- Deterministic proportional share\n"
+            "- A process's share is its weight over the total weight ready\n"
+            "- No starvation: every ready process's pass is eventually the lowest\n\n";
+        advantages = "Advantages:\n"
+            "- Predictable CPU shares over short intervals\n"
+            "- Isolates tenants of different weights from each other\n"
+            "- No starvation\n\n";
+        disadvantages = "Disadvantages:\n"
+            "- Ignores burst lengths, so average waiting time is not minimized\n"
+            "- Context switch overhead as with Round Robin\n"
+            "- Weights must be chosen by hand\n";
+        break;
+
+    case LOTTERY:
+        title = "Lottery Scheduling\n\n";
+        description = "Description:\n"
+            "Lottery scheduling gives each ready process as many tickets as its weight and draws "
+            "one ticket before every time quantum; the holder runs for that quantum. On average a "
+            "process gets CPU time in proportion to its tickets, though any one stretch of time can "
+            "stray from that. A process without a weight gets 11 minus its priority.\n\n";
+        characteristics = "Characteristics:\n"
+            "- Preemptive at the end of each time quantum\n"
+            "- Randomized proportional share\n"
+            "- Shares are exact only in expectation\n"
+            "- Probabilistically free of starvation\n\n";
+        advantages = "Advantages:\n"
+            "- Simple to reason about: the odds of running match the tickets held\n"
+            "- New processes get a share straight away\n"
+            "- No starvation in the long run\n\n";
+        disadvantages = "Disadvantages:\n"
+            "- Short-term shares vary more than under Stride\n"
+            "- Ignores burst lengths, so average waiting time is not minimized\n"
+            "- Context switch overhead as with Round Robin\n";
+        break;
+    }
+
+    gtk_text_buffer_insert(buffer, &iter, title, -1);
+    gtk_text_buffer_insert(buffer, &iter, description, -1);
+    gtk_text_buffer_insert(buffer, &iter, characteristics, -1);
+    gtk_text_buffer_insert(buffer, &iter, advantages, -1);
+    gtk_text_buffer_insert(buffer, &iter, disadvantages, -1);
+}
+
+void compare_algorithms() {
     GtkTextBuffer* buffer = gtk_text_view_get_buffer(GTK_TEXT_VIEW(comparison_text_view));
     gtk_text_buffer_set_text(buffer, "", -1);
 
@@ -498,6 +2681,18 @@ void compare_algorithms() {
         "   - May suffer from starvation\n"
         "   - Good for real-time systems\n\n"
 
+        "7. Stride Scheduling\n"
+        "   - Preemptive at the end of each quantum\n"
+        "   - CPU shared in proportion to weights, deterministically\n"
+        "   - No starvation\n"
+        "   - Good for sharing a machine between tenants\n\n"
+
+        "8. Lottery Scheduling\n"
+        "   - Preemptive at the end of each quantum\n"
+        "   - CPU shared in proportion to weights, by random draws\n"
+        "   - No starvation in the long run\n"
+        "   - Good for sharing a machine between tenants\n\n"
+
         "Summary Table:\n"
         "+-------------------+------------+------------+-------------------+----------------+\n"
         "| Algorithm         | Preemptive | Starvation | Average Wait Time | Suitable For   |\n"
@@ -508,6 +2703,8 @@ void compare_algorithms() {
         "| Priority          | Optional   | Yes        | Medium            | Real-time      |\n"
         "| Round Robin       | Yes        | No         | Medium            | Time-sharing   |\n"
         "| Preemptive Prio.  | Yes        | Yes        | Medium            | Real-time      |\n"
+        "| Stride            | Yes        | No         | Medium            | Multi-tenant   |\n"
+        "| Lottery           | Yes        | No         | Medium            | Multi-tenant   |\n"
         "+-------------------+------------+------------+-------------------+----------------+\n\n"
 
         "Key Points:\n"
@@ -515,19 +2712,52 @@ void compare_algorithms() {
         "- SJF/SRTF give optimal waiting times but hard to implement\n"
         "- Round Robin is fair and good for time-sharing\n"
         "- Priority scheduling is good for real-time systems\n"
+        "- Stride and Lottery divide the CPU by weight\n"
         "- Preemptive algorithms have more overhead but better response\n";
 
     gtk_text_buffer_insert(buffer, &iter, comparison_text, -1);
+
+    Process* table = malloc(MAX_PROCESSES * sizeof(Process));
+    int count = process_table_pack(&process_table, table);
+
+    // Measured on the process table, once it has I/O to overlap
+    if (workload_has_io(table, count)) {
+        char measured[4096];
+        format_io_comparison(table, count, time_quantum, &switch_cost, &io_config,
+            measured, sizeof(measured));
+        gtk_text_buffer_insert(buffer, &iter, "\n", -1);
+        gtk_text_buffer_insert(buffer, &iter, measured, -1);
+    }
+
+    // Plugins measured against the built-in algorithms on the process table
+    if (plugin_count > 0 && count > 0) {
+        char measured[8192];
+        format_plugin_comparison(table, count, time_quantum, &switch_cost, measured, sizeof(measured));
+        gtk_text_buffer_insert(buffer, &iter, "\n", -1);
+        gtk_text_buffer_insert(buffer, &iter, measured, -1);
+    }
+
+    // Queueing model estimates beside the simulated policies
+    if (count >= 2) {
+        char estimates[4096];
+        format_queueing_model(table, count, time_quantum, &switch_cost, 1,
+            estimates, sizeof(estimates));
+        gtk_text_buffer_insert(buffer, &iter, "\n", -1);
+        gtk_text_buffer_insert(buffer, &iter, estimates, -1);
+    }
+
+    free(table);
 }
 
 void assign_process_colors() {
-    for (int i = 0; i < process_count; i++) {
-        processes[i].color = process_colors[i % 10];
+    int i = 0;
+    for (int slot = process_table.head; slot >= 0; slot = process_table.next[slot]) {
+        process_table.slot[slot].color = process_colors[i++ % 10];
     }
 }
 
 void on_add_process_clicked(GtkButton* button, gpointer user_data) {
-    if (process_count >= MAX_PROCESSES) {
+    if (process_table.count >= MAX_PROCESSES) {
         GtkWidget* dialog = gtk_message_dialog_new(GTK_WINDOW(main_window),
             GTK_DIALOG_MODAL, GTK_MESSAGE_ERROR, GTK_BUTTONS_OK,
             "Maximum number of processes reached!");
@@ -551,54 +2781,120 @@ void on_add_process_clicked(GtkButton* button, gpointer user_data) {
     GtkWidget* arrival_entry = gtk_entry_new();
     GtkWidget* burst_entry = gtk_entry_new();
     GtkWidget* priority_entry = gtk_entry_new();
+    GtkWidget* weight_entry = gtk_entry_new();
+    GtkWidget* group_entry = gtk_entry_new();
 
     gtk_grid_attach(GTK_GRID(grid), gtk_label_new("Process Name:"), 0, 0, 1, 1);
     gtk_grid_attach(GTK_GRID(grid), name_entry, 1, 0, 1, 1);
     gtk_grid_attach(GTK_GRID(grid), gtk_label_new("Arrival Time:"), 0, 1, 1, 1);
     gtk_grid_attach(GTK_GRID(grid), arrival_entry, 1, 1, 1, 1);
-    gtk_grid_attach(GTK_GRID(grid), gtk_label_new("Burst Time:"), 0, 2, 1, 1);
+    gtk_grid_attach(GTK_GRID(grid), gtk_label_new("Bursts (CPU,I/O,CPU... [res:from-to]):"), 0, 2, 1, 1);
     gtk_grid_attach(GTK_GRID(grid), burst_entry, 1, 2, 1, 1);
     gtk_grid_attach(GTK_GRID(grid), gtk_label_new("Priority (1-10):"), 0, 3, 1, 1);
     gtk_grid_attach(GTK_GRID(grid), priority_entry, 1, 3, 1, 1);
+    gtk_grid_attach(GTK_GRID(grid), gtk_label_new("Share Weight (0 = from priority):"), 0, 4, 1, 1);
+    gtk_grid_attach(GTK_GRID(grid), weight_entry, 1, 4, 1, 1);
+    gtk_grid_attach(GTK_GRID(grid), gtk_label_new("Bandwidth Group:"), 0, 5, 1, 1);
+    gtk_grid_attach(GTK_GRID(grid), group_entry, 1, 5, 1, 1);
 
-    // Set default values
+    // Set default values, naming the process after its id unless that name is taken
     char default_name[20];
-    snprintf(default_name, sizeof(default_name), "P%d", process_count + 1);
+    int suffix = process_table.next_id;
+    do {
+        snprintf(default_name, sizeof(default_name), "P%d", suffix++);
+    } while (process_table_find_name(&process_table, default_name));
     gtk_entry_set_text(GTK_ENTRY(name_entry), default_name);
     gtk_entry_set_text(GTK_ENTRY(arrival_entry), "0");
     gtk_entry_set_text(GTK_ENTRY(burst_entry), "5");
     gtk_entry_set_text(GTK_ENTRY(priority_entry), "5");
+    gtk_entry_set_text(GTK_ENTRY(weight_entry), "0");
+    gtk_entry_set_text(GTK_ENTRY(group_entry), "/");
 
     gtk_widget_show_all(dialog);
 
     if (gtk_dialog_run(GTK_DIALOG(dialog)) == GTK_RESPONSE_OK) {
-        Process* p = &processes[process_count];
-        strncpy(p->name, gtk_entry_get_text(GTK_ENTRY(name_entry)), MAX_NAME_LEN - 1);
-        p->arrival_time = atoi(gtk_entry_get_text(GTK_ENTRY(arrival_entry)));
-        p->burst_time = atoi(gtk_entry_get_text(GTK_ENTRY(burst_entry)));
+        Process added;
+        Process* p = &added;
+        const char* name = gtk_entry_get_text(GTK_ENTRY(name_entry));
+        memset(p, 0, sizeof(*p));
+        if (process_table_find_name(&process_table, name)) {
+            GtkWidget* error = gtk_message_dialog_new(GTK_WINDOW(main_window),
+                GTK_DIALOG_MODAL, GTK_MESSAGE_ERROR, GTK_BUTTONS_OK,
+                "There is already a process named %s.", name);
+            gtk_dialog_run(GTK_DIALOG(error));
+            gtk_widget_destroy(error);
+            gtk_widget_destroy(dialog);
+            return;
+        }
+        int group = find_group(&group_config, gtk_entry_get_text(GTK_ENTRY(group_entry)));
+        if (group < 0) {
+            GtkWidget* error = gtk_message_dialog_new(GTK_WINDOW(main_window),
+                GTK_DIALOG_MODAL, GTK_MESSAGE_ERROR, GTK_BUTTONS_OK,
+                "There is no group %s. Define it under Groups first.", gtk_entry_get_text(GTK_ENTRY(group_entry)));
+            gtk_dialog_run(GTK_DIALOG(error));
+            gtk_widget_destroy(error);
+            gtk_widget_destroy(dialog);
+            return;
+        }
+        const char* arrival_text = gtk_entry_get_text(GTK_ENTRY(arrival_entry));
+        char* arrival_end;
+        p->arrival_time = parse_time(arrival_text, &arrival_end);
+        if (arrival_end == arrival_text || *arrival_end != '\0' || p->arrival_time < 0) {
+            GtkWidget* error = gtk_message_dialog_new(GTK_WINDOW(main_window),
+                GTK_DIALOG_MODAL, GTK_MESSAGE_ERROR, GTK_BUTTONS_OK,
+                "Arrival time %s is not a time of 0 or more.\nGive a whole number of %s%s.", arrival_text,
+                time_unit == TIME_UNIT_NONE ? "time units" : "ticks",
+                time_unit == TIME_UNIT_NONE ? "" : ", or a time such as 1.5ms that comes to one");
+            gtk_dialog_run(GTK_DIALOG(error));
+            gtk_widget_destroy(error);
+            gtk_widget_destroy(dialog);
+            return;
+        }
+        // New resource names only join the table once the process is added
+        char message[256];
+        ResourceTable resources = resource_table;
+        if (!parse_process_bursts(gtk_entry_get_text(GTK_ENTRY(burst_entry)), p, &resources,
+                message, sizeof(message))) {
+            GtkWidget* error = gtk_message_dialog_new(GTK_WINDOW(main_window),
+                GTK_DIALOG_MODAL, GTK_MESSAGE_ERROR, GTK_BUTTONS_OK,
+                "%s.\nFor example 4,10,3, or 10@2 to send an I/O burst to device 2,\n"
+                "or 8[db:2-5] to hold db from 2 to 5 units of CPU time.", message);
+            gtk_dialog_run(GTK_DIALOG(error));
+            gtk_widget_destroy(error);
+            gtk_widget_destroy(dialog);
+            return;
+        }
+        snprintf(p->name, MAX_NAME_LEN, "%.*s", MAX_NAME_LEN - 1, name);
         p->priority = atoi(gtk_entry_get_text(GTK_ENTRY(priority_entry)));
 
+        p->weight = atoi(gtk_entry_get_text(GTK_ENTRY(weight_entry)));
+        p->group = group;
+        resource_table = resources;
+
         if (p->priority < 1) p->priority = 1;
         if (p->priority > 10) p->priority = 10;
+        if (p->weight < 0) p->weight = 0;
+        if (p->weight > MAX_WEIGHT) p->weight = MAX_WEIGHT;
 
         p->remaining_time = p->burst_time;
-        p->process_id = process_count + 1;
-        p->color = process_colors[process_count % 10];
+        p->color = process_colors[process_table.count % 10];
         p->start_time = -1;
         p->completion_time = 0;
         p->waiting_time = 0;
         p->turnaround_time = 0;
         p->response_time = -1;
 
-        process_count++;
-        update_process_list();
+        int slot = process_table_add(&process_table, p);
+        invalidate_arrival_order(&gui_sim);
+        clear_playback();
+        append_process_row(&process_table.slot[slot]);
     }
 
     gtk_widget_destroy(dialog);
 }
 
 void on_delete_process_clicked(GtkButton* button, gpointer user_data) {
-    if (process_count == 0) {
+    if (process_table.count == 0) {
         GtkWidget* dialog = gtk_message_dialog_new(GTK_WINDOW(main_window),
             GTK_DIALOG_MODAL, GTK_MESSAGE_INFO, GTK_BUTTONS_OK,
             "No processes to delete!");
@@ -612,17 +2908,15 @@ void on_delete_process_clicked(GtkButton* button, gpointer user_data) {
     GtkTreeIter iter;
 
     if (gtk_tree_selection_get_selected(selection, &model, &iter)) {
-        GtkTreePath* path = gtk_tree_model_get_path(model, &iter);
-        int index = gtk_tree_path_get_indices(path)[0];
-
-        // Remove process
-        for (int i = index; i < process_count - 1; i++) {
-            processes[i] = processes[i + 1];
-        }
-        process_count--;
-
-        update_process_list();
-        gtk_tree_path_free(path);
+        gint id;
+        gtk_tree_model_get(model, &iter, 0, &id, -1);
+
+        // The rest keep their order, which breaks ties; a row whose process
+        // is already gone just leaves the list
+        process_table_delete(&process_table, id);
+        gtk_list_store_remove(process_list_store, &iter);
+        invalidate_arrival_order(&gui_sim);
+        clear_playback();
     }
     else {
         GtkWidget* dialog = gtk_message_dialog_new(GTK_WINDOW(main_window),
@@ -636,7 +2930,7 @@ void on_delete_process_clicked(GtkButton* button, gpointer user_data) {
 void on_run_algorithm_clicked(GtkButton* button, gpointer user_data) {
     int algo = GPOINTER_TO_INT(user_data);
 
-    if (process_count == 0) {
+    if (process_table.count == 0) {
         GtkWidget* dialog = gtk_message_dialog_new(GTK_WINDOW(main_window),
             GTK_DIALOG_MODAL, GTK_MESSAGE_ERROR, GTK_BUTTONS_OK,
             "No processes available! Add some processes first.");
@@ -645,7 +2939,7 @@ void on_run_algorithm_clicked(GtkButton* button, gpointer user_data) {
         return;
     }
 
-    if (algo == ROUND_ROBIN) {
+    if (algo == ROUND_ROBIN || proportional_share(algo) || algorithm_plugin(algo)) {
         GtkWidget* dialog = gtk_dialog_new_with_buttons("Time Quantum",
             GTK_WINDOW(main_window), GTK_DIALOG_MODAL,
             "Cancel", GTK_RESPONSE_CANCEL,
@@ -662,759 +2956,10459 @@ void on_run_algorithm_clicked(GtkButton* button, gpointer user_data) {
         gtk_box_pack_start(GTK_BOX(box), label, FALSE, FALSE, 5);
         gtk_box_pack_start(GTK_BOX(box), entry, FALSE, FALSE, 5);
 
-        gtk_widget_show_all(dialog);
+        gtk_widget_show_all(dialog);
+
+        if (gtk_dialog_run(GTK_DIALOG(dialog)) == GTK_RESPONSE_OK) {
+            time_quantum = atoi(gtk_entry_get_text(GTK_ENTRY(entry)));
+            if (time_quantum <= 0) time_quantum = 2;
+            if (algo == STRIDE && time_quantum > MAX_STRIDE_QUANTUM) time_quantum = MAX_STRIDE_QUANTUM;
+        }
+        else {
+            gtk_widget_destroy(dialog);
+            return;
+        }
+        gtk_widget_destroy(dialog);
+    }
+
+    leave_trace_replay();
+    simulate_scheduling(algo);
+    update_process_list();
+    update_statistics();
+    reload_playback();
+    int chart_height = gantt_chart_height(&gui_sim);
+    gtk_widget_set_size_request(gantt_drawing_area, 800, chart_height > 400 ? chart_height : 400);
+    gtk_widget_queue_draw(gantt_drawing_area);
+    gtk_widget_queue_draw(performance_drawing_area);
+}
+
+void on_reset_clicked(GtkButton* button, gpointer user_data) {
+    leave_trace_replay();
+    reset_simulation();
+    update_process_list();
+    update_statistics();
+    reload_playback();
+    gtk_widget_queue_draw(gantt_drawing_area);
+    gtk_widget_queue_draw(performance_drawing_area);
+}
+
+void on_load_sample_clicked(GtkButton* button, gpointer user_data) {
+    checkpoint_log_reset(&checkpoint_log);
+    invalidate_arrival_order(&gui_sim);
+    clear_playback();
+    load_sample_processes();
+    assign_process_colors();
+    update_process_list();
+}
+
+void append_process_row(const Process* p) {
+    GtkTreeIter iter;
+    char locks[128];
+    format_lock_spans(p, &resource_table, locks, sizeof(locks));
+    gtk_list_store_append(process_list_store, &iter);
+    gtk_list_store_set(process_list_store, &iter,
+        0, p->process_id,
+        1, p->name,
+        2, (gint64)p->arrival_time,
+        3, (gint64)p->burst_time,
+        4, (gint64)io_total(p),
+        5, p->priority,
+        6, process_weight(p),
+        7, p->group > 0 ? group_config.group[p->group].path : "/",
+        8, locks,
+        9, (gint64)p->start_time,
+        10, (gint64)p->completion_time,
+        11, (gint64)p->turnaround_time,
+        -1);
+}
+
+void update_process_list() {
+    gtk_list_store_clear(process_list_store);
+
+    for (int slot = process_table.head; slot >= 0; slot = process_table.next[slot]) {
+        append_process_row(&process_table.slot[slot]);
+    }
+}
+
+void update_statistics() {
+    if (process_count == 0) return;
+
+    GtkTextBuffer* buffer = gtk_text_view_get_buffer(GTK_TEXT_VIEW(statistics_text_view));
+
+    // Grows as needed: groups, locks, shares and I/O can each add kilobytes
+    TextBuffer stats = { 0 };
+    text_append(&stats, "SCHEDULING STATISTICS\n");
+    text_append(&stats, "====================\n\n");
+
+    double total_tat = 0, total_wt = 0, total_rt = 0;
+
+    if (time_unit != TIME_UNIT_NONE) {
+        text_append(&stats, "Times in %s\n\n", time_unit_keys[time_unit]);
+    }
+    text_append(&stats, "Process Details:\n");
+    text_append(&stats, "Process\tAT\tBT\tCT\tTAT\tWT\tRT\n");
+    text_append(&stats, "-------\t--\t--\t--\t---\t--\t--\n");
+
+    for (int i = 0; i < process_count; i++) {
+        Process* p = &processes[i];
+        text_append(&stats, "%.*s\t%lld\t%lld\t%lld\t%lld\t%lld\t%lld\n",
+            MAX_NAME_LEN - 1, p->name, (long long)p->arrival_time, (long long)p->burst_time, (long long)p->completion_time,
+            (long long)p->turnaround_time, (long long)p->waiting_time, (long long)p->response_time);
+
+        total_tat += p->turnaround_time;
+        total_wt += p->waiting_time;
+        total_rt += p->response_time;
+    }
+
+    char avg_tat[32], avg_wt[32], avg_rt[32];
+    format_time(total_tat / process_count, 2, avg_tat, sizeof(avg_tat));
+    format_time(total_wt / process_count, 2, avg_wt, sizeof(avg_wt));
+    format_time(total_rt / process_count, 2, avg_rt, sizeof(avg_rt));
+    text_append(&stats,
+        "\nAVERAGES:\n"
+        "Average Turnaround Time: %s\n"
+        "Average Waiting Time: %s\n"
+        "Average Response Time: %s\n\n"
+        "Legend:\n"
+        "AT = Arrival Time\n"
+        "BT = Burst Time\n"
+        "CT = Completion Time\n"
+        "TAT = Turnaround Time\n"
+        "WT = Waiting Time (in the ready queue)\n"
+        "RT = Response Time\n",
+        avg_tat, avg_wt, avg_rt);
+
+    char tail[256];
+    format_tail_latency(&gui_sim, tail, sizeof(tail));
+    text_append(&stats, "\nTAIL LATENCY:\n%s", tail);
+
+    char switching[512];
+    format_switch_summary(&gui_sim, switching, sizeof(switching));
+    text_append(&stats, "\nCONTEXT SWITCHING:\n%s", switching);
+
+    if (gui_sim.io_log) {
+        char io_text[1024];
+        format_io_summary(&gui_sim, io_text, sizeof(io_text));
+        text_append(&stats, "\nI/O DEVICES:\n%s", io_text);
+    }
+
+    if (gui_sim.group_log) {
+        char groups_text[4096];
+        format_group_report(&gui_sim, last_run_algo, groups_text, sizeof(groups_text));
+        text_append(&stats, "\n%s", groups_text);
+    }
+
+    if (gui_sim.lock_log) {
+        char locks_text[4096];
+        format_lock_report(&gui_sim, locks_text, sizeof(locks_text));
+        text_append(&stats, "\n%s", locks_text);
+    }
+
+    // Windows of ten quanta: a few turns each for a handful of processes
+    if (proportional_share(last_run_algo)) {
+        char share[4096];
+        format_share_report(&gui_sim, last_run_algo, 10 * gui_sim.time_quantum, share, sizeof(share));
+        text_append(&stats, "\n%s", share);
+    }
+
+    if (algorithm_plugin(last_run_algo)) {
+        char timing[1024];
+        format_plugin_timing(algorithm_plugin(last_run_algo), timing, sizeof(timing));
+        text_append(&stats, "\nPLUGIN HOT PATH (all runs so far):\n%s", timing);
+    }
+
+    text_append(&stats,
+        "\nResult cache: %s (%d entries, %zu of %zu KB, %ld hits, %ld misses, %ld evictions)\n",
+        last_run_from_cache ? "restored this run" : "computed this run",
+        result_cache.entries, result_cache.bytes / 1024, result_cache.budget / 1024,
+        result_cache.hits, result_cache.misses, result_cache.evictions);
+
+    if (!last_run_from_cache && last_incremental.resumed) {
+        long total = last_incremental.total_dispatches;
+        text_append(&stats,
+            "Incremental run: resumed at t=%lld, skipped %ld of %ld scheduling decisions (%.1f%%)\n",
+            (long long)last_incremental.resume_time, last_incremental.skipped_dispatches, total,
+            total > 0 ? 100.0 * last_incremental.skipped_dispatches / total : 0.0);
+    }
+
+    gtk_text_buffer_set_text(buffer, stats.data, -1);
+    free(stats.data);
+}
+
+gboolean on_gantt_draw(GtkWidget* widget, cairo_t* cr, gpointer user_data) {
+    GtkAllocation allocation;
+    gtk_widget_get_allocation(widget, &allocation);
+
+    int width = allocation.width;
+    int height = allocation.height;
+
+    if (trace_replay_active) {
+        render_trace_gantt(cr, &trace_replay, 0, trace_replay_end(&trace_replay), width, height);
+        return FALSE;
+    }
+
+    if (gui_sim.gantt_count == 0) {
+        cairo_set_source_rgb(cr, 1.0, 1.0, 1.0);
+        cairo_paint(cr);
+        cairo_set_source_rgb(cr, 0.0, 0.0, 0.0);
+        cairo_move_to(cr, 20, height / 2);
+        cairo_show_text(cr, "No simulation data available. Run an algorithm first.");
+        return FALSE;
+    }
+
+    // Blocks are appended in time order, so the last one ends the run
+    SimTime total_time = gui_sim.gantt[gui_sim.gantt_count - 1].end_time;
+    if (total_time <= 0) total_time = 1;
+
+    render_gantt_chart(cr, &gui_sim, "Gantt Chart", 0, (double)total_time, width, height);
+
+    // Playback cursor; the part of the run after it is faded out
+    int chart_start_y = 50;
+    int chart_height = 40;
+    int chart_width = width - 100;
+    double time_scale = (double)chart_width / total_time;
+
+    if (playback.events && playback.time < total_time) {
+        double cursor_x = 50 + playback.time * time_scale;
+
+        cairo_set_source_rgba(cr, 1.0, 1.0, 1.0, 0.7);
+        cairo_rectangle(cr, cursor_x, chart_start_y, 50 + chart_width - cursor_x, chart_height);
+        cairo_fill(cr);
+
+        cairo_set_source_rgb(cr, 0.9, 0.0, 0.0);
+        cairo_set_line_width(cr, 2);
+        cairo_move_to(cr, cursor_x, chart_start_y - 10);
+        cairo_line_to(cr, cursor_x, chart_start_y + chart_height + 5);
+        cairo_stroke(cr);
+    }
+
+    return FALSE;
+}
+
+void gantt_painter_init(GanttPainter* painter, cairo_t* cr, int y, int height, double origin, double time_scale) {
+    painter->cr = cr;
+    painter->y = y;
+    painter->height = height;
+    painter->origin = origin;
+    painter->time_scale = time_scale;
+    painter->column = INT_MIN;
+    painter->column_busy = 0;
+    painter->column_longest = 0;
+}
+
+// One bar for the pixel column, shaded by how busy the CPU was in it
+void flush_gantt_column(GanttPainter* painter) {
+    if (painter->column == INT_MIN) return;
+
+    double coverage = painter->column_busy * painter->time_scale;
+    cairo_set_source_rgba(painter->cr, painter->column_color.red, painter->column_color.green,
+        painter->column_color.blue, coverage < 1.0 ? coverage : 1.0);
+    cairo_rectangle(painter->cr, painter->column, painter->y, 1, painter->height);
+    cairo_fill(painter->cr);
+
+    painter->column = INT_MIN;
+    painter->column_busy = 0;
+    painter->column_longest = 0;
+}
+
+// Draws the blocks that fall inside the area being repainted; playback
+// invalidates a thin strip per frame. Blocks narrower than GANTT_LOD_PIXELS
+// are merged into one bar per pixel column, coloured by the process that ran
+// longest in it, so a zoomed-out chart costs O(width) however long the run.
+void draw_gantt_blocks(GanttPainter* painter, const GanttBlock* blocks, int count) {
+    cairo_t* cr = painter->cr;
+    int y = painter->y;
+    int height = painter->height;
+    double time_scale = painter->time_scale;
+
+    double clip_x1, clip_y1, clip_x2, clip_y2;
+    cairo_clip_extents(cr, &clip_x1, &clip_y1, &clip_x2, &clip_y2);
+    double visible_from = painter->origin + (clip_x1 - 50 - 30) / time_scale;
+    double visible_to = painter->origin + (clip_x2 - 50) / time_scale;
+
+    int first = 0, last = count;
+    while (first < last) {
+        int mid = (first + last) / 2;
+        if (blocks[mid].end_time < visible_from) first = mid + 1;
+        else last = mid;
+    }
+
+    for (int i = first; i < count && blocks[i].start_time <= visible_to; i++) {
+        const GanttBlock* block = &blocks[i];
+
+        double start_x = 50 + ((block->start_time - painter->origin) * time_scale);
+        double block_width = (block->end_time - block->start_time) * time_scale;
+
+        if (block_width < GANTT_LOD_PIXELS) {
+            int column = (int)floor(start_x);
+            if (column != painter->column) {
+                flush_gantt_column(painter);
+                painter->column = column;
+            }
+            SimTime duration = block->end_time - block->start_time;
+            painter->column_busy += duration;
+            if (duration > painter->column_longest) {
+                painter->column_longest = duration;
+                painter->column_color = block->color;
+            }
+            continue;
+        }
+        flush_gantt_column(painter);
+
+        // Draw colored rectangle
+        cairo_set_source_rgba(cr, block->color.red, block->color.green,
+            block->color.blue, block->color.alpha);
+        cairo_rectangle(cr, start_x, y, block_width, height);
+        cairo_fill(cr);
+
+        // Switch overhead at the start of the block in dark grey
+        if (block->overhead > 0) {
+            cairo_set_source_rgb(cr, 0.35, 0.35, 0.35);
+            cairo_rectangle(cr, start_x, y, block->overhead * time_scale, height);
+            cairo_fill(cr);
+        }
+
+        // Draw border
+        cairo_set_source_rgb(cr, 0.0, 0.0, 0.0);
+        cairo_set_line_width(cr, 1);
+        cairo_rectangle(cr, start_x, y, block_width, height);
+        cairo_stroke(cr);
+
+        // Draw process name
+        cairo_set_source_rgb(cr, 0.0, 0.0, 0.0);
+        cairo_set_font_size(cr, 10);
+        cairo_move_to(cr, start_x + 2, y + height / 2 + 3);
+        cairo_show_text(cr, block->process_name);
+
+        // Draw time labels
+        cairo_set_font_size(cr, 8);
+        char time_str[24];
+        format_time(block->start_time, 0, time_str, sizeof(time_str));
+        cairo_move_to(cr, start_x, y + height + 15);
+        cairo_show_text(cr, time_str);
+    }
+}
+
+void draw_gantt_chunk(const GanttBlock* blocks, int count, void* data) {
+    draw_gantt_blocks(data, blocks, count);
+}
+
+// Like draw_gantt_blocks, but pages in only the spilled chunks on screen
+void draw_gantt_log(GanttPainter* painter, const GanttSpill* spill, const GanttBlock* blocks, int count) {
+    double clip_x1, clip_y1, clip_x2, clip_y2;
+    cairo_clip_extents(painter->cr, &clip_x1, &clip_y1, &clip_x2, &clip_y2);
+
+    visit_gantt_log(spill, blocks, count,
+        painter->origin + (clip_x1 - 50 - 30) / painter->time_scale,
+        painter->origin + (clip_x2 - 50) / painter->time_scale,
+        draw_gantt_chunk, painter);
+    flush_gantt_column(painter);
+}
+
+// Draws one time axis lane: the blocks between `from` and `to`, clipped to
+// the chart, with the end time under its right edge
+void draw_gantt_lane(cairo_t* cr, const GanttSpill* spill, const GanttBlock* blocks, int count,
+    double from, double to, int y, int lane_height, int chart_width) {
+    GanttPainter painter;
+
+    cairo_set_source_rgb(cr, 0.0, 0.0, 0.0);
+    cairo_set_line_width(cr, 1);
+    cairo_move_to(cr, 50, y + lane_height);
+    cairo_line_to(cr, 50 + chart_width, y + lane_height);
+    cairo_stroke(cr);
+
+    cairo_save(cr);
+    cairo_rectangle(cr, 50, y - 5, chart_width + 1, lane_height + 25);
+    cairo_clip(cr);
+    gantt_painter_init(&painter, cr, y, lane_height, from, chart_width / (to > from ? to - from : 1.0));
+    draw_gantt_log(&painter, spill, blocks, count);
+    cairo_restore(cr);
+
+    char time_str[24];
+    cairo_set_source_rgb(cr, 0.0, 0.0, 0.0);
+    cairo_set_font_size(cr, 8);
+    format_time(to, 0, time_str, sizeof(time_str));
+    cairo_move_to(cr, 50 + chart_width - 10, y + lane_height + 15);
+    cairo_show_text(cr, time_str);
+}
+
+// The Gantt chart of a run between two times, on any cairo surface
+void render_gantt_chart(cairo_t* cr, const Simulation* sim, const char* title, double from, double to,
+    int width, int height) {
+    // Clear background
+    cairo_set_source_rgb(cr, 1.0, 1.0, 1.0);
+    cairo_paint(cr);
+
+    // Draw title
+    cairo_set_source_rgb(cr, 0.0, 0.0, 0.0);
+    cairo_select_font_face(cr, "Arial", CAIRO_FONT_SLANT_NORMAL, CAIRO_FONT_WEIGHT_BOLD);
+    cairo_set_font_size(cr, 16);
+    cairo_move_to(cr, 20, 25);
+    cairo_show_text(cr, title);
+
+    const IoLog* log = sim->io_log;
+    const GroupLog* group_log = sim->group_log;
+    const LockLog* lock_log = sim->lock_log;
+    if (!log && !group_log && !lock_log) {
+        draw_gantt_lane(cr, sim->spill, sim->gantt, sim->gantt_count, from, to, 50, 40, width - 100);
+        return;
+    }
+
+    // A run with I/O gets one lane per device under the CPU, a run with
+    // groups one lane per group, shaded where the group was throttled, and a
+    // run with locks one lane per resource showing its holders, shaded where
+    // a process was blocked on it
+    int devices = log ? log->device_count : 0;
+    int groups = group_log ? group_log->group_count : 0;
+    int resources = lock_log ? lock_log->resource_count : 0;
+    int chart_width = width - 100;
+    double time_scale = chart_width / (to > from ? to - from : 1.0);
+
+    for (int lane = 0; lane <= devices + groups + resources; lane++) {
+        int y = 60 + lane * 70;
+        int g = lane - devices;
+        int r = lane - devices - groups - 1;
+        char label[128];
+
+        cairo_set_source_rgb(cr, 0.0, 0.0, 0.0);
+        cairo_set_font_size(cr, 11);
+        if (lane == 0) snprintf(label, sizeof(label), "CPU");
+        else if (r >= 0) {
+            int ceiling = INT_MAX;
+            for (int i = 0; i < sim->process_count; i++) {
+                for (int k = 0; k < sim->processes[i].lock_count; k++) {
+                    int priority = sim->processes[i].priority;
+                    if (sim->processes[i].locks[k].resource == r && priority < ceiling) ceiling = priority;
+                }
+            }
+            if (ceiling == INT_MAX) snprintf(label, sizeof(label), "Resource %s (unused)", sim->resources.name[r]);
+            else snprintf(label, sizeof(label), "Resource %s (ceiling %d)", sim->resources.name[r], ceiling);
+        }
+        else if (g <= 0) snprintf(label, sizeof(label), "Device %d (%s)", lane, io_discipline_keys[io_discipline(&sim->io, lane - 1)]);
+        else if (sim->groups.group[g].quota > 0) {
+            snprintf(label, sizeof(label), "Group %s (quota %d/%d)", sim->groups.group[g].path,
+                sim->groups.group[g].quota, sim->groups.group[g].period);
+        }
+        else snprintf(label, sizeof(label), "Group %s (no quota)", sim->groups.group[g].path);
+        cairo_move_to(cr, 50, y - 6);
+        cairo_show_text(cr, label);
+
+        if (lane == 0) {
+            draw_gantt_lane(cr, sim->spill, sim->gantt, sim->gantt_count, from, to, y, 40, chart_width);
+        }
+        else if (r >= 0) {
+            cairo_set_source_rgb(cr, 1.0, 0.85, 0.85);
+            for (long k = 0; k < lock_log->wait_count; k++) {
+                const LockWait* wait = &lock_log->waits[k];
+                if (wait->resource != r || wait->end <= from || wait->start >= to) continue;
+                double x0 = 50 + ((wait->start > from ? wait->start : from) - from) * time_scale;
+                double x1 = 50 + ((wait->end < to ? wait->end : to) - from) * time_scale;
+                cairo_rectangle(cr, x0, y, x1 - x0, 40);
+            }
+            cairo_fill(cr);
+            draw_gantt_lane(cr, NULL, lock_log->gantt[r], lock_log->gantt_count[r], from, to, y, 40, chart_width);
+        }
+        else if (g <= 0) {
+            draw_gantt_lane(cr, NULL, log->gantt[lane - 1], log->gantt_count[lane - 1], from, to, y, 40, chart_width);
+        }
+        else {
+            cairo_set_source_rgb(cr, 1.0, 0.85, 0.85);
+            for (long k = 0; k < group_log->span_count; k++) {
+                const ThrottleSpan* span = &group_log->spans[k];
+                if (span->group != g || span->end <= from || span->start >= to) continue;
+                double x0 = 50 + ((span->start > from ? span->start : from) - from) * time_scale;
+                double x1 = 50 + ((span->end < to ? span->end : to) - from) * time_scale;
+                cairo_rectangle(cr, x0, y, x1 - x0, 40);
+            }
+            cairo_fill(cr);
+            draw_gantt_lane(cr, NULL, group_log->gantt[g], group_log->gantt_count[g], from, to, y, 40, chart_width);
+        }
+    }
+}
+
+// Height render_gantt_chart needs for the lanes of a run
+int gantt_chart_height(const Simulation* sim) {
+    int lanes = (sim->io_log ? sim->io_log->device_count : 0) + (sim->group_log ? sim->group_log->group_count : 0) +
+        (sim->lock_log ? sim->lock_log->resource_count : 0);
+    return sim->io_log || sim->group_log || sim->lock_log ? 110 + 70 * lanes : 140;
+}
+
+SimTime trace_replay_end(const TraceReplay* tr) {
+    SimTime recorded_end = tr->recorded_count ? tr->recorded[tr->recorded_count - 1].end_time : 0;
+    SimTime simulated_end = tr->simulated.gantt_count ?
+        tr->simulated.gantt[tr->simulated.gantt_count - 1].end_time : 0;
+    SimTime total_time = recorded_end > simulated_end ? recorded_end : simulated_end;
+    return total_time > 0 ? total_time : 1;
+}
+
+// Recorded schedule above the simulated one, on a shared time axis
+void render_trace_gantt(cairo_t* cr, const TraceReplay* tr, double from, double to, int width, int height) {
+    int lane_height = 40;
+    int chart_width = width - 100;
+    const char* titles[2] = { "Recorded", "Simulated" };
+    const GanttBlock* lanes[2] = { tr->recorded, tr->simulated.gantt };
+    int counts[2] = { tr->recorded_count, tr->simulated.gantt_count };
+    const GanttSpill* spills[2] = { tr->recorded_spill, tr->simulated.spill };
+
+    cairo_set_source_rgb(cr, 1.0, 1.0, 1.0);
+    cairo_paint(cr);
+
+    cairo_set_source_rgb(cr, 0.0, 0.0, 0.0);
+    cairo_select_font_face(cr, "Arial", CAIRO_FONT_SLANT_NORMAL, CAIRO_FONT_WEIGHT_BOLD);
+    cairo_set_font_size(cr, 16);
+    cairo_move_to(cr, 20, 25);
+    cairo_show_text(cr, "Gantt Chart: Trace Replay");
+
+    for (int lane = 0; lane < 2; lane++) {
+        int y = 60 + lane * (lane_height + 50);
+        char title[64];
+
+        cairo_set_source_rgb(cr, 0.0, 0.0, 0.0);
+        cairo_set_font_size(cr, 11);
+        if (lane == 0) snprintf(title, sizeof(title), "%s (CPU %d)", titles[lane], tr->cpu);
+        else snprintf(title, sizeof(title), "%s (%s)", titles[lane], algorithm_keys[tr->algo - 1]);
+        cairo_move_to(cr, 50, y - 6);
+        cairo_show_text(cr, title);
+
+        draw_gantt_lane(cr, spills[lane], lanes[lane], counts[lane], from, to, y, lane_height, chart_width);
+    }
+}
+
+void stop_playback() {
+    if (playback_source) {
+        g_source_remove(playback_source);
+        playback_source = 0;
+    }
+}
+
+void clear_playback() {
+    stop_playback();
+    playback_free(&playback);
+    gtk_label_set_text(GTK_LABEL(playback_state_label), "Run an algorithm to enable playback.");
+}
+
+// Rebuilds the timeline from the last run and parks the cursor at its end
+void reload_playback() {
+    if (gui_sim.gantt_count == 0) {
+        clear_playback();
+        return;
+    }
+    // The timeline has no blocked state, so it would show waiting processes
+    // as ready, and its cursor covers only a single lane
+    if (gui_sim.io_log || gui_sim.group_log || gui_sim.lock_log) {
+        clear_playback();
+        gtk_label_set_text(GTK_LABEL(playback_state_label),
+            "Playback is not available for runs with I/O, bandwidth groups or locks.");
+        return;
+    }
+
+    stop_playback();
+    build_playback_timeline(&playback, processes, process_count, gui_sim.gantt, gui_sim.gantt_count);
+    playback_seek(&playback, playback.end_time);
+    playback_position = playback.end_time;
+
+    playback_slider_guard = 1;
+    gtk_range_set_range(GTK_RANGE(playback_scale), 0, playback.end_time > 0 ? playback.end_time : 1);
+    playback_slider_guard = 0;
+    refresh_playback(0);
+}
+
+// Updates the state panel and slider, and repaints only the strip of the
+// Gantt chart between the old and new cursor positions
+void refresh_playback(SimTime previous_time) {
+    char text[1024];
+    format_playback_state(&playback, text, sizeof(text));
+    gtk_label_set_text(GTK_LABEL(playback_state_label), text);
+
+    playback_slider_guard = 1;
+    gtk_range_set_value(GTK_RANGE(playback_scale), playback.time);
+    playback_slider_guard = 0;
+
+    GtkAllocation allocation;
+    gtk_widget_get_allocation(gantt_drawing_area, &allocation);
+    double time_scale = (double)(allocation.width - 100) / (playback.end_time > 0 ? playback.end_time : 1);
+    double x0 = 50 + previous_time * time_scale;
+    double x1 = 50 + playback.time * time_scale;
+    if (x0 > x1) {
+        double swap = x0;
+        x0 = x1;
+        x1 = swap;
+    }
+    gtk_widget_queue_draw_area(gantt_drawing_area, (int)x0 - 3, 0, (int)(x1 - x0) + 7, allocation.height);
+}
+
+gboolean on_playback_tick(gpointer user_data) {
+    gint64 now = g_get_monotonic_time();
+    double elapsed = (now - playback_last_tick) / 1e6;
+    SimTime previous_time = playback.time;
+    playback_last_tick = now;
+
+    // The whole run plays in about 20 seconds; the clock only moves on once
+    // the replay has caught up, so a frame never takes on more than its budget
+    double speed = playback.end_time / 20.0;
+    if (speed < 1) speed = 1;
+    if (playback.time >= (SimTime)playback_position) {
+        playback_position += speed * elapsed;
+    }
+    if (playback_position > playback.end_time) {
+        playback_position = playback.end_time;
+    }
+
+    int reached = playback_advance(&playback, (SimTime)playback_position, PLAYBACK_FRAME_EVENTS);
+    refresh_playback(previous_time);
+
+    if (reached && playback.time >= playback.end_time) {
+        playback_source = 0;
+        return FALSE;
+    }
+    return TRUE;
+}
+
+void on_playback_play_clicked(GtkButton* button, gpointer user_data) {
+    if (!playback.events || playback_source) return;
+
+    if (playback.time >= playback.end_time) {
+        SimTime previous_time = playback.time;
+        playback_seek(&playback, 0);
+        playback_position = 0;
+        refresh_playback(previous_time);
+    }
+
+    playback_last_tick = g_get_monotonic_time();
+    playback_source = g_timeout_add(PLAYBACK_FRAME_MS, on_playback_tick, NULL);
+}
+
+void on_playback_pause_clicked(GtkButton* button, gpointer user_data) {
+    stop_playback();
+}
+
+void on_playback_step_clicked(GtkButton* button, gpointer user_data) {
+    if (!playback.events) return;
+
+    SimTime previous_time = playback.time;
+    stop_playback();
+    playback_advance(&playback, playback_next_event_time(&playback), LONG_MAX);
+    playback_position = playback.time;
+    refresh_playback(previous_time);
+}
+
+void on_playback_scale_changed(GtkRange* range, gpointer user_data) {
+    if (playback_slider_guard || !playback.events) return;
+
+    SimTime previous_time = playback.time;
+    stop_playback();
+    playback_seek(&playback, (SimTime)gtk_range_get_value(range));
+    playback_position = playback.time;
+    refresh_playback(previous_time);
+}
+
+gboolean on_performance_draw(GtkWidget* widget, cairo_t* cr, gpointer user_data) {
+    GtkAllocation allocation;
+    gtk_widget_get_allocation(widget, &allocation);
+
+    render_performance_chart(cr, processes, process_count, allocation.width, allocation.height);
+    return FALSE;
+}
+
+// Turnaround, waiting and response bars per process, on any cairo surface
+void render_performance_chart(cairo_t* cr, const Process* procs, int count, int width, int height) {
+    // Clear background
+    cairo_set_source_rgb(cr, 1.0, 1.0, 1.0);
+    cairo_paint(cr);
+
+    if (count == 0) {
+        cairo_set_source_rgb(cr, 0.0, 0.0, 0.0);
+        cairo_move_to(cr, 20, height / 2);
+        cairo_show_text(cr, "No process data available.");
+        return;
+    }
+
+    // Draw title
+    cairo_set_source_rgb(cr, 0.0, 0.0, 0.0);
+    cairo_select_font_face(cr, "Arial", CAIRO_FONT_SLANT_NORMAL, CAIRO_FONT_WEIGHT_BOLD);
+    cairo_set_font_size(cr, 16);
+    cairo_move_to(cr, 20, 25);
+    cairo_show_text(cr, "Performance Matrix");
+
+    // Calculate chart dimensions
+    int chart_start_x = 80;
+    int chart_start_y = 60;
+    int chart_width = width - 150;
+    int chart_height = height - 120;
+    int bar_height = chart_height / (count * 3 + 2); // 3 metrics per process
+
+    // Find maximum values for scaling
+    SimTime max_tat = 0, max_wt = 0, max_rt = 0;
+    for (int i = 0; i < count; i++) {
+        if (procs[i].turnaround_time > max_tat) max_tat = procs[i].turnaround_time;
+        if (procs[i].waiting_time > max_wt) max_wt = procs[i].waiting_time;
+        if (procs[i].response_time > max_rt) max_rt = procs[i].response_time;
+    }
+    SimTime max_value = (max_tat > max_wt) ? ((max_tat > max_rt) ? max_tat : max_rt) :
+        ((max_wt > max_rt) ? max_wt : max_rt);
+
+    if (max_value == 0) max_value = 1; // Avoid division by zero
+
+    double scale = (double)chart_width / (double)max_value;
+
+    int y_pos = chart_start_y;
+
+    // Draw bars for each process
+    for (int i = 0; i < count; i++) {
+        const Process* p = &procs[i];
+
+        // Process name label
+        cairo_set_source_rgb(cr, 0.0, 0.0, 0.0);
+        cairo_set_font_size(cr, 10);
+        cairo_move_to(cr, 10, y_pos + bar_height / 2 + 3);
+        cairo_show_text(cr, p->name);
+
+        // Turnaround Time bar
+        cairo_set_source_rgb(cr, 0.8, 0.2, 0.2); // Red
+        cairo_rectangle(cr, chart_start_x, y_pos, p->turnaround_time * scale, bar_height - 2);
+        cairo_fill(cr);
+
+        // Value label
+        cairo_set_source_rgb(cr, 0.0, 0.0, 0.0);
+        cairo_set_font_size(cr, 8);
+        char val_str[40], time_str[24];
+        format_time(p->turnaround_time, 0, time_str, sizeof(time_str));
+        snprintf(val_str, sizeof(val_str), "TAT: %s", time_str);
+        cairo_move_to(cr, chart_start_x + p->turnaround_time * scale + 5, y_pos + bar_height / 2 + 3);
+        cairo_show_text(cr, val_str);
+
+        y_pos += bar_height;
+
+        // Waiting Time bar
+        cairo_set_source_rgb(cr, 0.2, 0.8, 0.2); // Green
+        cairo_rectangle(cr, chart_start_x, y_pos, p->waiting_time * scale, bar_height - 2);
+        cairo_fill(cr);
+
+        format_time(p->waiting_time, 0, time_str, sizeof(time_str));
+        snprintf(val_str, sizeof(val_str), "WT: %s", time_str);
+        cairo_move_to(cr, chart_start_x + p->waiting_time * scale + 5, y_pos + bar_height / 2 + 3);
+        cairo_show_text(cr, val_str);
+
+        y_pos += bar_height;
+
+        // Response Time bar
+        cairo_set_source_rgb(cr, 0.2, 0.2, 0.8); // Blue
+        cairo_rectangle(cr, chart_start_x, y_pos, p->response_time * scale, bar_height - 2);
+        cairo_fill(cr);
+
+        format_time(p->response_time, 0, time_str, sizeof(time_str));
+        snprintf(val_str, sizeof(val_str), "RT: %s", time_str);
+        cairo_move_to(cr, chart_start_x + p->response_time * scale + 5, y_pos + bar_height / 2 + 3);
+        cairo_show_text(cr, val_str);
+
+        y_pos += bar_height + 5;
+    }
+
+    // Draw legend
+    int legend_y = height - 40;
+    cairo_set_font_size(cr, 10);
+
+    cairo_set_source_rgb(cr, 0.8, 0.2, 0.2);
+    cairo_rectangle(cr, 20, legend_y, 15, 10);
+    cairo_fill(cr);
+    cairo_set_source_rgb(cr, 0.0, 0.0, 0.0);
+    cairo_move_to(cr, 40, legend_y + 8);
+    cairo_show_text(cr, "Turnaround Time");
+
+    cairo_set_source_rgb(cr, 0.2, 0.8, 0.2);
+    cairo_rectangle(cr, 150, legend_y, 15, 10);
+    cairo_fill(cr);
+    cairo_set_source_rgb(cr, 0.0, 0.0, 0.0);
+    cairo_move_to(cr, 170, legend_y + 8);
+    cairo_show_text(cr, "Waiting Time");
+
+    cairo_set_source_rgb(cr, 0.2, 0.2, 0.8);
+    cairo_rectangle(cr, 260, legend_y, 15, 10);
+    cairo_fill(cr);
+    cairo_set_source_rgb(cr, 0.0, 0.0, 0.0);
+    cairo_move_to(cr, 280, legend_y + 8);
+    cairo_show_text(cr, "Response Time");
+}
+
+void simulate_scheduling(SchedulingAlgorithm algo) {
+    // Runs index rows, so they work on a dense copy of the table
+    process_count = process_table_pack(&process_table, processes);
+    reset_simulation();
+    last_run_algo = algo;
+    gui_sim.processes = processes;
+    gui_sim.process_count = process_count;
+    gui_sim.time_quantum = time_quantum;
+    gui_sim.cost = switch_cost;
+    gui_sim.io = io_config;
+    gui_sim.aging_interval = (algo == PRIORITY || algo == PREEMPTIVE_PRIORITY) ? aging_interval : 0;
+    gui_sim.groups = group_config;
+    gui_sim.resources = resource_table;
+    gui_sim.lock_protocol = lock_protocol;
+
+    // The cache key does not cover I/O bursts, devices, groups or locks, and
+    // a plugin need not give the same schedule twice
+    if (workload_has_io(processes, process_count) || workload_has_groups(&gui_sim) || locks_apply(&gui_sim, algo) ||
+        algorithm_plugin(algo)) {
+        last_run_from_cache = 0;
+        run_incremental(&gui_sim, algo, &checkpoint_log, &last_incremental);
+        store_run_results();
+        return;
+    }
+
+    // Only the time-sliced policies depend on the quantum
+    int quantum = (algo == ROUND_ROBIN || proportional_share(algo)) ? time_quantum : 0;
+    WorkloadEntry* input = malloc(process_count * sizeof(WorkloadEntry) + 1);
+    snapshot_workload(processes, process_count, input);
+
+    CacheEntry* hit = cache_lookup(&result_cache, input, process_count, algo, quantum, &switch_cost,
+        gui_sim.aging_interval);
+    last_run_from_cache = hit != NULL;
+    if (hit) {
+        for (int i = 0; i < process_count; i++) {
+            copy_process_results(&processes[i], &hit->processes[i]);
+        }
+        copy_gantt(&gui_sim, hit->gantt, hit->gantt_count);
+        gui_sim.switches = hit->switches;
+        gui_sim.overhead_time = hit->overhead_time;
+    }
+    else {
+        // The event-driven engines match the reference loops and can resume
+        // from a checkpoint after processes are added or deleted
+        run_incremental(&gui_sim, algo, &checkpoint_log, &last_incremental);
+        cache_store(&result_cache, input, algo, quantum, &gui_sim);
+    }
+
+    free(input);
+    store_run_results();
+}
+
+// Copies the last run's results back to the table's processes by id
+void store_run_results() {
+    for (int i = 0; i < process_count; i++) {
+        Process* p = process_table_find(&process_table, processes[i].process_id);
+        if (p) copy_process_results(p, &processes[i]);
+    }
+}
+
+void run_scheduler(Simulation* sim, SchedulingAlgorithm algo) {
+    begin_run(sim);
+
+    switch (algo) {
+    case FCFS:
+        fcfs_scheduling(sim);
+        break;
+    case SJF:
+        sjf_scheduling(sim);
+        break;
+    case SRTF:
+        srtf_scheduling(sim);
+        break;
+    case PRIORITY:
+        priority_scheduling(sim);
+        break;
+    case ROUND_ROBIN:
+        round_robin_scheduling(sim);
+        break;
+    case PREEMPTIVE_PRIORITY:
+        preemptive_priority_scheduling(sim);
+        break;
+    case STRIDE:
+        stride_scheduling(sim);
+        break;
+    case LOTTERY:
+        lottery_scheduling(sim);
+        break;
+    }
+
+    calculate_times(sim);
+}
+
+void fcfs_scheduling(Simulation* sim) {
+    Process* procs = sim->processes;
+
+    // Visit processes by arrival time without reordering the table
+    const int* order = simulation_arrival_order(sim);
+
+    sim->current_time = 0;
+    for (int i = 0; i < sim->process_count; i++) {
+        Process* p = &procs[order[i]];
+
+        if (sim->current_time < p->arrival_time) {
+            sim->current_time = p->arrival_time;
+        }
+
+        int overhead = switch_overhead(sim, order[i]);
+        p->start_time = sim->current_time + overhead;
+        p->completion_time = p->start_time + p->burst_time;
+
+        // Add to Gantt chart
+        add_gantt_block(sim, p, sim->current_time, p->completion_time, overhead);
+
+        sim->current_time = p->completion_time;
+        p->last_run_end = sim->current_time;
+    }
+}
+
+void sjf_scheduling(Simulation* sim) {
+    Process* procs = sim->processes;
+    int completed = 0;
+    sim->current_time = 0;
+
+    // Mark all processes as not completed
+    int* is_completed = calloc(sim->process_count, sizeof(int));
+
+    while (completed != sim->process_count) {
+        int shortest = -1;
+        SimTime min_burst = INT64_MAX;
+
+        // Find shortest job among arrived processes
+        for (int i = 0; i < sim->process_count; i++) {
+            if (!is_completed[i] && procs[i].arrival_time <= sim->current_time) {
+                if (procs[i].burst_time < min_burst) {
+                    min_burst = procs[i].burst_time;
+                    shortest = i;
+                }
+            }
+        }
+
+        if (shortest == -1) {
+            sim->current_time++;
+            continue;
+        }
+
+        Process* p = &procs[shortest];
+        int overhead = switch_overhead(sim, shortest);
+        p->start_time = sim->current_time + overhead;
+        p->completion_time = p->start_time + p->burst_time;
+
+        // Add to Gantt chart
+        add_gantt_block(sim, p, sim->current_time, p->completion_time, overhead);
+
+        sim->current_time = p->completion_time;
+        p->last_run_end = sim->current_time;
+        is_completed[shortest] = 1;
+        completed++;
+    }
+
+    free(is_completed);
+}
+
+void srtf_scheduling(Simulation* sim) {
+    Process* procs = sim->processes;
+    int completed = 0;
+    sim->current_time = 0;
+    int* is_completed = calloc(sim->process_count, sizeof(int));
+
+    // Reset remaining times
+    for (int i = 0; i < sim->process_count; i++) {
+        procs[i].remaining_time = procs[i].burst_time;
+        procs[i].start_time = -1;
+        procs[i].last_run_end = -1;
+    }
+
+    while (completed != sim->process_count) {
+        int shortest = -1;
+        SimTime min_remaining = INT64_MAX;
+
+        // Find process with shortest remaining time
+        for (int i = 0; i < sim->process_count; i++) {
+            if (!is_completed[i] && procs[i].arrival_time <= sim->current_time) {
+                if (procs[i].remaining_time < min_remaining) {
+                    min_remaining = procs[i].remaining_time;
+                    shortest = i;
+                }
+            }
+        }
+
+        if (shortest == -1) {
+            sim->current_time++;
+            continue;
+        }
+
+        Process* p = &procs[shortest];
+
+        // A switch is paid for before the first unit runs; arrivals during
+        // it are only considered after that unit
+        SimTime dispatched = sim->current_time;
+        int overhead = switch_overhead(sim, shortest);
+        sim->current_time += overhead;
+
+        // Set start time if first execution
+        if (p->start_time == -1) {
+            p->start_time = sim->current_time;
+        }
+
+        // Execute for 1 time unit
+        p->remaining_time--;
+
+        // Add/update Gantt chart entry
+        if (overhead > 0 || !extends_last_block(sim, p)) {
+            add_gantt_block(sim, p, dispatched, sim->current_time + 1, overhead);
+        }
+        else {
+            sim->gantt[sim->gantt_count - 1].end_time = sim->current_time + 1;
+        }
+
+        sim->current_time++;
+        p->last_run_end = sim->current_time;
+
+        // Mark as completed if finished
+        if (p->remaining_time == 0) {
+            p->completion_time = sim->current_time;
+            is_completed[shortest] = 1;
+            completed++;
+        }
+    }
+
+    free(is_completed);
+}
+
+void priority_scheduling(Simulation* sim) {
+    Process* procs = sim->processes;
+    int completed = 0;
+    sim->current_time = 0;
+    int* is_completed = calloc(sim->process_count, sizeof(int));
+
+    // Aged ranks count the CPU time used so far
+    for (int i = 0; i < sim->process_count; i++) {
+        procs[i].remaining_time = procs[i].burst_time;
+    }
+
+    while (completed != sim->process_count) {
+        int highest_priority = -1;
+        SimTime min_priority = INT64_MAX;
+
+        // Find highest priority process (lower number = higher priority)
+        for (int i = 0; i < sim->process_count; i++) {
+            if (!is_completed[i] && procs[i].arrival_time <= sim->current_time) {
+                SimTime priority = aged_priority(sim, &procs[i]);
+                if (priority < min_priority) {
+                    min_priority = priority;
+                    highest_priority = i;
+                }
+            }
+        }
+
+        if (highest_priority == -1) {
+            sim->current_time++;
+            continue;
+        }
+
+        Process* p = &procs[highest_priority];
+        int overhead = switch_overhead(sim, highest_priority);
+        p->start_time = sim->current_time + overhead;
+        p->completion_time = p->start_time + p->burst_time;
+
+        // Add to Gantt chart
+        add_gantt_block(sim, p, sim->current_time, p->completion_time, overhead);
+
+        sim->current_time = p->completion_time;
+        p->last_run_end = sim->current_time;
+        p->remaining_time = 0;
+        is_completed[highest_priority] = 1;
+        completed++;
+    }
+
+    free(is_completed);
+}
+
+void round_robin_scheduling(Simulation* sim) {
+    Process* procs = sim->processes;
+    int completed = 0;
+    sim->current_time = 0;
+
+    // Circular queue: each process is queued at most once at any time
+    int capacity = sim->process_count + 1;
+    int* queue = malloc(capacity * sizeof(int));
+    int front = 0, rear = 0;
+    int* in_queue = calloc(sim->process_count, sizeof(int));
+
+    // Reset remaining times
+    for (int i = 0; i < sim->process_count; i++) {
+        procs[i].remaining_time = procs[i].burst_time;
+        procs[i].start_time = -1;
+        procs[i].last_run_end = -1;
+    }
+
+    // Add processes that arrive at time 0
+    for (int i = 0; i < sim->process_count; i++) {
+        if (procs[i].arrival_time == 0) {
+            queue[rear] = i;
+            rear = (rear + 1) % capacity;
+            in_queue[i] = 1;
+        }
+    }
+
+    while (completed != sim->process_count) {
+        if (front == rear) {
+            // Find next arriving process
+            SimTime next_arrival = INT64_MAX;
+            for (int i = 0; i < sim->process_count; i++) {
+                if (procs[i].arrival_time > sim->current_time &&
+                    procs[i].arrival_time < next_arrival &&
+                    procs[i].remaining_time > 0) {
+                    next_arrival = procs[i].arrival_time;
+                }
+            }
+            if (next_arrival != INT64_MAX) {
+                sim->current_time = next_arrival;
+                for (int i = 0; i < sim->process_count; i++) {
+                    if (procs[i].arrival_time <= sim->current_time &&
+                        !in_queue[i] && procs[i].remaining_time > 0) {
+                        queue[rear] = i;
+                        rear = (rear + 1) % capacity;
+                        in_queue[i] = 1;
+                    }
+                }
+            }
+            continue;
+        }
+
+        int current_process = queue[front];
+        front = (front + 1) % capacity;
+        Process* p = &procs[current_process];
+
+        // The switch comes out of the CPU's time, not the quantum
+        SimTime dispatched = sim->current_time;
+        int overhead = switch_overhead(sim, current_process);
+        sim->current_time += overhead;
+
+        // Set start time if first execution
+        if (p->start_time == -1) {
+            p->start_time = sim->current_time;
+        }
+
+        // Execute for time quantum or remaining time, whichever is smaller
+        SimTime execution_time = (p->remaining_time < sim->time_quantum) ? p->remaining_time : sim->time_quantum;
+
+        // Add to Gantt chart
+        add_gantt_block(sim, p, dispatched, sim->current_time + execution_time, overhead);
+
+        sim->current_time += execution_time;
+        p->remaining_time -= execution_time;
+        p->last_run_end = sim->current_time;
+
+        // Add newly arrived processes to queue
+        for (int i = 0; i < sim->process_count; i++) {
+            if (procs[i].arrival_time <= sim->current_time &&
+                !in_queue[i] && procs[i].remaining_time > 0) {
+                queue[rear] = i;
+                rear = (rear + 1) % capacity;
+                in_queue[i] = 1;
+            }
+        }
+
+        if (p->remaining_time == 0) {
+            p->completion_time = sim->current_time;
+            in_queue[current_process] = 0;
+            completed++;
+        }
+        else {
+            // Add back to queue if not completed
+            queue[rear] = current_process;
+            rear = (rear + 1) % capacity;
+        }
+    }
+
+    free(queue);
+    free(in_queue);
+}
+
+// With a workload that takes resources, blocked processes are passed over
+// and the others rank as the lock protocol says
+void preemptive_priority_scheduling(Simulation* sim) {
+    Process* procs = sim->processes;
+    int completed = 0;
+    sim->current_time = 0;
+    int* is_completed = calloc(sim->process_count, sizeof(int));
+    LockState locks;
+    SimTime* own = NULL;
+    int* active = NULL;
+    int has_locks = workload_has_locks(procs, sim->process_count);
+
+    // Reset remaining times
+    for (int i = 0; i < sim->process_count; i++) {
+        procs[i].remaining_time = procs[i].burst_time;
+        procs[i].start_time = -1;
+        procs[i].last_run_end = -1;
+    }
+    if (has_locks) {
+        lock_state_init(&locks, sim);
+        own = malloc(sim->process_count * sizeof(SimTime));
+        active = malloc(sim->process_count * sizeof(int));
+    }
+
+    while (completed != sim->process_count) {
+        int highest_priority = -1;
+        SimTime min_priority = INT64_MAX;
+
+        if (has_locks) {
+            for (int i = 0; i < sim->process_count; i++) {
+                active[i] = !is_completed[i] && procs[i].arrival_time <= sim->current_time;
+                own[i] = aged_priority(sim, &procs[i]);
+                if (procs[i].last_run_end == sim->current_time) own[i] -= sim->aging_interval;
+            }
+            lock_update(&locks, own, active);
+        }
+
+        // Find highest priority process among arrived processes
+        for (int i = 0; i < sim->process_count; i++) {
+            if (!is_completed[i] && procs[i].arrival_time <= sim->current_time) {
+                SimTime priority = aged_priority(sim, &procs[i]);
+                // With aging, the process that ran the last unit is a level ahead
+                if (procs[i].last_run_end == sim->current_time) priority -= sim->aging_interval;
+                if (has_locks) {
+                    if (locks.blocked_on[i] >= 0) continue;
+                    priority = locks.rank[i];
+                }
+                if (priority < min_priority) {
+                    min_priority = priority;
+                    highest_priority = i;
+                }
+            }
+        }
+
+        if (highest_priority == -1) {
+            sim->current_time++;
+            continue;
+        }
+
+        Process* p = &procs[highest_priority];
+
+        // A switch is paid for before the first unit runs; arrivals during
+        // it are only considered after that unit
+        SimTime dispatched = sim->current_time;
+        int overhead = switch_overhead(sim, highest_priority);
+        sim->current_time += overhead;
+
+        // Set start time if first execution
+        if (p->start_time == -1) {
+            p->start_time = sim->current_time;
+        }
+        if (has_locks) lock_acquire(&locks, highest_priority, sim->current_time);
+
+        // Execute for 1 time unit
+        p->remaining_time--;
+
+        // Add/update Gantt chart entry
+        if (overhead > 0 || !extends_last_block(sim, p)) {
+            add_gantt_block(sim, p, dispatched, sim->current_time + 1, overhead);
+        }
+        else {
+            sim->gantt[sim->gantt_count - 1].end_time = sim->current_time + 1;
+        }
+
+        sim->current_time++;
+        p->last_run_end = sim->current_time;
+        if (has_locks) {
+            lock_account(&locks, highest_priority, dispatched, sim->current_time);
+            lock_release(&locks, highest_priority, sim->current_time);
+        }
+
+        // Mark as completed if finished
+        if (p->remaining_time == 0) {
+            p->completion_time = sim->current_time;
+            is_completed[highest_priority] = 1;
+            completed++;
+        }
+    }
+
+    free(is_completed);
+    if (has_locks) {
+        lock_state_free(&locks);
+        free(own);
+        free(active);
+    }
+}
+
+// Each process has a pass value that grows by STRIDE_ONE / weight for every
+// unit it runs; the process with the lowest pass runs next for up to one
+// quantum. A process joins at the pass of the last process dispatched, so
+// it neither owes time nor is owed any.
+void stride_scheduling(Simulation* sim) {
+    Process* procs = sim->processes;
+    int completed = 0;
+    int64_t* pass = calloc(sim->process_count + 1, sizeof(int64_t));
+    int* joined = calloc(sim->process_count + 1, sizeof(int));
+    int64_t global_pass = 0;
+    sim->current_time = 0;
+
+    for (int i = 0; i < sim->process_count; i++) {
+        procs[i].remaining_time = procs[i].burst_time;
+        procs[i].start_time = -1;
+        procs[i].last_run_end = -1;
+    }
+
+    while (completed != sim->process_count) {
+        int chosen = -1;
+
+        for (int i = 0; i < sim->process_count; i++) {
+            if (!joined[i] && procs[i].arrival_time <= sim->current_time) {
+                joined[i] = 1;
+                pass[i] = global_pass;
+            }
+            if (joined[i] && procs[i].remaining_time > 0 && (chosen == -1 || pass[i] < pass[chosen])) {
+                chosen = i;
+            }
+        }
+
+        if (chosen == -1) {
+            sim->current_time++;
+            continue;
+        }
+
+        Process* p = &procs[chosen];
+        global_pass = pass[chosen];
+
+        SimTime dispatched = sim->current_time;
+        int overhead = switch_overhead(sim, chosen);
+        sim->current_time += overhead;
+        if (p->start_time == -1) {
+            p->start_time = sim->current_time;
+        }
+
+        SimTime execution_time = (p->remaining_time < sim->time_quantum) ? p->remaining_time : sim->time_quantum;
+        add_gantt_block(sim, p, dispatched, sim->current_time + execution_time, overhead);
+        sim->current_time += execution_time;
+        p->remaining_time -= execution_time;
+        p->last_run_end = sim->current_time;
+        pass[chosen] += (int64_t)process_stride(p) * execution_time;
+
+        if (p->remaining_time == 0) {
+            p->completion_time = sim->current_time;
+            completed++;
+        }
+    }
+
+    free(pass);
+    free(joined);
+}
+
+// Before each quantum one ticket is drawn from all the ready processes'
+// tickets, a process holding as many as its weight. Tickets are numbered in
+// table order, so the same draw always picks the same process.
+void lottery_scheduling(Simulation* sim) {
+    Process* procs = sim->processes;
+    int completed = 0;
+    RngState rng;
+    rng_seed(&rng, sim->seed, 0);
+    sim->current_time = 0;
+
+    for (int i = 0; i < sim->process_count; i++) {
+        procs[i].remaining_time = procs[i].burst_time;
+        procs[i].start_time = -1;
+        procs[i].last_run_end = -1;
+    }
+
+    while (completed != sim->process_count) {
+        int64_t tickets = 0;
+        for (int i = 0; i < sim->process_count; i++) {
+            if (procs[i].arrival_time <= sim->current_time && procs[i].remaining_time > 0) {
+                tickets += process_weight(&procs[i]);
+            }
+        }
+
+        if (tickets == 0) {
+            sim->current_time++;
+            continue;
+        }
+
+        int64_t ticket = (int64_t)(rng_next(&rng) % (uint64_t)tickets);
+        int chosen = 0;
+        for (int i = 0; i < sim->process_count; i++) {
+            if (procs[i].arrival_time <= sim->current_time && procs[i].remaining_time > 0) {
+                if (ticket < process_weight(&procs[i])) {
+                    chosen = i;
+                    break;
+                }
+                ticket -= process_weight(&procs[i]);
+            }
+        }
+
+        Process* p = &procs[chosen];
+        SimTime dispatched = sim->current_time;
+        int overhead = switch_overhead(sim, chosen);
+        sim->current_time += overhead;
+        if (p->start_time == -1) {
+            p->start_time = sim->current_time;
+        }
+
+        SimTime execution_time = (p->remaining_time < sim->time_quantum) ? p->remaining_time : sim->time_quantum;
+        add_gantt_block(sim, p, dispatched, sim->current_time + execution_time, overhead);
+        sim->current_time += execution_time;
+        p->remaining_time -= execution_time;
+        p->last_run_end = sim->current_time;
+
+        if (p->remaining_time == 0) {
+            p->completion_time = sim->current_time;
+            completed++;
+        }
+    }
+}
+
+void calculate_times(Simulation* sim) {
+    for (int i = 0; i < sim->process_count; i++) {
+        Process* p = &sim->processes[i];
+        p->turnaround_time = p->completion_time - p->arrival_time;
+        p->waiting_time = p->turnaround_time - p->burst_time - p->blocked_time;
+
+        // Response time is start time - arrival time
+        if (p->start_time != -1) {
+            p->response_time = p->start_time - p->arrival_time;
+        }
+        else {
+            p->response_time = 0;
+        }
+
+        // Ensure non-negative values
+        if (p->waiting_time < 0) p->waiting_time = 0;
+        if (p->response_time < 0) p->response_time = 0;
+    }
+}
+
+void reset_simulation() {
+    gui_sim.gantt_count = 0;
+    gui_sim.current_time = 0;
+    io_log_free(gui_sim.io_log);
+    gui_sim.io_log = NULL;
+    group_log_free(gui_sim.group_log);
+    gui_sim.group_log = NULL;
+    lock_log_free(gui_sim.lock_log);
+    gui_sim.lock_log = NULL;
+
+    reset_process_state(processes, process_count);
+    for (int slot = process_table.head; slot >= 0; slot = process_table.next[slot]) {
+        reset_process_state(&process_table.slot[slot], 1);
+    }
+
+    // Clear statistics
+    GtkTextBuffer* buffer = gtk_text_view_get_buffer(GTK_TEXT_VIEW(statistics_text_view));
+    gtk_text_buffer_set_text(buffer, "Run a scheduling algorithm to see statistics.", -1);
+}
+
+void load_sample_processes() {
+    // Sample process data: name, arrival, burst, priority
+    static const struct {
+        const char* name;
+        SimTime arrival_time;
+        SimTime burst_time;
+        int priority;
+    } samples[] = {
+        { "P1", 0, 6, 3 },
+        { "P2", 1, 4, 1 },
+        { "P3", 2, 3, 4 },
+        { "P4", 3, 2, 2 },
+        { "P5", 4, 5, 5 },
+    };
+
+    process_table_clear(&process_table);
+    for (int i = 0; i < 5; i++) {
+        Process p;
+        memset(&p, 0, sizeof(p));
+        strcpy(p.name, samples[i].name);
+        p.arrival_time = samples[i].arrival_time;
+        p.burst_time = samples[i].burst_time;
+        p.priority = samples[i].priority;
+        p.color = process_colors[i % 10];
+        reset_process_state(&p, 1);
+        process_table_add(&process_table, &p);
+    }
+}
+
+// Simulation helpers
+
+void init_simulation(Simulation* sim, Process* procs, int count, int quantum) {
+    sim->processes = procs;
+    sim->process_count = count;
+    sim->gantt = NULL;
+    sim->gantt_count = 0;
+    sim->gantt_capacity = 0;
+    sim->record_gantt = 1;
+    sim->time_quantum = quantum;
+    sim->current_time = 0;
+    sim->arrival_order = NULL;
+    sim->spill = NULL;
+    sim->cost = (SwitchCost){ 0, 0, 0 };
+    sim->last_process = -1;
+    sim->switches = 0;
+    sim->overhead_time = 0;
+    sim->io = (IoConfig){ 0, { IO_FCFS } };
+    sim->io_log = NULL;
+    sim->aging_interval = 0;
+    sim->seed = 1;
+    sim->groups.count = 0;
+    sim->group_log = NULL;
+    sim->resources.count = 0;
+    sim->lock_protocol = LOCK_NONE;
+    sim->lock_log = NULL;
+}
+
+void reset_process_state(Process* procs, int count) {
+    for (int i = 0; i < count; i++) {
+        procs[i].remaining_time = procs[i].burst_time;
+        procs[i].start_time = -1;
+        procs[i].completion_time = 0;
+        procs[i].waiting_time = 0;
+        procs[i].turnaround_time = 0;
+        procs[i].response_time = -1;
+        procs[i].last_run_end = -1;
+        procs[i].io_next = 0;
+        procs[i].blocked_time = 0;
+        procs[i].throttled_time = 0;
+        procs[i].lock_wait_time = 0;
+    }
+}
+
+void free_simulation(Simulation* sim) {
+    invalidate_arrival_order(sim);
+    gantt_spill_free(sim->spill);
+    sim->spill = NULL;
+    free(sim->gantt);
+    sim->gantt = NULL;
+    sim->gantt_count = 0;
+    sim->gantt_capacity = 0;
+    io_log_free(sim->io_log);
+    sim->io_log = NULL;
+    group_log_free(sim->group_log);
+    sim->group_log = NULL;
+    lock_log_free(sim->lock_log);
+    sim->lock_log = NULL;
+}
+
+void add_gantt_block(Simulation* sim, const Process* p, SimTime start, SimTime end, int overhead) {
+    if (!sim->record_gantt) return;
+    if (sim->spill) gantt_spill_chunk(sim->spill, sim->gantt, &sim->gantt_count);
+
+    if (sim->gantt_count == sim->gantt_capacity) {
+        sim->gantt_capacity = sim->gantt_capacity ? sim->gantt_capacity * 2 : MAX_PROCESSES * 10;
+        sim->gantt = realloc(sim->gantt, sim->gantt_capacity * sizeof(GanttBlock));
+    }
+
+    GanttBlock* block = &sim->gantt[sim->gantt_count++];
+    strcpy(block->process_name, p->name);
+    block->start_time = start;
+    block->end_time = end;
+    block->process_index = (int)(p - sim->processes);
+    block->overhead = overhead;
+    block->color = p->color;
+}
+
+// Whether p ran in the latest Gantt block, which a slice with no switch in
+// between extends rather than starting a new one. Names can repeat, so the
+// block's row decides.
+int extends_last_block(const Simulation* sim, const Process* p) {
+    return sim->gantt_count > 0 && sim->gantt[sim->gantt_count - 1].process_index == (int)(p - sim->processes);
+}
+
+// Time charged for handing the CPU to processes[index] at the current time:
+// nothing when it already holds the CPU, otherwise the dispatch cost plus
+// its cache penalty. Every scheduler calls this once per dispatch.
+int switch_overhead(Simulation* sim, int index) {
+    if (index == sim->last_process) return 0;
+    sim->last_process = index;
+    sim->switches++;
+
+    const SwitchCost* cost = &sim->cost;
+    int overhead = cost->dispatch;
+    if (cost->cache_penalty > 0) {
+        const Process* p = &sim->processes[index];
+        SimTime away = p->last_run_end < 0 ? INT64_MAX : sim->current_time - p->last_run_end;
+        if (cost->cache_decay <= 0 || away >= cost->cache_decay) {
+            overhead += cost->cache_penalty;
+        }
+        else {
+            overhead += (int)((cost->cache_penalty * away + cost->cache_decay - 1) / cost->cache_decay);
+        }
+    }
+    sim->overhead_time += overhead;
+    return overhead;
+}
+
+// Rank of p under the priority policies, lower first. With aging, a process
+// gains one level for every aging_interval units it has spent waiting for the
+// CPU. Scaled by the interval and with the current time taken off every rank
+// alike, that is priority * interval plus the time it did not wait: arrival,
+// CPU used and I/O. The rank stays fixed while a process waits, so nothing
+// has to be updated as time passes; only the running process's rank moves.
+// Preemptive Priority gives the running process a level's head start, so a
+// waiting process has to gain a whole level on it to take the CPU; otherwise
+// two processes of the same rank would trade the CPU every unit.
+SimTime aged_priority(const Simulation* sim, const Process* p) {
+    if (sim->aging_interval <= 0) return p->priority;
+    return p->priority * sim->aging_interval + p->arrival_time +
+        (p->burst_time - p->remaining_time) + p->blocked_time;
+}
+
+// Tickets a process holds under Stride and Lottery: its weight, or for a
+// process without one, 11 - priority, so priority 1 gets the most
+int process_weight(const Process* p) {
+    int weight = p->weight > 0 ? p->weight : 11 - p->priority;
+    if (weight < 1) return 1;
+    return weight > MAX_WEIGHT ? MAX_WEIGHT : weight;
+}
+
+int process_stride(const Process* p) {
+    return STRIDE_ONE / process_weight(p);
+}
+
+// Clears what a previous run left behind
+void begin_run(Simulation* sim) {
+    sim->current_time = 0;
+    sim->gantt_count = 0;
+    sim->last_process = -1;
+    sim->switches = 0;
+    sim->overhead_time = 0;
+    io_log_free(sim->io_log);
+    sim->io_log = NULL;
+    group_log_free(sim->group_log);
+    sim->group_log = NULL;
+    lock_log_free(sim->lock_log);
+    sim->lock_log = NULL;
+}
+
+void summarize_switching(const Simulation* sim, SwitchSummary* out) {
+    SimTime first_arrival = INT64_MAX, last_completion = 0;
+
+    out->switches = sim->switches;
+    out->overhead_time = sim->overhead_time;
+    out->useful_time = 0;
+    for (int i = 0; i < sim->process_count; i++) {
+        const Process* p = &sim->processes[i];
+        out->useful_time += p->burst_time;
+        if (p->arrival_time < first_arrival) first_arrival = p->arrival_time;
+        if (p->completion_time > last_completion) last_completion = p->completion_time;
+    }
+    out->elapsed = last_completion > first_arrival ? last_completion - first_arrival : 1;
+}
+
+void format_switch_summary(const Simulation* sim, char* out, size_t out_len) {
+    SwitchSummary summary;
+    summarize_switching(sim, &summary);
+
+    snprintf(out, out_len,
+        "Context switches: %ld (dispatch cost %d, cache penalty %d over %d units)\n"
+        "Switch overhead: %ld time units, %.1f%% of the elapsed time\n"
+        "CPU utilization: %.1f%% busy, %.1f%% doing useful work\n"
+        "Effective throughput: %.3f processes per 100 time units\n",
+        summary.switches, sim->cost.dispatch, sim->cost.cache_penalty, sim->cost.cache_decay,
+        summary.overhead_time, 100.0 * summary.overhead_time / summary.elapsed,
+        100.0 * (summary.useful_time + summary.overhead_time) / summary.elapsed,
+        100.0 * summary.useful_time / summary.elapsed,
+        100.0 * sim->process_count / summary.elapsed);
+}
+
+// Process ids
+//
+// The GUI keeps its processes in a ProcessTable, a slot map: a process stays
+// in its slot until it is deleted, a delete puts the slot on a free list, and
+// a doubly linked list over the slots holds the table order, which breaks
+// ties in a run. Adding and deleting are O(1), as are lookups by id and name
+// through the table's ProcessIndex. Ids come from one counter and are never
+// handed out twice, even after a delete.
+//
+// A run works on a dense copy, packed in table order, so its engines index
+// rows. Everything that outlives a run names processes by id: results are
+// stored back by id, checkpoints match the edited table by id, plugins see
+// and pick ids, and trace exports use them as thread ids.
+
+// FNV-1a
+uint32_t hash_name(const char* name) {
+    uint32_t h = 2166136261u;
+    while (*name) {
+        h ^= (unsigned char)*name++;
+        h *= 16777619u;
+    }
+    return h;
+}
+
+uint32_t process_bucket(const ProcessIndex* index, const Process* p, int by_name) {
+    uint32_t h = by_name ? hash_name(p->name) : (uint32_t)p->process_id * 2654435761u;
+    return h & (uint32_t)(index->bucket_count - 1);
+}
+
+void process_index_free(ProcessIndex* index) {
+    free(index->by_id);
+    free(index->by_name);
+    memset(index, 0, sizeof(*index));
+}
+
+// Adds procs[pos] to both maps, which must have room for it
+void process_index_put(ProcessIndex* index, const Process* procs, int pos) {
+    uint32_t mask = index->bucket_count - 1;
+    uint32_t b = process_bucket(index, &procs[pos], 0);
+    while (index->by_id[b] != 0) b = (b + 1) & mask;
+    index->by_id[b] = pos + 1;
+
+    if (process_index_find_name(index, procs, procs[pos].name) < 0) {
+        b = process_bucket(index, &procs[pos], 1);
+        while (index->by_name[b] != 0) b = (b + 1) & mask;
+        index->by_name[b] = pos + 1;
+    }
+    index->count++;
+}
+
+// Rehashes what is indexed into bucket_count buckets
+void process_index_resize(ProcessIndex* index, const Process* procs, int bucket_count) {
+    ProcessIndex old = *index;
+
+    index->bucket_count = bucket_count;
+    index->by_id = calloc(bucket_count, sizeof(int));
+    index->by_name = calloc(bucket_count, sizeof(int));
+    index->count = 0;
+    for (int b = 0; b < old.bucket_count; b++) {
+        if (old.by_id[b] != 0) process_index_put(index, procs, old.by_id[b] - 1);
+    }
+    process_index_free(&old);
+}
+
+void process_index_build(ProcessIndex* index, const Process* procs, int count) {
+    int buckets = 16;
+    while (buckets < 2 * count) buckets *= 2;
+
+    process_index_free(index);
+    process_index_resize(index, procs, buckets);
+    for (int pos = 0; pos < count; pos++) {
+        process_index_put(index, procs, pos);
+    }
+}
+
+void process_index_add(ProcessIndex* index, const Process* procs, int pos) {
+    if (2 * (index->count + 1) > index->bucket_count) {
+        process_index_resize(index, procs, index->bucket_count ? 2 * index->bucket_count : 16);
+    }
+    process_index_put(index, procs, pos);
+}
+
+// Empties bucket b, moving later entries of its probe run back so every
+// entry stays reachable from its home bucket
+void process_index_unlink(ProcessIndex* index, const Process* procs, int* buckets, uint32_t b, int by_name) {
+    uint32_t mask = index->bucket_count - 1;
+
+    buckets[b] = 0;
+    for (uint32_t next = (b + 1) & mask; buckets[next] != 0; next = (next + 1) & mask) {
+        uint32_t home = process_bucket(index, &procs[buckets[next] - 1], by_name);
+        if (((next - home) & mask) >= ((next - b) & mask)) {
+            buckets[b] = buckets[next];
+            buckets[next] = 0;
+            b = next;
+        }
+    }
+}
+
+// Forgets procs[pos]; call while it still holds the process
+void process_index_delete(ProcessIndex* index, const Process* procs, int pos) {
+    uint32_t mask = index->bucket_count - 1;
+
+    uint32_t b = process_bucket(index, &procs[pos], 0);
+    while (index->by_id[b] != pos + 1) b = (b + 1) & mask;
+    process_index_unlink(index, procs, index->by_id, b, 0);
+
+    for (b = process_bucket(index, &procs[pos], 1); index->by_name[b] != 0; b = (b + 1) & mask) {
+        if (index->by_name[b] == pos + 1) {
+            process_index_unlink(index, procs, index->by_name, b, 1);
+            break;
+        }
+    }
+    index->count--;
+}
+
+// Position holding the id, or -1
+int process_index_find_id(const ProcessIndex* index, const Process* procs, int id) {
+    if (index->bucket_count == 0) return -1;
+
+    uint32_t mask = index->bucket_count - 1;
+    for (uint32_t b = ((uint32_t)id * 2654435761u) & mask; index->by_id[b] != 0; b = (b + 1) & mask) {
+        if (procs[index->by_id[b] - 1].process_id == id) return index->by_id[b] - 1;
+    }
+    return -1;
+}
+
+// First position with the name, or -1
+int process_index_find_name(const ProcessIndex* index, const Process* procs, const char* name) {
+    if (index->bucket_count == 0) return -1;
+
+    uint32_t mask = index->bucket_count - 1;
+    for (uint32_t b = hash_name(name) & mask; index->by_name[b] != 0; b = (b + 1) & mask) {
+        if (strcmp(procs[index->by_name[b] - 1].name, name) == 0) return index->by_name[b] - 1;
+    }
+    return -1;
+}
+
+// Empties the table; ids already handed out stay used
+void process_table_clear(ProcessTable* table) {
+    table->head = -1;
+    table->tail = -1;
+    table->count = 0;
+    table->free_count = MAX_PROCESSES;
+    for (int k = 0; k < MAX_PROCESSES; k++) {
+        table->free_slots[k] = MAX_PROCESSES - 1 - k;
+    }
+    if (table->next_id < 1) table->next_id = 1;
+    process_index_free(&table->lookup);
+}
+
+// Appends a copy of p under a new id; returns its slot, or -1 when the table is full
+int process_table_add(ProcessTable* table, const Process* p) {
+    if (table->free_count == 0) return -1;
+
+    int slot = table->free_slots[--table->free_count];
+    table->slot[slot] = *p;
+    table->slot[slot].process_id = table->next_id++;
+    table->prev[slot] = table->tail;
+    table->next[slot] = -1;
+    if (table->tail >= 0) table->next[table->tail] = slot;
+    else table->head = slot;
+    table->tail = slot;
+    table->count++;
+    process_index_add(&table->lookup, table->slot, slot);
+    return slot;
+}
+
+// Returns 0, or -1 when no process has the id
+int process_table_delete(ProcessTable* table, int id) {
+    int slot = process_index_find_id(&table->lookup, table->slot, id);
+    if (slot < 0) return -1;
+
+    process_index_delete(&table->lookup, table->slot, slot);
+    if (table->prev[slot] >= 0) table->next[table->prev[slot]] = table->next[slot];
+    else table->head = table->next[slot];
+    if (table->next[slot] >= 0) table->prev[table->next[slot]] = table->prev[slot];
+    else table->tail = table->prev[slot];
+    table->free_slots[table->free_count++] = slot;
+    table->count--;
+    return 0;
+}
+
+Process* process_table_find(ProcessTable* table, int id) {
+    int slot = process_index_find_id(&table->lookup, table->slot, id);
+    return slot >= 0 ? &table->slot[slot] : NULL;
+}
+
+Process* process_table_find_name(ProcessTable* table, const char* name) {
+    int slot = process_index_find_name(&table->lookup, table->slot, name);
+    return slot >= 0 ? &table->slot[slot] : NULL;
+}
+
+// Copies the processes into out in table order; returns how many
+int process_table_pack(const ProcessTable* table, Process* out) {
+    int count = 0;
+    for (int slot = table->head; slot >= 0; slot = table->next[slot]) {
+        out[count++] = table->slot[slot];
+    }
+    return count;
+}
+
+// Gantt spill
+//
+// Multi-hour traces with fine-grained preemption produce more Gantt blocks
+// than fit in memory. A spilled log writes every full chunk to disk and keeps
+// a sparse index of each chunk's time span; readers map only the chunks that
+// overlap the range they need, one at a time, so resident memory stays at a
+// chunk or two whatever the length of the run.
+
+GanttSpill* gantt_spill_create() {
+    char path[PATH_MAX];
+    snprintf(path, sizeof(path), "%s/cpu_scheduler_gantt_XXXXXX", g_get_tmp_dir());
+
+    int fd = mkstemp(path);
+    if (fd < 0) return NULL;
+    unlink(path);
+
+    GanttSpill* spill = calloc(1, sizeof(GanttSpill));
+    spill->fd = fd;
+    return spill;
+}
+
+void gantt_spill_free(GanttSpill* spill) {
+    if (!spill) return;
+    close(spill->fd);
+    free(spill->chunks);
+    free(spill);
+}
+
+// Called before a block is appended. Once the tail holds a full chunk plus
+// one block, the chunk goes to disk and the last block (which may still be
+// extended) moves to the front.
+void gantt_spill_chunk(GanttSpill* spill, GanttBlock* blocks, int* count) {
+    if (spill->failed || *count != GANTT_CHUNK_BLOCKS + 1) return;
+
+    size_t length = GANTT_CHUNK_BLOCKS * sizeof(GanttBlock);
+    off_t offset = (off_t)spill->chunk_count * length;
+    size_t written = 0;
+    while (written < length) {
+        ssize_t n = pwrite(spill->fd, (const char*)blocks + written, length - written, offset + written);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) {
+            spill->failed = 1;
+            return;
+        }
+        written += n;
+    }
+
+    if (spill->chunk_count == spill->chunk_capacity) {
+        spill->chunk_capacity = spill->chunk_capacity ? spill->chunk_capacity * 2 : 64;
+        spill->chunks = realloc(spill->chunks, spill->chunk_capacity * sizeof(GanttChunk));
+    }
+    GanttChunk* chunk = &spill->chunks[spill->chunk_count++];
+    chunk->start_time = blocks[0].start_time;
+    chunk->end_time = blocks[GANTT_CHUNK_BLOCKS - 1].end_time;
+
+    blocks[0] = blocks[GANTT_CHUNK_BLOCKS];
+    *count = 1;
+}
+
+// Total blocks in a log whose in-memory tail holds `count`
+long gantt_log_length(const GanttSpill* spill, int count) {
+    return (spill ? (long)spill->chunk_count * GANTT_CHUNK_BLOCKS : 0) + count;
+}
+
+// Calls visit for each spilled chunk that overlaps [from, to], in time
+// order, then for the in-memory tail. Each chunk is mapped only for the call.
+void visit_gantt_log(const GanttSpill* spill, const GanttBlock* blocks, int count, double from, double to,
+    void (*visit)(const GanttBlock* blocks, int count, void* data), void* data) {
+    if (spill && spill->chunk_count > 0) {
+        // Blocks never overlap, so chunk end times are sorted
+        int first = 0, last = spill->chunk_count;
+        while (first < last) {
+            int mid = (first + last) / 2;
+            if (spill->chunks[mid].end_time < from) first = mid + 1;
+            else last = mid;
+        }
+
+        long page = sysconf(_SC_PAGESIZE);
+        size_t length = GANTT_CHUNK_BLOCKS * sizeof(GanttBlock);
+        for (int c = first; c < spill->chunk_count && spill->chunks[c].start_time <= to; c++) {
+            off_t offset = (off_t)c * length;
+            off_t aligned = offset / page * page;
+
+            void* map = mmap(NULL, length + (offset - aligned), PROT_READ, MAP_PRIVATE, spill->fd, aligned);
+            if (map == MAP_FAILED) continue;
+            visit((const GanttBlock*)((const char*)map + (offset - aligned)), GANTT_CHUNK_BLOCKS, data);
+            munmap(map, length + (offset - aligned));
+        }
+    }
+
+    if (count > 0) visit(blocks, count, data);
+}
+
+int compare_int64(const void* a, const void* b) {
+    int64_t x = *(const int64_t*)a;
+    int64_t y = *(const int64_t*)b;
+    return (x > y) - (x < y);
+}
+
+int compare_int(const void* a, const void* b) {
+    int x = *(const int*)a;
+    int y = *(const int*)b;
+    return (x > y) - (x < y);
+}
+
+int compare_double(const void* a, const void* b) {
+    double x = *(const double*)a;
+    double y = *(const double*)b;
+    return (x > y) - (x < y);
+}
+
+// Packs (primary, index) into one sortable key so ties resolve to the lowest
+// table index, exactly like the "strictly less than" scans in the reference loops.
+SchedKey make_key(SimTime primary, int index) {
+    return (SchedKey)primary * 4294967296LL + index;
+}
+
+int key_index(SchedKey key) {
+    return (int)(key & 0xffffffffLL);
+}
+
+// The primary of a key, a time or rank
+SimTime key_primary(SchedKey key) {
+    return (SimTime)((key - key_index(key)) / 4294967296LL);
+}
+
+int compare_key(const void* a, const void* b) {
+    SchedKey x = *(const SchedKey*)a;
+    SchedKey y = *(const SchedKey*)b;
+    return (x > y) - (x < y);
+}
+
+// Indices of procs ordered by (arrival_time, index); caller frees.
+// LSD radix sort on 11-bit digits of the arrival time, carrying each key next
+// to its index so the passes never go back to the process table. Each pass is
+// stable, so equal arrivals keep table order, and a pass whose digit is the
+// same for every process (the high bits, for most workloads) is skipped.
+int* build_arrival_order(const Process* procs, int count) {
+    int n = count ? count : 1;
+    uint64_t* keys = malloc(n * sizeof(uint64_t));
+    uint64_t* key_scratch = malloc(n * sizeof(uint64_t));
+    int* order = malloc(n * sizeof(int));
+    int* scratch = malloc(n * sizeof(int));
+    int counts[6][2048];
+
+    memset(counts, 0, sizeof(counts));
+    for (int i = 0; i < count; i++) {
+        // Flipping the sign bit makes negative arrivals sort first
+        keys[i] = (uint64_t)procs[i].arrival_time ^ 0x8000000000000000ull;
+        order[i] = i;
+        for (int pass = 0; pass < 6; pass++) {
+            counts[pass][(keys[i] >> (pass * 11)) & 0x7ff]++;
+        }
+    }
+
+    for (int pass = 0; pass < 6 && count > 0; pass++) {
+        int shift = pass * 11;
+        int* bucket = counts[pass];
+        if (bucket[(keys[0] >> shift) & 0x7ff] == count) continue;
+
+        int total = 0;
+        for (int d = 0; d < 2048; d++) {
+            int c = bucket[d];
+            bucket[d] = total;
+            total += c;
+        }
+        for (int k = 0; k < count; k++) {
+            int slot = bucket[(keys[k] >> shift) & 0x7ff]++;
+            key_scratch[slot] = keys[k];
+            scratch[slot] = order[k];
+        }
+
+        uint64_t* key_swap = keys;
+        keys = key_scratch;
+        key_scratch = key_swap;
+        int* swap = order;
+        order = scratch;
+        scratch = swap;
+    }
+
+    free(keys);
+    free(key_scratch);
+    free(scratch);
+    return order;
+}
+
+// The arrival order is shared by every run on the same workload; call
+// invalidate_arrival_order() whenever arrival times or the process set change
+const int* simulation_arrival_order(Simulation* sim) {
+    if (!sim->arrival_order) {
+        sim->arrival_order = build_arrival_order(sim->processes, sim->process_count);
+    }
+    return sim->arrival_order;
+}
+
+void invalidate_arrival_order(Simulation* sim) {
+    free(sim->arrival_order);
+    sim->arrival_order = NULL;
+}
+
+void heap_push(SchedKey* heap, int* size, SchedKey key) {
+    int i = (*size)++;
+    while (i > 0) {
+        int parent = (i - 1) / 2;
+        if (heap[parent] <= key) break;
+        heap[i] = heap[parent];
+        i = parent;
+    }
+    heap[i] = key;
+}
+
+SchedKey heap_pop(SchedKey* heap, int* size) {
+    SchedKey top = heap[0];
+    SchedKey last = heap[--(*size)];
+    int i = 0;
+
+    while (1) {
+        int child = 2 * i + 1;
+        if (child >= *size) break;
+        if (child + 1 < *size && heap[child + 1] < heap[child]) child++;
+        if (last <= heap[child]) break;
+        heap[i] = heap[child];
+        i = child;
+    }
+    if (*size > 0) heap[i] = last;
+
+    return top;
+}
+
+SchedKey scheduling_key(const Simulation* sim, const Process* p, int index, SchedulingAlgorithm algo) {
+    switch (algo) {
+    case SJF:
+        return make_key(p->burst_time, index);
+    case SRTF:
+        return make_key(p->remaining_time, index);
+    case PRIORITY:
+    case PREEMPTIVE_PRIORITY:
+        return make_key(aged_priority(sim, p), index);
+    default:
+        return make_key(p->arrival_time, index);
+    }
+}
+
+// Preemptive Priority with aging: the first unit boundary at which the best
+// waiting process outranks processes[index], dispatched at sim->current_time,
+// whose rank with its head start grows by one for each unit it runs.
+// INT64_MAX when aging is off or nothing waits.
+SimTime aging_preemption_time(const Simulation* sim, const SchedKey* heap, int heap_size, const Process* p, int index) {
+    if (sim->aging_interval <= 0 || heap_size == 0) return INT64_MAX;
+
+    SimTime t = key_primary(heap[0]) - (aged_priority(sim, p) - sim->aging_interval) + sim->current_time;
+    if (key_index(heap[0]) > index) t++;
+    return t;
+}
+
+// The key processes[index] goes back into the ready heap with when it stops
+// at sim->current_time without finishing. Under Preemptive Priority with
+// aging it keeps its head start if it still beats the best waiting process,
+// so it is popped straight back; otherwise it waits with its plain key.
+// Arrivals at the current time must already be in the heap.
+SchedKey preempted_key(const Simulation* sim, const SchedKey* heap, int heap_size, const Process* p, int index,
+    SchedKey key) {
+    if (sim->aging_interval <= 0) return key;
+
+    SchedKey ahead = make_key(aged_priority(sim, p) - sim->aging_interval, index);
+    return heap_size == 0 || ahead < heap[0] ? ahead : key;
+}
+
+// Event-driven engines for large workloads
+//
+// These produce the same schedule as the reference loops above, but jump
+// straight from one arrival or completion to the next and keep the ready set
+// in a binary heap, so a run costs O(n log n) instead of O(n * makespan).
+// All loop state lives in an EngineState so a run can be checkpointed and
+// resumed part way through.
+
+void run_fast_scheduler(Simulation* sim, SchedulingAlgorithm algo) {
+    EngineState state;
+    Plugin* plugin = algorithm_plugin(algo);
+
+    if (plugin) {
+        run_plugin_scheduler(sim, plugin);
+        return;
+    }
+    if (workload_has_io(sim->processes, sim->process_count) || workload_has_groups(sim)) {
+        run_io_scheduler(sim, algo);
+        return;
+    }
+    // Blocking on resources is only modelled by the reference loop
+    if (locks_apply(sim, algo)) {
+        reset_process_state(sim->processes, sim->process_count);
+        run_scheduler(sim, algo);
+        return;
+    }
+
+    reset_process_state(sim->processes, sim->process_count);
+    begin_run(sim);
+
+    engine_init(&state, sim);
+    run_engine(sim, algo, &state, NULL);
+    engine_free(&state);
+
+    calculate_times(sim);
+}
+
+void engine_init(EngineState* state, Simulation* sim) {
+    int n = sim->process_count;
+
+    // Round Robin reorders batches of this copy in place
+    state->order = malloc((n ? n : 1) * sizeof(int));
+    memcpy(state->order, simulation_arrival_order(sim), n * sizeof(int));
+    state->next = 0;
+    state->completed = 0;
+    state->dispatches = 0;
+    state->heap = malloc((n ? n : 1) * sizeof(SchedKey));
+    state->heap_size = 0;
+    state->capacity = n + 1;
+    state->queue = malloc(state->capacity * sizeof(int));
+    state->front = 0;
+    state->rear = 0;
+}
+
+void engine_free(EngineState* state) {
+    free(state->order);
+    free(state->heap);
+    free(state->queue);
+}
+
+void run_engine(Simulation* sim, SchedulingAlgorithm algo, EngineState* state, CheckpointLog* log) {
+    switch (algo) {
+    case FCFS:
+        fast_fcfs_scheduling(sim, state, log);
+        break;
+    case SJF:
+        fast_sjf_scheduling(sim, state, log);
+        break;
+    case PRIORITY:
+        fast_priority_scheduling(sim, state, log);
+        break;
+    case SRTF:
+        fast_srtf_scheduling(sim, state, log);
+        break;
+    case PREEMPTIVE_PRIORITY:
+        fast_preemptive_priority_scheduling(sim, state, log);
+        break;
+    case ROUND_ROBIN:
+        fast_round_robin_scheduling(sim, state, log);
+        break;
+    case STRIDE:
+        fast_stride_scheduling(sim, state);
+        break;
+    case LOTTERY:
+        fast_lottery_scheduling(sim, state);
+        break;
+    }
+}
+
+// Queues every process that has arrived by now. The reference loop enqueues
+// each batch of new arrivals in table order, not arrival order, so the batch
+// is sorted by index first.
+void enqueue_arrivals(Simulation* sim, EngineState* state) {
+    Process* procs = sim->processes;
+    int batch_start = state->next;
+
+    while (state->next < sim->process_count &&
+        procs[state->order[state->next]].arrival_time <= sim->current_time) {
+        state->next++;
+    }
+    if (state->next - batch_start > 1) {
+        qsort(state->order + batch_start, state->next - batch_start, sizeof(int), compare_int);
+    }
+    for (int k = batch_start; k < state->next; k++) {
+        state->queue[state->rear] = state->order[k];
+        state->rear = (state->rear + 1) % state->capacity;
+    }
+}
+
+// Policy-driven core
+//
+// FCFS, SJF, Priority, SRTF, Preemptive Priority and Round Robin differ only
+// in the three rules of a SchedPolicy. The core loop below follows them, and
+// POLICY_ENGINE gives each policy its own copy of the loop with the rules as
+// constants, so the compiler folds every rule test and key switch away and
+// each copy runs like a hand-written loop for its policy.
+
+#define POLICY_INLINE static inline __attribute__((always_inline))
+
+// Makes ready everything that has arrived by now
+POLICY_INLINE void policy_admit(Simulation* sim, EngineState* state, const SchedPolicy policy) {
+    Process* procs = sim->processes;
+
+    if (policy.sliced) {
+        enqueue_arrivals(sim, state);
+        return;
+    }
+    while (state->next < sim->process_count &&
+        procs[state->order[state->next]].arrival_time <= sim->current_time) {
+        int i = state->order[state->next++];
+        heap_push(state->heap, &state->heap_size, scheduling_key(sim, &procs[i], i, policy.algo));
+    }
+}
+
+POLICY_INLINE void policy_engine(Simulation* sim, EngineState* state, CheckpointLog* log, const SchedPolicy policy) {
+    Process* procs = sim->processes;
+    int n = sim->process_count;
+
+    while (state->completed < n) {
+        policy_admit(sim, state, policy);
+        if (log && state->dispatches >= log->next_checkpoint) {
+            record_checkpoint(log, sim, state);
+        }
+
+        if (policy.sliced ? state->front == state->rear : state->heap_size == 0) {
+            // CPU idle until the next arrival
+            if (state->next >= n) break;
+            sim->current_time = procs[state->order[state->next]].arrival_time;
+            continue;
+        }
+
+        int index;
+        if (policy.sliced) {
+            index = state->queue[state->front];
+            state->front = (state->front + 1) % state->capacity;
+        }
+        else {
+            index = key_index(heap_pop(state->heap, &state->heap_size));
+        }
+        Process* p = &procs[index];
+        SimTime dispatched = sim->current_time;
+        int overhead = switch_overhead(sim, index);
+        sim->current_time += overhead;
+
+        if (p->start_time == -1) {
+            p->start_time = sim->current_time;
+        }
+
+        // The slice runs to the end of the burst unless the quantum runs out
+        // first or, under a preemptive policy, something could outrank it:
+        // an arrival, or a waiting process aging past it. One that came in
+        // during the switch is looked at after the first unit, as the
+        // reference loop does.
+        SimTime run_until = sim->current_time + p->remaining_time;
+        if (policy.sliced && sim->time_quantum < p->remaining_time) {
+            run_until = sim->current_time + sim->time_quantum;
+        }
+        if (policy.preemptive) {
+            SimTime event = state->next < n ? procs[state->order[state->next]].arrival_time : INT64_MAX;
+            if (policy.algo == PREEMPTIVE_PRIORITY) {
+                SimTime aged = aging_preemption_time(sim, state->heap, state->heap_size, p, index);
+                if (aged < event) event = aged;
+            }
+            if (event < run_until) {
+                run_until = event;
+                if (run_until <= sim->current_time) run_until = sim->current_time + 1;
+            }
+        }
+
+        // A preemptive policy resumes the process that ran last in the same block
+        if (policy.preemptive && overhead == 0 && extends_last_block(sim, p)) {
+            sim->gantt[sim->gantt_count - 1].end_time = run_until;
+        }
+        else {
+            add_gantt_block(sim, p, dispatched, run_until, overhead);
+        }
+
+        p->remaining_time -= run_until - sim->current_time;
+        sim->current_time = run_until;
+        p->last_run_end = run_until;
+        state->dispatches++;
+
+        if (p->remaining_time == 0) {
+            p->completion_time = sim->current_time;
+            state->completed++;
+            continue;
+        }
+
+        // Arrivals during the slice are ready ahead of the process it preempted
+        policy_admit(sim, state, policy);
+        if (policy.sliced) {
+            state->queue[state->rear] = index;
+            state->rear = (state->rear + 1) % state->capacity;
+        }
+        else if (policy.algo == PREEMPTIVE_PRIORITY) {
+            heap_push(state->heap, &state->heap_size, preempted_key(sim, state->heap, state->heap_size, p, index,
+                scheduling_key(sim, p, index, policy.algo)));
+        }
+        else {
+            heap_push(state->heap, &state->heap_size, scheduling_key(sim, p, index, policy.algo));
+        }
+    }
+}
+
+#define POLICY_ENGINE(name, algo, preemptive, sliced) \
+    void name(Simulation* sim, EngineState* state, CheckpointLog* log) { \
+        policy_engine(sim, state, log, (SchedPolicy){ algo, preemptive, sliced }); \
+    }
+
+POLICY_ENGINE(fast_fcfs_scheduling, FCFS, 0, 0)
+POLICY_ENGINE(fast_sjf_scheduling, SJF, 0, 0)
+POLICY_ENGINE(fast_priority_scheduling, PRIORITY, 0, 0)
+POLICY_ENGINE(fast_srtf_scheduling, SRTF, 1, 0)
+POLICY_ENGINE(fast_preemptive_priority_scheduling, PREEMPTIVE_PRIORITY, 1, 0)
+POLICY_ENGINE(fast_round_robin_scheduling, ROUND_ROBIN, 0, 1)
+
+// Engine benchmark
+//
+// --bench N times every built-in algorithm's engine N times on one workload,
+// a workload file or --jobs generated ones, and reports the best and median
+// run. The checksum covers every completion time, so two builds that report
+// the same checksums made the same schedules and their times can be compared:
+// run `make bench` on both and compare the tables.
+
+int run_bench(const ReplicationConfig* config, const char* workload_path, int runs) {
+    Process* procs;
+    int count;
+    char error[1200];
+    Simulation sim;
+
+    if (workload_path) {
+        if (load_workload(workload_path, &procs, &count, NULL, NULL, error, sizeof(error)) != 0) {
+            fprintf(stderr, "%s\n", error);
+            return 1;
+        }
+    }
+    else {
+        RngState rng;
+        count = config->jobs;
+        procs = malloc(count * sizeof(Process));
+        rng_seed(&rng, config->seed, 0);
+        generate_workload(procs, count, &rng, config);
+    }
+    init_simulation(&sim, procs, count, config->time_quantum);
+    sim.cost = config->cost;
+    sim.aging_interval = config->aging_interval;
+
+    double* ms = malloc(runs * sizeof(double));
+    printf("ENGINE BENCHMARK\n"
+        "================\n\n"
+        "Processes: %d, seed %llu, quantum %d, best and median of %d run%s\n\n"
+        "%-22s %10s %10s %12s %18s\n", count, (unsigned long long)config->seed, config->time_quantum, runs,
+        runs == 1 ? "" : "s", "Algorithm", "Best ms", "Median ms", "Mjobs/s", "Checksum");
+
+    for (int a = FCFS; a <= ALGORITHM_COUNT; a++) {
+        uint64_t checksum = 0;
+        for (int r = 0; r < runs; r++) {
+            struct timespec started;
+            clock_gettime(CLOCK_MONOTONIC, &started);
+            run_fast_scheduler(&sim, (SchedulingAlgorithm)a);
+            ms[r] = elapsed_seconds(&started) * 1000;
+        }
+        for (int i = 0; i < count; i++) {
+            checksum = checksum * 31 + (uint64_t)procs[i].completion_time;
+        }
+        qsort(ms, runs, sizeof(double), compare_double);
+        printf("%-22s %10.2f %10.2f %12.2f   %016llx\n", algorithm_names[a - 1], ms[0], ms[runs / 2],
+            ms[0] > 0 ? count / (ms[0] * 1000) : 0.0, (unsigned long long)checksum);
+    }
+
+    free(ms);
+    free_simulation(&sim);
+    free(procs);
+    return 0;
+}
+
+// Proportional share
+//
+// Stride and Lottery give each ready process CPU time in proportion to its
+// weight, one quantum at a time. Stride is deterministic: a heap of pass
+// values, rebased now and then to keep them small. Lottery
+// draws a ticket each quantum and finds its holder in a Fenwick tree of the
+// ready processes' weights, indexed by table row. Both make O(log n) choices.
+// Neither keeps its state in checkpoints. Runs with I/O or bandwidth groups
+// go through the I/O engine, which schedules both the same way.
+
+int proportional_share(SchedulingAlgorithm algo) {
+    return algo == STRIDE || algo == LOTTERY;
+}
+
+// Moves every pass value in a heap down by `shift`; keys keep their order
+void stride_rebase(SchedKey* heap, int heap_size, int64_t shift) {
+    for (int k = 0; k < heap_size; k++) {
+        heap[k] -= (SchedKey)shift * 4294967296LL;
+    }
+}
+
+void fast_stride_scheduling(Simulation* sim, EngineState* state) {
+    Process* procs = sim->processes;
+    int n = sim->process_count;
+    int64_t base = 0;           // pass value of key primary 0
+    int64_t global_pass = 0;
+
+    while (state->completed < n) {
+        while (state->next < n && procs[state->order[state->next]].arrival_time <= sim->current_time) {
+            int i = state->order[state->next++];
+            heap_push(state->heap, &state->heap_size, make_key(global_pass - base, i));
+        }
+
+        if (state->heap_size == 0) {
+            sim->current_time = procs[state->order[state->next]].arrival_time;
+            continue;
+        }
+
+        SchedKey key = heap_pop(state->heap, &state->heap_size);
+        int index = key_index(key);
+        Process* p = &procs[index];
+        global_pass = base + key_primary(key);
+        if (global_pass - base > STRIDE_REBASE) {
+            stride_rebase(state->heap, state->heap_size, global_pass - base);
+            base = global_pass;
+        }
+
+        SimTime dispatched = sim->current_time;
+        int overhead = switch_overhead(sim, index);
+        sim->current_time += overhead;
+        if (p->start_time == -1) {
+            p->start_time = sim->current_time;
+        }
+
+        SimTime execution_time = (p->remaining_time < sim->time_quantum) ? p->remaining_time : sim->time_quantum;
+        add_gantt_block(sim, p, dispatched, sim->current_time + execution_time, overhead);
+        sim->current_time += execution_time;
+        p->remaining_time -= execution_time;
+        p->last_run_end = sim->current_time;
+        state->dispatches++;
+
+        if (p->remaining_time == 0) {
+            p->completion_time = sim->current_time;
+            state->completed++;
+        }
+        else {
+            int64_t pass = global_pass + (int64_t)process_stride(p) * execution_time;
+            heap_push(state->heap, &state->heap_size, make_key(pass - base, index));
+        }
+    }
+}
+
+// Fenwick tree over table rows; tree[i] covers rows i - (i & -i) to i - 1
+void fenwick_add(int64_t* tree, int n, int row, int64_t amount) {
+    for (int i = row + 1; i <= n; i += i & -i) {
+        tree[i] += amount;
+    }
+}
+
+// Row holding ticket number `ticket`, counting tickets in table order
+int fenwick_find(const int64_t* tree, int n, int64_t ticket) {
+    int step = 1, pos = 0;
+    while (step * 2 <= n) step *= 2;
+
+    for (; step > 0; step /= 2) {
+        if (pos + step <= n && tree[pos + step] <= ticket) {
+            pos += step;
+            ticket -= tree[pos];
+        }
+    }
+    return pos;
+}
+
+void fast_lottery_scheduling(Simulation* sim, EngineState* state) {
+    Process* procs = sim->processes;
+    int n = sim->process_count;
+    int64_t* tree = calloc(n + 1, sizeof(int64_t));
+    int64_t tickets = 0;
+    RngState rng;
+    rng_seed(&rng, sim->seed, 0);
+
+    while (state->completed < n) {
+        while (state->next < n && procs[state->order[state->next]].arrival_time <= sim->current_time) {
+            int i = state->order[state->next++];
+            fenwick_add(tree, n, i, process_weight(&procs[i]));
+            tickets += process_weight(&procs[i]);
+        }
+
+        if (tickets == 0) {
+            sim->current_time = procs[state->order[state->next]].arrival_time;
+            continue;
+        }
+
+        int index = fenwick_find(tree, n, (int64_t)(rng_next(&rng) % (uint64_t)tickets));
+        Process* p = &procs[index];
+        SimTime dispatched = sim->current_time;
+        int overhead = switch_overhead(sim, index);
+        sim->current_time += overhead;
+        if (p->start_time == -1) {
+            p->start_time = sim->current_time;
+        }
+
+        SimTime execution_time = (p->remaining_time < sim->time_quantum) ? p->remaining_time : sim->time_quantum;
+        add_gantt_block(sim, p, dispatched, sim->current_time + execution_time, overhead);
+        sim->current_time += execution_time;
+        p->remaining_time -= execution_time;
+        p->last_run_end = sim->current_time;
+        state->dispatches++;
+
+        if (p->remaining_time == 0) {
+            p->completion_time = sim->current_time;
+            state->completed++;
+            fenwick_add(tree, n, index, -process_weight(p));
+            tickets -= process_weight(p);
+        }
+    }
+
+    free(tree);
+}
+
+int compare_share_events(const void* a, const void* b) {
+    const ShareEvent* x = a;
+    const ShareEvent* y = b;
+    return (x->time > y->time) - (x->time < y->time);
+}
+
+// visit_gantt_log callback: each block's useful time, split across windows
+void add_share_block(const GanttBlock* blocks, int count, void* data) {
+    ShareVisit* v = data;
+
+    for (int i = 0; i < count; i++) {
+        int c = v->class_of_weight[process_weight(&v->processes[blocks[i].process_index])];
+        for (SimTime t = blocks[i].start_time + blocks[i].overhead; t < blocks[i].end_time;) {
+            SimTime k = t / v->window;
+            SimTime end = (k + 1) * v->window < blocks[i].end_time ? (k + 1) * v->window : blocks[i].end_time;
+            v->achieved[(size_t)k * v->class_count + c] += end - t;
+            t = end;
+        }
+    }
+}
+
+// Compares, per weight and per window of `window` units, the CPU time the
+// processes got with what their weights entitle them to: at every moment,
+// the busy CPU divided among the processes then ready by weight. Windows
+// contended for less than half their length are left out of the errors.
+void format_share_report(const Simulation* sim, SchedulingAlgorithm algo, int window, char* out, size_t out_len) {
+    const Process* procs = sim->processes;
+    int n = sim->process_count;
+    int class_of_weight[MAX_WEIGHT + 1];
+    ShareClass classes[MAX_WEIGHT];
+    int class_count = 0;
+    SimTime makespan = 0;
+
+    for (int w = 0; w <= MAX_WEIGHT; w++) class_of_weight[w] = -1;
+    for (int i = 0; i < n; i++) {
+        class_of_weight[process_weight(&procs[i])] = 0;
+        if (procs[i].completion_time > makespan) makespan = procs[i].completion_time;
+    }
+    for (int w = MAX_WEIGHT; w >= 1; w--) {
+        if (class_of_weight[w] < 0) continue;
+        memset(&classes[class_count], 0, sizeof(ShareClass));
+        classes[class_count].weight = w;
+        class_of_weight[w] = class_count++;
+    }
+
+    int windows = (int)(makespan / window + 1);
+    double* contended = calloc(windows, sizeof(double));
+    double* target = calloc((size_t)windows * class_count, sizeof(double));
+    double* achieved = calloc((size_t)windows * class_count, sizeof(double));
+    long* ready_weight = calloc(class_count, sizeof(long));
+    long total_weight = 0;
+
+    // Entitlement: sweep the arrivals and completions, between which the
+    // ready weights are constant
+    ShareEvent* events = malloc((2 * n + 1) * sizeof(ShareEvent));
+    for (int i = 0; i < n; i++) {
+        int c = class_of_weight[process_weight(&procs[i])];
+        classes[c].processes++;
+        events[2 * i] = (ShareEvent){ procs[i].arrival_time, c, process_weight(&procs[i]) };
+        events[2 * i + 1] = (ShareEvent){ procs[i].completion_time, c, -process_weight(&procs[i]) };
+    }
+    qsort(events, 2 * n, sizeof(ShareEvent), compare_share_events);
+
+    SimTime previous = 0;
+    for (int e = 0; e < 2 * n; e++) {
+        for (SimTime t = previous; t < events[e].time && total_weight > 0;) {
+            SimTime k = t / window;
+            SimTime end = (k + 1) * window < events[e].time ? (k + 1) * window : events[e].time;
+            contended[k] += end - t;
+            for (int c = 0; c < class_count; c++) {
+                if (ready_weight[c] > 0) {
+                    target[(size_t)k * class_count + c] += (double)(end - t) * ready_weight[c] / total_weight;
+                }
+            }
+            t = end;
+        }
+        previous = events[e].time;
+        ready_weight[events[e].share_class] += events[e].weight;
+        total_weight += events[e].weight;
+    }
+
+    ShareVisit visit = { procs, class_of_weight, class_count, window, achieved };
+    visit_gantt_log(sim->spill, sim->gantt, sim->gantt_count, 0, INT64_MAX, add_share_block, &visit);
+
+    double contended_total = 0, error_max = 0;
+    int counted = 0, worst_class = 0, worst_window = 0;
+    for (int k = 0; k < windows; k++) {
+        contended_total += contended[k];
+        int count_window = contended[k] * 2 >= window;
+        counted += count_window;
+
+        for (int c = 0; c < class_count; c++) {
+            double t = target[(size_t)k * class_count + c];
+            double a = achieved[(size_t)k * class_count + c];
+            classes[c].target += t;
+            classes[c].achieved += a;
+            if (!count_window || t == 0) continue;
+
+            double error = 100.0 * fabs(a - t) / contended[k];
+            classes[c].error_sum += error;
+            classes[c].windows++;
+            if (error > classes[c].error_max) {
+                classes[c].error_max = error;
+                classes[c].worst_window = k;
+            }
+            if (error > error_max) {
+                error_max = error;
+                worst_class = c;
+                worst_window = k;
+            }
+        }
+    }
+
+    size_t used = snprintf(out, out_len,
+        "PROPORTIONAL SHARE\n"
+        "==================\n\n"
+        "Algorithm: %s (quantum %d)\n"
+        "Windows: %d time units, %d of %d contended for at least half their length\n"
+        "Shares are of the time some process was ready or running. The target divides\n"
+        "that time by weight among the processes ready at each moment; errors are in\n"
+        "percentage points of share.\n\n"
+        "%6s %10s %9s %9s %11s %10s\n",
+        algorithm_names[algo - 1], sim->time_quantum, window, counted, windows,
+        "Weight", "Processes", "Target", "Achieved", "Mean Error", "Max Error");
+
+    for (int c = 0; c < class_count && used < out_len; c++) {
+        used += snprintf(out + used, out_len - used, "%6d %10d %8.2f%% %8.2f%% %11.2f %10.2f\n",
+            classes[c].weight, classes[c].processes,
+            contended_total > 0 ? 100.0 * classes[c].target / contended_total : 0.0,
+            contended_total > 0 ? 100.0 * classes[c].achieved / contended_total : 0.0,
+            classes[c].windows > 0 ? classes[c].error_sum / classes[c].windows : 0.0, classes[c].error_max);
+    }
+    if (used < out_len && class_count > 0 && counted > 0) {
+        snprintf(out + used, out_len - used, "\nLargest error: %.2f points, weight %d over %d-%d\n",
+            error_max, classes[worst_class].weight, worst_window * window, (worst_window + 1) * window);
+    }
+
+    free(events);
+    free(ready_weight);
+    free(achieved);
+    free(target);
+    free(contended);
+}
+
+// --share-report: runs --algorithm on a workload file or on one generated
+// workload, whose weights come from the priorities
+int run_share_report(const ReplicationConfig* config, const char* workload_path, int window) {
+    Process* procs;
+    int count;
+    char error[1200];
+    size_t out_len = 16384;
+    char* out;
+    Simulation sim;
+
+    if (workload_path) {
+        if (load_workload(workload_path, &procs, &count, NULL, NULL, error, sizeof(error)) != 0) {
+            fprintf(stderr, "%s\n", error);
+            return 1;
+        }
+    }
+    else {
+        RngState rng;
+        count = config->jobs;
+        procs = malloc(count * sizeof(Process));
+        rng_seed(&rng, config->seed, 0);
+        generate_workload(procs, count, &rng, config);
+    }
+
+    init_simulation(&sim, procs, count, config->time_quantum);
+    sim.spill = gantt_spill_create();
+    sim.cost = config->cost;
+    sim.io = config->io;
+    sim.aging_interval = config->aging_interval;
+    sim.seed = config->seed;
+    run_fast_scheduler(&sim, config->algo);
+
+    out = malloc(out_len);
+    format_share_report(&sim, config->algo, window, out, out_len);
+    fputs(out, stdout);
+
+    free(out);
+    free_simulation(&sim);
+    free(procs);
+    return 0;
+}
+
+// Scheduler plugins
+//
+// Policies kept outside this file load from shared objects at startup
+// (--plugin FILE, any number of times) through the ABI in scheduler_plugin.h.
+// Each one becomes one more algorithm after the built-in ones: a button in the
+// window, a key for --algorithm, a choice for the Monte Carlo runs and the
+// autotuner. The plugin engine keeps the clock, the Gantt log and the switch
+// costs, and calls the plugin's hooks at arrivals, dispatches and slice ends.
+// A plugin sees each process as one CPU burst: I/O, bandwidth groups and
+// resource locks are not modelled for it. Every hook call is timed, and the
+// totals are kept per plugin across runs and threads.
+
+// Calls a plugin hook and charges its time to the hook's counter
+#define PLUGIN_CALL(timing, hook, call) do { \
+        int64_t hook_started = plugin_clock(); \
+        call; \
+        (timing)->ns[hook] += plugin_clock() - hook_started; \
+        (timing)->calls[hook]++; \
+    } while (0)
+
+int load_plugin(const char* path, char* error, size_t error_len) {
+    if (plugin_count == MAX_PLUGINS) {
+        snprintf(error, error_len, "%s: at most %d plugins can be loaded", path, MAX_PLUGINS);
+        return 0;
+    }
+
+    void* handle = dlopen(path, RTLD_NOW | RTLD_LOCAL);
+    if (!handle) {
+        snprintf(error, error_len, "%s", dlerror());
+        return 0;
+    }
+    SchedPluginEntry entry = (SchedPluginEntry)dlsym(handle, SCHED_PLUGIN_ENTRY);
+    const SchedPluginOps* ops = entry ? entry() : NULL;
+    if (!ops) {
+        snprintf(error, error_len, "%s: no %s() or it returned NULL", path, SCHED_PLUGIN_ENTRY);
+        dlclose(handle);
+        return 0;
+    }
+    if (ops->abi_version != SCHED_PLUGIN_ABI_VERSION) {
+        snprintf(error, error_len, "%s: built for plugin ABI %u, this simulator has %d", path,
+            ops->abi_version, SCHED_PLUGIN_ABI_VERSION);
+        dlclose(handle);
+        return 0;
+    }
+    if (!ops->key || !ops->key[0] || strspn(ops->key, "abcdefghijklmnopqrstuvwxyz0123456789-") != strlen(ops->key) ||
+        !ops->pick_next) {
+        snprintf(error, error_len, "%s: needs a key of lowercase letters, digits and dashes, and pick_next", path);
+        dlclose(handle);
+        return 0;
+    }
+    if (algorithm_from_key(ops->key)) {
+        snprintf(error, error_len, "%s: algorithm '%s' already exists", path, ops->key);
+        dlclose(handle);
+        return 0;
+    }
+
+    Plugin* plugin = &plugins[plugin_count++];
+    memset(plugin, 0, sizeof(*plugin));
+    plugin->handle = handle;
+    plugin->ops = ops;
+    algorithm_keys[algorithm_count] = ops->key;
+    algorithm_names[algorithm_count] = ops->name && ops->name[0] ? ops->name : ops->key;
+    algorithm_count++;
+    return 1;
+}
+
+// Loads every --plugin FILE or --plugin=FILE and takes them out of argv, so
+// neither GTK nor the headless options see them. 0 once one fails to load.
+int load_plugins_from_args(int* argc, char* argv[]) {
+    char error[1200];
+    int kept = 1;
+
+    for (int i = 1; i < *argc; i++) {
+        const char* path = NULL;
+        if (strcmp(argv[i], "--plugin") == 0 && i + 1 < *argc) path = argv[++i];
+        else if (strncmp(argv[i], "--plugin=", 9) == 0) path = argv[i] + 9;
+        else {
+            argv[kept++] = argv[i];
+            continue;
+        }
+        if (!load_plugin(path, error, sizeof(error))) {
+            fprintf(stderr, "Cannot load plugin: %s\n", error);
+            return 0;
+        }
+    }
+    *argc = kept;
+    argv[kept] = NULL;
+    return 1;
+}
+
+// The plugin that runs as algo, NULL for a built-in algorithm
+Plugin* algorithm_plugin(SchedulingAlgorithm algo) {
+    int slot = (int)algo - ALGORITHM_COUNT - 1;
+    return slot >= 0 && slot < plugin_count ? &plugins[slot] : NULL;
+}
+
+int64_t plugin_clock() {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (int64_t)now.tv_sec * 1000000000 + now.tv_nsec;
+}
+
+void plugin_view(const Process* p, int index, SchedPluginProcess* view) {
+    view->id = p->process_id;
+    view->index = index;
+    view->name = p->name;
+    view->priority = p->priority;
+    view->weight = process_weight(p);
+    view->arrival_time = p->arrival_time;
+    view->burst_time = p->burst_time;
+    view->remaining_time = p->remaining_time;
+}
+
+// Makes ready, and announces, every process that has arrived by now
+void plugin_admit(Simulation* sim, PluginRun* pr) {
+    Process* procs = sim->processes;
+    SchedPluginProcess view;
+
+    while (pr->next < sim->process_count && procs[pr->order[pr->next]].arrival_time <= sim->current_time) {
+        int i = pr->order[pr->next++];
+        pr->ready[i] = 1;
+        pr->ready_count++;
+        if (pr->ops->arrival) {
+            plugin_view(&procs[i], i, &view);
+            PLUGIN_CALL(&pr->timing, HOOK_ARRIVAL, pr->ops->arrival(pr->run, &view, sim->current_time));
+        }
+    }
+}
+
+void run_plugin_scheduler(Simulation* sim, Plugin* plugin) {
+    Process* procs = sim->processes;
+    int n = sim->process_count;
+    const SchedPluginOps* ops = plugin->ops;
+    SchedPluginConfig config = { n, sim->time_quantum, sim->seed };
+    SchedPluginProcess view;
+    PluginRun pr;
+    int completed = 0;
+
+    reset_process_state(procs, n);
+    begin_run(sim);
+
+    memset(&pr, 0, sizeof(pr));
+    pr.ops = ops;
+    pr.order = simulation_arrival_order(sim);
+    pr.ready = calloc(n + 1, 1);
+    process_index_build(&pr.lookup, procs, n);
+    if (ops->init) PLUGIN_CALL(&pr.timing, HOOK_INIT, pr.run = ops->init(&config));
+
+    while (completed < n) {
+        plugin_admit(sim, &pr);
+        if (pr.ready_count == 0) {
+            // CPU idle until the next arrival
+            sim->current_time = procs[pr.order[pr.next]].arrival_time;
+            continue;
+        }
+
+        int64_t slice = 0;
+        int id = 0;
+        PLUGIN_CALL(&pr.timing, HOOK_PICK_NEXT, id = ops->pick_next(pr.run, sim->current_time, &slice));
+        int index = process_index_find_id(&pr.lookup, procs, id);
+        if (index < 0 || !pr.ready[index]) {
+            pr.timing.invalid_picks++;
+            index = 0;
+            while (!pr.ready[index]) index++;
+        }
+        pr.ready[index] = 0;
+        pr.ready_count--;
+
+        Process* p = &procs[index];
+        SimTime dispatched = sim->current_time;
+        int overhead = switch_overhead(sim, index);
+        sim->current_time += overhead;
+        if (p->start_time == -1) {
+            p->start_time = sim->current_time;
+        }
+
+        // An arrival during the switch is looked at after the first unit,
+        // as under the built-in preemptive policies
+        SimTime run_until = sim->current_time + p->remaining_time;
+        if (slice > 0 && slice < p->remaining_time) run_until = sim->current_time + slice;
+        if (ops->preempt_on_arrival && pr.next < n && procs[pr.order[pr.next]].arrival_time < run_until) {
+            run_until = procs[pr.order[pr.next]].arrival_time;
+            if (run_until <= sim->current_time) run_until = sim->current_time + 1;
+        }
+
+        if (overhead == 0 && extends_last_block(sim, p) && sim->gantt[sim->gantt_count - 1].end_time == dispatched) {
+            sim->gantt[sim->gantt_count - 1].end_time = run_until;
+        }
+        else {
+            add_gantt_block(sim, p, dispatched, run_until, overhead);
+        }
+        p->remaining_time -= run_until - sim->current_time;
+        sim->current_time = run_until;
+        p->last_run_end = run_until;
+
+        // Arrivals during the slice are announced before it ends
+        plugin_admit(sim, &pr);
+        plugin_view(p, index, &view);
+        if (p->remaining_time == 0) {
+            p->completion_time = sim->current_time;
+            completed++;
+            if (ops->complete) {
+                PLUGIN_CALL(&pr.timing, HOOK_COMPLETE, ops->complete(pr.run, &view, sim->current_time));
+            }
+        }
+        else {
+            pr.ready[index] = 1;
+            pr.ready_count++;
+            if (ops->slice_end) {
+                PLUGIN_CALL(&pr.timing, HOOK_SLICE_END, ops->slice_end(pr.run, &view, sim->current_time));
+            }
+        }
+    }
+    if (ops->finish) PLUGIN_CALL(&pr.timing, HOOK_FINISH, ops->finish(pr.run));
+
+    pthread_mutex_lock(&plugin_lock);
+    for (int h = 0; h < PLUGIN_HOOKS; h++) {
+        plugin->timing.calls[h] += pr.timing.calls[h];
+        plugin->timing.ns[h] += pr.timing.ns[h];
+    }
+    plugin->timing.runs++;
+    plugin->timing.invalid_picks += pr.timing.invalid_picks;
+    pthread_mutex_unlock(&plugin_lock);
+
+    free(pr.ready);
+    process_index_free(&pr.lookup);
+    calculate_times(sim);
+}
+
+// Time spent in a plugin's hooks over every run so far. The clock reads
+// around each call are counted too, a few tens of nanoseconds.
+void format_plugin_timing(Plugin* plugin, char* out, size_t out_len) {
+    PluginTiming timing;
+    int64_t total = 0;
+    long calls = 0;
+
+    pthread_mutex_lock(&plugin_lock);
+    timing = plugin->timing;
+    pthread_mutex_unlock(&plugin_lock);
+
+    size_t used = snprintf(out, out_len, "Plugin %s: %ld run%s, %ld invalid pick%s\n%-10s %12s %12s %10s\n",
+        plugin->ops->key, timing.runs, timing.runs == 1 ? "" : "s", timing.invalid_picks,
+        timing.invalid_picks == 1 ? "" : "s", "Hook", "Calls", "Total ms", "ns/call");
+    for (int h = 0; h < PLUGIN_HOOKS && used < out_len; h++) {
+        if (timing.calls[h] == 0) continue;
+        used += snprintf(out + used, out_len - used, "%-10s %12ld %12.3f %10.1f\n", plugin_hook_names[h],
+            timing.calls[h], timing.ns[h] / 1e6, (double)timing.ns[h] / timing.calls[h]);
+        total += timing.ns[h];
+        calls += timing.calls[h];
+    }
+    if (used < out_len) {
+        snprintf(out + used, out_len - used, "%-10s %12ld %12.3f %10.1f\n", "all", calls, total / 1e6,
+            calls ? (double)total / calls : 0.0);
+    }
+}
+
+// Every algorithm, built-in or plugin, on the same workload. Plugins do not
+// model I/O, groups or locks, so every policy runs the CPU demand alone.
+void format_plugin_comparison(const Process* procs, int count, int quantum, const SwitchCost* cost,
+    char* out, size_t out_len) {
+    Process* copy = malloc((count ? count : 1) * sizeof(Process));
+    Simulation sim;
+
+    for (int i = 0; i < count; i++) {
+        copy[i] = procs[i];
+        copy[i].io_count = 0;
+        copy[i].group = 0;
+        copy[i].lock_count = 0;
+    }
+    init_simulation(&sim, copy, count, quantum);
+    sim.cost = *cost;
+    sim.record_gantt = 0;
+
+    size_t used = snprintf(out, out_len,
+        "ALGORITHMS AND PLUGINS\n"
+        "======================\n\n"
+        "Processes: %d (CPU demand only)\n"
+        "Time Quantum: %d\n\n"
+        "%-22s %9s %9s %9s %9s %10s %9s\n",
+        count, quantum, "Algorithm", "Avg TAT", "Avg WT", "Avg RT", "p99 WT", "Switches", "Run ms");
+
+    for (int a = FCFS; a <= algorithm_count && used < out_len; a++) {
+        struct timespec started;
+        TailLatency tail;
+        double total_tat = 0, total_rt = 0;
+
+        clock_gettime(CLOCK_MONOTONIC, &started);
+        run_fast_scheduler(&sim, (SchedulingAlgorithm)a);
+        double seconds = elapsed_seconds(&started);
+
+        for (int i = 0; i < count; i++) {
+            total_tat += copy[i].turnaround_time;
+            total_rt += copy[i].response_time;
+        }
+        measure_waiting_tail(copy, count, &tail);
+        used += snprintf(out + used, out_len - used, "%-22s %9.2f %9.2f %9.2f %9lld %10ld %9.3f\n",
+            algorithm_names[a - 1], count ? total_tat / count : 0.0, tail.mean, count ? total_rt / count : 0.0,
+            (long long)tail.p99, sim.switches, seconds * 1000);
+    }
+
+    for (int k = 0; k < plugin_count && used < out_len; k++) {
+        used += snprintf(out + used, out_len - used, "\n");
+        if (used < out_len) format_plugin_timing(&plugins[k], out + used, out_len - used);
+        used += strlen(out + used);
+    }
+
+    free_simulation(&sim);
+    free(copy);
+}
+
+// --plugin-compare: the comparison on a workload file or a generated workload
+int run_plugin_compare(const ReplicationConfig* config, const char* workload_path) {
+    Process* procs;
+    int count;
+    char error[1200];
+    size_t out_len = 16384;
+    char* out;
+
+    if (workload_path) {
+        if (load_workload(workload_path, &procs, &count, NULL, NULL, error, sizeof(error)) != 0) {
+            fprintf(stderr, "%s\n", error);
+            return 1;
+        }
+    }
+    else {
+        RngState rng;
+        count = config->jobs;
+        procs = malloc(count * sizeof(Process));
+        rng_seed(&rng, config->seed, 0);
+        generate_workload(procs, count, &rng, config);
+    }
+
+    out = malloc(out_len);
+    format_plugin_comparison(procs, count, config->time_quantum, &config->cost, out, out_len);
+    fputs(out, stdout);
+
+    free(out);
+    free(procs);
+    return 0;
+}
+
+// --plugin-match ALGO: runs the plugin chosen with --algorithm and the
+// built-in ALGO on one workload's CPU demand. Returns 1 unless the Gantt
+// blocks and metrics are the same, so a plugin that clones a built-in policy
+// checks the plugin ABI and engine end to end.
+int run_plugin_match(const ReplicationConfig* config, const char* workload_path, SchedulingAlgorithm expected) {
+    Process* procs;
+    int count;
+    char error[1200];
+
+    if (workload_path) {
+        if (load_workload(workload_path, &procs, &count, NULL, NULL, error, sizeof(error)) != 0) {
+            fprintf(stderr, "%s\n", error);
+            return 1;
+        }
+    }
+    else {
+        RngState rng;
+        count = config->jobs;
+        procs = malloc(count * sizeof(Process));
+        rng_seed(&rng, config->seed, 0);
+        generate_workload(procs, count, &rng, config);
+    }
+    for (int i = 0; i < count; i++) {
+        procs[i].io_count = 0;
+        procs[i].group = 0;
+        procs[i].lock_count = 0;
+    }
+
+    Process* copy = malloc(count * sizeof(Process));
+    memcpy(copy, procs, count * sizeof(Process));
+    Simulation reference, actual;
+    init_simulation(&reference, procs, count, config->time_quantum);
+    init_simulation(&actual, copy, count, config->time_quantum);
+    reference.cost = actual.cost = config->cost;
+    run_fast_scheduler(&reference, expected);
+    run_fast_scheduler(&actual, config->algo);
+
+    char diff[512];
+    int failed = compare_schedules(&reference, &actual, diff, sizeof(diff));
+    if (failed) {
+        printf("%s does not match %s: %s\n", algorithm_keys[config->algo - 1], algorithm_keys[expected - 1], diff);
+    }
+    else {
+        printf("%s matches %s: %d processes, %d Gantt blocks\n", algorithm_keys[config->algo - 1],
+            algorithm_keys[expected - 1], count, actual.gantt_count);
+    }
+
+    free_simulation(&reference);
+    free_simulation(&actual);
+    free(copy);
+    free(procs);
+    return failed;
+}
+
+// Time units
+//
+// Every engine counts time in 64-bit ticks and never looks at what a tick
+// stands for: an abstract time unit by default, or a nanosecond, microsecond
+// or millisecond. Only parsing and display use the unit, so a run costs the
+// same at any resolution; what grows with it is the size of the numbers.
+
+// Like strtoll for a time: a whole number of ticks or, when ticks are real
+// units, a decimal with an ns, us, ms or s suffix that comes to a whole
+// number of ticks ("1.5ms" is 1500 ticks of a microsecond). *end stays at
+// text when there is no valid time there.
+SimTime parse_time(const char* text, char** end) {
+    static const char* suffixes[] = { "ns", "us", "ms", "s" };
+    static const int64_t suffix_ns[] = { 1, 1000, 1000000, 1000000000 };
+    const char* c = text;
+    __int128 mantissa = 0, divisor = 1;
+    int digits = 0, decimals = -1, suffix = -1;
+
+    *end = (char*)text;
+    while (isspace((unsigned char)*c)) c++;
+    int negative = *c == '-';
+    if (*c == '-' || *c == '+') c++;
+    for (; isdigit((unsigned char)*c) || (*c == '.' && decimals < 0); c++) {
+        if (*c == '.') {
+            decimals = 0;
+            continue;
+        }
+        if (++digits > 27) return 0;
+        mantissa = mantissa * 10 + (*c - '0');
+        if (decimals >= 0) {
+            decimals++;
+            divisor *= 10;
+        }
+    }
+    if (digits == 0) return 0;
+
+    if (time_unit != TIME_UNIT_NONE) {
+        for (int k = 0; k < 4 && suffix < 0; k++) {
+            size_t length = strlen(suffixes[k]);
+            if (strncmp(c, suffixes[k], length) == 0 && !isalpha((unsigned char)c[length])) {
+                suffix = k;
+                c += length;
+            }
+        }
+    }
+    if (suffix >= 0) {
+        mantissa *= suffix_ns[suffix];
+        divisor *= time_unit_ns[time_unit];
+    }
+    if (mantissa % divisor != 0 || mantissa / divisor > MAX_SIM_TIME) return 0;
+
+    *end = (char*)c;
+    return (SimTime)(negative ? -(mantissa / divisor) : mantissa / divisor);
+}
+
+// A time for display. Abstract units print as a number with the given
+// decimals; real ones are scaled to the largest of ns, us, ms and s that
+// leaves at least 1, with three significant digits or more.
+void format_time(double t, int decimals, char* out, size_t out_len) {
+    static const char* scales[] = { "ns", "us", "ms", "s" };
+
+    if (time_unit == TIME_UNIT_NONE) {
+        snprintf(out, out_len, "%.*f", decimals, t);
+        return;
+    }
+    int scale = time_unit - TIME_UNIT_NS;
+    while (scale < 3 && fabs(t) >= 1000) {
+        t /= 1000;
+        scale++;
+    }
+    if (t == floor(t) || fabs(t) >= 100) snprintf(out, out_len, "%.0f %s", t, scales[scale]);
+    else snprintf(out, out_len, "%.*f %s", fabs(t) >= 10 ? 1 : 2, t, scales[scale]);
+}
+
+// I/O bursts and devices
+//
+// A process with I/O alternates between the CPU and its devices: once it has
+// had io[k].after units of CPU time it leaves the CPU and queues for device
+// io[k].device, and it is ready again when that request has been served. Each
+// device serves one request at a time, in the order of its discipline. Runs
+// with I/O go through this one event-driven engine for every policy. The
+// policies only see the current CPU burst, so SJF orders by the length of the
+// next burst and SRTF by what is left of it. On a workload without I/O the
+// engine makes the same schedule as the reference loops, which --verify checks.
+// Runs with bandwidth groups come here too: each group has a ready set of its
+// own, and a throttled group's set is passed over until its period ends.
+
+// "CPU,IO,CPU,..." where an I/O length may name its device as IO@D (1-based)
+int parse_burst_sequence(const char* text, Process* p) {
+    IoBurst io[MAX_IO_BURSTS];
+    SimTime total = 0;
+    int io_count = 0;
+    int expect_cpu = 1;
+    const char* c = text;
+
+    while (1) {
+        char* end;
+        SimTime value = parse_time(c, &end);
+        if (end == c || value < 1) return 0;
+        c = end;
+
+        if (expect_cpu) {
+            total += value;
+            if (total > MAX_SIM_TIME) return 0;
+        }
+        else {
+            long device = 1;
+            if (*c == '@') {
+                device = strtol(c + 1, &end, 10);
+                if (end == c + 1 || device < 1 || device > MAX_IO_DEVICES) return 0;
+                c = end;
+            }
+            if (io_count == MAX_IO_BURSTS) return 0;
+            io[io_count++] = (IoBurst){ total, value, (int)device - 1 };
+        }
+        expect_cpu = !expect_cpu;
+
+        while (isspace((unsigned char)*c)) c++;
+        if (*c != ',') break;
+        c++;
+    }
+
+    // The sequence starts and ends with a CPU burst
+    if (expect_cpu || *c != '\0') return 0;
+
+    p->burst_time = total;
+    p->io_count = io_count;
+    memcpy(p->io, io, io_count * sizeof(IoBurst));
+    return 1;
+}
+
+// Comma-separated disciplines, one per device: "fcfs,sjf"
+int parse_io_devices(const char* text, IoConfig* out) {
+    char copy[256];
+    IoConfig io = { 0, { IO_FCFS } };
+
+    snprintf(copy, sizeof(copy), "%s", text);
+    for (char* item = strtok(copy, ","); item; item = strtok(NULL, ",")) {
+        int found = -1;
+        for (int d = 0; d < 3; d++) {
+            if (strcmp(item, io_discipline_keys[d]) == 0) found = d;
+        }
+        if (found < 0 || io.device_count == MAX_IO_DEVICES) return 0;
+        io.discipline[io.device_count++] = (IoDiscipline)found;
+    }
+    if (io.device_count == 0) return 0;
+
+    *out = io;
+    return 1;
+}
+
+void format_io_devices(const IoConfig* io, int device_count, char* out, size_t out_len) {
+    size_t used = 0;
+
+    out[0] = '\0';
+    for (int d = 0; d < device_count && used < out_len; d++) {
+        used += snprintf(out + used, out_len - used, "%s%d %s", d ? ", " : "", d + 1,
+            io_discipline_keys[io_discipline(io, d)]);
+    }
+}
+
+// Devices the configuration does not name serve FCFS
+IoDiscipline io_discipline(const IoConfig* io, int device) {
+    return device < io->device_count ? io->discipline[device] : IO_FCFS;
+}
+
+int workload_has_io(const Process* procs, int count) {
+    for (int i = 0; i < count; i++) {
+        if (procs[i].io_count > 0) return 1;
+    }
+    return 0;
+}
+
+SimTime io_total(const Process* p) {
+    SimTime total = 0;
+    for (int k = 0; k < p->io_count; k++) {
+        total += p->io[k].length;
+    }
+    return total;
+}
+
+// CPU time left before the process next blocks or finishes
+SimTime cpu_burst_left(const Process* p) {
+    SimTime used = p->burst_time - p->remaining_time;
+    SimTime end = p->io_next < p->io_count ? p->io[p->io_next].after : p->burst_time;
+    return end - used;
+}
+
+void io_log_free(IoLog* log) {
+    if (!log) return;
+    for (int d = 0; d < MAX_IO_DEVICES; d++) {
+        free(log->gantt[d]);
+    }
+    free(log->spans);
+    free(log);
+}
+
+void io_log_span(IoLog* log, SimTime start, SimTime end, int device) {
+    if (log->span_count == log->span_capacity) {
+        log->span_capacity = log->span_capacity ? log->span_capacity * 2 : MAX_PROCESSES * 10;
+        log->spans = realloc(log->spans, log->span_capacity * sizeof(IoSpan));
+    }
+    log->spans[log->span_count++] = (IoSpan){ start, end, device };
+}
+
+int compare_io_edges(const void* a, const void* b) {
+    const IoEdge* x = (const IoEdge*)a;
+    const IoEdge* y = (const IoEdge*)b;
+    if (x->time != y->time) return (x->time > y->time) - (x->time < y->time);
+    return (x->delta > y->delta) - (x->delta < y->delta);
+}
+
+// Sweeps the CPU and device spans in time order to find how long the devices
+// were busy and how much of that time the CPU was busy too.
+void io_log_finish(IoLog* log, const Simulation* sim) {
+    SimTime first_arrival = INT64_MAX, last_completion = 0;
+    IoEdge* edges = malloc((2 * log->span_count + 1) * sizeof(IoEdge));
+    long edge_count = 0;
+    int cpu = 0, devices = 0;
+
+    for (int i = 0; i < sim->process_count; i++) {
+        const Process* p = &sim->processes[i];
+        if (p->arrival_time < first_arrival) first_arrival = p->arrival_time;
+        if (p->completion_time > last_completion) last_completion = p->completion_time;
+    }
+    log->elapsed = last_completion > first_arrival ? last_completion - first_arrival : 1;
+
+    for (long k = 0; k < log->span_count; k++) {
+        const IoSpan* s = &log->spans[k];
+        if (s->device < 0) log->cpu_busy += s->end - s->start;
+        edges[edge_count++] = (IoEdge){ s->start, 1, s->device };
+        edges[edge_count++] = (IoEdge){ s->end, -1, s->device };
+    }
+    qsort(edges, edge_count, sizeof(IoEdge), compare_io_edges);
+
+    for (long k = 0; k < edge_count; k++) {
+        if (k > 0) {
+            long span = edges[k].time - edges[k - 1].time;
+            if (devices > 0) log->device_busy += span;
+            if (devices > 0 && cpu > 0) log->overlap_time += span;
+        }
+        if (edges[k].device < 0) cpu += edges[k].delta;
+        else devices += edges[k].delta;
+    }
+
+    free(edges);
+    free(log->spans);
+    log->spans = NULL;
+    log->span_count = 0;
+    log->span_capacity = 0;
+}
+
+SchedKey io_ready_key(const Simulation* sim, const Process* p, int index, SchedulingAlgorithm algo, SimTime time) {
+    switch (algo) {
+    case SJF:
+    case SRTF:
+        return make_key(cpu_burst_left(p), index);
+    case PRIORITY:
+    case PREEMPTIVE_PRIORITY:
+        return make_key(aged_priority(sim, p), index);
+    default:
+        // FCFS serves bursts in the order they became ready
+        return make_key(time, index);
+    }
+}
+
+// One ready set per group, sized for the processes of the group and, under
+// Stride, its child groups
+void io_sets_init(IoEngine* e) {
+    const Simulation* sim = e->sim;
+    int n = sim->process_count;
+
+    e->set_count = sim->groups.count + 1;
+    e->sets = calloc(e->set_count, sizeof(ReadySet));
+    e->releases = malloc(e->set_count * sizeof(SchedKey));
+    for (int i = 0; i < n; i++) {
+        e->set_of[i] = process_group(sim, &sim->processes[i]);
+        e->sets[e->set_of[i]].capacity++;
+    }
+    for (int s = 0; s < e->set_count; s++) {
+        ReadySet* set = &e->sets[s];
+        if (e->algo == LOTTERY && set->capacity > 0) set->tree = calloc(n + 1, sizeof(int64_t));
+        if (s > 0) {
+            set->parent = sim->groups.group[s].parent;
+            e->sets[set->parent].capacity++;
+        }
+    }
+    for (int s = 0; s < e->set_count; s++) {
+        ReadySet* set = &e->sets[s];
+        set->capacity++;
+        set->heap = malloc(set->capacity * sizeof(SchedKey));
+        if (e->algo == ROUND_ROBIN) set->queue = malloc(set->capacity * sizeof(int));
+    }
+}
+
+void io_sets_free(IoEngine* e) {
+    for (int s = 0; s < e->set_count; s++) {
+        free(e->sets[s].heap);
+        free(e->sets[s].queue);
+        free(e->sets[s].tree);
+    }
+    free(e->sets);
+    free(e->releases);
+}
+
+// Time the set has spent blocked up to `time`
+SimTime io_blocked_area(const ReadySet* set, SimTime time) {
+    return set->blocked_area + (set->blocked ? time - set->blocked_from : 0);
+}
+
+// A ready process is held back for exactly as long as its set is blocked,
+// so its throttled time is the growth of the set's blocked time from when it
+// became ready to when it is dispatched
+void io_mark_ready(IoEngine* e, int index, SimTime time) {
+    e->mark[index] = io_blocked_area(&e->sets[e->set_of[index]], time);
+}
+
+// Recomputes which sets are blocked after a group was throttled or released
+// at `time`. Parents come before their children.
+void io_update_blocked(IoEngine* e, SimTime time) {
+    for (int s = 1; s < e->set_count; s++) {
+        ReadySet* set = &e->sets[s];
+        int blocked = set->throttled || e->sets[set->parent].blocked;
+        if (blocked == set->blocked) continue;
+
+        if (blocked) set->blocked_from = time;
+        else set->blocked_area += time - set->blocked_from;
+        set->blocked = blocked;
+    }
+}
+
+// Finds the sets with a process that may run in or below them, children
+// before parents. Under Stride the groups that became runnable join their
+// parent's heap at no less than its current pass, like a process does.
+void io_sync_sets(IoEngine* e) {
+    int n = e->sim->process_count;
+
+    for (int s = 0; s < e->set_count; s++) {
+        e->sets[s].runnable = e->sets[s].members > 0;
+    }
+    for (int g = e->set_count - 1; g > 0; g--) {
+        ReadySet* set = &e->sets[g];
+        if (set->throttled) set->runnable = 0;
+        if (set->runnable) e->sets[set->parent].runnable = 1;
+    }
+
+    if (e->algo != STRIDE) return;
+    for (int g = 1; g < e->set_count; g++) {
+        ReadySet* set = &e->sets[g];
+        ReadySet* parent = &e->sets[set->parent];
+        if (!set->runnable || set->queued) continue;
+
+        if (set->own_pass < parent->pass) set->own_pass = parent->pass;
+        heap_push(parent->heap, &parent->heap_size, make_key(set->own_pass - parent->base, n + g));
+        set->queued = 1;
+    }
+}
+
+// Puts processes[index] in its group's ready set: by `key` under the heap
+// policies, behind everything queued before under Round Robin, at no less
+// than the set's current pass under Stride, and with its tickets under Lottery
+void io_enqueue(IoEngine* e, int index, SchedKey key) {
+    ReadySet* set = &e->sets[e->set_of[index]];
+    const Process* p = &e->sim->processes[index];
+
+    set->members++;
+    switch (e->algo) {
+    case ROUND_ROBIN:
+        e->ready_key[index] = e->enqueued++;
+        set->queue[set->rear] = index;
+        set->rear = (set->rear + 1) % set->capacity;
+        break;
+    case STRIDE:
+        if (e->pass[index] < set->pass) e->pass[index] = set->pass;
+        heap_push(set->heap, &set->heap_size, make_key(e->pass[index] - set->base, index));
+        break;
+    case LOTTERY:
+        fenwick_add(set->tree, e->sim->process_count, index, process_weight(p));
+        set->tickets += process_weight(p);
+        break;
+    default:
+        e->ready_key[index] = key;
+        heap_push(set->heap, &set->heap_size, key);
+        break;
+    }
+}
+
+// Round Robin collects what became ready into a batch that io_admit queues
+// in table order, like a batch of arrivals.
+void io_make_ready(IoEngine* e, int index, SimTime time) {
+    io_mark_ready(e, index, time);
+    if (e->algo == ROUND_ROBIN) {
+        e->batch[e->batch_count++] = index;
+    }
+    else {
+        io_enqueue(e, index, io_ready_key(e->sim, &e->sim->processes[index], index, e->algo, time));
+    }
+}
+
+// The unblocked set whose first process goes next under the policies that
+// ignore group weights, -1 if nothing ready may run
+int io_best_set(const IoEngine* e) {
+    int best = -1;
+    SchedKey best_key = 0;
+
+    for (int s = 0; s < e->set_count; s++) {
+        const ReadySet* set = &e->sets[s];
+        if (set->blocked || set->members == 0) continue;
+
+        SchedKey key = e->algo == ROUND_ROBIN ? e->ready_key[set->queue[set->front]] : set->heap[0];
+        if (best < 0 || key < best_key) {
+            best = s;
+            best_key = key;
+        }
+    }
+    return best;
+}
+
+// Takes the process to run next out of its ready set. Stride and Lottery
+// choose level by level from the root, between a group's own processes and
+// its runnable child groups; the other policies take the first process of
+// any unblocked set. io_sync_sets must have run since the sets last changed.
+int io_pick(IoEngine* e) {
+    int n = e->sim->process_count;
+    int index, s = 0;
+
+    if (e->algo == STRIDE) {
+        while (1) {
+            ReadySet* set = &e->sets[s];
+            SchedKey key = heap_pop(set->heap, &set->heap_size);
+            int entry = key_index(key);
+            set->pass = set->base + key_primary(key);
+            if (set->pass - set->base > STRIDE_REBASE) {
+                stride_rebase(set->heap, set->heap_size, set->pass - set->base);
+                set->base = set->pass;
+            }
+            if (entry < n) {
+                index = entry;
+                break;
+            }
+            s = entry - n;
+            e->sets[s].queued = 0;
+        }
+    }
+    else if (e->algo == LOTTERY) {
+        while (1) {
+            ReadySet* set = &e->sets[s];
+            int64_t weights = 0;
+            int children = 0, only = -1;
+            for (int g = s + 1; g < e->set_count; g++) {
+                if (e->sets[g].parent != s || !e->sets[g].runnable) continue;
+                weights += e->sim->groups.group[g].weight;
+                children++;
+                only = g;
+            }
+
+            // A group holding nothing but one runnable child has no draw to make
+            if (set->tickets == 0 && children == 1) {
+                s = only;
+                continue;
+            }
+
+            int64_t ticket = (int64_t)(rng_next(&e->rng) % (uint64_t)(set->tickets + weights));
+            if (ticket < set->tickets) {
+                index = fenwick_find(set->tree, n, ticket);
+                break;
+            }
+            ticket -= set->tickets;
+            for (int g = s + 1; g < e->set_count; g++) {
+                if (e->sets[g].parent != s || !e->sets[g].runnable) continue;
+                if (ticket < e->sim->groups.group[g].weight) {
+                    s = g;
+                    break;
+                }
+                ticket -= e->sim->groups.group[g].weight;
+            }
+        }
+        fenwick_add(e->sets[s].tree, n, index, -process_weight(&e->sim->processes[index]));
+        e->sets[s].tickets -= process_weight(&e->sim->processes[index]);
+    }
+    else {
+        s = io_best_set(e);
+        ReadySet* set = &e->sets[s];
+        if (e->algo == ROUND_ROBIN) {
+            index = set->queue[set->front];
+            set->front = (set->front + 1) % set->capacity;
+        }
+        else {
+            index = key_index(heap_pop(set->heap, &set->heap_size));
+        }
+    }
+
+    ReadySet* set = &e->sets[s];
+    set->members--;
+    e->sim->processes[index].throttled_time += io_blocked_area(set, e->sim->current_time) - e->mark[index];
+    return index;
+}
+
+// Stride: processes[index] ran for `ran` units, so it and every group above
+// it move on by their stride for each
+void io_stride_advance(IoEngine* e, int index, SimTime ran) {
+    e->pass[index] += (int64_t)process_stride(&e->sim->processes[index]) * ran;
+    for (int g = e->set_of[index]; g > 0; g = e->sets[g].parent) {
+        e->sets[g].own_pass += (int64_t)(STRIDE_ONE / e->sim->groups.group[g].weight) * ran;
+    }
+}
+
+// Moves a group on to the period holding `time`, with its whole quota
+void io_refresh_period(ReadySet* set, const CpuGroup* group, SimTime time) {
+    if (time >= set->period_start && (int64_t)time - set->period_start < group->period) return;
+    set->period_start = time - ((time % group->period) + group->period) % group->period;
+    set->used = 0;
+}
+
+// When a group above processes[index] runs out of quota if the process runs
+// from `now` without a break, INT64_MAX if none of them ever would. A group
+// that reaches its quota just as its period ends is not throttled.
+SimTime io_budget_end(IoEngine* e, int index, SimTime now) {
+    SimTime end = INT64_MAX;
+
+    for (int g = e->set_of[index]; g > 0; g = e->sets[g].parent) {
+        const CpuGroup* group = &e->sim->groups.group[g];
+        ReadySet* set = &e->sets[g];
+        if (group->quota <= 0) continue;
+
+        io_refresh_period(set, group, now);
+        int64_t period_end = (int64_t)set->period_start + group->period;
+        int64_t exhausted = (int64_t)now + group->quota - set->used;
+        if (exhausted >= period_end) {
+            if (group->quota >= group->period) continue;
+            exhausted = period_end + group->quota;
+        }
+        if (exhausted < end) end = exhausted;
+    }
+    return end;
+}
+
+// The group used up its quota at `time`; it is released when its period ends
+void io_throttle(IoEngine* e, int group, SimTime time) {
+    ReadySet* set = &e->sets[group];
+
+    set->throttled = 1;
+    set->throttled_since = time;
+    e->sim->group_log->throttles[group]++;
+    heap_push(e->releases, &e->release_count, make_key(set->period_start + e->sim->groups.group[group].period, group));
+    io_update_blocked(e, time);
+}
+
+// A new period began at `time` for a throttled group
+void io_release(IoEngine* e, int group, SimTime time) {
+    ReadySet* set = &e->sets[group];
+    GroupLog* log = e->sim->group_log;
+
+    log->throttled_time[group] += time - set->throttled_since;
+    if (e->sim->record_gantt) group_log_span(log, set->throttled_since, time, group);
+    set->throttled = 0;
+    set->period_start = time;
+    set->used = 0;
+    io_update_blocked(e, time);
+}
+
+// Charges the slice [from, to) of processes[index] to every group above it,
+// and throttles those that used their quota before their period ended
+void io_charge(IoEngine* e, int index, SimTime from, SimTime to) {
+    for (int g = e->set_of[index]; g > 0; g = e->sets[g].parent) {
+        const CpuGroup* group = &e->sim->groups.group[g];
+        ReadySet* set = &e->sets[g];
+        e->sim->group_log->used[g] += to - from;
+        if (group->quota <= 0) continue;
+
+        io_refresh_period(set, group, from);
+        if ((int64_t)to - set->period_start >= group->period) {
+            // Only the part in the period the slice ended in counts against it
+            io_refresh_period(set, group, to);
+            set->used = to - set->period_start;
+        }
+        else {
+            set->used += to - from;
+        }
+        if (set->used >= group->quota) io_throttle(e, g, to);
+    }
+}
+
+void io_start_request(IoEngine* e, int device, SimTime time) {
+    if (e->device_queued[device] == 0) {
+        e->device_busy[device] = -1;
+        return;
+    }
+
+    int index = key_index(heap_pop(e->device_queue[device], &e->device_queued[device]));
+    Process* p = &e->sim->processes[index];
+    IoLog* log = e->sim->io_log;
+    SimTime length = p->io[p->io_next].length;
+
+    e->device_busy[device] = index;
+    e->device_until[device] = time + length;
+    log->requests[device]++;
+    log->busy_time[device] += length;
+    log->queue_time[device] += time - e->requested[index];
+    io_log_span(log, time, time + length, device);
+
+    if (e->sim->record_gantt) {
+        if (log->gantt_count[device] == log->gantt_capacity[device]) {
+            log->gantt_capacity[device] = log->gantt_capacity[device] ? log->gantt_capacity[device] * 2 : MAX_PROCESSES;
+            log->gantt[device] = realloc(log->gantt[device], log->gantt_capacity[device] * sizeof(GanttBlock));
+        }
+        GanttBlock* block = &log->gantt[device][log->gantt_count[device]++];
+        strcpy(block->process_name, p->name);
+        block->start_time = time;
+        block->end_time = time + length;
+        block->process_index = index;
+        block->overhead = 0;
+        block->color = p->color;
+    }
+}
+
+// Queues the pending request of processes[index] at its device
+void io_issue(IoEngine* e, int index) {
+    Simulation* sim = e->sim;
+    Process* p = &sim->processes[index];
+    int device = p->io[p->io_next].device;
+    SchedKey key;
+
+    io_advance_devices(e, sim->current_time);
+    switch (io_discipline(&sim->io, device)) {
+    case IO_SJF:
+        key = make_key(p->io[p->io_next].length, index);
+        break;
+    case IO_PRIORITY:
+        key = make_key(p->priority, index);
+        break;
+    default:
+        key = make_key(sim->current_time, index);
+        break;
+    }
+
+    e->requested[index] = sim->current_time;
+    heap_push(e->device_queue[device], &e->device_queued[device], key);
+    if (e->device_busy[device] < 0) io_start_request(e, device, sim->current_time);
+}
+
+// Finishes every request done by `now`, earliest first, starting the next
+// request of each device as it frees up.
+void io_advance_devices(IoEngine* e, SimTime now) {
+    while (1) {
+        int device = -1;
+        for (int d = 0; d < e->device_count; d++) {
+            if (e->device_busy[d] >= 0 && e->device_until[d] <= now &&
+                (device < 0 || e->device_until[d] < e->device_until[device])) {
+                device = d;
+            }
+        }
+        if (device < 0) return;
+
+        int index = e->device_busy[device];
+        SimTime time = e->device_until[device];
+        Process* p = &e->sim->processes[index];
+        p->blocked_time += time - e->requested[index];
+        p->io_next++;
+
+        io_start_request(e, device, time);
+        io_make_ready(e, index, time);
+    }
+}
+
+// Admits arrivals, finished requests and the ends of throttled periods up
+// to the current time
+void io_admit(IoEngine* e) {
+    Simulation* sim = e->sim;
+    Process* procs = sim->processes;
+
+    io_advance_devices(e, sim->current_time);
+    while (e->next < sim->process_count && procs[e->order[e->next]].arrival_time <= sim->current_time) {
+        int i = e->order[e->next++];
+        io_make_ready(e, i, procs[i].arrival_time);
+    }
+    while (e->release_count > 0 && key_primary(e->releases[0]) <= sim->current_time) {
+        SchedKey key = heap_pop(e->releases, &e->release_count);
+        io_release(e, key_index(key), key_primary(key));
+    }
+
+    if (e->algo == ROUND_ROBIN) {
+        if (e->batch_count > 1) qsort(e->batch, e->batch_count, sizeof(int), compare_int);
+        for (int k = 0; k < e->batch_count; k++) {
+            io_enqueue(e, e->batch[k], 0);
+        }
+        e->batch_count = 0;
+    }
+}
+
+// Next arrival, request completion or end of a throttled period, INT64_MAX if
+// there is none
+SimTime io_next_event(const IoEngine* e) {
+    SimTime next = INT64_MAX;
+
+    if (e->next < e->sim->process_count) next = e->sim->processes[e->order[e->next]].arrival_time;
+    for (int d = 0; d < e->device_count; d++) {
+        if (e->device_busy[d] >= 0 && e->device_until[d] < next) next = e->device_until[d];
+    }
+    if (e->release_count > 0) {
+        SimTime release = key_primary(e->releases[0]);
+        if (release < next) next = release;
+    }
+    return next;
+}
+
+void io_end_burst(IoEngine* e, int index) {
+    Process* p = &e->sim->processes[index];
+
+    if (p->remaining_time == 0) {
+        p->completion_time = e->sim->current_time;
+        e->completed++;
+    }
+    else {
+        io_issue(e, index);
+    }
+}
+
+void io_scheduling(Simulation* sim, SchedulingAlgorithm algo) {
+    Process* procs = sim->processes;
+    int n = sim->process_count;
+    int slots = n ? n : 1;
+    int preemptive = algo == SRTF || algo == PREEMPTIVE_PRIORITY;
+    int sliced = algo == ROUND_ROBIN || proportional_share(algo);
+    // A run without I/O that only comes here for its groups keeps no device log
+    int log_io = workload_has_io(procs, n) || !workload_has_groups(sim);
+    IoEngine e;
+
+    memset(&e, 0, sizeof(e));
+    e.sim = sim;
+    e.algo = algo;
+    e.order = simulation_arrival_order(sim);
+    e.set_of = malloc(slots * sizeof(int));
+    e.mark = malloc(slots * sizeof(SimTime));
+    e.pass = calloc(slots, sizeof(int64_t));
+    e.ready_key = malloc(slots * sizeof(SchedKey));
+    e.batch = malloc(slots * sizeof(int));
+    e.requested = malloc(slots * sizeof(SimTime));
+    rng_seed(&e.rng, sim->seed, 0);
+    io_sets_init(&e);
+
+    e.device_count = sim->io.device_count;
+    for (int i = 0; i < n; i++) {
+        for (int k = 0; k < procs[i].io_count; k++) {
+            if (procs[i].io[k].device >= e.device_count) e.device_count = procs[i].io[k].device + 1;
+        }
+    }
+    for (int d = 0; d < e.device_count; d++) {
+        e.device_queue[d] = malloc(slots * sizeof(SchedKey));
+        e.device_busy[d] = -1;
+    }
+
+    io_log_free(sim->io_log);
+    sim->io_log = NULL;
+    if (log_io) {
+        sim->io_log = calloc(1, sizeof(IoLog));
+        sim->io_log->device_count = e.device_count;
+    }
+    group_log_free(sim->group_log);
+    sim->group_log = NULL;
+    if (workload_has_groups(sim)) {
+        sim->group_log = calloc(1, sizeof(GroupLog));
+        sim->group_log->group_count = sim->groups.count;
+    }
+
+    while (e.completed < n) {
+        io_admit(&e);
+        io_sync_sets(&e);
+
+        if (!e.sets[0].runnable) {
+            // CPU idle until the next arrival, finished request or release
+            SimTime next = io_next_event(&e);
+            if (next == INT64_MAX) break;
+            sim->current_time = next;
+            continue;
+        }
+
+        int index = io_pick(&e);
+        Process* p = &procs[index];
+        SimTime dispatched = sim->current_time;
+        int overhead = switch_overhead(sim, index);
+        sim->current_time += overhead;
+
+        if (p->start_time == -1) {
+            p->start_time = sim->current_time;
+        }
+
+        // Non-preemptive policies run the whole burst, the sliced ones a
+        // quantum of it. The preemptive ones stop at the next arrival,
+        // finished request or release, or when a waiting process ages past
+        // this one: the only events that can change which process is best.
+        // Any of them stops when a group above the process runs out of quota.
+        SimTime run_until = sim->current_time + cpu_burst_left(p);
+        if (sliced && cpu_burst_left(p) > sim->time_quantum) {
+            run_until = sim->current_time + sim->time_quantum;
+        }
+        else if (preemptive) {
+            SimTime next = io_next_event(&e);
+            int best = io_best_set(&e);
+            if (algo == PREEMPTIVE_PRIORITY && best >= 0) {
+                SimTime aged = aging_preemption_time(sim, e.sets[best].heap, e.sets[best].heap_size, p, index);
+                if (aged < next) next = aged;
+            }
+            if (next < run_until) {
+                run_until = next;
+                if (run_until <= sim->current_time) run_until = sim->current_time + 1;
+            }
+        }
+        SimTime budget_end = io_budget_end(&e, index, sim->current_time);
+        if (budget_end < run_until) run_until = budget_end;
+
+        if (preemptive && overhead == 0 && extends_last_block(sim, p) &&
+            sim->gantt[sim->gantt_count - 1].end_time == dispatched) {
+            sim->gantt[sim->gantt_count - 1].end_time = run_until;
+        }
+        else {
+            add_gantt_block(sim, p, dispatched, run_until, overhead);
+        }
+        if (log_io) io_log_span(sim->io_log, dispatched, run_until, -1);
+
+        SimTime started = sim->current_time;
+        p->remaining_time -= run_until - started;
+        sim->current_time = run_until;
+        p->last_run_end = run_until;
+
+        // Arrivals and returns during the slice queue ahead of a preempted
+        // process; then the slice is charged to the process's groups
+        io_admit(&e);
+        io_charge(&e, index, started, run_until);
+        if (algo == STRIDE) io_stride_advance(&e, index, run_until - started);
+
+        if (cpu_burst_left(p) > 0) {
+            // FCFS keeps its place when a quota cut its burst short
+            SchedKey key = algo == FCFS ? e.ready_key[index] : io_ready_key(sim, p, index, algo, sim->current_time);
+            int best = io_best_set(&e);
+
+            // A process its group holds back has no head start to keep
+            if (algo == PREEMPTIVE_PRIORITY && !e.sets[e.set_of[index]].blocked) {
+                key = preempted_key(sim, best >= 0 ? e.sets[best].heap : NULL, best >= 0 ? e.sets[best].heap_size : 0,
+                    p, index, key);
+            }
+            io_mark_ready(&e, index, sim->current_time);
+            io_enqueue(&e, index, key);
+        }
+        else {
+            io_end_burst(&e, index);
+        }
+    }
+
+    // Groups throttled when the last process finishes stop counting there
+    for (int g = 1; g < e.set_count; g++) {
+        if (e.sets[g].throttled) io_release(&e, g, sim->current_time);
+    }
+
+    if (log_io) io_log_finish(sim->io_log, sim);
+    if (sim->group_log) group_log_finish(sim->group_log, sim);
+
+    io_sets_free(&e);
+    free(e.set_of);
+    free(e.mark);
+    free(e.pass);
+    free(e.ready_key);
+    free(e.batch);
+    free(e.requested);
+    for (int d = 0; d < e.device_count; d++) {
+        free(e.device_queue[d]);
+    }
+}
+
+void run_io_scheduler(Simulation* sim, SchedulingAlgorithm algo) {
+    reset_process_state(sim->processes, sim->process_count);
+    begin_run(sim);
+    io_scheduling(sim, algo);
+    calculate_times(sim);
+}
+
+void format_io_summary(const Simulation* sim, char* out, size_t out_len) {
+    const IoLog* log = sim->io_log;
+    int completed = sim->process_count;
+    size_t used = 0;
+
+    for (int d = 0; d < log->device_count && used < out_len; d++) {
+        used += snprintf(out + used, out_len - used,
+            "Device %d (%s): %.1f%% busy, %ld requests, mean queue wait %.2f\n",
+            d + 1, io_discipline_keys[io_discipline(&sim->io, d)],
+            100.0 * log->busy_time[d] / log->elapsed, log->requests[d],
+            log->requests[d] ? (double)log->queue_time[d] / log->requests[d] : 0.0);
+    }
+    if (used < out_len) {
+        snprintf(out + used, out_len - used,
+            "CPU utilization: %.1f%% (switch overhead included)\n"
+            "Any device busy: %.1f%% of the elapsed time\n"
+            "CPU and I/O overlap: %.1f%% of the elapsed time\n"
+            "Throughput: %.3f processes per 100 time units\n",
+            100.0 * log->cpu_busy / log->elapsed,
+            100.0 * log->device_busy / log->elapsed,
+            100.0 * log->overlap_time / log->elapsed,
+            100.0 * completed / log->elapsed);
+    }
+}
+
+// Runs every policy on a copy of procs with the I/O engine and tabulates
+// what each one gets out of the CPU and the devices.
+void format_io_comparison(const Process* procs, int count, int quantum, const SwitchCost* cost,
+    const IoConfig* io, char* out, size_t out_len) {
+    Process* copy = malloc((count ? count : 1) * sizeof(Process));
+    long cpu_demand = 0, io_demand = 0;
+    int io_bound = 0;
+    char devices[128];
+    size_t used;
+    Simulation sim;
+
+    for (int i = 0; i < count; i++) {
+        cpu_demand += procs[i].burst_time;
+        io_demand += io_total(&procs[i]);
+        if (procs[i].io_count > 0) io_bound++;
+    }
+
+    memcpy(copy, procs, count * sizeof(Process));
+    init_simulation(&sim, copy, count, quantum);
+    sim.cost = *cost;
+    sim.io = *io;
+    sim.record_gantt = 0;
+
+
+    run_io_scheduler(&sim, FCFS);
+    format_io_devices(io, sim.io_log->device_count, devices, sizeof(devices));
+
+    used = snprintf(out, out_len,
+        "POLICIES WITH I/O\n"
+        "=================\n\n"
+        "Processes: %d (%d with I/O)\n"
+        "CPU demand: %ld, I/O demand: %ld time units\n"
+        "Devices: %s\n"
+        "Time Quantum: %d\n\n"
+        "%-20s %9s %9s %7s %7s %9s %11s\n",
+        count, io_bound, cpu_demand, io_demand, devices, quantum,
+        "Algorithm", "Avg TAT", "Avg WT", "CPU %", "I/O %", "Overlap %", "Throughput");
+
+    for (int a = 0; a < ALGORITHM_COUNT && used < out_len; a++) {
+        double total_tat = 0, total_wt = 0;
+
+        if (a > 0) run_io_scheduler(&sim, (SchedulingAlgorithm)(a + 1));
+        for (int i = 0; i < count; i++) {
+            total_tat += copy[i].turnaround_time;
+            total_wt += copy[i].waiting_time;
+        }
+
+        const IoLog* log = sim.io_log;
+        used += snprintf(out + used, out_len - used,
+            "%-20s %9.2f %9.2f %7.1f %7.1f %9.1f %11.3f\n",
+            algorithm_names[a], count ? total_tat / count : 0.0, count ? total_wt / count : 0.0,
+            100.0 * log->cpu_busy / log->elapsed, 100.0 * log->device_busy / log->elapsed,
+            100.0 * log->overlap_time / log->elapsed, 100.0 * count / log->elapsed);
+    }
+    if (used < out_len) {
+        snprintf(out + used, out_len - used,
+            "\nWaiting time counts the ready queue only. Overlap is the share of the\n"
+            "elapsed time in which the CPU and a device were busy at once; the more\n"
+            "a policy overlaps, the sooner the same work finishes.\n");
+    }
+
+    free_simulation(&sim);
+    free(copy);
+}
+
+// --io-compare: runs every policy on a workload file, or on a generated mix
+// of CPU-bound and I/O-bound jobs, and prints the comparison.
+int run_io_compare(const ReplicationConfig* config, const char* workload_path) {
+    Process* procs;
+    int count;
+    char error[1200];
+    size_t out_len = 16384;
+    char* out;
+
+    if (workload_path) {
+        if (load_workload(workload_path, &procs, &count, NULL, NULL, error, sizeof(error)) != 0) {
+            fprintf(stderr, "%s\n", error);
+            return 1;
+        }
+    }
+    else {
+        RngState rng;
+        count = config->jobs;
+        procs = malloc(count * sizeof(Process));
+        rng_seed(&rng, config->seed, 0);
+        generate_workload(procs, count, &rng, config);
+    }
+
+    out = malloc(out_len);
+    format_io_comparison(procs, count, config->time_quantum, &config->cost, &config->io, out, out_len);
+    fputs(out, stdout);
+
+    free(out);
+    free(procs);
+    return 0;
+}
+
+// CPU bandwidth groups
+//
+// Processes can belong to a tree of groups modelled on cgroup v2's cpu.max
+// and cpu.weight. A group with a quota may use that much CPU time in each
+// period, its subgroups' use included; once it has, it is throttled and none
+// of its processes run until the next period begins. The I/O engine keeps
+// the ends of throttled periods in a heap beside the arrivals and request
+// completions, so a release is one more event rather than a check every
+// tick. Under Stride and Lottery a group also competes with its siblings and
+// its parent's own processes in proportion to its weight; the other policies
+// ignore weights. Switch overhead is not charged to a group.
+
+// Group number of a path, 0 for "/", -1 if there is no such group
+int find_group(const GroupConfig* groups, const char* path) {
+    if (strcmp(path, "/") == 0) return 0;
+    for (int g = 1; g <= groups->count; g++) {
+        if (strcmp(groups->group[g].path, path) == 0) return g;
+    }
+    return -1;
+}
+
+// Whether `group` is `ancestor` or below it
+int group_within(const GroupConfig* groups, int group, int ancestor) {
+    for (; group > 0; group = groups->group[group].parent) {
+        if (group == ancestor) return 1;
+    }
+    return ancestor == 0;
+}
+
+// A group number the configuration does not have counts as none
+int process_group(const Simulation* sim, const Process* p) {
+    return p->group > 0 && p->group <= sim->groups.count ? p->group : 0;
+}
+
+int workload_has_groups(const Simulation* sim) {
+    if (sim->groups.count == 0) return 0;
+    for (int i = 0; i < sim->process_count; i++) {
+        if (process_group(sim, &sim->processes[i]) > 0) return 1;
+    }
+    return 0;
+}
+
+// Adds the group of a "group PATH QUOTA|max PERIOD [WEIGHT]" line. Its parent
+// must already be defined. Returns 0 and describes the problem on error.
+int parse_group(const char* line, GroupConfig* groups, char* error, size_t error_len) {
+    char keyword[16], path[MAX_GROUP_PATH + 1], quota_text[16];
+    int period = 0, weight = DEFAULT_GROUP_WEIGHT;
+    long quota = 0;
+
+    int fields = sscanf(line, " %15s %64s %15s %d %d", keyword, path, quota_text, &period, &weight);
+    if (fields < 4 || strcmp(keyword, "group") != 0) {
+        snprintf(error, error_len, "expected group PATH QUOTA|max PERIOD [WEIGHT]");
+        return 0;
+    }
+    if (strcmp(quota_text, "max") != 0) {
+        char* end;
+        quota = strtol(quota_text, &end, 10);
+        if (*end != '\0' || quota < 1 || quota > 1000000000L) {
+            snprintf(error, error_len, "quota must be max or 1-1000000000");
+            return 0;
+        }
+    }
+    if (period < 1 || period > 1000000000 || weight < 1 || weight > MAX_WEIGHT) {
+        snprintf(error, error_len, "period must be 1-1000000000 and weight 1-%d", MAX_WEIGHT);
+        return 0;
+    }
+
+    size_t length = strlen(path);
+    const char* slash = strrchr(path, '/');
+    if (path[0] != '/' || length >= MAX_GROUP_PATH || path[length - 1] == '/' || strstr(path, "//")) {
+        snprintf(error, error_len, "group path must look like /name/name, under %d characters", MAX_GROUP_PATH);
+        return 0;
+    }
+    if (find_group(groups, path) >= 0) {
+        snprintf(error, error_len, "group %s is defined twice", path);
+        return 0;
+    }
+    if (groups->count == MAX_GROUPS) {
+        snprintf(error, error_len, "at most %d groups", MAX_GROUPS);
+        return 0;
+    }
+
+    char parent_path[MAX_GROUP_PATH];
+    snprintf(parent_path, sizeof(parent_path), "%.*s", slash == path ? 1 : (int)(slash - path), path);
+    int parent = find_group(groups, parent_path);
+    if (parent < 0) {
+        snprintf(error, error_len, "parent group %s must be defined before %s", parent_path, path);
+        return 0;
+    }
+
+    CpuGroup* group = &groups->group[++groups->count];
+    strcpy(group->path, path);
+    group->parent = parent;
+    group->quota = (int)quota;
+    group->period = period;
+    group->weight = weight;
+    return 1;
+}
+
+// One group line per line of text, as the GUI's editor holds them
+int parse_groups(const char* text, GroupConfig* out, char* error, size_t error_len) {
+    GroupConfig groups;
+    int line_number = 0;
+    const char* c = text;
+
+    groups.count = 0;
+    while (*c) {
+        char line[TRACE_LINE_MAX], message[256], first[2];
+        size_t length = strcspn(c, "\n");
+        snprintf(line, sizeof(line), "%.*s", (int)(length < sizeof(line) ? length : sizeof(line) - 1), c);
+        c += length + (c[length] == '\n');
+        line_number++;
+
+        char* hash = strchr(line, '#');
+        if (hash) *hash = '\0';
+        if (sscanf(line, " %1s", first) != 1) continue;
+        if (!parse_group(line, &groups, message, sizeof(message))) {
+            snprintf(error, error_len, "Line %d: %s", line_number, message);
+            return 0;
+        }
+    }
+
+    *out = groups;
+    return 1;
+}
+
+// The groups as workload-file lines
+void format_groups(const GroupConfig* groups, char* out, size_t out_len) {
+    size_t used = 0;
+
+    out[0] = '\0';
+    for (int g = 1; g <= groups->count && used < out_len; g++) {
+        const CpuGroup* group = &groups->group[g];
+        char quota[16];
+        if (group->quota > 0) snprintf(quota, sizeof(quota), "%d", group->quota);
+        else snprintf(quota, sizeof(quota), "max");
+        used += snprintf(out + used, out_len - used, "group %s %s %d %d\n",
+            group->path, quota, group->period, group->weight);
+    }
+}
+
+void group_log_free(GroupLog* log) {
+    if (!log) return;
+    for (int g = 0; g <= MAX_GROUPS; g++) {
+        free(log->gantt[g]);
+    }
+    free(log->spans);
+    free(log);
+}
+
+void group_log_span(GroupLog* log, SimTime start, SimTime end, int group) {
+    if (log->span_count == log->span_capacity) {
+        log->span_capacity = log->span_capacity ? log->span_capacity * 2 : MAX_PROCESSES;
+        log->spans = realloc(log->spans, log->span_capacity * sizeof(ThrottleSpan));
+    }
+    log->spans[log->span_count++] = (ThrottleSpan){ start, end, group };
+}
+
+// visit_gantt_log callback: copies each slice to the lane of every group above its process
+void add_group_blocks(const GanttBlock* blocks, int count, void* data) {
+    GroupVisit* visit = data;
+    GroupLog* log = visit->log;
+
+    for (int k = 0; k < count; k++) {
+        const Process* p = &visit->sim->processes[blocks[k].process_index];
+        for (int g = process_group(visit->sim, p); g > 0; g = visit->sim->groups.group[g].parent) {
+            if (log->gantt_count[g] == log->gantt_capacity[g]) {
+                log->gantt_capacity[g] = log->gantt_capacity[g] ? log->gantt_capacity[g] * 2 : MAX_PROCESSES;
+                log->gantt[g] = realloc(log->gantt[g], log->gantt_capacity[g] * sizeof(GanttBlock));
+            }
+            log->gantt[g][log->gantt_count[g]++] = blocks[k];
+        }
+    }
+}
+
+// Builds the per-group Gantt lanes once the run is over
+void group_log_finish(GroupLog* log, const Simulation* sim) {
+    GroupVisit visit = { log, sim };
+    if (!sim->record_gantt) return;
+    visit_gantt_log(sim->spill, sim->gantt, sim->gantt_count, INT64_MIN, INT64_MAX, add_group_blocks, &visit);
+}
+
+// Per group: the quota, what its processes used, how often and how long it
+// was throttled, and its processes' waiting times against a run of the
+// same workload with every quota lifted
+void format_group_report(const Simulation* sim, SchedulingAlgorithm algo, char* out, size_t out_len) {
+    const GroupConfig* groups = &sim->groups;
+    const GroupLog* log = sim->group_log;
+    int n = sim->process_count;
+    size_t used;
+
+    if (!log) {
+        snprintf(out, out_len, "BANDWIDTH GROUPS\n================\n\nNo process belongs to a group.\n");
+        return;
+    }
+
+    // The same run with the groups but without their quotas
+    Process* free_procs = malloc((n ? n : 1) * sizeof(Process));
+    Process* members = malloc((n ? n : 1) * sizeof(Process));
+    Process* free_members = malloc((n ? n : 1) * sizeof(Process));
+    Simulation unlimited;
+    memcpy(free_procs, sim->processes, n * sizeof(Process));
+    init_simulation(&unlimited, free_procs, n, sim->time_quantum);
+    unlimited.record_gantt = 0;
+    unlimited.cost = sim->cost;
+    unlimited.io = sim->io;
+    unlimited.aging_interval = sim->aging_interval;
+    unlimited.seed = sim->seed;
+    unlimited.groups = *groups;
+    for (int g = 1; g <= groups->count; g++) {
+        unlimited.groups.group[g].quota = 0;
+    }
+    run_io_scheduler(&unlimited, algo);
+
+    used = snprintf(out, out_len,
+        "BANDWIDTH GROUPS\n"
+        "================\n\n"
+        "Under %s:\n"
+        "%-24s %13s %6s %6s %10s %9s %10s\n",
+        algorithm_names[algo - 1], "Group", "Quota/Period", "Weight", "Procs", "CPU Used", "Throttles", "Throttled");
+
+    for (int g = 1; g <= groups->count && used < out_len; g++) {
+        const CpuGroup* group = &groups->group[g];
+        char limit[32];
+        int procs = 0;
+        for (int i = 0; i < n; i++) {
+            if (group_within(groups, process_group(sim, &sim->processes[i]), g)) procs++;
+        }
+        if (group->quota > 0) snprintf(limit, sizeof(limit), "%d/%d", group->quota, group->period);
+        else snprintf(limit, sizeof(limit), "max/%d", group->period);
+        used += snprintf(out + used, out_len - used, "%-24s %13s %6d %6d %10ld %9ld %10ld\n",
+            group->path, limit, group->weight, procs, log->used[g], log->throttles[g], log->throttled_time[g]);
+    }
+
+    if (used < out_len) {
+        used += snprintf(out + used, out_len - used,
+            "\nWaiting time of each group's processes, with and without the quotas:\n"
+            "%-24s %10s %8s %10s %8s %10s\n",
+            "Group", "Mean WT", "p99", "Free WT", "Free p99", "Throttled");
+    }
+    for (int g = 0; g <= groups->count && used < out_len; g++) {
+        TailLatency limited, free_tail;
+        double throttled = 0;
+        int count = 0;
+
+        for (int i = 0; i < n; i++) {
+            if (!group_within(groups, process_group(sim, &sim->processes[i]), g)) continue;
+            members[count] = sim->processes[i];
+            free_members[count] = free_procs[i];
+            throttled += sim->processes[i].throttled_time;
+            count++;
+        }
+        if (count == 0) continue;
+
+        measure_waiting_tail(members, count, &limited);
+        measure_waiting_tail(free_members, count, &free_tail);
+        used += snprintf(out + used, out_len - used, "%-24s %10.2f %8lld %10.2f %8lld %10.2f\n",
+            g == 0 ? "/ (every process)" : groups->group[g].path, limited.mean, (long long)limited.p99,
+            free_tail.mean, (long long)free_tail.p99, throttled / count);
+    }
+
+    if (used < out_len) {
+        snprintf(out + used, out_len - used,
+            "\nCPU Used excludes switch overhead. Throttled is the mean part of the\n"
+            "waiting time a process was ready but held back by a throttled group.\n");
+    }
+
+    free_simulation(&unlimited);
+    free(free_procs);
+    free(members);
+    free(free_members);
+}
+
+// --group-report: runs --algorithm on a workload file that defines groups
+int run_group_report(const ReplicationConfig* config, const char* workload_path) {
+    Process* procs;
+    int count;
+    char error[1200];
+    size_t out_len = 16384;
+    char* out;
+    Simulation sim;
+
+    init_simulation(&sim, NULL, 0, config->time_quantum);
+    if (load_workload(workload_path, &procs, &count, &sim.groups, NULL, error, sizeof(error)) != 0) {
+        fprintf(stderr, "%s\n", error);
+        return 1;
+    }
+
+    sim.processes = procs;
+    sim.process_count = count;
+    sim.record_gantt = 0;
+    sim.cost = config->cost;
+    sim.io = config->io;
+    sim.aging_interval = config->aging_interval;
+    sim.seed = config->seed;
+    run_fast_scheduler(&sim, config->algo);
+
+    out = malloc(out_len);
+    format_group_report(&sim, config->algo, out, out_len);
+    fputs(out, stdout);
+
+    free(out);
+    free_simulation(&sim);
+    free(procs);
+    return 0;
+}
+
+// Shared resources and priority inversion
+//
+// A process can take named resources for part of its CPU demand: it takes
+// resource r once it has had `acquire` units of CPU time and lets it go at
+// `release`. Under Preemptive Priority a process whose next step is to take a
+// resource another process holds is blocked and does not run; every other
+// policy ignores the spans. A process that takes several resources at once
+// waits until all of them are free. Resources taken while another is held
+// must come later in the order the workload first names them, which rules out
+// deadlock.
+//
+// While a high-priority process is blocked, a lower-priority one runs: that is
+// priority inversion. The holder itself running is bounded by how long it
+// keeps the resource; a process outside the chain of holders running is the
+// unbounded kind the protocols are there to stop. Priority inheritance ranks a
+// holder as the best of the processes blocked behind it, transitively;
+// priority ceiling ranks it as the best priority of any process that uses one
+// of the resources it holds. Runs with locks go through the tick-by-tick
+// reference loop.
+
+int find_resource(const ResourceTable* resources, const char* name) {
+    for (int r = 0; r < resources->count; r++) {
+        if (strcmp(resources->name[r], name) == 0) return r;
+    }
+    return -1;
+}
+
+// "NAME:FROM-TO,..." after the bursts, between brackets. Names new to the
+// table are added to it. Returns 0 and describes the problem on error.
+int parse_lock_spans(const char* text, Process* p, ResourceTable* resources, char* error, size_t error_len) {
+    const char* c = text;
+    int count = 0;
+    LockSpan spans[MAX_LOCKS];
+
+    while (*c) {
+        char name[MAX_RESOURCE_NAME];
+        int length = 0;
+        while (isalnum((unsigned char)c[length]) || c[length] == '_') length++;
+        if (length == 0 || length >= MAX_RESOURCE_NAME || c[length] != ':') {
+            snprintf(error, error_len, "locks look like [db:2-5,log:3-4], names up to %d letters, digits or _",
+                MAX_RESOURCE_NAME - 1);
+            return 0;
+        }
+        snprintf(name, sizeof(name), "%.*s", length, c);
+        c += length + 1;
+
+        char* end;
+        SimTime from = parse_time(c, &end);
+        SimTime to = end != c && *end == '-' ? parse_time(end + 1, &end) : -1;
+        if (from < 0 || to <= from || to > p->burst_time) {
+            snprintf(error, error_len, "%s must be held from FROM to TO units of CPU time, 0 <= FROM < TO <= %lld",
+                name, (long long)p->burst_time);
+            return 0;
+        }
+        c = end;
+        if (*c == ',') c++;
+        else if (*c != '\0') {
+            snprintf(error, error_len, "lock spans are separated by commas");
+            return 0;
+        }
+
+        int r = find_resource(resources, name);
+        if (r < 0) {
+            if (resources->count == MAX_RESOURCES) {
+                snprintf(error, error_len, "at most %d resources", MAX_RESOURCES);
+                return 0;
+            }
+            r = resources->count++;
+            strcpy(resources->name[r], name);
+        }
+        if (count == MAX_LOCKS) {
+            snprintf(error, error_len, "at most %d locks per process", MAX_LOCKS);
+            return 0;
+        }
+        spans[count++] = (LockSpan){ r, from, to };
+    }
+
+    for (int a = 0; a < count; a++) {
+        for (int b = 0; b < count; b++) {
+            const LockSpan* outer = &spans[a];
+            const LockSpan* inner = &spans[b];
+            if (a == b || inner->acquire < outer->acquire || inner->acquire >= outer->release) continue;
+            if (inner->resource == outer->resource) {
+                snprintf(error, error_len, "%s is held twice at once", resources->name[inner->resource]);
+                return 0;
+            }
+            if (inner->acquire > outer->acquire && inner->resource < outer->resource) {
+                snprintf(error, error_len, "%s is taken while %s is held; nested resources must be taken in "
+                    "the order the workload first names them", resources->name[inner->resource],
+                    resources->name[outer->resource]);
+                return 0;
+            }
+        }
+    }
+    if (count > 0 && p->io_count > 0) {
+        snprintf(error, error_len, "a process with I/O bursts cannot take resources");
+        return 0;
+    }
+
+    p->lock_count = count;
+    memcpy(p->locks, spans, count * sizeof(LockSpan));
+    return 1;
+}
+
+// Bursts as parse_burst_sequence takes them, then optionally lock spans in
+// brackets: "8[db:2-5]". Without a table, lock spans are an error.
+int parse_process_bursts(const char* text, Process* p, ResourceTable* resources, char* error, size_t error_len) {
+    char bursts[TRACE_LINE_MAX];
+    const char* open = strchr(text, '[');
+    size_t length = open ? (size_t)(open - text) : strlen(text);
+
+    snprintf(bursts, sizeof(bursts), "%.*s", (int)(length < sizeof(bursts) ? length : sizeof(bursts) - 1), text);
+    if (!parse_burst_sequence(bursts, p)) {
+        snprintf(error, error_len, "bursts alternate CPU and I/O lengths, starting and ending with CPU");
+        return 0;
+    }
+    p->lock_count = 0;
+    if (!open) return 1;
+
+    char spans[TRACE_LINE_MAX];
+    size_t span_length = strlen(open + 1);
+    if (!resources) {
+        snprintf(error, error_len, "resource locks are not supported here");
+        return 0;
+    }
+    if (span_length == 0 || open[span_length] != ']') {
+        snprintf(error, error_len, "lock spans end with ]");
+        return 0;
+    }
+    snprintf(spans, sizeof(spans), "%.*s", (int)(span_length - 1), open + 1);
+    return parse_lock_spans(spans, p, resources, error, error_len);
+}
+
+// "[db:2-5,log:3-4]", or nothing for a process without locks
+void format_lock_spans(const Process* p, const ResourceTable* resources, char* out, size_t out_len) {
+    size_t used = 0;
+
+    out[0] = '\0';
+    for (int k = 0; k < p->lock_count && used < out_len; k++) {
+        const LockSpan* span = &p->locks[k];
+        used += snprintf(out + used, out_len - used, "%s%s:%lld-%lld%s", k == 0 ? "[" : ",",
+            span->resource < resources->count ? resources->name[span->resource] : "?",
+            (long long)span->acquire, (long long)span->release, k == p->lock_count - 1 ? "]" : "");
+    }
+}
+
+int workload_has_locks(const Process* procs, int count) {
+    for (int i = 0; i < count; i++) {
+        if (procs[i].lock_count > 0) return 1;
+    }
+    return 0;
+}
+
+// Whether a run of algo honours the workload's locks
+int locks_apply(const Simulation* sim, SchedulingAlgorithm algo) {
+    return algo == PREEMPTIVE_PRIORITY && workload_has_locks(sim->processes, sim->process_count) &&
+        !workload_has_io(sim->processes, sim->process_count) && !workload_has_groups(sim);
+}
+
+void lock_log_free(LockLog* log) {
+    if (!log) return;
+    for (int r = 0; r < MAX_RESOURCES; r++) {
+        free(log->gantt[r]);
+    }
+    free(log->waits);
+    free(log);
+}
+
+void lock_state_init(LockState* locks, Simulation* sim) {
+    int n = sim->process_count;
+
+    locks->sim = sim;
+    locks->blocked_on = malloc((n ? n : 1) * sizeof(int));
+    locks->rank = malloc((n ? n : 1) * sizeof(SimTime));
+    locks->wait = malloc((n ? n : 1) * sizeof(long));
+    for (int i = 0; i < n; i++) {
+        locks->blocked_on[i] = -1;
+        locks->wait[i] = -1;
+    }
+    for (int r = 0; r < MAX_RESOURCES; r++) {
+        locks->holder[r] = -1;
+        locks->ceiling[r] = INT_MAX;
+    }
+    for (int i = 0; i < n; i++) {
+        for (int k = 0; k < sim->processes[i].lock_count; k++) {
+            int r = sim->processes[i].locks[k].resource;
+            if (sim->processes[i].priority < locks->ceiling[r]) locks->ceiling[r] = sim->processes[i].priority;
+        }
+    }
+
+    lock_log_free(sim->lock_log);
+    sim->lock_log = calloc(1, sizeof(LockLog));
+    sim->lock_log->resource_count = sim->resources.count;
+}
+
+void lock_state_free(LockState* locks) {
+    free(locks->blocked_on);
+    free(locks->rank);
+    free(locks->wait);
+}
+
+// Finds which of the processes in the system are blocked and ranks the
+// others under the protocol. `own` holds each process's rank by the policy
+// alone; `active` marks the processes that have arrived and not finished.
+void lock_update(LockState* locks, const SimTime* own, const int* active) {
+    Simulation* sim = locks->sim;
+    Process* procs = sim->processes;
+    int n = sim->process_count;
+
+    for (int i = 0; i < n; i++) {
+        locks->blocked_on[i] = -1;
+        if (!active[i]) continue;
+        locks->rank[i] = own[i];
+
+        SimTime used = procs[i].burst_time - procs[i].remaining_time;
+        for (int k = 0; k < procs[i].lock_count; k++) {
+            const LockSpan* span = &procs[i].locks[k];
+            int holder = locks->holder[span->resource];
+            if (span->acquire == used && holder >= 0 && holder != i) {
+                locks->blocked_on[i] = span->resource;
+                break;
+            }
+        }
+        if (locks->blocked_on[i] < 0) locks->wait[i] = -1;
+    }
+
+    if (sim->lock_protocol == LOCK_CEILING) {
+        // Priority levels are aging_interval rank steps apart when aging is on
+        int step = sim->aging_interval > 0 ? sim->aging_interval : 1;
+        for (int r = 0; r < sim->resources.count; r++) {
+            int h = locks->holder[r];
+            if (h < 0 || locks->ceiling[r] >= procs[h].priority) continue;
+            SimTime ceiling_rank = own[h] - (procs[h].priority - locks->ceiling[r]) * step;
+            if (ceiling_rank < locks->rank[h]) locks->rank[h] = ceiling_rank;
+        }
+    }
+    else if (sim->lock_protocol == LOCK_INHERIT) {
+        // Chains are at most one link per resource long
+        int changed = 1;
+        while (changed) {
+            changed = 0;
+            for (int i = 0; i < n; i++) {
+                if (locks->blocked_on[i] < 0) continue;
+                int h = locks->holder[locks->blocked_on[i]];
+                if (locks->rank[i] < locks->rank[h]) {
+                    locks->rank[h] = locks->rank[i];
+                    changed = 1;
+                }
+            }
+        }
+    }
+}
+
+// processes[index] is about to run its next unit at `time`: it takes the
+// resources it asks for there, which lock_update found free
+void lock_acquire(LockState* locks, int index, SimTime time) {
+    const Process* p = &locks->sim->processes[index];
+    SimTime used = p->burst_time - p->remaining_time;
+
+    for (int k = 0; k < p->lock_count; k++) {
+        const LockSpan* span = &p->locks[k];
+        if (span->acquire != used || locks->holder[span->resource] == index) continue;
+        locks->holder[span->resource] = index;
+        locks->held_since[span->resource] = time;
+        locks->sim->lock_log->holds[span->resource]++;
+    }
+}
+
+// processes[index] has run up to `time`: it lets go of what it is done with
+void lock_release(LockState* locks, int index, SimTime time) {
+    Simulation* sim = locks->sim;
+    const Process* p = &sim->processes[index];
+    LockLog* log = sim->lock_log;
+    SimTime used = p->burst_time - p->remaining_time;
+
+    for (int k = 0; k < p->lock_count; k++) {
+        int r = p->locks[k].resource;
+        if (p->locks[k].release != used || locks->holder[r] != index) continue;
+        locks->holder[r] = -1;
+
+        if (sim->record_gantt) {
+            if (log->gantt_count[r] == log->gantt_capacity[r]) {
+                log->gantt_capacity[r] = log->gantt_capacity[r] ? log->gantt_capacity[r] * 2 : MAX_PROCESSES;
+                log->gantt[r] = realloc(log->gantt[r], log->gantt_capacity[r] * sizeof(GanttBlock));
+            }
+            GanttBlock* block = &log->gantt[r][log->gantt_count[r]++];
+            strcpy(block->process_name, p->name);
+            block->start_time = locks->held_since[r];
+            block->end_time = time;
+            block->process_index = index;
+            block->overhead = 0;
+            block->color = p->color;
+        }
+    }
+}
+
+// processes[runner] had the CPU over [from, to): every blocked process waited
+// that long, and the time counts as inversion for those of better priority
+void lock_account(LockState* locks, int runner, SimTime from, SimTime to) {
+    Simulation* sim = locks->sim;
+    Process* procs = sim->processes;
+    LockLog* log = sim->lock_log;
+
+    for (int i = 0; i < sim->process_count; i++) {
+        int r = locks->blocked_on[i];
+        if (r < 0) continue;
+
+        if (locks->wait[i] < 0) {
+            if (log->wait_count == log->wait_capacity) {
+                log->wait_capacity = log->wait_capacity ? log->wait_capacity * 2 : MAX_PROCESSES;
+                log->waits = realloc(log->waits, log->wait_capacity * sizeof(LockWait));
+            }
+            locks->wait[i] = log->wait_count++;
+            memset(&log->waits[locks->wait[i]], 0, sizeof(LockWait));
+            log->waits[locks->wait[i]].process = i;
+            log->waits[locks->wait[i]].resource = r;
+            log->waits[locks->wait[i]].start = from;
+            log->contended[r]++;
+        }
+        LockWait* wait = &log->waits[locks->wait[i]];
+        wait->end = to;
+        procs[i].lock_wait_time += to - from;
+        log->wait_time[r] += to - from;
+
+        // Follow the holders until one that is not blocked itself
+        int depth = 0, in_chain = 0;
+        int holders[MAX_RESOURCES], resources[MAX_RESOURCES];
+        for (int w = i; locks->blocked_on[w] >= 0 && depth < MAX_RESOURCES; depth++) {
+            resources[depth] = locks->blocked_on[w];
+            holders[depth] = locks->holder[resources[depth]];
+            w = holders[depth];
+            if (w == runner) in_chain = 1;
+        }
+        if (depth > wait->depth) {
+            wait->depth = depth;
+            memcpy(wait->chain_holder, holders, depth * sizeof(int));
+            memcpy(wait->chain_resource, resources, depth * sizeof(int));
+        }
+
+        if (procs[runner].priority > procs[i].priority) {
+            wait->inverted += to - from;
+            if (!in_chain && locks->rank[runner] > locks->rank[i]) wait->unbounded += to - from;
+        }
+    }
+}
+
+void lock_waits_describe(const Simulation* sim, const LockWait* wait, char* out, size_t out_len) {
+    const Process* procs = sim->processes;
+    size_t used = snprintf(out, out_len, "%s at %lld-%lld", procs[wait->process].name,
+        (long long)wait->start, (long long)wait->end);
+
+    for (int d = 0; d < wait->depth && used < out_len; d++) {
+        used += snprintf(out + used, out_len - used, "%s %s held by %s", d == 0 ? ": waits for" : ", which waits for",
+            sim->resources.name[wait->chain_resource[d]], procs[wait->chain_holder[d]].name);
+    }
+}
+
+int compare_lock_waits(const void* a, const void* b) {
+    const LockWait* x = *(const LockWait* const*)a;
+    const LockWait* y = *(const LockWait* const*)b;
+    if (x->depth != y->depth) return y->depth - x->depth;
+    if (x->end - x->start != y->end - y->start) return (y->end - y->start) > (x->end - x->start) ? 1 : -1;
+    return (x->start > y->start) - (x->start < y->start);
+}
+
+// Totals of a run's lock log
+void sum_lock_waits(const LockLog* log, long* wait, long* inverted, long* unbounded, int* depth) {
+    *wait = *inverted = *unbounded = 0;
+    *depth = 0;
+    for (long k = 0; k < log->wait_count; k++) {
+        *wait += log->waits[k].end - log->waits[k].start;
+        *inverted += log->waits[k].inverted;
+        *unbounded += log->waits[k].unbounded;
+        if (log->waits[k].depth > *depth) *depth = log->waits[k].depth;
+    }
+}
+
+// Per resource and per process: how long processes were blocked, how much of
+// that was inversion, the longest blocking chains, and the same workload
+// under each protocol
+void format_lock_report(const Simulation* sim, char* out, size_t out_len) {
+    const LockLog* log = sim->lock_log;
+    const Process* procs = sim->processes;
+    int n = sim->process_count;
+    size_t used;
+
+    if (!log) {
+        snprintf(out, out_len, "PRIORITY INVERSION\n==================\n\n"
+            "Locks are only honoured by Preemptive Priority on a workload without I/O or groups.\n");
+        return;
+    }
+
+    used = snprintf(out, out_len,
+        "PRIORITY INVERSION\n"
+        "==================\n\n"
+        "Preemptive Priority, %s:\n"
+        "%-16s %8s %6s %6s %10s\n",
+        lock_protocol_names[sim->lock_protocol], "Resource", "Ceiling", "Holds", "Waits", "Wait Time");
+    for (int r = 0; r < log->resource_count && used < out_len; r++) {
+        int ceiling = INT_MAX;
+        for (int i = 0; i < n; i++) {
+            for (int k = 0; k < procs[i].lock_count; k++) {
+                if (procs[i].locks[k].resource == r && procs[i].priority < ceiling) ceiling = procs[i].priority;
+            }
+        }
+        if (ceiling == INT_MAX) continue;
+        used += snprintf(out + used, out_len - used, "%-16s %8d %6ld %6ld %10ld\n",
+            sim->resources.name[r], ceiling, log->holds[r], log->contended[r], log->wait_time[r]);
+    }
+
+    if (used < out_len) {
+        used += snprintf(out + used, out_len - used, "\n%-12s %8s %10s %10s %10s %6s\n",
+            "Process", "Priority", "Lock Wait", "Inversion", "Unbounded", "Chain");
+    }
+    for (int i = 0; i < n && used < out_len; i++) {
+        long inverted = 0, unbounded = 0;
+        int depth = 0;
+        for (long k = 0; k < log->wait_count; k++) {
+            if (log->waits[k].process != i) continue;
+            inverted += log->waits[k].inverted;
+            unbounded += log->waits[k].unbounded;
+            if (log->waits[k].depth > depth) depth = log->waits[k].depth;
+        }
+        if (procs[i].lock_count == 0 && procs[i].lock_wait_time == 0) continue;
+        used += snprintf(out + used, out_len - used, "%-12s %8d %10lld %10ld %10ld %6d\n",
+            procs[i].name, procs[i].priority, (long long)procs[i].lock_wait_time, inverted, unbounded, depth);
+    }
+
+    // The longest chains first, then the longest waits
+    if (log->wait_count > 0 && used < out_len) {
+        const LockWait** order = malloc(log->wait_count * sizeof(LockWait*));
+        char line[512];
+        for (long k = 0; k < log->wait_count; k++) {
+            order[k] = &log->waits[k];
+        }
+        qsort(order, log->wait_count, sizeof(LockWait*), compare_lock_waits);
+        used += snprintf(out + used, out_len - used, "\nLongest blocking chains:\n");
+        for (long k = 0; k < log->wait_count && k < 5 && used < out_len; k++) {
+            lock_waits_describe(sim, order[k], line, sizeof(line));
+            used += snprintf(out + used, out_len - used, "  %s\n", line);
+        }
+        free(order);
+    }
+
+    // The same workload under every protocol
+    if (used < out_len) {
+        used += snprintf(out + used, out_len - used, "\n%-22s %10s %10s %10s %6s %8s %6s\n",
+            "Protocol", "Lock Wait", "Inversion", "Unbounded", "Chain", "Mean WT", "p99");
+    }
+    Process* copy = malloc((n ? n : 1) * sizeof(Process));
+    for (int protocol = LOCK_NONE; protocol < LOCK_PROTOCOLS && used < out_len; protocol++) {
+        Simulation run;
+        TailLatency tail;
+        long wait, inverted, unbounded;
+        int depth;
+
+        memcpy(copy, procs, n * sizeof(Process));
+        init_simulation(&run, copy, n, sim->time_quantum);
+        run.record_gantt = 0;
+        run.cost = sim->cost;
+        run.aging_interval = sim->aging_interval;
+        run.resources = sim->resources;
+        run.lock_protocol = (LockProtocol)protocol;
+        run_fast_scheduler(&run, PREEMPTIVE_PRIORITY);
+
+        sum_lock_waits(run.lock_log, &wait, &inverted, &unbounded, &depth);
+        measure_waiting_tail(copy, n, &tail);
+        used += snprintf(out + used, out_len - used, "%-22s %10ld %10ld %10ld %6d %8.2f %6lld\n",
+            lock_protocol_names[protocol], wait, inverted, unbounded, depth, tail.mean, (long long)tail.p99);
+        free_simulation(&run);
+    }
+    free(copy);
+
+    if (used < out_len) {
+        snprintf(out + used, out_len - used,
+            "\nInversion is time a process of lower priority ran while one was blocked.\n"
+            "Unbounded is the part run by a process outside the chain of holders that\n"
+            "did not outrank the blocked one; the protocols exist to remove it.\n");
+    }
+}
+
+// --lock-report: runs Preemptive Priority on a workload file with locks
+int run_lock_report(const ReplicationConfig* config, const char* workload_path) {
+    Process* procs;
+    int count;
+    char error[1200];
+    size_t out_len = 16384;
+    char* out;
+    Simulation sim;
+
+    init_simulation(&sim, NULL, 0, config->time_quantum);
+    if (load_workload(workload_path, &procs, &count, NULL, &sim.resources, error, sizeof(error)) != 0) {
+        fprintf(stderr, "%s\n", error);
+        return 1;
+    }
+
+    sim.processes = procs;
+    sim.process_count = count;
+    sim.record_gantt = 0;
+    sim.cost = config->cost;
+    sim.aging_interval = config->aging_interval;
+    sim.lock_protocol = config->lock_protocol;
+    run_fast_scheduler(&sim, PREEMPTIVE_PRIORITY);
+
+    out = malloc(out_len);
+    format_lock_report(&sim, out, out_len);
+    fputs(out, stdout);
+
+    free(out);
+    free_simulation(&sim);
+    free(procs);
+    return 0;
+}
+
+// Starvation aging
+//
+// Under the priority policies a steady supply of high-priority work can keep
+// a low-priority process waiting forever. Aging bounds that: a process gains
+// a level for every aging_interval units it waits (see aged_priority). The
+// price is extra preemptions, and with a switch cost, throughput. The sweep
+// below measures both sides of that trade on one workload.
+
+// Mean and nearest-rank percentiles of the waiting times
+void measure_waiting_tail(const Process* procs, int count, TailLatency* out) {
+    SimTime* waits = malloc((count ? count : 1) * sizeof(SimTime));
+    double total = 0;
+
+    for (int i = 0; i < count; i++) {
+        waits[i] = procs[i].waiting_time;
+        total += waits[i];
+    }
+    qsort(waits, count, sizeof(SimTime), compare_int64);
+
+    memset(out, 0, sizeof(*out));
+    if (count > 0) {
+        out->mean = total / count;
+        out->p50 = waits[(int)ceil(0.5 * count) - 1];
+        out->p99 = waits[(int)ceil(0.99 * count) - 1];
+        out->p999 = waits[(int)ceil(0.999 * count) - 1];
+        out->max = waits[count - 1];
+    }
+    free(waits);
+}
+
+void format_tail_latency(const Simulation* sim, char* out, size_t out_len) {
+    TailLatency tail;
+    measure_waiting_tail(sim->processes, sim->process_count, &tail);
+
+    size_t used = snprintf(out, out_len,
+        "Waiting time: mean %.2f, p50 %lld, p99 %lld, p99.9 %lld, max %lld\n",
+        tail.mean, (long long)tail.p50, (long long)tail.p99, (long long)tail.p999, (long long)tail.max);
+    if (used < out_len && sim->aging_interval > 0) {
+        snprintf(out + used, out_len - used, "Aging: one priority level per %d time units waited\n",
+            sim->aging_interval);
+    }
+}
+
+// Runs both priority policies on a copy of procs at a range of aging
+// intervals, from none to one level per unit waited
+void format_aging_sweep(const Process* procs, int count, const SwitchCost* cost, char* out, size_t out_len) {
+    static const int intervals[] = { 0, 1000, 200, 100, 50, 20, 10, 5, 2, 1 };
+    const SchedulingAlgorithm algos[2] = { PRIORITY, PREEMPTIVE_PRIORITY };
+    const char* names[2] = { "Priority", "Preemptive Priority" };
+    Process* copy = malloc((count ? count : 1) * sizeof(Process));
+    Simulation sim;
+    size_t used;
+
+    memcpy(copy, procs, count * sizeof(Process));
+    init_simulation(&sim, copy, count, 1);
+    sim.cost = *cost;
+    sim.record_gantt = 0;
+
+    used = snprintf(out, out_len,
+        "STARVATION AGING\n"
+        "================\n\n"
+        "Processes: %d\n"
+        "Switch Cost: dispatch %d, cache penalty %d over %d units\n"
+        "Aging is the waiting time that raises a process one priority level.\n",
+        count, cost->dispatch, cost->cache_penalty, cost->cache_decay);
+
+    for (int a = 0; a < 2 && used < out_len; a++) {
+        used += snprintf(out + used, out_len - used, "\n%s\n%-8s %10s %8s %8s %8s %8s %11s %10s\n",
+            names[a], "Aging", "Mean WT", "p50", "p99", "p99.9", "Max", "Throughput", "Switches");
+
+        for (size_t k = 0; k < sizeof(intervals) / sizeof(intervals[0]) && used < out_len; k++) {
+            TailLatency tail;
+            SwitchSummary summary;
+            char aging[16];
+
+            sim.aging_interval = intervals[k];
+            run_fast_scheduler(&sim, algos[a]);
+            measure_waiting_tail(copy, count, &tail);
+            summarize_switching(&sim, &summary);
+
+            if (intervals[k] > 0) snprintf(aging, sizeof(aging), "%d", intervals[k]);
+            else snprintf(aging, sizeof(aging), "off");
+            used += snprintf(out + used, out_len - used, "%-8s %10.2f %8lld %8lld %8lld %8lld %11.3f %10ld\n",
+                aging, tail.mean, (long long)tail.p50, (long long)tail.p99, (long long)tail.p999, (long long)tail.max,
+                summary.elapsed ? 100.0 * count / summary.elapsed : 0.0, summary.switches);
+        }
+    }
+
+    free_simulation(&sim);
+    free(copy);
+}
+
+// --aging-sweep: the sweep on a workload file or on one generated workload
+int run_aging_sweep(const ReplicationConfig* config, const char* workload_path) {
+    Process* procs;
+    int count;
+    char error[1200];
+    size_t out_len = 16384;
+    char* out;
+
+    if (workload_path) {
+        if (load_workload(workload_path, &procs, &count, NULL, NULL, error, sizeof(error)) != 0) {
+            fprintf(stderr, "%s\n", error);
+            return 1;
+        }
+    }
+    else {
+        RngState rng;
+        count = config->jobs;
+        procs = malloc(count * sizeof(Process));
+        rng_seed(&rng, config->seed, 0);
+        generate_workload(procs, count, &rng, config);
+    }
+
+    out = malloc(out_len);
+    format_aging_sweep(procs, count, &config->cost, out, out_len);
+    fputs(out, stdout);
+
+    free(out);
+    free(procs);
+    return 0;
+}
+
+// Incremental re-simulation
+//
+// A logged run keeps up to CHECKPOINT_LIMIT snapshots of the engine state,
+// taken every `interval` dispatches; when the log fills up every other
+// snapshot is dropped and the interval doubles. Adding or deleting a process
+// that arrives at time a cannot change anything the scheduler did before a,
+// so the next run of the same algorithm restarts from the last snapshot taken
+// before a. The run's processes are matched to the edited table by id; as long
+// as the survivors keep their order and workload, every tie-break between
+// them is intact.
+
+void checkpoint_free(Checkpoint* cp) {
+    free(cp->ready);
+    free(cp->progress);
+    cp->ready = NULL;
+    cp->progress = NULL;
+}
+
+void checkpoint_log_reset(CheckpointLog* log) {
+    for (int i = 0; i < log->count; i++) {
+        checkpoint_free(&log->items[i]);
+    }
+    free(log->run_ids);
+    free(log->input);
+    free(log->gantt);
+    memset(log, 0, sizeof(*log));
+}
+
+void checkpoint_log_start(CheckpointLog* log, const Simulation* sim, SchedulingAlgorithm algo) {
+    checkpoint_log_reset(log);
+    log->valid = 1;
+    log->algo = algo;
+    log->time_quantum = sim->time_quantum;
+    log->cost = sim->cost;
+    log->aging_interval = sim->aging_interval;
+    log->process_count = sim->process_count;
+    log->input = malloc(sim->process_count * sizeof(WorkloadEntry) + 1);
+    snapshot_workload(sim->processes, sim->process_count, log->input);
+    log->run_ids = malloc(sim->process_count * sizeof(int) + 1);
+    for (int i = 0; i < sim->process_count; i++) {
+        log->run_ids[i] = sim->processes[i].process_id;
+    }
+    log->interval = 1;
+    log->next_checkpoint = 0;
+}
+
+void record_checkpoint(CheckpointLog* log, const Simulation* sim, const EngineState* state) {
+    if (log->count == CHECKPOINT_LIMIT) {
+        // Thin out: keep every other snapshot and space future ones twice as far apart
+        int kept = 0;
+        for (int i = 0; i < log->count; i++) {
+            if (i % 2 == 0) log->items[kept++] = log->items[i];
+            else checkpoint_free(&log->items[i]);
+        }
+        log->count = kept;
+        log->interval *= 2;
+    }
+
+    Checkpoint* cp = &log->items[log->count++];
+    cp->time = sim->current_time;
+    cp->completed = state->completed;
+    cp->dispatches = state->dispatches;
+    cp->admitted = state->next;
+    cp->gantt_count = sim->gantt_count;
+    cp->last_gantt_end = sim->gantt_count > 0 ? sim->gantt[sim->gantt_count - 1].end_time : 0;
+    cp->last_process = sim->last_process;
+    cp->switches = sim->switches;
+    cp->overhead_time = sim->overhead_time;
+
+    if (log->algo == ROUND_ROBIN) {
+        cp->ready_count = (state->rear - state->front + state->capacity) % state->capacity;
+        cp->ready = malloc(cp->ready_count * sizeof(SchedKey) + 1);
+        for (int k = 0; k < cp->ready_count; k++) {
+            cp->ready[k] = state->queue[(state->front + k) % state->capacity];
+        }
+    }
+    else {
+        cp->ready_count = state->heap_size;
+        cp->ready = malloc(cp->ready_count * sizeof(SchedKey) + 1);
+        memcpy(cp->ready, state->heap, cp->ready_count * sizeof(SchedKey));
+    }
+
+    // Processes that have not arrived yet are still in their reset state
+    cp->progress = malloc(cp->admitted * sizeof(ProcessProgress) + 1);
+    for (int k = 0; k < cp->admitted; k++) {
+        const Process* p = &sim->processes[state->order[k]];
+        cp->progress[k].index = state->order[k];
+        cp->progress[k].remaining_time = p->remaining_time;
+        cp->progress[k].start_time = p->start_time;
+        cp->progress[k].completion_time = p->completion_time;
+        cp->progress[k].last_run_end = p->last_run_end;
+    }
+
+    log->next_checkpoint = state->dispatches + log->interval;
+}
+
+void checkpoint_log_finish(CheckpointLog* log, const Simulation* sim, const EngineState* state) {
+    log->total_dispatches = state->dispatches;
+    log->gantt_count = sim->gantt_count;
+    log->gantt = realloc(log->gantt, sim->gantt_count * sizeof(GanttBlock) + 1);
+    if (sim->gantt_count > 0) memcpy(log->gantt, sim->gantt, sim->gantt_count * sizeof(GanttBlock));
+}
+
+// Finds the run's processes in the current table by id, filling index_map
+// (run index -> row, or -1 for a deleted process). Returns the earliest
+// arrival added or deleted since the run, INT64_MAX for none, or -1 when a
+// surviving process was edited or reordered.
+SimTime match_run_processes(const CheckpointLog* log, const Simulation* sim, int* index_map) {
+    ProcessIndex current = { 0 };
+    unsigned char* matched = calloc(sim->process_count + 1, 1);
+    SimTime affected = INT64_MAX;
+    int last_row = -1;
+
+    process_index_build(&current, sim->processes, sim->process_count);
+    for (int i = 0; i < log->process_count && affected >= 0; i++) {
+        int row = process_index_find_id(&current, sim->processes, log->run_ids[i]);
+        index_map[i] = row;
+        if (row < 0) {
+            if (log->input[i].arrival_time < affected) affected = log->input[i].arrival_time;
+            continue;
+        }
+
+        WorkloadEntry entry;
+        snapshot_workload(&sim->processes[row], 1, &entry);
+        if (row < last_row || memcmp(&entry, &log->input[i], sizeof(entry)) != 0) affected = -1;
+        matched[row] = 1;
+        last_row = row;
+    }
+    for (int row = 0; row < sim->process_count && affected >= 0; row++) {
+        if (!matched[row] && sim->processes[row].arrival_time < affected) affected = sim->processes[row].arrival_time;
+    }
+
+    free(matched);
+    process_index_free(&current);
+    return affected;
+}
+
+// Rewrites a snapshot's table indices through index_map, run index -> current
+// table index or -1 for a deleted process
+void remap_checkpoint(Checkpoint* cp, const int* index_map, SchedulingAlgorithm algo) {
+    for (int k = 0; k < cp->admitted; k++) {
+        cp->progress[k].index = index_map[cp->progress[k].index];
+    }
+    if (cp->last_process >= 0) cp->last_process = index_map[cp->last_process];
+    for (int k = 0; k < cp->ready_count; k++) {
+        if (algo == ROUND_ROBIN) {
+            cp->ready[k] = index_map[cp->ready[k]];
+        }
+        else {
+            cp->ready[k] = make_key(key_primary(cp->ready[k]), index_map[key_index(cp->ready[k])]);
+        }
+    }
+}
+
+// Index of the latest usable snapshot for this run, or -1 for a full run
+int find_resume_checkpoint(const CheckpointLog* log, const Simulation* sim, SchedulingAlgorithm algo) {
+    if (!log->valid || log->algo != algo) return -1;
+    if (algo == ROUND_ROBIN && log->time_quantum != sim->time_quantum) return -1;
+    if (memcmp(&log->cost, &sim->cost, sizeof(SwitchCost)) != 0) return -1;
+    if (log->aging_interval != sim->aging_interval) return -1;
+
+    // Anything other than adds and deletes invalidates the log
+    int* index_map = malloc(log->process_count * sizeof(int) + 1);
+    SimTime affected = match_run_processes(log, sim, index_map);
+    free(index_map);
+
+    // A snapshot is taken after admitting arrivals at its time, so it must
+    // predate the first edited arrival strictly.
+    int best = -1;
+    for (int i = 0; i < log->count; i++) {
+        if (log->items[i].time < affected) best = i;
+    }
+    return best;
+}
+
+void restore_checkpoint(Simulation* sim, EngineState* state, CheckpointLog* log, int which) {
+    Checkpoint* cp = &log->items[which];
+
+    // The run's processes are found in the edited table by id
+    int* index_map = malloc(log->process_count * sizeof(int) + 1);
+    match_run_processes(log, sim, index_map);
+
+    // Later snapshots describe the old workload; earlier ones stay valid once renumbered
+    for (int i = which + 1; i < log->count; i++) {
+        checkpoint_free(&log->items[i]);
+    }
+    log->count = which + 1;
+    for (int i = 0; i < log->count; i++) {
+        remap_checkpoint(&log->items[i], index_map, log->algo);
+    }
+
+    for (int k = 0; k < cp->admitted; k++) {
+        Process* p = &sim->processes[cp->progress[k].index];
+        p->remaining_time = cp->progress[k].remaining_time;
+        p->start_time = cp->progress[k].start_time;
+        p->completion_time = cp->progress[k].completion_time;
+        p->last_run_end = cp->progress[k].last_run_end;
+    }
+
+    if (log->algo == ROUND_ROBIN) {
+        for (int k = 0; k < cp->ready_count; k++) {
+            state->queue[k] = (int)cp->ready[k];
+        }
+        state->front = 0;
+        state->rear = cp->ready_count;
+    }
+    else {
+        memcpy(state->heap, cp->ready, cp->ready_count * sizeof(SchedKey));
+        state->heap_size = cp->ready_count;
+    }
+
+    state->next = cp->admitted;
+    state->completed = cp->completed;
+    state->dispatches = cp->dispatches;
+    sim->current_time = cp->time;
+    sim->last_process = cp->last_process;
+    sim->switches = cp->switches;
+    sim->overhead_time = cp->overhead_time;
+
+    // Blocks before the snapshot belong to processes that are still in the table
+    copy_gantt(sim, log->gantt, cp->gantt_count);
+    for (int k = 0; k < cp->gantt_count; k++) {
+        sim->gantt[k].process_index = index_map[sim->gantt[k].process_index];
+    }
+    free(index_map);
+    if (cp->gantt_count > 0) {
+        sim->gantt[cp->gantt_count - 1].end_time = cp->last_gantt_end;
+    }
+
+    // The log now describes the edited workload
+    log->process_count = sim->process_count;
+    log->run_ids = realloc(log->run_ids, sim->process_count * sizeof(int) + 1);
+    for (int i = 0; i < sim->process_count; i++) {
+        log->run_ids[i] = sim->processes[i].process_id;
+    }
+    log->input = realloc(log->input, sim->process_count * sizeof(WorkloadEntry) + 1);
+    snapshot_workload(sim->processes, sim->process_count, log->input);
+    log->next_checkpoint = cp->dispatches + log->interval;
+}
+
+void run_incremental(Simulation* sim, SchedulingAlgorithm algo, CheckpointLog* log, IncrementalReport* report) {
+    EngineState state;
+
+    // Checkpoints do not capture device queues, group quotas, resource
+    // holders, pass values, the lottery's generator or a plugin's state, so
+    // those runs start over
+    if (workload_has_io(sim->processes, sim->process_count) || workload_has_groups(sim) || locks_apply(sim, algo) ||
+        proportional_share(algo) || algorithm_plugin(algo)) {
+        checkpoint_log_reset(log);
+        memset(report, 0, sizeof(*report));
+        run_fast_scheduler(sim, algo);
+        return;
+    }
+
+    reset_process_state(sim->processes, sim->process_count);
+    begin_run(sim);
+    engine_init(&state, sim);
+
+    memset(report, 0, sizeof(*report));
+    int which = find_resume_checkpoint(log, sim, algo);
+    if (which >= 0) {
+        report->resumed = 1;
+        report->resume_time = log->items[which].time;
+        report->skipped_dispatches = log->items[which].dispatches;
+        restore_checkpoint(sim, &state, log, which);
+    }
+    else {
+        checkpoint_log_start(log, sim, algo);
+    }
+
+    run_engine(sim, algo, &state, log);
+    checkpoint_log_finish(log, sim, &state);
+    report->total_dispatches = state.dispatches;
+    engine_free(&state);
+
+    calculate_times(sim);
+}
+
+// Monte Carlo replication
+
+uint64_t splitmix64(uint64_t* state) {
+    uint64_t z = (*state += 0x9E3779B97F4A7C15ULL);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+}
+
+// Every (seed, stream) pair gets its own independent sequence, so replication k
+// sees the same workload no matter which thread runs it.
+void rng_seed(RngState* rng, uint64_t seed, uint64_t stream) {
+    uint64_t state = seed ^ (stream * 0xD1B54A32D192ED03ULL);
+    for (int i = 0; i < 4; i++) {
+        rng->s[i] = splitmix64(&state);
+    }
+}
+
+uint64_t rng_next(RngState* rng) {
+    uint64_t* s = rng->s;
+    uint64_t x = s[1] * 5;
+    uint64_t result = ((x << 7) | (x >> 57)) * 9;
+    uint64_t t = s[1] << 17;
+
+    s[2] ^= s[0];
+    s[3] ^= s[1];
+    s[1] ^= s[2];
+    s[0] ^= s[3];
+    s[2] ^= t;
+    s[3] = (s[3] << 45) | (s[3] >> 19);
+
+    return result;
+}
+
+// Uniform on [0, 1)
+double rng_uniform(RngState* rng) {
+    return (rng_next(rng) >> 11) * (1.0 / 9007199254740992.0);
+}
+
+double rng_exponential(RngState* rng, double mean) {
+    return -mean * log(1.0 - rng_uniform(rng));
+}
+
+// Poisson arrivals starting at t=0, exponential bursts (at least 1 unit),
+// priorities uniform in 1-10; a share io_mix of the jobs are I/O-bound.
+void generate_workload(Process* out, int count, RngState* rng, const ReplicationConfig* config) {
+    double clock = 0.0;
+
+    for (int i = 0; i < count; i++) {
+        generate_process(&out[i], i, &clock, rng, config);
+    }
+
+    reset_process_state(out, count);
+}
+
+// The i-th generated process; clock carries the arrival time from one call
+// to the next, so a workload can be drawn one process at a time.
+void generate_process(Process* p, int i, double* clock, RngState* rng, const ReplicationConfig* config) {
+    if (i > 0) {
+        *clock += rng_exponential(rng, 1.0 / config->arrival_rate);
+    }
+
+    snprintf(p->name, MAX_NAME_LEN, "P%d", i + 1);
+    p->arrival_time = (SimTime)*clock;
+    p->burst_time = llround(rng_exponential(rng, config->mean_burst));
+    if (p->burst_time < 1) p->burst_time = 1;
+    p->priority = 1 + (int)(rng_uniform(rng) * 10);
+    p->weight = 0;
+    p->process_id = i + 1;
+    p->color = process_colors[i % 10];
+    p->io_count = 0;
+
+    // An I/O-bound job trades its one long burst for short CPU bursts
+    // between I/O requests on random devices. Nothing extra is drawn
+    // without an I/O mix, so existing seeds keep their workloads.
+    if (config->io_mix > 0 && rng_uniform(rng) < config->io_mix) {
+        int devices = config->io.device_count > 0 ? config->io.device_count : 1;
+        int requests = 1 + (int)(rng_next(rng) % MAX_IO_BURSTS);
+
+        p->burst_time = 0;
+        for (int k = 0; k <= requests; k++) {
+            SimTime cpu = llround(rng_exponential(rng, config->mean_burst / 4));
+            p->burst_time += cpu < 1 ? 1 : cpu;
+            if (k == requests) break;
+
+            SimTime length = llround(rng_exponential(rng, config->mean_burst));
+            p->io[k] = (IoBurst){ p->burst_time, length < 1 ? 1 : length, (int)(rng_next(rng) % devices) };
+            p->io_count++;
+        }
+    }
+}
+
+void running_stat_add(RunningStat* stat, double value) {
+    stat->count++;
+    double delta = value - stat->mean;
+    stat->mean += delta / stat->count;
+    stat->m2 += delta * (value - stat->mean);
+}
+
+// Chan et al. pairwise combination of two Welford accumulators
+void running_stat_merge(RunningStat* into, const RunningStat* from) {
+    if (from->count == 0) return;
+    if (into->count == 0) {
+        *into = *from;
+        return;
+    }
+
+    long total = into->count + from->count;
+    double delta = from->mean - into->mean;
+    into->mean += delta * from->count / total;
+    into->m2 += from->m2 + delta * delta * ((double)into->count * from->count / total);
+    into->count = total;
+}
+
+// Two-sided 95% Student t critical value for the given sample size
+double t_critical_95(long samples) {
+    static const double table[] = {
+        12.706, 4.303, 3.182, 2.776, 2.571, 2.447, 2.365, 2.306, 2.262, 2.228,
+        2.201, 2.179, 2.160, 2.145, 2.131, 2.120, 2.110, 2.101, 2.093, 2.086,
+        2.080, 2.074, 2.069, 2.064, 2.060, 2.056, 2.052, 2.048, 2.045, 2.042
+    };
+    long df = samples - 1;
+
+    if (df < 1) return 0.0;
+    if (df <= 30) return table[df - 1];
+    return 1.96 + 2.4 / df;
+}
+
+void* replication_worker(void* arg) {
+    ReplicationWorker* worker = arg;
+    const ReplicationConfig* config = worker->config;
+    Process* procs = malloc(config->jobs * sizeof(Process));
+    RunningStat local[REPLICATION_METRICS];
+    Simulation sim;
+    RngState rng;
+
+    memset(local, 0, sizeof(local));
+    init_simulation(&sim, procs, config->jobs, config->time_quantum);
+    sim.record_gantt = 0;
+    sim.cost = config->cost;
+    sim.io = config->io;
+    sim.aging_interval = config->aging_interval;
+
+    for (int k = worker->first_replication; k < worker->last_replication; k++) {
+        rng_seed(&rng, config->seed, k);
+        generate_workload(procs, config->jobs, &rng, config);
+        sim.seed = rng_next(&rng);
+        invalidate_arrival_order(&sim);
+        run_fast_scheduler(&sim, config->algo);
+
+        double total_tat = 0, total_wt = 0, total_rt = 0;
+        for (int i = 0; i < config->jobs; i++) {
+            total_tat += procs[i].turnaround_time;
+            total_wt += procs[i].waiting_time;
+            total_rt += procs[i].response_time;
+        }
+
+        SwitchSummary summary;
+        summarize_switching(&sim, &summary);
+
+        running_stat_add(&local[0], total_tat / config->jobs);
+        running_stat_add(&local[1], total_wt / config->jobs);
+        running_stat_add(&local[2], total_rt / config->jobs);
+        running_stat_add(&local[3], 100.0 * config->jobs / summary.elapsed);
+        running_stat_add(&local[4], 100.0 * summary.useful_time / summary.elapsed);
+        running_stat_add(&local[5], 100.0 * summary.overhead_time / summary.elapsed);
+    }
+
+    // Publish once at the end so threads never write to shared cache lines
+    memcpy(worker->metrics, local, sizeof(local));
+    free_simulation(&sim);
+    free(procs);
+    return NULL;
+}
+
+int run_replications(const ReplicationConfig* config, ReplicationResult* result) {
+    int threads = config->threads > 0 ? config->threads : default_thread_count();
+    if (threads > config->replications) threads = config->replications;
+    if (threads < 1) threads = 1;
+
+    ReplicationWorker* workers = calloc(threads, sizeof(ReplicationWorker));
+    pthread_t* handles = malloc(threads * sizeof(pthread_t));
+    int* joinable = calloc(threads, sizeof(int));
+    struct timespec started, finished;
+
+    clock_gettime(CLOCK_MONOTONIC, &started);
+
+    // Contiguous blocks keep the merge order, and therefore the result,
+    // independent of thread scheduling.
+    for (int t = 0; t < threads; t++) {
+        workers[t].config = config;
+        workers[t].first_replication = (int)((long)config->replications * t / threads);
+        workers[t].last_replication = (int)((long)config->replications * (t + 1) / threads);
+        joinable[t] = pthread_create(&handles[t], NULL, replication_worker, &workers[t]) == 0;
+        if (!joinable[t]) {
+            // Fall back to running this block on the calling thread
+            replication_worker(&workers[t]);
+        }
+    }
+    for (int t = 0; t < threads; t++) {
+        if (joinable[t]) pthread_join(handles[t], NULL);
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &finished);
+
+    memset(result, 0, sizeof(*result));
+    for (int t = 0; t < threads; t++) {
+        for (int m = 0; m < REPLICATION_METRICS; m++) {
+            running_stat_merge(&result->metrics[m], &workers[t].metrics[m]);
+        }
+    }
+    result->threads_used = threads;
+    result->elapsed_seconds = (finished.tv_sec - started.tv_sec) +
+        (finished.tv_nsec - started.tv_nsec) / 1e9;
+
+    free(joinable);
+    free(handles);
+    free(workers);
+    return 0;
+}
+
+void format_replication_report(const ReplicationConfig* config, const ReplicationResult* result,
+    char* out, size_t out_len) {
+    char devices[128];
+    format_io_devices(&config->io, config->io.device_count > 0 ? config->io.device_count : 1,
+        devices, sizeof(devices));
+
+    char aging[64] = "off";
+    if (config->aging_interval > 0 && (config->algo == PRIORITY || config->algo == PREEMPTIVE_PRIORITY)) {
+        snprintf(aging, sizeof(aging), "one level per %d units waited", config->aging_interval);
+    }
+
+    size_t used = snprintf(out, out_len,
+        "MONTE CARLO REPLICATION\n"
+        "=======================\n\n"
+        "Algorithm: %s\n"
+        "Replications: %d workloads x %d processes\n"
+        "Workload: Poisson arrivals (rate %.3f), exponential bursts (mean %.2f), priority 1-10\n"
+        "I/O-bound Jobs: %.0f%% (devices %s)\n"
+        "Time Quantum: %d\n"
+        "Switch Cost: dispatch %d, cache penalty %d over %d units\n"
+        "Aging: %s\n"
+        "Seed: %llu\n"
+        "Threads: %d\n"
+        "Elapsed: %.3f s\n\n"
+        "%-26s %12s %12s %26s\n",
+        algorithm_keys[config->algo - 1], config->replications, config->jobs,
+        config->arrival_rate, config->mean_burst, 100.0 * config->io_mix, devices, config->time_quantum,
+        config->cost.dispatch, config->cost.cache_penalty, config->cost.cache_decay, aging,
+        (unsigned long long)config->seed, result->threads_used, result->elapsed_seconds,
+        "Metric", "Mean", "Std Dev", "95% Confidence Interval");
+
+    for (int m = 0; m < REPLICATION_METRICS && used < out_len; m++) {
+        const RunningStat* stat = &result->metrics[m];
+        double sd = stat->count > 1 ? sqrt(stat->m2 / (stat->count - 1)) : 0.0;
+        double half = stat->count > 1 ? t_critical_95(stat->count) * sd / sqrt((double)stat->count) : 0.0;
+
+        used += snprintf(out + used, out_len - used, "%-26s %12.3f %12.3f   [%10.3f, %10.3f]\n",
+            replication_metric_names[m], stat->mean, sd, stat->mean - half, stat->mean + half);
+    }
+    if (algorithm_plugin(config->algo) && used < out_len) {
+        used += snprintf(out + used, out_len - used, "\n");
+        if (used < out_len) format_plugin_timing(algorithm_plugin(config->algo), out + used, out_len - used);
+    }
+}
+
+int default_thread_count() {
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    return cpus > 0 ? (int)cpus : 1;
+}
+
+int algorithm_from_key(const char* key) {
+    for (int i = 0; i < algorithm_count; i++) {
+        if (strcmp(key, algorithm_keys[i]) == 0) {
+            return i + 1;
+        }
+    }
+    return 0;
+}
+
+// Autotuner
+//
+// Searches the algorithm, time quantum and aging interval for the
+// configuration that minimises a latency objective subject to a minimum
+// throughput, by random search with successive halving: every sampled
+// configuration runs on a prefix of the workload, the better half goes on to
+// a prefix twice as long, and so on until the survivors run the whole
+// workload. Each evaluation is a full simulation; the evaluations of a rung
+// are shared out among worker threads. Every configuration writes to its own
+// slot, so the result does not depend on the thread count.
+
+const char* tune_objective_keys[] = { "p99-response", "mean-response", "p99-waiting", "mean-waiting",
+    "mean-turnaround" };
+const char* tune_objective_names[] = { "p99 response time", "mean response time", "p99 waiting time",
+    "mean waiting time", "mean turnaround time" };
+
+// Nearest-rank percentile; sorts values
+SimTime nearest_rank(SimTime* values, int count, double q) {
+    if (count == 0) return 0;
+    qsort(values, count, sizeof(SimTime), compare_int64);
+    return values[(int)ceil(q * count) - 1];
+}
+
+void tune_evaluate(const TunePool* pool, TuneCandidate* candidate, Process* scratch) {
+    const ReplicationConfig* config = pool->config;
+    int n = pool->jobs;
+    SimTime* values = malloc(n * sizeof(SimTime));
+    double response = 0, waiting = 0, turnaround = 0;
+    SwitchSummary summary;
+    Simulation sim;
+
+    memcpy(scratch, pool->procs, n * sizeof(Process));
+    init_simulation(&sim, scratch, n, candidate->time_quantum > 0 ? candidate->time_quantum : 1);
+    sim.record_gantt = 0;
+    sim.cost = config->cost;
+    sim.io = config->io;
+    sim.aging_interval = candidate->aging_interval;
+    sim.seed = config->seed;
+    run_fast_scheduler(&sim, candidate->algo);
+
+    for (int i = 0; i < n; i++) {
+        response += scratch[i].response_time;
+        waiting += scratch[i].waiting_time;
+        turnaround += scratch[i].turnaround_time;
+        values[i] = scratch[i].response_time;
+    }
+    candidate->metrics[OBJECTIVE_P99_RESPONSE] = nearest_rank(values, n, 0.99);
+    for (int i = 0; i < n; i++) {
+        values[i] = scratch[i].waiting_time;
+    }
+    candidate->metrics[OBJECTIVE_P99_WAITING] = nearest_rank(values, n, 0.99);
+    candidate->metrics[OBJECTIVE_MEAN_RESPONSE] = response / n;
+    candidate->metrics[OBJECTIVE_MEAN_WAITING] = waiting / n;
+    candidate->metrics[OBJECTIVE_MEAN_TURNAROUND] = turnaround / n;
+
+    summarize_switching(&sim, &summary);
+    candidate->throughput = 100.0 * n / summary.elapsed;
+    candidate->rung = pool->rung;
+
+    free_simulation(&sim);
+    free(values);
+}
+
+void* tune_worker(void* arg) {
+    TunePool* pool = arg;
+    Process* scratch = malloc(pool->jobs * sizeof(Process));
+
+    while (1) {
+        pthread_mutex_lock(&pool->lock);
+        int k = pool->next < pool->batch_count ? pool->next++ : -1;
+        pthread_mutex_unlock(&pool->lock);
+        if (k < 0) break;
+        tune_evaluate(pool, &pool->candidates[pool->batch[k]], scratch);
+    }
+
+    free(scratch);
+    return NULL;
+}
+
+// Evaluations differ in cost by algorithm, so threads take them one at a time
+void tune_run_rung(TunePool* pool, int threads) {
+    pthread_t* handles = malloc(threads * sizeof(pthread_t));
+    int* joinable = calloc(threads, sizeof(int));
+
+    pool->next = 0;
+    pthread_mutex_init(&pool->lock, NULL);
+    for (int t = 0; t < threads; t++) {
+        joinable[t] = pthread_create(&handles[t], NULL, tune_worker, pool) == 0;
+    }
+    // Whatever no thread could be started for runs here
+    tune_worker(pool);
+    for (int t = 0; t < threads; t++) {
+        if (joinable[t]) pthread_join(handles[t], NULL);
+    }
+    pthread_mutex_destroy(&pool->lock);
+
+    free(joinable);
+    free(handles);
+}
+
+// Draws a configuration not among the first `count` taken: quanta from 1 to
+// 64 and aging intervals from 1 to 500 evenly on a log scale, with aging off
+// half the time. Returns 0 when a hundred draws found nothing new.
+int tune_sample(TuneCandidate* out, const TuneCandidate* taken, int count, RngState* rng) {
+    for (int attempt = 0; attempt < 100; attempt++) {
+        TuneCandidate c;
+        memset(&c, 0, sizeof(c));
+        c.algo = (SchedulingAlgorithm)(FCFS + (int)(rng_next(rng) % algorithm_count));
+        if (c.algo == ROUND_ROBIN || proportional_share(c.algo) || algorithm_plugin(c.algo)) {
+            c.time_quantum = (int)floor(exp(rng_uniform(rng) * log(65.0)));
+            if (c.time_quantum < 1) c.time_quantum = 1;
+            if (c.time_quantum > 64) c.time_quantum = 64;
+        }
+        if ((c.algo == PRIORITY || c.algo == PREEMPTIVE_PRIORITY) && rng_next(rng) % 2) {
+            c.aging_interval = (int)floor(exp(rng_uniform(rng) * log(501.0)));
+            if (c.aging_interval < 1) c.aging_interval = 1;
+            if (c.aging_interval > 500) c.aging_interval = 500;
+        }
+
+        int seen = 0;
+        for (int k = 0; k < count && !seen; k++) {
+            seen = taken[k].algo == c.algo && taken[k].time_quantum == c.time_quantum &&
+                taken[k].aging_interval == c.aging_interval;
+        }
+        if (!seen) {
+            *out = c;
+            return 1;
+        }
+    }
+    return 0;
+}
+
+// Configurations that reach the throughput floor come first, by the
+// objective; the rest by how close they come to it
+int tune_better(const TuneCandidate* a, const TuneCandidate* b, const TuneConfig* tune) {
+    int feasible_a = a->throughput >= tune->min_throughput;
+    int feasible_b = b->throughput >= tune->min_throughput;
+
+    if (feasible_a != feasible_b) return feasible_a;
+    if (!feasible_a) return a->throughput > b->throughput;
+    if (a->metrics[tune->objective] != b->metrics[tune->objective]) {
+        return a->metrics[tune->objective] < b->metrics[tune->objective];
+    }
+    return a->throughput > b->throughput;
+}
+
+void tune_describe(const TuneCandidate* c, char* out, size_t out_len) {
+    size_t used = snprintf(out, out_len, "%s", algorithm_names[c->algo - 1]);
+    if (c->time_quantum > 0 && used < out_len) {
+        used += snprintf(out + used, out_len - used, ", quantum %d", c->time_quantum);
+    }
+    if (c->aging_interval > 0 && used < out_len) {
+        snprintf(out + used, out_len - used, ", aging %d", c->aging_interval);
+    }
+}
+
+// --tune: the search on a workload file or on one generated workload
+int run_tune(const ReplicationConfig* config, const TuneConfig* tune, const char* workload_path) {
+    Process* loaded;
+    int count;
+    char error[1200];
+    struct timespec started, finished;
+
+    if (workload_path) {
+        if (load_workload(workload_path, &loaded, &count, NULL, NULL, error, sizeof(error)) != 0) {
+            fprintf(stderr, "%s\n", error);
+            return 1;
+        }
+    }
+    else {
+        RngState rng;
+        count = config->jobs;
+        loaded = malloc(count * sizeof(Process));
+        rng_seed(&rng, config->seed, 0);
+        generate_workload(loaded, count, &rng, config);
+    }
+    if (count == 0) {
+        fprintf(stderr, "The workload has no processes\n");
+        free(loaded);
+        return 1;
+    }
+    clock_gettime(CLOCK_MONOTONIC, &started);
+
+    // Prefixes are taken in arrival order, so each is a workload of its own
+    Process* procs = malloc(count * sizeof(Process));
+    SchedKey* order = malloc(count * sizeof(SchedKey));
+    for (int i = 0; i < count; i++) {
+        order[i] = make_key(loaded[i].arrival_time, i);
+    }
+    qsort(order, count, sizeof(SchedKey), compare_key);
+    for (int k = 0; k < count; k++) {
+        procs[k] = loaded[key_index(order[k])];
+    }
+    free(order);
+    free(loaded);
+
+    TuneCandidate* candidates = malloc(tune->candidates * sizeof(TuneCandidate));
+    int sampled = 0;
+    RngState rng;
+    rng_seed(&rng, config->seed, 1);
+    while (sampled < tune->candidates && tune_sample(&candidates[sampled], candidates, sampled, &rng)) {
+        sampled++;
+    }
+
+    // Up to four rungs, none on fewer than 50 processes
+    int rungs = 1;
+    while (rungs < 4 && (count >> rungs) >= 50 && (sampled >> rungs) >= 1) rungs++;
+
+    int threads = config->threads > 0 ? config->threads : default_thread_count();
+    int* batch = malloc(sampled * sizeof(int));
+    int batch_count = sampled;
+    int rung_jobs[4], rung_size[4], rung_feasible[4], rung_leader[4];
+    double rung_score[4];
+    for (int k = 0; k < sampled; k++) {
+        batch[k] = k;
+    }
+
+    for (int r = 0; r < rungs; r++) {
+        TunePool pool;
+        memset(&pool, 0, sizeof(pool));
+        pool.config = config;
+        pool.procs = procs;
+        pool.jobs = count >> (rungs - 1 - r);
+        pool.rung = r;
+        pool.candidates = candidates;
+        pool.batch = batch;
+        pool.batch_count = batch_count;
+        tune_run_rung(&pool, threads < batch_count ? threads - 1 : batch_count - 1);
+
+        // Insertion sort keeps ties in sampling order
+        for (int a = 1; a < batch_count; a++) {
+            int key = batch[a], b = a - 1;
+            while (b >= 0 && tune_better(&candidates[key], &candidates[batch[b]], tune)) {
+                batch[b + 1] = batch[b];
+                b--;
+            }
+            batch[b + 1] = key;
+        }
+        rung_jobs[r] = pool.jobs;
+        rung_size[r] = batch_count;
+        rung_leader[r] = batch[0];
+        rung_score[r] = candidates[batch[0]].metrics[tune->objective];
+        rung_feasible[r] = 0;
+        for (int k = 0; k < batch_count; k++) {
+            if (candidates[batch[k]].throughput >= tune->min_throughput) rung_feasible[r]++;
+        }
+        if (r < rungs - 1) batch_count = (batch_count + 1) / 2;
+    }
+    clock_gettime(CLOCK_MONOTONIC, &finished);
+
+    const TuneCandidate* best = &candidates[batch[0]];
+    char line[256];
+    printf("AUTOTUNER\n"
+        "=========\n\n"
+        "Workload: %d processes%s\n"
+        "Switch Cost: dispatch %d, cache penalty %d over %d units\n"
+        "Objective: minimise %s with throughput >= %.3f processes per 100 time units\n"
+        "Search: %d configurations, successive halving over %d rung%s, %d thread%s, %.3f s\n\n",
+        count, workload_path ? "" : " (generated)", config->cost.dispatch, config->cost.cache_penalty,
+        config->cost.cache_decay, tune_objective_names[tune->objective], tune->min_throughput,
+        sampled, rungs, rungs == 1 ? "" : "s", threads, threads == 1 ? "" : "s",
+        (finished.tv_sec - started.tv_sec) + (finished.tv_nsec - started.tv_nsec) / 1e9);
+
+    printf("%-6s %10s %10s %10s %12s  %s\n", "Rung", "Processes", "Evaluated", "Feasible",
+        tune_objective_keys[tune->objective], "Leader");
+    for (int r = 0; r < rungs; r++) {
+        tune_describe(&candidates[rung_leader[r]], line, sizeof(line));
+        printf("%-6d %10d %10d %10d %12.2f  %s\n", r + 1, rung_jobs[r], rung_size[r], rung_feasible[r],
+            rung_score[r], line);
+    }
+
+    tune_describe(best, line, sizeof(line));
+    printf("\nBest: %s\n", line);
+    if (best->throughput < tune->min_throughput) {
+        printf("No configuration reached the throughput floor; this one came closest.\n");
+    }
+    printf("  p99 response %.0f, mean response %.2f, p99 waiting %.0f, mean waiting %.2f,\n"
+        "  mean turnaround %.2f, throughput %.3f\n",
+        best->metrics[OBJECTIVE_P99_RESPONSE], best->metrics[OBJECTIVE_MEAN_RESPONSE],
+        best->metrics[OBJECTIVE_P99_WAITING], best->metrics[OBJECTIVE_MEAN_WAITING],
+        best->metrics[OBJECTIVE_MEAN_TURNAROUND], best->throughput);
+
+    // Of the configurations run on the whole workload, those no other beats
+    // on both the objective and throughput, best objective first
+    printf("\nPareto frontier (whole workload, %s against throughput):\n", tune_objective_names[tune->objective]);
+    printf("  %-40s %12s %11s\n", "Configuration", tune_objective_keys[tune->objective], "Throughput");
+    int* frontier = malloc(batch_count * sizeof(int));
+    int frontier_count = 0;
+    for (int k = 0; k < batch_count; k++) {
+        frontier[frontier_count++] = batch[k];
+    }
+    for (int a = 1; a < frontier_count; a++) {
+        int key = frontier[a], b = a - 1;
+        while (b >= 0 && candidates[key].metrics[tune->objective] < candidates[frontier[b]].metrics[tune->objective]) {
+            frontier[b + 1] = frontier[b];
+            b--;
+        }
+        frontier[b + 1] = key;
+    }
+    double top = -1;
+    for (int k = 0; k < frontier_count; k++) {
+        const TuneCandidate* c = &candidates[frontier[k]];
+        if (c->throughput <= top) continue;
+        top = c->throughput;
+        tune_describe(c, line, sizeof(line));
+        printf("  %-40s %12.2f %11.3f\n", line, c->metrics[tune->objective], c->throughput);
+    }
+
+    for (int k = 0; k < plugin_count; k++) {
+        char timing[1024];
+        if (plugins[k].timing.runs == 0) continue;
+        format_plugin_timing(&plugins[k], timing, sizeof(timing));
+        printf("\n%s", timing);
+    }
+
+    free(frontier);
+    free(batch);
+    free(candidates);
+    free(procs);
+    return 0;
+}
+
+// Queueing model
+//
+// Closed-form estimates of the mean waiting time under FCFS, SRTF and Round
+// Robin, from the first two moments of the workload's interarrival gaps and
+// service times. Each takes microseconds where a simulation of a large
+// workload takes seconds. They assume one CPU, free context switches and a
+// workload long enough for the queue to settle, and describe the steady
+// state only when the load is below 1.
+//
+// - FCFS: the M/G/1 Pollaczek-Khinchine formula, exact for Poisson arrivals,
+//   and Kingman's GI/G/1 approximation, which also uses the arrivals' variance.
+// - SRTF: the M/G/1 SRPT response time of Schrage and Miller, over the
+//   workload's own service times.
+// - Round Robin: M/G/1 processor sharing, its limit as the quantum shrinks.
+//
+// Kingman's exponential bound on the FCFS waiting time gives a p99 that
+// holds for any arrival process.
+
+double elapsed_seconds(const struct timespec* since) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (now.tv_sec - since->tv_sec) + (now.tv_nsec - since->tv_nsec) / 1e9;
+}
+
+void format_duration(double seconds, char* out, size_t out_len) {
+    if (seconds < 1e-3) snprintf(out, out_len, "%.1f us", seconds * 1e6);
+    else if (seconds < 1) snprintf(out, out_len, "%.2f ms", seconds * 1e3);
+    else snprintf(out, out_len, "%.2f s", seconds);
+}
+
+// arrival must be in ascending order; service[i] belongs to arrival[i]
+void queue_fit(const SimTime* arrival, const SimTime* service, int count, QueueFit* fit) {
+    RunningStat gaps = { 0, 0, 0 }, sizes = { 0, 0, 0 };
+
+    for (int i = 0; i < count; i++) {
+        running_stat_add(&sizes, service[i]);
+        if (i > 0) running_stat_add(&gaps, arrival[i] - arrival[i - 1]);
+    }
+
+    memset(fit, 0, sizeof(*fit));
+    fit->count = count;
+    if (count == 0) return;
+    fit->span = arrival[count - 1] - arrival[0];
+    fit->arrival_rate = fit->span > 0 ? (count - 1) / fit->span : 0;
+    fit->gap_scv = gaps.mean > 0 ? gaps.m2 / gaps.count / (gaps.mean * gaps.mean) : 0;
+    fit->mean_service = sizes.mean;
+    fit->service_m2 = sizes.m2 / sizes.count + sizes.mean * sizes.mean;
+    fit->service_scv = sizes.mean > 0 ? sizes.m2 / sizes.count / (sizes.mean * sizes.mean) : 0;
+    fit->load = fit->arrival_rate * fit->mean_service;
+}
+
+// The distribution with the same squared coefficient of variation
+void queue_family(double scv, char* out, size_t out_len) {
+    if (scv < 0.02) snprintf(out, out_len, "deterministic");
+    else if (scv > 1.1) snprintf(out, out_len, "hyperexponential");
+    else if (lround(1 / scv) <= 1) snprintf(out, out_len, "exponential");
+    else snprintf(out, out_len, "Erlang-%ld", lround(1 / scv));
+}
+
+// FCFS mean waiting time, M/G/1 Pollaczek-Khinchine
+double estimate_pk(const QueueFit* fit) {
+    return fit->arrival_rate * fit->service_m2 / (2 * (1 - fit->load));
+}
+
+// FCFS mean waiting time, Kingman's GI/G/1 approximation
+double estimate_kingman(const QueueFit* fit) {
+    return fit->load / (1 - fit->load) * (fit->gap_scv + fit->service_scv) / 2 * fit->mean_service;
+}
+
+// Round Robin mean waiting time, M/G/1 processor sharing: a job of size x
+// takes x / (1 - load) whatever the distribution
+double estimate_ps(const QueueFit* fit) {
+    return fit->load * fit->mean_service / (1 - fit->load);
+}
+
+// SRTF mean waiting time, from the M/G/1 SRPT response time of a job of size x:
+//   T(x) = lambda (m2(x) + x^2 (1 - F(x))) / (2 (1 - rho(x))^2) + integral_0^x dt / (1 - rho(t))
+// where m2(x) and rho(x) / lambda are the second and first moments of the
+// sizes up to x. The integral is its residence time: only work smaller than
+// what it has left gets ahead of it. Sorts sizes, by counting when they
+// are small enough.
+double estimate_srpt(const QueueFit* fit, SimTime* sizes, int count) {
+    double lambda = fit->arrival_rate;
+    double m1 = 0, m2 = 0, residence = 0, previous = 0, total = 0;
+    SimTime largest = 0;
+
+    for (int i = 0; i < count; i++) {
+        if (sizes[i] > largest) largest = sizes[i];
+    }
+    long* counts = largest < (1 << 22) ? calloc(largest + 1, sizeof(long)) : NULL;
+    if (counts) {
+        for (int i = 0; i < count; i++) {
+            counts[sizes[i]]++;
+        }
+        for (SimTime x = 0, k = 0; x <= largest; x++) {
+            for (long c = 0; c < counts[x]; c++) sizes[k++] = x;
+        }
+        free(counts);
+    }
+    else qsort(sizes, count, sizeof(SimTime), compare_int64);
+    for (int i = 0; i < count;) {
+        int j = i;
+        while (j < count && sizes[j] == sizes[i]) j++;
+
+        double x = (double)sizes[i], share = (double)(j - i) / count;
+        residence += (x - previous) / (1 - lambda * m1);
+        m1 += share * x;
+        m2 += share * x * x;
+        double rho = lambda * m1;
+        double wait = lambda * (m2 + x * x * (double)(count - j) / count) / (2 * (1 - rho) * (1 - rho));
+        total += share * (wait + residence);
+
+        previous = x;
+        i = j;
+    }
+    return total - fit->mean_service;
+}
+
+// Decay rate of Kingman's bound P(FCFS wait > t) <= exp(-theta t): the
+// positive root of E[exp(theta (S - A))] = 1, over each process's service
+// time S and the gap A to the next arrival. The differences are integers, so
+// they are counted first and the root found by bisection over the counts.
+// Returns 0 when no process ever has to wait.
+double kingman_theta(const SimTime* arrival, const SimTime* service, int count) {
+    if (count < 2) return 0;
+
+    SimTime lo = INT64_MAX, hi = INT64_MIN;
+    for (int i = 0; i + 1 < count; i++) {
+        SimTime d = service[i] - (arrival[i + 1] - arrival[i]);
+        if (d < lo) lo = d;
+        if (d > hi) hi = d;
+    }
+    if (hi <= 0) return 0;
+
+    // Differences far apart are rare; those fall back to one pass per step
+    int64_t range = hi - lo + 1;
+    long* counts = range <= (1L << 22) ? calloc(range, sizeof(long)) : NULL;
+    if (counts) {
+        for (int i = 0; i + 1 < count; i++) {
+            counts[service[i] - (arrival[i + 1] - arrival[i]) - lo]++;
+        }
+    }
+
+    // log E[exp(theta D)], shifted by the largest difference so nothing overflows
+    double low = 0, high = 1.0 / hi;
+    for (int step = 0; step < 200; step++) {
+        double theta = step < 100 ? high : (low + high) / 2, sum = 0;
+        if (counts) {
+            for (long d = 0; d < range; d++) {
+                if (counts[d]) sum += counts[d] * exp(theta * (d + lo - hi));
+            }
+        }
+        else {
+            for (int i = 0; i + 1 < count; i++) {
+                sum += exp(theta * (service[i] - (arrival[i + 1] - arrival[i]) - hi));
+            }
+        }
+        double log_mgf = theta * hi + log(sum / (count - 1));
+
+        if (step < 100) {
+            // Double until the function turns positive, then bisect
+            if (log_mgf > 0) step = 99;
+            else {
+                low = high;
+                high *= 2;
+            }
+        }
+        else if (log_mgf > 0) high = theta;
+        else low = theta;
+    }
+
+    free(counts);
+    return (low + high) / 2;
+}
+
+// Fits the workload and tabulates each model's estimate and the time it
+// took. With procs, each policy is also simulated on it for comparison.
+void format_queue_estimates(const SimTime* arrival, const SimTime* service, int count, const Process* procs,
+    int quantum, const SwitchCost* cost, char* out, size_t out_len) {
+    struct timespec started;
+    char gaps[32], sizes[32], took[32], fit_took[32];
+    QueueFit fit;
+    size_t used;
+
+    clock_gettime(CLOCK_MONOTONIC, &started);
+    queue_fit(arrival, service, count, &fit);
+    format_duration(elapsed_seconds(&started), fit_took, sizeof(fit_took));
+    queue_family(fit.gap_scv, gaps, sizeof(gaps));
+    queue_family(fit.service_scv, sizes, sizeof(sizes));
+
+    used = snprintf(out, out_len,
+        "QUEUEING MODEL\n"
+        "==============\n\n"
+        "Processes: %d, arriving over %.0f time units\n",
+        count, fit.span);
+    if (fit.arrival_rate <= 0) {
+        snprintf(out + used, out_len - used,
+            "\nThe processes all arrive together, so there is no arrival process to fit.\n");
+        return;
+    }
+    used += snprintf(out + used, out_len - used,
+        "Arrivals: rate %.4f, gap SCV %.2f (%s)\n"
+        "Service: mean %.2f, SCV %.2f (%s)\n"
+        "Load: %.3f\n"
+        "Fit: %s\n\n",
+        fit.arrival_rate, fit.gap_scv, gaps, fit.mean_service, fit.service_scv, sizes, fit.load, fit_took);
+    if (fit.load >= 1) {
+        snprintf(out + used, out_len - used,
+            "The load is at least 1, so the queue grows for as long as processes keep\n"
+            "arriving and there is no steady state to estimate.\n");
+        return;
+    }
+
+    QueueEstimate estimates[4] = {
+        { FCFS, "M/G/1 Pollaczek-Khinchine" },
+        { FCFS, "GI/G/1 Kingman" },
+        { SRTF, "M/G/1 SRPT" },
+        { ROUND_ROBIN, "M/G/1 processor sharing" }
+    };
+    clock_gettime(CLOCK_MONOTONIC, &started);
+    estimates[0].waiting = estimate_pk(&fit);
+    estimates[0].seconds = elapsed_seconds(&started);
+    clock_gettime(CLOCK_MONOTONIC, &started);
+    estimates[1].waiting = estimate_kingman(&fit);
+    estimates[1].seconds = elapsed_seconds(&started);
+    clock_gettime(CLOCK_MONOTONIC, &started);
+    SimTime* sorted = malloc(count * sizeof(SimTime));
+    memcpy(sorted, service, count * sizeof(SimTime));
+    estimates[2].waiting = estimate_srpt(&fit, sorted, count);
+    free(sorted);
+    estimates[2].seconds = elapsed_seconds(&started);
+    clock_gettime(CLOCK_MONOTONIC, &started);
+    estimates[3].waiting = estimate_ps(&fit);
+    estimates[3].seconds = elapsed_seconds(&started);
+
+    clock_gettime(CLOCK_MONOTONIC, &started);
+    double theta = kingman_theta(arrival, service, count);
+    double tail_seconds = elapsed_seconds(&started);
+
+    // The simulations, one per policy the models cover
+    SchedulingAlgorithm simulated[3] = { FCFS, SRTF, ROUND_ROBIN };
+    double sim_waiting[3] = { 0, 0, 0 }, sim_seconds[3] = { 0, 0, 0 };
+    SimTime sim_p99 = 0;
+    if (procs) {
+        Process* copy = malloc(count * sizeof(Process));
+        SimTime* values = malloc(count * sizeof(SimTime));
+        for (int a = 0; a < 3; a++) {
+            Simulation sim;
+            memcpy(copy, procs, count * sizeof(Process));
+            clock_gettime(CLOCK_MONOTONIC, &started);
+            init_simulation(&sim, copy, count, quantum);
+            sim.record_gantt = 0;
+            sim.cost = *cost;
+            run_fast_scheduler(&sim, simulated[a]);
+            free_simulation(&sim);
+            sim_seconds[a] = elapsed_seconds(&started);
+
+            for (int i = 0; i < count; i++) {
+                sim_waiting[a] += copy[i].waiting_time;
+                values[i] = copy[i].waiting_time;
+            }
+            sim_waiting[a] /= count;
+            if (simulated[a] == FCFS) sim_p99 = nearest_rank(values, count, 0.99);
+        }
+        free(values);
+        free(copy);
+    }
+
+    used += snprintf(out + used, out_len - used, "%-6s %-26s %9s %9s %7s %11s %11s\n",
+        "Policy", "Model", "Avg WT", "Sim WT", "Error", "Model time", "Sim time");
+    for (int k = 0; k < 4 && used < out_len; k++) {
+        const QueueEstimate* e = &estimates[k];
+        int a = e->algo == FCFS ? 0 : e->algo == SRTF ? 1 : 2;
+        char error[16], sim_took[32];
+
+        format_duration(e->seconds, took, sizeof(took));
+        format_duration(sim_seconds[a], sim_took, sizeof(sim_took));
+        if (procs && sim_waiting[a] > 0) {
+            snprintf(error, sizeof(error), "%+.1f%%", 100 * (e->waiting - sim_waiting[a]) / sim_waiting[a]);
+        }
+        else snprintf(error, sizeof(error), "-");
+        if (procs) {
+            used += snprintf(out + used, out_len - used, "%-6s %-26s %9.2f %9.2f %7s %11s %11s\n",
+                algorithm_keys[e->algo - 1], e->model, e->waiting, sim_waiting[a], error, took, sim_took);
+        }
+        else {
+            used += snprintf(out + used, out_len - used, "%-6s %-26s %9.2f %9s %7s %11s %11s\n",
+                algorithm_keys[e->algo - 1], e->model, e->waiting, "-", error, took, "-");
+        }
+    }
+
+    if (used < out_len) {
+        format_duration(tail_seconds, took, sizeof(took));
+        if (theta > 0) {
+            used += snprintf(out + used, out_len - used,
+                "\nFCFS p99 waiting time: at most %.1f by Kingman's bound", log(100) / theta);
+        }
+        else {
+            used += snprintf(out + used, out_len - used,
+                "\nFCFS p99 waiting time: 0, as no process arrives before the one ahead of it ends");
+        }
+        if (procs && used < out_len) {
+            used += snprintf(out + used, out_len - used, " (simulated %lld)", (long long)sim_p99);
+        }
+        if (used < out_len) used += snprintf(out + used, out_len - used, ", %s\n", took);
+    }
+
+    if (used < out_len) {
+        used += snprintf(out + used, out_len - used,
+            "\nWaiting time is turnaround time less service time. The models assume one\n"
+            "CPU, free context switches and a steady state; Pollaczek-Khinchine also\n"
+            "assumes Poisson arrivals (gap SCV 1).\n");
+    }
+    if (procs && (cost->dispatch > 0 || cost->cache_penalty > 0) && used < out_len) {
+        used += snprintf(out + used, out_len - used,
+            "The simulations charge the switch cost; the models do not.\n");
+    }
+    if (procs && workload_has_io(procs, count) && used < out_len) {
+        used += snprintf(out + used, out_len - used,
+            "The models see each process's CPU demand only, not its I/O.\n");
+    }
+    if (count < 1000 && used < out_len) {
+        snprintf(out + used, out_len - used,
+            "With fewer than 1000 processes the fit is rough, and the workload may end\n"
+            "before the queue settles.\n");
+    }
+}
+
+// The estimates for a process table, in arrival order, beside simulations of
+// it when simulate is set
+void format_queueing_model(const Process* procs, int count, int quantum, const SwitchCost* cost,
+    int simulate, char* out, size_t out_len) {
+    SimTime* arrival = malloc((count ? count : 1) * sizeof(SimTime));
+    SimTime* service = malloc((count ? count : 1) * sizeof(SimTime));
+    SchedKey* order = malloc((count ? count : 1) * sizeof(SchedKey));
+
+    for (int i = 0; i < count; i++) {
+        order[i] = make_key(procs[i].arrival_time, i);
+    }
+    qsort(order, count, sizeof(SchedKey), compare_key);
+    for (int k = 0; k < count; k++) {
+        arrival[k] = procs[key_index(order[k])].arrival_time;
+        service[k] = procs[key_index(order[k])].burst_time;
+    }
+
+    format_queue_estimates(arrival, service, count, simulate ? procs : NULL, quantum, cost, out, out_len);
+
+    free(order);
+    free(service);
+    free(arrival);
+}
+
+// --estimate: the estimates for a workload file or a generated workload.
+// Without simulate, a generated workload is drawn one process at a time and
+// only its arrival and service times kept, so it can be far larger than one
+// that could be simulated.
+int run_estimate(const ReplicationConfig* config, const char* workload_path, int simulate) {
+    Process* procs = NULL;
+    int count;
+    char error[1200];
+    size_t out_len = 8192;
+    char* out = malloc(out_len);
+
+    if (workload_path) {
+        if (load_workload(workload_path, &procs, &count, NULL, NULL, error, sizeof(error)) != 0) {
+            fprintf(stderr, "%s\n", error);
+            free(out);
+            return 1;
+        }
+    }
+    else if (simulate) {
+        RngState rng;
+        count = config->jobs;
+        procs = malloc(count * sizeof(Process));
+        rng_seed(&rng, config->seed, 0);
+        generate_workload(procs, count, &rng, config);
+    }
+
+    if (procs) {
+        format_queueing_model(procs, count, config->time_quantum, &config->cost, simulate, out, out_len);
+    }
+    else {
+        // Generated processes arrive in order
+        RngState rng;
+        Process p;
+        double clock = 0.0;
+        count = config->jobs;
+        SimTime* arrival = malloc(count * sizeof(SimTime));
+        SimTime* service = malloc(count * sizeof(SimTime));
+        rng_seed(&rng, config->seed, 0);
+        for (int i = 0; i < count; i++) {
+            generate_process(&p, i, &clock, &rng, config);
+            arrival[i] = p.arrival_time;
+            service[i] = p.burst_time;
+        }
+        format_queue_estimates(arrival, service, count, NULL, config->time_quantum, &config->cost, out, out_len);
+        free(service);
+        free(arrival);
+    }
+    fputs(out, stdout);
+
+    free(procs);
+    free(out);
+    return 0;
+}
+
+// Result cache
+
+void snapshot_workload(const Process* procs, int count, WorkloadEntry* out) {
+    // Zero first so padding and bytes after the name's terminator hash consistently
+    memset(out, 0, count * sizeof(WorkloadEntry));
+    for (int i = 0; i < count; i++) {
+        memcpy(out[i].name, procs[i].name, strnlen(procs[i].name, MAX_NAME_LEN - 1));
+        out[i].arrival_time = procs[i].arrival_time;
+        out[i].burst_time = procs[i].burst_time;
+        out[i].priority = procs[i].priority;
+        out[i].weight = procs[i].weight;
+        out[i].color = procs[i].color;
+    }
+}
+
+// Word-at-a-time multiply/rotate hash over the snapshot bytes
+uint64_t hash_workload(const WorkloadEntry* input, int count) {
+    const unsigned char* bytes = (const unsigned char*)input;
+    size_t len = count * sizeof(WorkloadEntry);
+    uint64_t h = 0x84222325CBF29CE4ULL ^ len;
+    size_t i = 0;
+
+    for (; i + 8 <= len; i += 8) {
+        uint64_t word;
+        memcpy(&word, bytes + i, 8);
+        h ^= word * 0x9E3779B97F4A7C15ULL;
+        h = ((h << 31) | (h >> 33)) * 0xBF58476D1CE4E5B9ULL;
+    }
+    for (; i < len; i++) {
+        h = (h ^ bytes[i]) * 0x100000001B3ULL;
+    }
+
+    return splitmix64(&h);
+}
+
+void cache_unlink(ResultCache* cache, CacheEntry* entry) {
+    if (entry->lru_prev) entry->lru_prev->lru_next = entry->lru_next;
+    else cache->lru_head = entry->lru_next;
+    if (entry->lru_next) entry->lru_next->lru_prev = entry->lru_prev;
+    else cache->lru_tail = entry->lru_prev;
+    entry->lru_prev = entry->lru_next = NULL;
+}
+
+void cache_push_front(ResultCache* cache, CacheEntry* entry) {
+    entry->lru_prev = NULL;
+    entry->lru_next = cache->lru_head;
+    if (cache->lru_head) cache->lru_head->lru_prev = entry;
+    cache->lru_head = entry;
+    if (!cache->lru_tail) cache->lru_tail = entry;
+}
+
+void cache_free_entry(CacheEntry* entry) {
+    free(entry->input);
+    free(entry->processes);
+    free(entry->gantt);
+    free(entry);
+}
+
+CacheEntry* cache_lookup(ResultCache* cache, const WorkloadEntry* input, int count,
+    SchedulingAlgorithm algo, int quantum, const SwitchCost* cost, int aging) {
+    uint64_t hash = hash_workload(input, count);
+
+    for (CacheEntry* e = cache->buckets[hash % RESULT_CACHE_BUCKETS]; e; e = e->bucket_next) {
+        if (e->hash == hash && e->algo == algo && e->time_quantum == quantum &&
+            memcmp(&e->cost, cost, sizeof(SwitchCost)) == 0 && e->aging_interval == aging && e->process_count == count &&
+            memcmp(e->input, input, count * sizeof(WorkloadEntry)) == 0) {
+            cache_unlink(cache, e);
+            cache_push_front(cache, e);
+            cache->hits++;
+            return e;
+        }
+    }
+
+    cache->misses++;
+    return NULL;
+}
+
+void cache_remove(ResultCache* cache, CacheEntry* entry) {
+    CacheEntry** link = &cache->buckets[entry->hash % RESULT_CACHE_BUCKETS];
+    while (*link != entry) {
+        link = &(*link)->bucket_next;
+    }
+    *link = entry->bucket_next;
+
+    cache_unlink(cache, entry);
+    cache->bytes -= entry->bytes;
+    cache->entries--;
+    cache_free_entry(entry);
+}
+
+// Adds a finished run, evicting least recently used entries to stay in budget
+void cache_store(ResultCache* cache, const WorkloadEntry* input, SchedulingAlgorithm algo,
+    int quantum, const Simulation* sim) {
+    int count = sim->process_count;
+    size_t bytes = sizeof(CacheEntry) + count * (sizeof(WorkloadEntry) + sizeof(Process)) +
+        sim->gantt_count * sizeof(GanttBlock);
+
+    if (bytes > cache->budget) return;
+
+    while (cache->bytes + bytes > cache->budget && cache->lru_tail) {
+        cache_remove(cache, cache->lru_tail);
+        cache->evictions++;
+    }
+
+    CacheEntry* entry = calloc(1, sizeof(CacheEntry));
+    entry->hash = hash_workload(input, count);
+    entry->algo = algo;
+    entry->time_quantum = quantum;
+    entry->cost = sim->cost;
+    entry->aging_interval = sim->aging_interval;
+    entry->switches = sim->switches;
+    entry->overhead_time = sim->overhead_time;
+    entry->process_count = count;
+    entry->gantt_count = sim->gantt_count;
+    entry->bytes = bytes;
+    entry->input = malloc(count * sizeof(WorkloadEntry) + 1);
+    entry->processes = malloc(count * sizeof(Process) + 1);
+    entry->gantt = malloc(sim->gantt_count * sizeof(GanttBlock) + 1);
+    memcpy(entry->input, input, count * sizeof(WorkloadEntry));
+    memcpy(entry->processes, sim->processes, count * sizeof(Process));
+    memcpy(entry->gantt, sim->gantt, sim->gantt_count * sizeof(GanttBlock));
+
+    CacheEntry** bucket = &cache->buckets[entry->hash % RESULT_CACHE_BUCKETS];
+    entry->bucket_next = *bucket;
+    *bucket = entry;
+    cache_push_front(cache, entry);
+    cache->bytes += bytes;
+    cache->entries++;
+}
+
+void cache_clear(ResultCache* cache) {
+    while (cache->lru_tail) {
+        cache_remove(cache, cache->lru_tail);
+    }
+}
+
+// File layout: magic, the struct sizes it was written with, then entries from
+// least to most recently used so loading them in order rebuilds the LRU list.
+int cache_save(const ResultCache* cache, const char* path) {
+    FILE* file = fopen(path, "wb");
+    if (!file) return -1;
+
+    uint32_t sizes[3] = { sizeof(WorkloadEntry), sizeof(Process), sizeof(GanttBlock) };
+    fwrite(RESULT_CACHE_MAGIC, 1, 8, file);
+    fwrite(sizes, sizeof(sizes), 1, file);
+
+    for (const CacheEntry* e = cache->lru_tail; e; e = e->lru_prev) {
+        int64_t header[10] = { e->algo, e->time_quantum, e->process_count, e->gantt_count,
+            e->cost.dispatch, e->cost.cache_penalty, e->cost.cache_decay, e->switches, e->overhead_time,
+            e->aging_interval };
+        fwrite(header, sizeof(header), 1, file);
+        fwrite(e->input, sizeof(WorkloadEntry), e->process_count, file);
+        fwrite(e->processes, sizeof(Process), e->process_count, file);
+        fwrite(e->gantt, sizeof(GanttBlock), e->gantt_count, file);
+    }
+
+    return fclose(file) == 0 ? 0 : -1;
+}
+
+int cache_load(ResultCache* cache, const char* path) {
+    FILE* file = fopen(path, "rb");
+    if (!file) return -1;
+
+    char magic[8];
+    uint32_t sizes[3];
+    if (fread(magic, 1, 8, file) != 8 || memcmp(magic, RESULT_CACHE_MAGIC, 8) != 0 ||
+        fread(sizes, sizeof(sizes), 1, file) != 1 ||
+        sizes[0] != sizeof(WorkloadEntry) || sizes[1] != sizeof(Process) || sizes[2] != sizeof(GanttBlock)) {
+        fclose(file);
+        return -1;
+    }
+
+    int64_t header[10];
+    int loaded = 0;
+    while (fread(header, sizeof(header), 1, file) == 1) {
+        if (header[2] < 0 || header[2] > MAX_PROCESSES || header[3] < 0 || header[3] > INT_MAX) break;
+
+        Simulation sim;
+        WorkloadEntry* input = malloc(header[2] * sizeof(WorkloadEntry) + 1);
+        Process* procs = malloc(header[2] * sizeof(Process) + 1);
+        init_simulation(&sim, procs, header[2], header[1]);
+        sim.gantt = malloc(header[3] * sizeof(GanttBlock) + 1);
+        sim.gantt_count = sim.gantt_capacity = header[3];
+        sim.cost = (SwitchCost){ header[4], header[5], header[6] };
+        sim.switches = header[7];
+        sim.overhead_time = header[8];
+        sim.aging_interval = header[9];
+
+        int complete = fread(input, sizeof(WorkloadEntry), header[2], file) == (size_t)header[2] &&
+            fread(procs, sizeof(Process), header[2], file) == (size_t)header[2] &&
+            fread(sim.gantt, sizeof(GanttBlock), header[3], file) == (size_t)header[3];
+        if (complete) {
+            cache_store(cache, input, header[0], header[1], &sim);
+            loaded++;
+        }
+
+        free_simulation(&sim);
+        free(procs);
+        free(input);
+        if (!complete) break;
+    }
+
+    fclose(file);
+    return loaded;
+}
+
+void result_cache_path(char* out, size_t out_len) {
+    const char* xdg = getenv("XDG_CACHE_HOME");
+    const char* home = getenv("HOME");
+
+    if (xdg && *xdg) {
+        snprintf(out, out_len, "%s/cpu_scheduler_results.bin", xdg);
+    }
+    else {
+        snprintf(out, out_len, "%s/.cache/cpu_scheduler_results.bin", home ? home : ".");
+    }
+}
+
+void copy_gantt(Simulation* sim, const GanttBlock* blocks, int count) {
+    if (count > sim->gantt_capacity) {
+        sim->gantt_capacity = count;
+        sim->gantt = realloc(sim->gantt, count * sizeof(GanttBlock));
+    }
+    memcpy(sim->gantt, blocks, count * sizeof(GanttBlock));
+    sim->gantt_count = count;
+}
+
+// Only what a run computes; the inputs and id stay the table's own
+void copy_process_results(Process* dst, const Process* src) {
+    dst->remaining_time = src->remaining_time;
+    dst->start_time = src->start_time;
+    dst->completion_time = src->completion_time;
+    dst->waiting_time = src->waiting_time;
+    dst->turnaround_time = src->turnaround_time;
+    dst->response_time = src->response_time;
+    dst->last_run_end = src->last_run_end;
+}
+
+// Playback timeline
+//
+// A finished run is turned into a time-ordered list of arrive/run/preempt/
+// complete events. Replaying events reconstructs the ready set and running
+// totals at any time. Snapshots of that state are taken along the way, spaced
+// so that each one is paid for by at least as many events as it stores ready
+// entries; seeking restores the latest snapshot at or before the target with a
+// binary search and replays the few events after it.
+
+int compare_playback_events(const void* a, const void* b) {
+    const PlaybackEvent* x = a;
+    const PlaybackEvent* y = b;
+
+    if (x->time != y->time) return (x->time > y->time) - (x->time < y->time);
+    if (x->kind != y->kind) return x->kind - y->kind;
+    return x->index - y->index;
+}
+
+void playback_ready_add(PlaybackTimeline* tl, int index) {
+    if (tl->ready_pos[index] >= 0) return;
+    tl->ready_pos[index] = tl->ready_count;
+    tl->ready[tl->ready_count++] = index;
+}
+
+void playback_ready_remove(PlaybackTimeline* tl, int index) {
+    int pos = tl->ready_pos[index];
+    if (pos < 0) return;
+
+    int last = tl->ready[--tl->ready_count];
+    tl->ready[pos] = last;
+    tl->ready_pos[last] = pos;
+    tl->ready_pos[index] = -1;
+}
+
+void playback_apply_event(PlaybackTimeline* tl, const PlaybackEvent* e) {
+    const Process* p = &tl->processes[e->index];
+
+    switch (e->kind) {
+    case EVENT_ARRIVE:
+        playback_ready_add(tl, e->index);
+        break;
+    case EVENT_RUN:
+        playback_ready_remove(tl, e->index);
+        tl->running = e->index;
+        tl->running_since = e->time;
+        break;
+    case EVENT_PREEMPT:
+        tl->busy_time += e->time - tl->running_since;
+        tl->running = -1;
+        playback_ready_add(tl, e->index);
+        break;
+    case EVENT_COMPLETE:
+        if (tl->running == e->index) {
+            tl->busy_time += e->time - tl->running_since;
+            tl->running = -1;
+        }
+        playback_ready_remove(tl, e->index);
+        tl->completed++;
+        tl->total_tat += p->turnaround_time;
+        tl->total_wt += p->waiting_time;
+        break;
+    }
+}
+
+void playback_take_snapshot(PlaybackTimeline* tl) {
+    if (tl->snapshot_count == tl->snapshot_capacity) {
+        tl->snapshot_capacity = tl->snapshot_capacity ? tl->snapshot_capacity * 2 : 64;
+        tl->snapshots = realloc(tl->snapshots, tl->snapshot_capacity * sizeof(PlaybackSnapshot));
+    }
+    if (tl->ready_pool_size + tl->ready_count > tl->ready_pool_capacity) {
+        while (tl->ready_pool_size + tl->ready_count > tl->ready_pool_capacity) {
+            tl->ready_pool_capacity = tl->ready_pool_capacity ? tl->ready_pool_capacity * 2 : 1024;
+        }
+        tl->ready_pool = realloc(tl->ready_pool, tl->ready_pool_capacity * sizeof(int));
+    }
+
+    PlaybackSnapshot* snap = &tl->snapshots[tl->snapshot_count++];
+    snap->time = tl->event_pos > 0 ? tl->events[tl->event_pos - 1].time : INT_MIN;
+    snap->event_pos = tl->event_pos;
+    snap->running = tl->running;
+    snap->running_since = tl->running_since;
+    snap->completed = tl->completed;
+    snap->total_tat = tl->total_tat;
+    snap->total_wt = tl->total_wt;
+    snap->busy_time = tl->busy_time;
+    snap->ready_offset = tl->ready_pool_size;
+    snap->ready_count = tl->ready_count;
+    if (tl->ready_count > 0) {
+        memcpy(tl->ready_pool + tl->ready_pool_size, tl->ready, tl->ready_count * sizeof(int));
+        tl->ready_pool_size += tl->ready_count;
+    }
+}
+
+void playback_restore_snapshot(PlaybackTimeline* tl, const PlaybackSnapshot* snap) {
+    for (int k = 0; k < tl->ready_count; k++) {
+        tl->ready_pos[tl->ready[k]] = -1;
+    }
+    tl->ready_count = 0;
+    for (int k = 0; k < snap->ready_count; k++) {
+        playback_ready_add(tl, tl->ready_pool[snap->ready_offset + k]);
+    }
+
+    tl->event_pos = snap->event_pos;
+    tl->running = snap->running;
+    tl->running_since = snap->running_since;
+    tl->completed = snap->completed;
+    tl->total_tat = snap->total_tat;
+    tl->total_wt = snap->total_wt;
+    tl->busy_time = snap->busy_time;
+}
+
+void playback_free(PlaybackTimeline* tl) {
+    free(tl->events);
+    free(tl->snapshots);
+    free(tl->ready_pool);
+    free(tl->ready);
+    free(tl->ready_pos);
+    memset(tl, 0, sizeof(*tl));
+}
+
+void build_playback_timeline(PlaybackTimeline* tl, const Process* procs, int count,
+    const GanttBlock* gantt, int gantt_count) {
+    playback_free(tl);
+    tl->processes = procs;
+    tl->process_count = count;
+    tl->events = malloc((2 * count + 2 * gantt_count + 1) * sizeof(PlaybackEvent));
+
+    for (int i = 0; i < count; i++) {
+        // A zero-length job that never waited never enters the ready set
+        if (procs[i].arrival_time < procs[i].completion_time) {
+            tl->events[tl->event_count++] = (PlaybackEvent){ procs[i].arrival_time, EVENT_ARRIVE, i };
+        }
+        tl->events[tl->event_count++] = (PlaybackEvent){ procs[i].completion_time, EVENT_COMPLETE, i };
+        if (procs[i].completion_time > tl->end_time) tl->end_time = procs[i].completion_time;
+    }
+    for (int b = 0; b < gantt_count; b++) {
+        const GanttBlock* block = &gantt[b];
+        if (block->end_time <= block->start_time) continue;
+
+        tl->events[tl->event_count++] = (PlaybackEvent){ block->start_time, EVENT_RUN, block->process_index };
+        if (block->end_time != procs[block->process_index].completion_time) {
+            tl->events[tl->event_count++] = (PlaybackEvent){ block->end_time, EVENT_PREEMPT, block->process_index };
+        }
+    }
+    qsort(tl->events, tl->event_count, sizeof(PlaybackEvent), compare_playback_events);
+
+    tl->ready = malloc((count + 1) * sizeof(int));
+    tl->ready_pos = malloc((count + 1) * sizeof(int));
+    for (int i = 0; i < count; i++) {
+        tl->ready_pos[i] = -1;
+    }
+    tl->running = -1;
+
+    // One pass over the whole run, snapshotting as we go
+    int since_snapshot = 0;
+    playback_take_snapshot(tl);
+    while (tl->event_pos < tl->event_count) {
+        playback_apply_event(tl, &tl->events[tl->event_pos++]);
+        since_snapshot++;
+        if (since_snapshot >= PLAYBACK_MIN_INTERVAL && since_snapshot >= tl->ready_count) {
+            playback_take_snapshot(tl);
+            since_snapshot = 0;
+        }
+    }
+
+    playback_restore_snapshot(tl, &tl->snapshots[0]);
+    playback_advance(tl, 0, LONG_MAX);
+}
+
+// Applies events with time <= target, at most max_events of them unless more
+// share the time of the last one applied. Returns 1 once target is reached.
+int playback_advance(PlaybackTimeline* tl, SimTime target, long max_events) {
+    long applied = 0;
+
+    while (tl->event_pos < tl->event_count && tl->events[tl->event_pos].time <= target) {
+        if (applied >= max_events && tl->events[tl->event_pos].time != tl->events[tl->event_pos - 1].time) {
+            tl->time = tl->events[tl->event_pos - 1].time;
+            return 0;
+        }
+        playback_apply_event(tl, &tl->events[tl->event_pos++]);
+        applied++;
+    }
+
+    tl->time = target;
+    return 1;
+}
+
+void playback_seek(PlaybackTimeline* tl, SimTime target) {
+    if (!tl->events) return;
+
+    // Latest snapshot at or before the target
+    int lo = 0, hi = tl->snapshot_count - 1;
+    while (lo < hi) {
+        int mid = (lo + hi + 1) / 2;
+        if (tl->snapshots[mid].time <= target) lo = mid;
+        else hi = mid - 1;
+    }
+
+    // Replaying forward from the current position is cheaper when it is later
+    // than that snapshot and not past the target
+    int forward = target >= tl->time && tl->event_pos >= tl->snapshots[lo].event_pos;
+    if (!forward) {
+        playback_restore_snapshot(tl, &tl->snapshots[lo]);
+    }
+    playback_advance(tl, target, LONG_MAX);
+}
+
+// Time of the next event after the cursor, or the end of the run
+SimTime playback_next_event_time(const PlaybackTimeline* tl) {
+    for (int pos = tl->event_pos; pos < tl->event_count; pos++) {
+        if (tl->events[pos].time > tl->time) return tl->events[pos].time;
+    }
+    return tl->end_time;
+}
+
+void format_playback_state(const PlaybackTimeline* tl, char* out, size_t out_len) {
+    long busy = tl->busy_time + (tl->running >= 0 ? tl->time - tl->running_since : 0);
+    size_t used = snprintf(out, out_len, "t = %lld / %lld    Running: %s    Ready (%d):",
+        (long long)tl->time, (long long)tl->end_time, tl->running >= 0 ? tl->processes[tl->running].name : "idle",
+        tl->ready_count);
+
+    // Show a bounded slice of the ready set in table order
+    int shown[PLAYBACK_READY_SHOWN];
+    int shown_count = tl->ready_count < PLAYBACK_READY_SHOWN ? tl->ready_count : PLAYBACK_READY_SHOWN;
+    memcpy(shown, tl->ready, shown_count * sizeof(int));
+    qsort(shown, shown_count, sizeof(int), compare_int);
+    for (int k = 0; k < shown_count && used < out_len; k++) {
+        used += snprintf(out + used, out_len - used, " %s", tl->processes[shown[k]].name);
+    }
+    if (tl->ready_count > shown_count && used < out_len) {
+        used += snprintf(out + used, out_len - used, " ... +%d more", tl->ready_count - shown_count);
+    }
+
+    if (used < out_len) {
+        snprintf(out + used, out_len - used,
+            "\nCompleted: %d / %d    Avg Turnaround: %.2f    Avg Waiting: %.2f    "
+            "CPU Utilization: %.1f%%    Throughput: %.3f per unit",
+            tl->completed, tl->process_count,
+            tl->completed ? tl->total_tat / tl->completed : 0.0,
+            tl->completed ? tl->total_wt / tl->completed : 0.0,
+            tl->time > 0 ? 100.0 * busy / tl->time : 0.0,
+            tl->time > 0 ? (double)tl->completed / tl->time : 0.0);
+    }
+}
+
+// Trace import
+//
+// Real scheduler traces are turned into the workload model one line at a time.
+// A job starts when a task wakes up (or first runs) and ends when it is switched
+// out in any state other than runnable; its burst is the CPU time it got on
+// the replayed CPU in between. The recorded run slices are kept as a Gantt
+// chart next to the simulated one.
+
+int trace_parse_timestamp(const char* text, int64_t* out_us) {
+    char* end;
+    long long seconds = strtoll(text, &end, 10);
+    if (end == text || *end != '.') return 0;
+
+    // Microseconds from the first six fraction digits, padding shorter ones
+    int64_t micros = 0;
+    int digits = 0;
+    const char* p = end + 1;
+    while (*p >= '0' && *p <= '9') {
+        if (digits < 6) {
+            micros = micros * 10 + (*p - '0');
+            digits++;
+        }
+        p++;
+    }
+    if (p == end + 1) return 0;
+    while (digits < 6) {
+        micros *= 10;
+        digits++;
+    }
+
+    *out_us = seconds * 1000000LL + micros;
+    return 1;
+}
+
+int trace_find_task(TraceReplay* tr, int pid, const char* comm) {
+    if (tr->task_count * 2 >= tr->slot_capacity) {
+        int capacity = tr->slot_capacity ? tr->slot_capacity * 2 : 1024;
+        int* slots = malloc(capacity * sizeof(int));
+        for (int i = 0; i < capacity; i++) {
+            slots[i] = -1;
+        }
+        for (int t = 0; t < tr->task_count; t++) {
+            unsigned h = (unsigned)tr->tasks[t].pid * 2654435761u & (capacity - 1);
+            while (slots[h] >= 0) h = (h + 1) & (capacity - 1);
+            slots[h] = t;
+        }
+        free(tr->task_slots);
+        tr->task_slots = slots;
+        tr->slot_capacity = capacity;
+    }
+
+    unsigned h = (unsigned)pid * 2654435761u & (tr->slot_capacity - 1);
+    while (tr->task_slots[h] >= 0) {
+        if (tr->tasks[tr->task_slots[h]].pid == pid) return tr->task_slots[h];
+        h = (h + 1) & (tr->slot_capacity - 1);
+    }
+
+    if (tr->task_count == tr->task_capacity) {
+        tr->task_capacity = tr->task_capacity ? tr->task_capacity * 2 : 256;
+        tr->tasks = realloc(tr->tasks, tr->task_capacity * sizeof(TraceTask));
+    }
+
+    TraceTask* task = &tr->tasks[tr->task_count];
+    memset(task, 0, sizeof(*task));
+    task->pid = pid;
+    strncpy(task->comm, comm, MAX_NAME_LEN - 1);
+    task->priority = trace_priority(120);
+    task->job = -1;
+    task->wakeup_us = -1;
+    task->run_start_us = -1;
+
+    tr->task_slots[h] = tr->task_count;
+    return tr->task_count++;
+}
+
+// Kernel priority (0-99 real-time, 100-139 for nice -20..19) to the
+// simulator's scale, where lower numbers run first
+int trace_priority(int kernel_prio) {
+    if (kernel_prio < 100) return 1;
+    int priority = kernel_prio - 120 + 21;
+    if (priority < 1) priority = 1;
+    if (priority > 40) priority = 40;
+    return priority;
+}
+
+SimTime trace_ticks(const TraceReplay* tr, int64_t us) {
+    return (us - tr->base_us) * 1000 / tr->tick_ns;
+}
+
+// Returns 0 once the job limit is reached
+int trace_open_job(TraceReplay* tr, int task, int64_t arrival_us, int64_t run_us) {
+    if (tr->job_count >= tr->config.max_jobs) {
+        tr->truncated = 1;
+        return 0;
+    }
+    if (tr->job_count == tr->job_capacity) {
+        tr->job_capacity = tr->job_capacity ? tr->job_capacity * 2 : 1024;
+        tr->jobs = realloc(tr->jobs, tr->job_capacity * sizeof(TraceJob));
+    }
+
+    TraceJob* job = &tr->jobs[tr->job_count];
+    job->task = task;
+    job->arrival_us = arrival_us < tr->base_us ? tr->base_us : arrival_us;
+    job->first_run_us = run_us < job->arrival_us ? job->arrival_us : run_us;
+    job->end_us = job->first_run_us;
+    job->run_us = 0;
+
+    tr->tasks[task].job = tr->job_count++;
+    tr->tasks[task].wakeup_us = -1;
+    return 1;
+}
+
+void trace_add_slice(TraceReplay* tr, int task, int64_t start_us, int64_t end_us) {
+    TraceTask* t = &tr->tasks[task];
+    if (t->job < 0 || end_us <= start_us) return;
+
+    TraceJob* job = &tr->jobs[t->job];
+    job->run_us += end_us - start_us;
+    job->end_us = end_us;
+
+    SimTime start = trace_ticks(tr, start_us);
+    SimTime end = trace_ticks(tr, end_us);
+    if (end <= start) return;
+
+    // Back-to-back slices of the same job draw as one block
+    if (tr->recorded_count > 0) {
+        GanttBlock* last = &tr->recorded[tr->recorded_count - 1];
+        if (last->process_index == t->job && last->end_time == start) {
+            last->end_time = end;
+            return;
+        }
+    }
+
+    if (tr->recorded_spill) gantt_spill_chunk(tr->recorded_spill, tr->recorded, &tr->recorded_count);
+    if (tr->recorded_count == tr->recorded_capacity) {
+        tr->recorded_capacity = tr->recorded_capacity ? tr->recorded_capacity * 2 : 1024;
+        tr->recorded = realloc(tr->recorded, tr->recorded_capacity * sizeof(GanttBlock));
+    }
+
+    GanttBlock* block = &tr->recorded[tr->recorded_count++];
+    strcpy(block->process_name, t->comm);
+    block->start_time = start;
+    block->end_time = end;
+    block->process_index = t->job;
+    block->color = process_colors[task % 10];
+}
+
+void trace_close_job(TraceReplay* tr, int task) {
+    tr->tasks[task].job = -1;
+    tr->tasks[task].run_start_us = -1;
+}
+
+// Events before the configured start are skipped; the first one kept fixes time 0
+int trace_accept_time(TraceReplay* tr, int64_t t_us) {
+    if (t_us < (int64_t)(tr->config.start * 1e6)) return 0;
+    if (tr->base_us < 0) tr->base_us = t_us;
+    if (t_us > tr->last_us) tr->last_us = t_us;
+    return 1;
+}
+
+// Copies the value of "key=" (a whole word) up to the next space
+int trace_field(const char* line, const char* key, char* out, size_t out_len) {
+    size_t key_len = strlen(key);
+    const char* p = line;
+
+    while ((p = strstr(p, key)) != NULL) {
+        if ((p == line || p[-1] == ' ') && p[key_len] == '=') {
+            p += key_len + 1;
+            size_t n = 0;
+            while (p[n] && p[n] != ' ' && p[n] != '\n' && n + 1 < out_len) {
+                out[n] = p[n];
+                n++;
+            }
+            out[n] = '\0';
+            return 1;
+        }
+        p += key_len;
+    }
+    return 0;
+}
+
+// "  79371.874569 [0011]  gcc[31949]   0.014   0.000   1.148  [S]"
+// Each line is one run slice ending at the timestamp: wait time, scheduling
+// delay (wakeup to run) and run time are in milliseconds. With --state the
+// last column is the state the task was switched out in.
+int parse_perf_timehist_line(TraceReplay* tr, const char* line) {
+    int64_t t_us;
+    while (*line == ' ') line++;
+    if (!trace_parse_timestamp(line, &t_us)) return 1;
+
+    const char* p = strchr(line, '[');
+    if (!p) return 1;
+    int cpu = atoi(p + 1);
+    p = strchr(p, ']');
+    if (!p) return 1;
+    p++;
+    while (*p == ' ') p++;
+
+    // Task is "comm[tid]" or "comm[tid/pid]"; comm may itself contain brackets
+    const char* close = p;
+    while ((close = strchr(close, ']')) != NULL && close[1] != ' ' && close[1] != '\0' && close[1] != '\n') {
+        close++;
+    }
+    if (!close) return 1;
+    const char* open = close;
+    while (open > p && *open != '[') open--;
+    if (*open != '[') return 1;
+
+    int pid = atoi(open + 1);
+    char comm[MAX_NAME_LEN];
+    size_t comm_len = open - p < MAX_NAME_LEN - 1 ? (size_t)(open - p) : MAX_NAME_LEN - 1;
+    memcpy(comm, p, comm_len);
+    comm[comm_len] = '\0';
+
+    char* end;
+    double columns[3];
+    p = close + 1;
+    for (int c = 0; c < 3; c++) {
+        columns[c] = strtod(p, &end);
+        if (end == p) return 1;     // wakeup and migration lines carry no times
+        p = end;
+    }
+    while (*p == ' ') p++;
+    char state = (*p >= 'A' && *p <= 'Z') ? *p : 0;
+    if (state) tr->has_state = 1;
+
+    if (pid == 0) return 1;         // idle
+    if (tr->cpu < 0) tr->cpu = cpu;
+
+    int64_t run_us = (int64_t)llround(columns[2] * 1000);
+    int64_t delay_us = (int64_t)llround(columns[1] * 1000);
+    int64_t start_us = t_us - run_us;
+
+    if (cpu != tr->cpu) {
+        // Blocking elsewhere still ends the task's job here
+        int task = trace_find_task(tr, pid, comm);
+        if (state && state != 'R' && tr->tasks[task].job >= 0) trace_close_job(tr, task);
+        return 1;
+    }
+    if (!trace_accept_time(tr, start_us - delay_us)) return 1;
+    if (t_us > tr->last_us) tr->last_us = t_us;
+
+    int task = trace_find_task(tr, pid, comm);
+    // Without states, a run that had to wait for a wakeup begins a new job
+    if (tr->tasks[task].job >= 0 && !tr->has_state && delay_us > 0) {
+        trace_close_job(tr, task);
+    }
+    if (tr->tasks[task].job < 0 && !trace_open_job(tr, task, start_us - delay_us, start_us)) {
+        return 0;
+    }
+
+    trace_add_slice(tr, task, start_us, t_us);
+    if (state && state != 'R') trace_close_job(tr, task);
+    return gantt_log_length(tr->recorded_spill, tr->recorded_count) < (long)TRACE_SLICES_PER_JOB * tr->config.max_jobs;
+}
+
+// "  bash-1234  [001] d..3  1234.567900: sched_switch: prev_comm=bash prev_pid=1234
+//    prev_prio=120 prev_state=S ==> next_comm=swapper/1 next_pid=0 next_prio=120"
+int parse_ftrace_line(TraceReplay* tr, const char* line) {
+    const char* event = strstr(line, ": sched_switch:");
+    int is_switch = event != NULL;
+    if (!event) event = strstr(line, ": sched_wakeup:");
+    if (!event) event = strstr(line, ": sched_wakeup_new:");
+    if (!event) return 1;
+
+    // Timestamp ends right before the event name
+    const char* stamp = event;
+    while (stamp > line && (stamp[-1] == '.' || (stamp[-1] >= '0' && stamp[-1] <= '9'))) stamp--;
+    int64_t t_us;
+    if (!trace_parse_timestamp(stamp, &t_us)) return 1;
+
+    // CPU is the first "[nnn]" on the line
+    int cpu = -1;
+    for (const char* b = strchr(line, '['); b && b < stamp; b = strchr(b + 1, '[')) {
+        char* end;
+        long value = strtol(b + 1, &end, 10);
+        if (end > b + 1 && *end == ']') {
+            cpu = (int)value;
+            break;
+        }
+    }
+    if (cpu < 0) return 1;
+
+    char comm[64], value[32];
+    if (!is_switch) {
+        if (!trace_field(event, "pid", value, sizeof(value)) || !trace_accept_time(tr, t_us)) return 1;
+        int pid = atoi(value);
+        if (pid == 0) return 1;
+        if (!trace_field(event, "comm", comm, sizeof(comm))) strcpy(comm, "?");
+
+        int task = trace_find_task(tr, pid, comm);
+        if (trace_field(event, "prio", value, sizeof(value))) {
+            tr->tasks[task].priority = trace_priority(atoi(value));
+        }
+        if (tr->tasks[task].job < 0 && tr->tasks[task].wakeup_us < 0) {
+            tr->tasks[task].wakeup_us = t_us;
+        }
+        return 1;
+    }
+
+    char state[8];
+    if (!trace_field(event, "prev_pid", value, sizeof(value))) return 1;
+    int prev_pid = atoi(value);
+    if (!trace_field(event, "prev_state", state, sizeof(state))) strcpy(state, "R");
+    int blocked = state[0] != 'R';
+
+    if (tr->cpu < 0) tr->cpu = cpu;
+    if (cpu != tr->cpu) {
+        if (prev_pid != 0 && blocked) {
+            trace_field(event, "prev_comm", comm, sizeof(comm));
+            int task = trace_find_task(tr, prev_pid, comm);
+            if (tr->tasks[task].job >= 0 && tr->tasks[task].run_start_us < 0) trace_close_job(tr, task);
+        }
+        return 1;
+    }
+    if (!trace_accept_time(tr, t_us)) return 1;
+
+    if (prev_pid != 0) {
+        if (!trace_field(event, "prev_comm", comm, sizeof(comm))) strcpy(comm, "?");
+        int task = trace_find_task(tr, prev_pid, comm);
+        if (tr->tasks[task].run_start_us >= 0) {
+            trace_add_slice(tr, task, tr->tasks[task].run_start_us, t_us);
+            tr->tasks[task].run_start_us = -1;
+        }
+        if (blocked) trace_close_job(tr, task);
+    }
+
+    if (!trace_field(event, "next_pid", value, sizeof(value))) return 1;
+    int next_pid = atoi(value);
+    if (next_pid != 0) {
+        if (!trace_field(event, "next_comm", comm, sizeof(comm))) strcpy(comm, "?");
+        int task = trace_find_task(tr, next_pid, comm);
+        if (trace_field(event, "next_prio", value, sizeof(value))) {
+            tr->tasks[task].priority = trace_priority(atoi(value));
+        }
+        if (tr->tasks[task].job < 0) {
+            int64_t arrival = tr->tasks[task].wakeup_us >= 0 ? tr->tasks[task].wakeup_us : t_us;
+            if (!trace_open_job(tr, task, arrival, t_us)) return 0;
+        }
+        tr->tasks[task].run_start_us = t_us;
+    }
+
+    return gantt_log_length(tr->recorded_spill, tr->recorded_count) < (long)TRACE_SLICES_PER_JOB * tr->config.max_jobs;
+}
+
+int import_trace(TraceReplay* tr, const char* path, const TraceConfig* config, char* error, size_t error_len) {
+    FILE* file = fopen(path, "r");
+    if (!file) {
+        snprintf(error, error_len, "Cannot open %s", path);
+        return -1;
+    }
+
+    trace_replay_free(tr);
+    tr->recorded_spill = gantt_spill_create();
+    tr->config = *config;
+    if (tr->config.tick_us < 1) tr->config.tick_us = 1;
+    // Real time units are the tick; the trace's microseconds become ticks
+    // of a nanosecond exactly
+    tr->tick_ns = time_unit == TIME_UNIT_NONE ? tr->config.tick_us * 1000LL : time_unit_ns[time_unit];
+    if (tr->config.max_jobs < 1) tr->config.max_jobs = 1;
+    tr->format = config->format;
+    tr->cpu = config->cpu;
+    tr->base_us = -1;
+    tr->last_us = -1;
+
+    // Only one line is ever held in memory; overlong lines are cut short
+    char line[TRACE_LINE_MAX];
+    int in_line = 0;
+    while (fgets(line, sizeof(line), file)) {
+        size_t len = strlen(line);
+        int continued = in_line;
+        in_line = len > 0 && line[len - 1] != '\n';
+        tr->bytes += len;
+        if (continued) continue;
+        tr->lines++;
+
+        if (tr->format == TRACE_FORMAT_AUTO) {
+            if (strstr(line, ": sched_switch:") || strstr(line, ": sched_wakeup")) {
+                tr->format = TRACE_FORMAT_FTRACE;
+            }
+            else if (strstr(line, "sch delay")) {
+                tr->format = TRACE_FORMAT_PERF;
+            }
+            else {
+                continue;
+            }
+        }
+
+        int more = tr->format == TRACE_FORMAT_PERF ?
+            parse_perf_timehist_line(tr, line) : parse_ftrace_line(tr, line);
+        // Stop well before simulated time could overflow
+        if (tr->base_us >= 0 && trace_ticks(tr, tr->last_us) > MAX_SIM_TIME) {
+            more = 0;
+        }
+        if (!more) {
+            tr->truncated = 1;
+            break;
+        }
+    }
+    fclose(file);
+
+    // Whatever was still running or runnable ends where the trace does
+    for (int t = 0; t < tr->task_count; t++) {
+        if (tr->tasks[t].run_start_us >= 0) {
+            trace_add_slice(tr, t, tr->tasks[t].run_start_us, tr->last_us);
+        }
+        if (tr->tasks[t].job >= 0) trace_close_job(tr, t);
+    }
+
+    if (tr->job_count == 0) {
+        snprintf(error, error_len, "No scheduling events for CPU %d found in %s", tr->cpu, path);
+        return -1;
+    }
+    return 0;
+}
+
+void replay_trace(TraceReplay* tr, SchedulingAlgorithm algo, int quantum) {
+    tr->algo = algo;
+    free(tr->workload);
+    free_simulation(&tr->simulated);
+    tr->workload = malloc(tr->job_count * sizeof(Process));
+
+    for (int j = 0; j < tr->job_count; j++) {
+        const TraceJob* job = &tr->jobs[j];
+        const TraceTask* task = &tr->tasks[job->task];
+        Process* p = &tr->workload[j];
+
+        memset(p, 0, sizeof(*p));
+        strcpy(p->name, task->comm);
+        p->arrival_time = trace_ticks(tr, job->arrival_us);
+        p->burst_time = (job->run_us * 1000 + tr->tick_ns / 2) / tr->tick_ns;
+        if (p->burst_time < 1) p->burst_time = 1;
+        p->priority = task->priority;
+        p->process_id = j + 1;
+        p->color = process_colors[job->task % 10];
+    }
+
+    init_simulation(&tr->simulated, tr->workload, tr->job_count, quantum);
+    tr->simulated.spill = gantt_spill_create();
+    run_fast_scheduler(&tr->simulated, algo);
+
+    for (int t = 0; t < tr->task_count; t++) {
+        tr->tasks[t].jobs = 0;
+        tr->tasks[t].recorded_latency_us = 0;
+        tr->tasks[t].simulated_latency_us = 0;
+    }
+    for (int j = 0; j < tr->job_count; j++) {
+        TraceTask* task = &tr->tasks[tr->jobs[j].task];
+        task->jobs++;
+        task->recorded_latency_us += tr->jobs[j].first_run_us - tr->jobs[j].arrival_us;
+        task->simulated_latency_us += (double)tr->workload[j].response_time * tr->tick_ns / 1000.0;
+    }
+}
+
+int compare_trace_tasks(const void* a, const void* b) {
+    const TraceTask* x = a;
+    const TraceTask* y = b;
+    if (x->jobs != y->jobs) return y->jobs - x->jobs;
+    return x->pid - y->pid;
+}
+
+void format_trace_report(const TraceReplay* tr, char* out, size_t out_len) {
+    double recorded_total = 0, simulated_total = 0;
+    for (int t = 0; t < tr->task_count; t++) {
+        recorded_total += tr->tasks[t].recorded_latency_us;
+        simulated_total += tr->tasks[t].simulated_latency_us;
+    }
+
+    SimTime recorded_end = tr->recorded_count ? tr->recorded[tr->recorded_count - 1].end_time : 0;
+    SimTime simulated_end = tr->simulated.gantt_count ?
+        tr->simulated.gantt[tr->simulated.gantt_count - 1].end_time : 0;
+    char tick[32];
+    if (time_unit == TIME_UNIT_NONE) snprintf(tick, sizeof(tick), "%d us", tr->config.tick_us);
+    else snprintf(tick, sizeof(tick), "1 %s", time_unit_keys[time_unit]);
+
+    size_t used = snprintf(out, out_len,
+        "Trace Replay: %s on CPU %d, replayed with %s\n"
+        "Read %ld lines (%.1f MB); %d jobs from %d tasks%s\n"
+        "Time unit: %s\n\n"
+        "                        Recorded   Simulated\n"
+        "Mean latency (ms)     %10.3f  %10.3f\n"
+        "Makespan (ms)         %10.3f  %10.3f\n\n"
+        "Per-task mean wakeup-to-run latency (ms)\n"
+        "%-20s %6s %10s %10s %10s\n",
+        tr->format == TRACE_FORMAT_PERF ? "perf sched timehist" : "ftrace",
+        tr->cpu, algorithm_keys[tr->algo - 1],
+        tr->lines, tr->bytes / (1024.0 * 1024.0), tr->job_count, tr->task_count,
+        tr->truncated ? " (stopped at the job limit)" : "",
+        tick,
+        recorded_total / tr->job_count / 1000.0, simulated_total / tr->job_count / 1000.0,
+        recorded_end * (double)tr->tick_ns / 1e6,
+        simulated_end * (double)tr->tick_ns / 1e6,
+        "Task", "Jobs", "Recorded", "Simulated", "Diff");
+
+    // Busiest tasks first; idle ones have no latency to compare
+    TraceTask* sorted = malloc((tr->task_count + 1) * sizeof(TraceTask));
+    memcpy(sorted, tr->tasks, tr->task_count * sizeof(TraceTask));
+    qsort(sorted, tr->task_count, sizeof(TraceTask), compare_trace_tasks);
+
+    for (int t = 0; t < tr->task_count && t < TRACE_REPORT_TASKS && used < out_len; t++) {
+        const TraceTask* task = &sorted[t];
+        if (task->jobs == 0) break;
+
+        char label[MAX_NAME_LEN + 16];
+        snprintf(label, sizeof(label), "%s[%d]", task->comm, task->pid);
+        double recorded = task->recorded_latency_us / task->jobs / 1000.0;
+        double simulated = task->simulated_latency_us / task->jobs / 1000.0;
+        used += snprintf(out + used, out_len - used, "%-20s %6d %10.3f %10.3f %+10.3f\n",
+            label, task->jobs, recorded, simulated, simulated - recorded);
+    }
+
+    free(sorted);
+}
+
+void trace_replay_free(TraceReplay* tr) {
+    free(tr->tasks);
+    free(tr->task_slots);
+    free(tr->jobs);
+    free(tr->recorded);
+    gantt_spill_free(tr->recorded_spill);
+    free(tr->workload);
+    free_simulation(&tr->simulated);
+    memset(tr, 0, sizeof(*tr));
+}
+
+// Service mode
+//
+// Other tools on the host send newline-delimited JSON requests over a Unix
+// domain socket and get one JSON line back per request, in completion order.
+// A single thread multiplexes the connections and parses requests; admitted
+// ones go into a bounded FIFO that a pool of workers drains. A worker takes
+// up to SERVICE_BATCH small requests at once and answers each client with a
+// single write.
+//
+//   {"id": 7, "algorithm": "rr", "quantum": 4, "detail": true,
+//    "processes": [{"name": "P1", "arrival": 0, "burst": 5, "priority": 2}, [1, 3, 1]]}
+//   {"op": "stats"}
+
+volatile sig_atomic_t service_stop_requested = 0;
+
+int64_t monotonic_us() {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (int64_t)now.tv_sec * 1000000 + now.tv_nsec / 1000;
+}
+
+void text_append(TextBuffer* text, const char* format, ...) {
+    va_list args;
+
+    while (1) {
+        size_t room = text->capacity - text->length;
+        va_start(args, format);
+        int needed = vsnprintf(text->data ? text->data + text->length : NULL, room, format, args);
+        va_end(args);
+
+        if (needed < 0) return;
+        if ((size_t)needed < room) {
+            text->length += needed;
+            return;
+        }
+
+        text->capacity = text->capacity * 2 > text->length + needed + 1 ?
+            text->capacity * 2 : text->length + needed + 256;
+        text->data = realloc(text->data, text->capacity);
+    }
+}
+
+void json_append_string(TextBuffer* text, const char* value) {
+    text_append(text, "\"");
+    for (const char* c = value; *c; c++) {
+        if (*c == '"' || *c == '\\') text_append(text, "\\%c", *c);
+        else if ((unsigned char)*c < 0x20) text_append(text, "\\u%04x", *c);
+        else text_append(text, "%c", *c);
+    }
+    text_append(text, "\"");
+}
+
+void json_skip_space(JsonReader* json) {
+    while (json->p < json->end && (*json->p == ' ' || *json->p == '\t' || *json->p == '\r' || *json->p == '\n')) {
+        json->p++;
+    }
+}
+
+int json_consume(JsonReader* json, char c) {
+    json_skip_space(json);
+    if (json->p < json->end && *json->p == c) {
+        json->p++;
+        return 1;
+    }
+    return 0;
+}
+
+// Escapes other than \" \\ \/ \n \t are kept as the escaped character
+int json_read_string(JsonReader* json, char* out, size_t out_len) {
+    size_t n = 0;
+
+    if (!json_consume(json, '"')) return 0;
+    while (json->p < json->end && *json->p != '"') {
+        char c = *json->p++;
+        if (c == '\\' && json->p < json->end) {
+            c = *json->p++;
+            if (c == 'n') c = '\n';
+            else if (c == 't') c = '\t';
+            else if (c == 'u') {
+                json->p += json->end - json->p >= 4 ? 4 : json->end - json->p;
+                c = '?';
+            }
+        }
+        if (n + 1 < out_len) out[n++] = c;
+    }
+    if (out_len > 0) out[n] = '\0';
+    return json_consume(json, '"');
+}
+
+int json_read_number(JsonReader* json, double* out) {
+    char number[64];
+    size_t n = 0;
+
+    json_skip_space(json);
+    while (json->p < json->end && n + 1 < sizeof(number) && strchr("+-0123456789.eE", *json->p)) {
+        number[n++] = *json->p++;
+    }
+    number[n] = '\0';
+
+    char* end;
+    *out = strtod(number, &end);
+    return n > 0 && *end == '\0';
+}
+
+// A time: a number of ticks or, like a workload file, a string such as "1.5ms"
+int json_read_time(JsonReader* json, SimTime* out) {
+    double value;
+
+    json_skip_space(json);
+    if (json->p < json->end && *json->p == '"') {
+        char text[64];
+        char* end;
+        if (!json_read_string(json, text, sizeof(text))) return 0;
+        *out = parse_time(text, &end);
+        return end != text && *end == '\0';
+    }
+    if (!json_read_number(json, &value)) return 0;
+
+    // The bounds parse_time keeps: a whole number of ticks up to MAX_SIM_TIME
+    if (!isfinite(value) || value != floor(value) || value < 0 || value > (double)MAX_SIM_TIME) return 0;
+    *out = (SimTime)value;
+    return 1;
+}
+
+int json_skip_value(JsonReader* json) {
+    json_skip_space(json);
+    if (json->p >= json->end) return 0;
+
+    char c = *json->p;
+    if (c == '"') {
+        char ignored[1];
+        return json_read_string(json, ignored, sizeof(ignored));
+    }
+    if (c == '{' || c == '[') {
+        char close = c == '{' ? '}' : ']';
+        json->p++;
+        if (json_consume(json, close)) return 1;
+        do {
+            if (c == '{') {
+                char ignored[1];
+                if (!json_read_string(json, ignored, sizeof(ignored)) || !json_consume(json, ':')) return 0;
+            }
+            if (!json_skip_value(json)) return 0;
+        } while (json_consume(json, ','));
+        return json_consume(json, close);
+    }
+    if (strncmp(json->p, "true", 4) == 0 || strncmp(json->p, "null", 4) == 0) {
+        json->p += 4;
+        return 1;
+    }
+    if (strncmp(json->p, "false", 5) == 0) {
+        json->p += 5;
+        return 1;
+    }
+
+    double ignored;
+    return json_read_number(json, &ignored);
+}
+
+// A process is {"name", "arrival", "burst", "priority", "weight"} or [arrival, burst, priority].
+// Priority and weight are clamped to the ranges the window allows.
+int json_read_process(JsonReader* json, Process* p, int index) {
+    double value;
+
+    memset(p, 0, sizeof(*p));
+    snprintf(p->name, MAX_NAME_LEN, "P%d", index + 1);
+    p->priority = 1;
+    p->burst_time = -1;
+    p->process_id = index + 1;
+
+    if (json_consume(json, '[')) {
+        if (!json_read_time(json, &p->arrival_time)) return 0;
+        if (json_consume(json, ',')) {
+            if (!json_read_time(json, &p->burst_time)) return 0;
+            if (json_consume(json, ',')) {
+                if (!json_read_number(json, &value)) return 0;
+                p->priority = value < 1 ? 1 : value > 10 ? 10 : (int)value;
+            }
+        }
+        if (!json_consume(json, ']')) return 0;
+    }
+    else {
+        if (!json_consume(json, '{')) return 0;
+        if (!json_consume(json, '}')) {
+            do {
+                char key[32];
+                if (!json_read_string(json, key, sizeof(key)) || !json_consume(json, ':')) return 0;
+
+                if (strcmp(key, "name") == 0) {
+                    if (!json_read_string(json, p->name, MAX_NAME_LEN)) return 0;
+                }
+                else if (strcmp(key, "arrival") == 0) {
+                    if (!json_read_time(json, &p->arrival_time)) return 0;
+                }
+                else if (strcmp(key, "burst") == 0) {
+                    if (!json_read_time(json, &p->burst_time)) return 0;
+                }
+                else if (strcmp(key, "priority") == 0 || strcmp(key, "weight") == 0) {
+                    if (!json_read_number(json, &value)) return 0;
+                    if (key[0] == 'w') p->weight = value < 0 ? 0 : value > MAX_WEIGHT ? MAX_WEIGHT : (int)value;
+                    else p->priority = value < 1 ? 1 : value > 10 ? 10 : (int)value;
+                }
+                else if (!json_skip_value(json)) {
+                    return 0;
+                }
+            } while (json_consume(json, ','));
+            if (!json_consume(json, '}')) return 0;
+        }
+    }
+
+    p->remaining_time = p->burst_time;
+    p->color = process_colors[index % 10];
+    return 1;
+}
+
+// Returns 1 for a simulation request, 2 for a stats request, 0 on error. The
+// id is filled in whenever it could be read, so errors can still be matched.
+int parse_service_request(const char* line, size_t length, const ServiceConfig* config,
+    ServiceRequest* request, char* error, size_t error_len) {
+    JsonReader json = { line, line + length };
+    int is_stats = 0;
+    int capacity = 0;
+
+    memset(request, 0, sizeof(*request));
+    strcpy(request->id, "null");
+    request->algo = FCFS;
+    request->quantum = 2;
+
+    if (!json_consume(&json, '{')) {
+        snprintf(error, error_len, "request must be a JSON object");
+        return 0;
+    }
+    if (!json_consume(&json, '}')) {
+        do {
+            char key[32];
+            if (!json_read_string(&json, key, sizeof(key)) || !json_consume(&json, ':')) {
+                snprintf(error, error_len, "malformed JSON");
+                return 0;
+            }
+            json_skip_space(&json);
+
+            if (strcmp(key, "id") == 0) {
+                const char* start = json.p;
+                if (!json_skip_value(&json) || json.p - start >= SERVICE_ID_LEN) {
+                    snprintf(error, error_len, "id must be a number or string under %d bytes", SERVICE_ID_LEN);
+                    return 0;
+                }
+                memcpy(request->id, start, json.p - start);
+                request->id[json.p - start] = '\0';
+            }
+            else if (strcmp(key, "op") == 0) {
+                char op[16];
+                if (!json_read_string(&json, op, sizeof(op))) {
+                    snprintf(error, error_len, "op must be a string");
+                    return 0;
+                }
+                is_stats = strcmp(op, "stats") == 0;
+                if (!is_stats && strcmp(op, "simulate") != 0) {
+                    snprintf(error, error_len, "unknown op '%s'", op);
+                    return 0;
+                }
+            }
+            else if (strcmp(key, "algorithm") == 0) {
+                char name[32];
+                if (!json_read_string(&json, name, sizeof(name)) || !(request->algo = algorithm_from_key(name))) {
+                    snprintf(error, error_len, "unknown algorithm");
+                    return 0;
+                }
+            }
+            else if (strcmp(key, "quantum") == 0) {
+                double value;
+                if (!json_read_number(&json, &value) || value < 1 || value > INT_MAX) {
+                    snprintf(error, error_len, "quantum must be a positive number up to %d", INT_MAX);
+                    return 0;
+                }
+                request->quantum = (int)value;
+            }
+            else if (strcmp(key, "detail") == 0) {
+                request->detail = strncmp(json.p, "true", 4) == 0;
+                json_skip_value(&json);
+            }
+            else if (strcmp(key, "processes") == 0) {
+                if (!json_consume(&json, '[')) {
+                    snprintf(error, error_len, "processes must be an array");
+                    return 0;
+                }
+                if (json_consume(&json, ']')) continue;
+                do {
+                    if (request->process_count == config->max_request_jobs) {
+                        snprintf(error, error_len, "more than %d processes", config->max_request_jobs);
+                        return 0;
+                    }
+                    if (request->process_count == capacity) {
+                        capacity = capacity ? capacity * 2 : 64;
+                        request->processes = realloc(request->processes, capacity * sizeof(Process));
+                    }
+
+                    Process* p = &request->processes[request->process_count];
+                    if (!json_read_process(&json, p, request->process_count)) {
+                        snprintf(error, error_len, "malformed process %d", request->process_count + 1);
+                        return 0;
+                    }
+                    // A zero burst never completes in the preemptive loops
+                    if (p->burst_time < 1 || p->arrival_time < 0) {
+                        snprintf(error, error_len, "process %d needs burst >= 1 and arrival >= 0",
+                            request->process_count + 1);
+                        return 0;
+                    }
+                    request->process_count++;
+                } while (json_consume(&json, ','));
+                if (!json_consume(&json, ']')) {
+                    snprintf(error, error_len, "malformed processes array");
+                    return 0;
+                }
+            }
+            else if (!json_skip_value(&json)) {
+                snprintf(error, error_len, "malformed JSON");
+                return 0;
+            }
+        } while (json_consume(&json, ','));
+
+        if (!json_consume(&json, '}')) {
+            snprintf(error, error_len, "malformed JSON");
+            return 0;
+        }
+    }
+
+    if (is_stats) return 2;
+    if (request->process_count == 0) {
+        snprintf(error, error_len, "no processes");
+        return 0;
+    }
+    if (request->algo == STRIDE && request->quantum > MAX_STRIDE_QUANTUM) {
+        snprintf(error, error_len, "stride quantum must be at most %d", MAX_STRIDE_QUANTUM);
+        return 0;
+    }
+    return 1;
+}
+
+void format_service_result(const ServiceRequest* request, const Simulation* sim, int64_t latency_us, TextBuffer* out) {
+    double total_tat = 0, total_wt = 0, total_rt = 0;
+    long busy = 0;
+    SimTime makespan = 0;
+
+    for (int i = 0; i < sim->process_count; i++) {
+        const Process* p = &sim->processes[i];
+        total_tat += p->turnaround_time;
+        total_wt += p->waiting_time;
+        total_rt += p->response_time;
+        busy += p->burst_time;
+        if (p->completion_time > makespan) makespan = p->completion_time;
+    }
+
+    int n = sim->process_count;
+    text_append(out, "{\"id\":%s,\"algorithm\":\"%s\",\"processes\":%d,"
+        "\"avg_turnaround\":%.4f,\"avg_waiting\":%.4f,\"avg_response\":%.4f,"
+        "\"makespan\":%lld,\"cpu_utilization\":%.4f,\"throughput\":%.6f,\"latency_us\":%lld",
+        request->id, algorithm_keys[request->algo - 1], n,
+        total_tat / n, total_wt / n, total_rt / n, (long long)makespan,
+        makespan > 0 ? (double)busy / makespan : 0.0,
+        makespan > 0 ? (double)n / makespan : 0.0, (long long)latency_us);
+
+    if (request->detail) {
+        text_append(out, ",\"results\":[");
+        for (int i = 0; i < n; i++) {
+            const Process* p = &sim->processes[i];
+            text_append(out, "%s{\"name\":", i ? "," : "");
+            json_append_string(out, p->name);
+            text_append(out, ",\"start\":%lld,\"completion\":%lld,\"turnaround\":%lld,\"waiting\":%lld,\"response\":%lld}",
+                (long long)p->start_time, (long long)p->completion_time, (long long)p->turnaround_time,
+                (long long)p->waiting_time, (long long)p->response_time);
+        }
+        text_append(out, "]");
+    }
+    text_append(out, "}\n");
+}
+
+void format_service_stats(Service* service, TextBuffer* out) {
+    pthread_mutex_lock(&service->lock);
+    ServiceCounters c = service->counters;
+    int queued = service->queued;
+    pthread_mutex_unlock(&service->lock);
+
+    // Percentiles are the upper edge of the log2 bucket they fall in
+    int64_t percentiles[2] = { 0, 0 };
+    double targets[2] = { 0.50, 0.99 };
+    for (int k = 0; k < 2; k++) {
+        long seen = 0;
+        for (int b = 0; b < SERVICE_LATENCY_BUCKETS && c.completed > 0; b++) {
+            seen += c.latency_buckets[b];
+            if (seen >= targets[k] * c.completed) {
+                percentiles[k] = ((int64_t)1 << b) < c.latency_max_us ? (int64_t)1 << b : c.latency_max_us;
+                break;
+            }
+        }
+    }
+
+    double uptime = (monotonic_us() - service->started_us) / 1e6;
+    text_append(out, "{\"op\":\"stats\",\"uptime_s\":%.3f,\"accepted\":%ld,\"rejected\":%ld,"
+        "\"invalid\":%ld,\"completed\":%ld,\"queued\":%d,\"batches\":%ld,\"batched_requests\":%ld,"
+        "\"processes_simulated\":%lld,\"throughput_rps\":%.2f,"
+        "\"latency_us\":{\"mean\":%.1f,\"p50\":%lld,\"p99\":%lld,\"max\":%lld}}\n",
+        uptime, c.accepted, c.rejected, c.invalid, c.completed, queued, c.batches, c.batched_requests,
+        c.processes_simulated, uptime > 0 ? c.completed / uptime : 0.0,
+        c.completed ? c.latency_total_us / c.completed : 0.0,
+        (long long)percentiles[0], (long long)percentiles[1], (long long)c.latency_max_us);
+}
+
+// Never blocks: whatever the socket does not take now is kept in the client's
+// pending buffer and flushed by the I/O loop once the socket is writable
+void service_send(Service* service, ServiceClient* client, const char* data, size_t length) {
+    pthread_mutex_lock(&client->write_lock);
+    if (client->pending.length == 0) {
+        while (length > 0) {
+            ssize_t sent = send(client->fd, data, length, MSG_NOSIGNAL | MSG_DONTWAIT);
+            if (sent < 0 && errno == EINTR) continue;
+            if (sent <= 0) break;
+            data += sent;
+            length -= sent;
+        }
+    }
+    if (length > 0) {
+        text_append(&client->pending, "%.*s", (int)length, data);
+    }
+    pthread_mutex_unlock(&client->write_lock);
+
+    if (length > 0 && write(service->wake_pipe[1], "", 1) < 0) {
+        // The pipe is full, so the I/O loop is already awake
+    }
+}
+
+void service_send_error(Service* service, ServiceClient* client, const char* id, const char* error) {
+    TextBuffer out = { NULL, 0, 0 };
+    text_append(&out, "{\"id\":%s,\"error\":", id);
+    json_append_string(&out, error);
+    text_append(&out, "}\n");
+    service_send(service, client, out.data, out.length);
+    free(out.data);
+}
+
+// Returns 0 once the peer has gone
+int service_flush_client(ServiceClient* client) {
+    int alive = 1;
+
+    pthread_mutex_lock(&client->write_lock);
+    size_t done = 0;
+    while (done < client->pending.length) {
+        ssize_t sent = send(client->fd, client->pending.data + done, client->pending.length - done,
+            MSG_NOSIGNAL | MSG_DONTWAIT);
+        if (sent < 0 && errno == EINTR) continue;
+        if (sent < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) break;
+        if (sent <= 0) {
+            alive = 0;
+            break;
+        }
+        done += sent;
+    }
+    if (done > 0) {
+        memmove(client->pending.data, client->pending.data + done, client->pending.length - done);
+        client->pending.length -= done;
+    }
+    pthread_mutex_unlock(&client->write_lock);
+
+    return alive;
+}
+
+void service_release_client(Service* service, ServiceClient* client) {
+    pthread_mutex_lock(&service->lock);
+    int last = --client->refs == 0;
+    pthread_mutex_unlock(&service->lock);
+
+    if (last) {
+        close(client->fd);
+        pthread_mutex_destroy(&client->write_lock);
+        free(client->pending.data);
+        free(client->buffer);
+        free(client);
+    }
+}
+
+// Called with the service lock held
+void service_record_latency(ServiceCounters* counters, int64_t latency_us) {
+    int bucket = 0;
+    while (bucket < SERVICE_LATENCY_BUCKETS - 1 && ((int64_t)1 << bucket) < latency_us) bucket++;
+
+    counters->latency_buckets[bucket]++;
+    counters->latency_total_us += latency_us;
+    if (latency_us > counters->latency_max_us) counters->latency_max_us = latency_us;
+}
+
+void* service_worker(void* arg) {
+    Service* service = arg;
+    ServiceRequest* batch[SERVICE_BATCH];
+    int64_t latency[SERVICE_BATCH];
+    size_t offsets[SERVICE_BATCH + 1];
+    TextBuffer out = { NULL, 0, 0 };
+    TextBuffer reply = { NULL, 0, 0 };
+
+    while (1) {
+        pthread_mutex_lock(&service->lock);
+        while (!service->head && !service->stopping) {
+            pthread_cond_wait(&service->ready, &service->lock);
+        }
+        if (!service->head) {
+            pthread_mutex_unlock(&service->lock);
+            break;
+        }
+
+        // Small requests ride along with the first one; large ones go alone
+        int count = 0;
+        do {
+            ServiceRequest* request = service->head;
+            service->head = request->next;
+            if (!service->head) service->tail = NULL;
+            service->queued--;
+            batch[count++] = request;
+        } while (count < SERVICE_BATCH && service->head &&
+            batch[0]->process_count <= SERVICE_SMALL_REQUEST &&
+            service->head->process_count <= SERVICE_SMALL_REQUEST);
+        pthread_mutex_unlock(&service->lock);
+
+        out.length = 0;
+        for (int k = 0; k < count; k++) {
+            Simulation sim;
+            init_simulation(&sim, batch[k]->processes, batch[k]->process_count, batch[k]->quantum);
+            sim.record_gantt = 0;
+            run_fast_scheduler(&sim, batch[k]->algo);
+            free_simulation(&sim);
+
+            latency[k] = monotonic_us() - batch[k]->received_us;
+            offsets[k] = out.length;
+            format_service_result(batch[k], &sim, latency[k], &out);
+        }
+        offsets[count] = out.length;
+
+        // One write per client in the batch
+        for (int k = 0; k < count; k++) {
+            if (!batch[k]->client) continue;
+
+            ServiceClient* client = batch[k]->client;
+            reply.length = 0;
+            for (int j = k; j < count; j++) {
+                if (batch[j]->client != client) continue;
+                text_append(&reply, "%.*s", (int)(offsets[j + 1] - offsets[j]), out.data + offsets[j]);
+                if (j > k) {
+                    batch[j]->client = NULL;
+                    service_release_client(service, client);
+                }
+            }
+            service_send(service, client, reply.data, reply.length);
+            service_release_client(service, client);
+        }
+
+        pthread_mutex_lock(&service->lock);
+        service->counters.completed += count;
+        service->counters.batches++;
+        if (count > 1) service->counters.batched_requests += count;
+        for (int k = 0; k < count; k++) {
+            service->counters.processes_simulated += batch[k]->process_count;
+            service_record_latency(&service->counters, latency[k]);
+        }
+        pthread_mutex_unlock(&service->lock);
+
+        for (int k = 0; k < count; k++) {
+            free(batch[k]->processes);
+            free(batch[k]);
+        }
+    }
+
+    free(out.data);
+    free(reply.data);
+    return NULL;
+}
+
+void service_handle_line(Service* service, ServiceClient* client, const char* line, size_t length) {
+    ServiceRequest* request = malloc(sizeof(ServiceRequest));
+    char error[128];
+
+    int kind = parse_service_request(line, length, &service->config, request, error, sizeof(error));
+    if (kind != 1) {
+        if (kind == 2) {
+            TextBuffer out = { NULL, 0, 0 };
+            format_service_stats(service, &out);
+            service_send(service, client, out.data, out.length);
+            free(out.data);
+        }
+        else {
+            pthread_mutex_lock(&service->lock);
+            service->counters.invalid++;
+            pthread_mutex_unlock(&service->lock);
+            service_send_error(service, client, request->id, error);
+        }
+        free(request->processes);
+        free(request);
+        return;
+    }
+
+    request->client = client;
+    request->received_us = monotonic_us();
+
+    pthread_mutex_lock(&service->lock);
+    int admitted = service->queued < service->config.max_queue;
+    if (admitted) {
+        client->refs++;
+        if (service->tail) service->tail->next = request;
+        else service->head = request;
+        service->tail = request;
+        service->queued++;
+        service->counters.accepted++;
+        pthread_cond_signal(&service->ready);
+    }
+    else {
+        service->counters.rejected++;
+    }
+    pthread_mutex_unlock(&service->lock);
+
+    if (!admitted) {
+        service_send_error(service, client, request->id, "queue full, retry later");
+        free(request->processes);
+        free(request);
+    }
+}
+
+// Returns 0 once the connection should be closed
+int service_read_client(Service* service, ServiceClient* client) {
+    if (client->capacity - client->length < 4096) {
+        client->capacity = client->capacity ? client->capacity * 2 : 65536;
+        client->buffer = realloc(client->buffer, client->capacity);
+    }
+
+    ssize_t received = recv(client->fd, client->buffer + client->length, client->capacity - client->length, 0);
+    if (received < 0 && errno == EINTR) return 1;
+    if (received <= 0) return 0;
+    client->length += received;
+
+    size_t start = 0;
+    for (size_t i = client->length - received; i < client->length; i++) {
+        if (client->buffer[i] != '\n') continue;
+        if (i > start) service_handle_line(service, client, client->buffer + start, i - start);
+        start = i + 1;
+    }
+    memmove(client->buffer, client->buffer + start, client->length - start);
+    client->length -= start;
+
+    if (client->length > service->config.max_request_bytes) {
+        service_send_error(service, client, "null", "request too large");
+        return 0;
+    }
+    return 1;
+}
+
+void on_service_signal(int signum) {
+    service_stop_requested = 1;
+}
+
+int run_service(const ServiceConfig* config) {
+    Service service;
+    struct sockaddr_un address;
+
+    memset(&service, 0, sizeof(service));
+    service.config = *config;
+    if (service.config.threads < 1) service.config.threads = default_thread_count();
+    pthread_mutex_init(&service.lock, NULL);
+    pthread_cond_init(&service.ready, NULL);
+
+    memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    if (strlen(config->socket_path) >= sizeof(address.sun_path)) {
+        fprintf(stderr, "Socket path too long: %s\n", config->socket_path);
+        return 1;
+    }
+    strcpy(address.sun_path, config->socket_path);
+
+    int listen_fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    unlink(config->socket_path);
+    if (listen_fd < 0 || bind(listen_fd, (struct sockaddr*)&address, sizeof(address)) < 0 ||
+        listen(listen_fd, 64) < 0) {
+        fprintf(stderr, "Cannot listen on %s: %s\n", config->socket_path, strerror(errno));
+        if (listen_fd >= 0) close(listen_fd);
+        return 1;
+    }
+
+    if (pipe(service.wake_pipe) < 0) {
+        fprintf(stderr, "Cannot create wake-up pipe: %s\n", strerror(errno));
+        close(listen_fd);
+        return 1;
+    }
+    fcntl(service.wake_pipe[0], F_SETFL, O_NONBLOCK);
+    fcntl(service.wake_pipe[1], F_SETFL, O_NONBLOCK);
+
+    signal(SIGINT, on_service_signal);
+    signal(SIGTERM, on_service_signal);
+    service.started_us = monotonic_us();
+
+    pthread_t* workers = malloc(service.config.threads * sizeof(pthread_t));
+    int started = 0;
+    while (started < service.config.threads &&
+        pthread_create(&workers[started], NULL, service_worker, &service) == 0) {
+        started++;
+    }
+    if (started == 0) {
+        fprintf(stderr, "Cannot start worker threads\n");
+        close(listen_fd);
+        close(service.wake_pipe[0]);
+        close(service.wake_pipe[1]);
+        unlink(config->socket_path);
+        free(workers);
+        return 1;
+    }
+
+    fprintf(stderr, "Serving on %s with %d worker threads (queue limit %d)\n",
+        config->socket_path, started, service.config.max_queue);
+
+    ServiceClient* clients[SERVICE_MAX_CLIENTS];
+    struct pollfd fds[SERVICE_MAX_CLIENTS + 2];
+    int client_count = 0;
+
+    while (!service_stop_requested) {
+        fds[0].fd = listen_fd;
+        fds[0].events = POLLIN;
+        fds[1].fd = service.wake_pipe[0];
+        fds[1].events = POLLIN;
+        for (int c = 0; c < client_count; c++) {
+            pthread_mutex_lock(&clients[c]->write_lock);
+            size_t pending = clients[c]->pending.length;
+            pthread_mutex_unlock(&clients[c]->write_lock);
+
+            // Stop reading from a client that does not read its replies
+            fds[c + 2].fd = clients[c]->fd;
+            fds[c + 2].events = (pending < SERVICE_MAX_PENDING ? POLLIN : 0) | (pending > 0 ? POLLOUT : 0);
+        }
+
+        if (poll(fds, client_count + 2, 200) <= 0) continue;
+
+        if (fds[1].revents & POLLIN) {
+            char drain[256];
+            while (read(service.wake_pipe[0], drain, sizeof(drain)) > 0) {
+            }
+        }
+
+        // Walk backwards so closing a client can swap in the last one
+        for (int c = client_count - 1; c >= 0; c--) {
+            short revents = fds[c + 2].revents;
+            int alive = 1;
+
+            if (revents & POLLOUT) alive = service_flush_client(clients[c]);
+            if (alive && (revents & (POLLIN | POLLHUP | POLLERR))) {
+                alive = service_read_client(&service, clients[c]);
+            }
+            if (alive) continue;
+
+            service_release_client(&service, clients[c]);
+            clients[c] = clients[--client_count];
+        }
+
+        if (fds[0].revents & POLLIN) {
+            int fd = accept(listen_fd, NULL, NULL);
+            if (fd < 0) continue;
+            if (client_count == SERVICE_MAX_CLIENTS) {
+                close(fd);
+                continue;
+            }
+
+            ServiceClient* client = calloc(1, sizeof(ServiceClient));
+            client->fd = fd;
+            client->refs = 1;
+            pthread_mutex_init(&client->write_lock, NULL);
+            clients[client_count++] = client;
+        }
+    }
+
+    // Finish what was admitted, then shut down
+    close(listen_fd);
+    pthread_mutex_lock(&service.lock);
+    service.stopping = 1;
+    pthread_cond_broadcast(&service.ready);
+    pthread_mutex_unlock(&service.lock);
+    for (int t = 0; t < started; t++) {
+        pthread_join(workers[t], NULL);
+    }
+    for (int c = 0; c < client_count; c++) {
+        service_flush_client(clients[c]);
+        service_release_client(&service, clients[c]);
+    }
+    close(service.wake_pipe[0]);
+    close(service.wake_pipe[1]);
+    unlink(config->socket_path);
+
+    TextBuffer stats = { NULL, 0, 0 };
+    format_service_stats(&service, &stats);
+    fputs(stats.data, stderr);
+    free(stats.data);
+
+    pthread_cond_destroy(&service.ready);
+    pthread_mutex_destroy(&service.lock);
+    free(workers);
+    return 0;
+}
+
+// Online streaming
+//
+// Schedules jobs as their arrivals are read, one line at a time:
+//
+//   NAME ARRIVAL BURST [PRIORITY]     a job arrives
+//   advance TIME                      nothing arrives before TIME
+//
+// Arrival times never go backwards, so once an arrival at time h has been read
+// every decision before h is final and can be made and reported straight
+// away; decisions at h wait for the next line (or end of input). Each policy
+// makes the same choices as its batch engine. Only unfinished jobs are kept,
+// and statistics live in a ring of at most STREAM_MAX_BUCKETS buckets covering
+// exactly the last `window` time units, so memory depends on how many jobs
+// are in flight and not on how long the feed runs.
+
+void int_ring_push(IntRing* ring, int value) {
+    if (ring->count == ring->capacity) {
+        int capacity = ring->capacity ? ring->capacity * 2 : 64;
+        int* items = malloc(capacity * sizeof(int));
+        for (int k = 0; k < ring->count; k++) {
+            items[k] = ring->items[(ring->head + k) % ring->capacity];
+        }
+        free(ring->items);
+        ring->items = items;
+        ring->head = 0;
+        ring->capacity = capacity;
+    }
+    ring->items[(ring->head + ring->count++) % ring->capacity] = value;
+}
+
+int int_ring_pop(IntRing* ring) {
+    int value = ring->items[ring->head];
+    ring->head = (ring->head + 1) % ring->capacity;
+    ring->count--;
+    return value;
+}
+
+int int_ring_front(const IntRing* ring) {
+    return ring->items[ring->head];
+}
+
+// Width of the statistics buckets. Buckets dividing both the window and the
+// report interval make each report cover exactly the window. When that takes
+// more than STREAM_MAX_BUCKETS, the width is the smallest divisor of the window
+// that fits, and reports move to the next multiple of it.
+int64_t stream_bucket_width(int64_t window, int64_t report_every) {
+    int64_t a = window, b = report_every;
+    while (b != 0) {
+        int64_t r = a % b;
+        a = b;
+        b = r;
+    }
+    if (window / a <= STREAM_MAX_BUCKETS) return a;
+
+    int64_t least = (window + STREAM_MAX_BUCKETS - 1) / STREAM_MAX_BUCKETS;
+    int64_t width = window;
+    for (int64_t d = 1; d <= window / d; d++) {
+        if (window % d != 0) continue;
+        if (d >= least && d < width) width = d;
+        if (window / d >= least && window / d < width) width = window / d;
+    }
+    return width;
+}
+
+void stream_init(StreamScheduler* s, const StreamConfig* config, FILE* out) {
+    memset(s, 0, sizeof(*s));
+    s->config = *config;
+    s->held = -1;
+    s->running = -1;
+    s->out = out;
+
+    s->bucket_width = stream_bucket_width(config->window, config->report_every);
+    s->bucket_count = (int)(config->window / s->bucket_width);
+    s->buckets = calloc(s->bucket_count, sizeof(StreamBucket));
+    s->tokens = config->admission.token_burst;
+
+    // Reports fall on bucket boundaries
+    s->config.report_every = (config->report_every + s->bucket_width - 1) / s->bucket_width * s->bucket_width;
+    s->next_report = s->config.report_every;
+}
+
+void stream_free(StreamScheduler* s) {
+    free(s->buckets);
+    free(s->jobs);
+    free(s->free_slots);
+    free(s->pending.items);
+    free(s->queue.items);
+    free(s->heap);
+    free(s->departures);
+}
+
+int stream_before(const StreamScheduler* s, int a, int b) {
+    const StreamJob* x = &s->jobs[a];
+    const StreamJob* y = &s->jobs[b];
+    int64_t kx, ky;
+
+    switch (s->config.algo) {
+    case SJF:
+        kx = x->burst;
+        ky = y->burst;
+        break;
+    case SRTF:
+        kx = x->remaining;
+        ky = y->remaining;
+        break;
+    case PRIORITY:
+    case PREEMPTIVE_PRIORITY:
+        kx = x->priority;
+        ky = y->priority;
+        break;
+    default:
+        kx = ky = 0;
+        break;
+    }
+
+    return kx != ky ? kx < ky : x->seq < y->seq;
+}
+
+void stream_heap_push(StreamScheduler* s, int slot) {
+    int i = s->heap_size++;
+    while (i > 0) {
+        int parent = (i - 1) / 2;
+        if (!stream_before(s, slot, s->heap[parent])) break;
+        s->heap[i] = s->heap[parent];
+        i = parent;
+    }
+    s->heap[i] = slot;
+}
+
+int stream_heap_pop(StreamScheduler* s) {
+    int top = s->heap[0];
+    int last = s->heap[--s->heap_size];
+    int i = 0;
+
+    while (1) {
+        int child = 2 * i + 1;
+        if (child >= s->heap_size) break;
+        if (child + 1 < s->heap_size && stream_before(s, s->heap[child + 1], s->heap[child])) child++;
+        if (!stream_before(s, s->heap[child], last)) break;
+        s->heap[i] = s->heap[child];
+        i = child;
+    }
+    if (s->heap_size > 0) s->heap[i] = last;
+
+    return top;
+}
+
+void stream_make_ready(StreamScheduler* s, int slot) {
+    if (s->config.algo == ROUND_ROBIN) int_ring_push(&s->queue, slot);
+    else stream_heap_push(s, slot);
+}
+
+void stream_bucket_add(StreamBucket* into, const StreamBucket* from) {
+    into->completed += from->completed;
+    into->turnaround += from->turnaround;
+    into->waiting += from->waiting;
+    into->response += from->response;
+    into->busy += from->busy;
+    into->rejected += from->rejected;
+    into->shed += from->shed;
+    if (from->max_turnaround > into->max_turnaround) into->max_turnaround = from->max_turnaround;
+}
+
+// The bucket that time t falls in
+StreamBucket* stream_bucket(StreamScheduler* s, int64_t t) {
+    return &s->buckets[(t / s->bucket_width) % s->bucket_count];
+}
+
+// Summarises the window that ends at `at`, a bucket boundary
+void stream_report(StreamScheduler* s, int64_t at) {
+    if (!s->out) return;
+
+    StreamBucket window;
+    memset(&window, 0, sizeof(window));
+    for (int b = 0; b < s->bucket_count; b++) {
+        stream_bucket_add(&window, &s->buckets[b]);
+    }
+
+    int64_t span = s->config.window;
+    if (span > at) span = at;
+    double n = window.completed ? (double)window.completed : 1.0;
+
+    fprintf(s->out, "window end=%lld completed=%lld avg_turnaround=%.2f avg_waiting=%.2f avg_response=%.2f "
+        "max_turnaround=%lld utilization=%.4f throughput=%.6f live=%d rejected=%lld shed=%lld\n",
+        (long long)at, (long long)window.completed, window.turnaround / n, window.waiting / n,
+        window.response / n, (long long)window.max_turnaround,
+        span > 0 ? (double)window.busy / span : 0.0, span > 0 ? window.completed / (double)span : 0.0,
+        s->live, (long long)window.rejected, (long long)window.shed);
+}
+
+// Moves the statistics clock forward, crediting the time to the CPU when
+// `busy`, and emits every report whose time has come
+void stream_advance_clock(StreamScheduler* s, int64_t to, int busy) {
+    int64_t width = s->bucket_width;
+
+    while (s->clock < to) {
+        int64_t epoch = s->clock / width;
+        int64_t bucket_end = (epoch + 1) * width;
+
+        // Once a whole window has been idle every bucket is empty, so jump
+        // over the rest of the gap without reporting the empty windows
+        if (!busy && s->clock - s->last_activity > width * (s->bucket_count + 1) && to >= bucket_end) {
+            s->clock = to / width * width;
+            memset(s->buckets, 0, s->bucket_count * sizeof(StreamBucket));
+            if (s->next_report <= s->clock) {
+                s->next_report = (s->clock / s->config.report_every + 1) * s->config.report_every;
+            }
+            continue;
+        }
+
+        int64_t step = to < bucket_end ? to : bucket_end;
+        if (busy) {
+            s->buckets[epoch % s->bucket_count].busy += step - s->clock;
+            s->total.busy += step - s->clock;
+            s->last_activity = step;
+        }
+        s->clock = step;
+
+        if (s->clock == bucket_end) {
+            if (bucket_end >= s->next_report) {
+                stream_report(s, bucket_end);
+                s->next_report += s->config.report_every;
+            }
+            memset(&s->buckets[(epoch + 1) % s->bucket_count], 0, sizeof(StreamBucket));
+        }
+    }
+}
+
+void stream_close_segment(StreamScheduler* s) {
+    if (s->running < 0) return;
+
+    if (s->config.events == STREAM_EVENTS_ALL && s->now > s->segment_start) {
+        fprintf(s->out, "segment %s %lld %lld\n", s->jobs[s->running].name,
+            (long long)s->segment_start, (long long)s->now);
+    }
+    s->running = -1;
+}
+
+// Runs a job from now until `until`; back-to-back runs of one job form one segment
+void stream_run(StreamScheduler* s, int slot, int64_t until) {
+    StreamJob* job = &s->jobs[slot];
+
+    if (s->running != slot) {
+        stream_close_segment(s);
+        s->running = slot;
+        s->segment_start = s->now;
+    }
+    if (job->first_run < 0) job->first_run = s->now;
+
+    stream_advance_clock(s, until, 1);
+    job->remaining -= until - s->now;
+    s->now = until;
+}
+
+void stream_complete(StreamScheduler* s, int slot) {
+    StreamJob* job = &s->jobs[slot];
+    stream_close_segment(s);
+
+    StreamBucket done;
+    memset(&done, 0, sizeof(done));
+    done.completed = 1;
+    done.max_turnaround = s->now - job->arrival;
+    done.turnaround = (double)done.max_turnaround;
+    done.waiting = done.turnaround - job->burst;
+    done.response = (double)(job->first_run - job->arrival);
+    stream_bucket_add(stream_bucket(s, s->now), &done);
+    stream_bucket_add(&s->total, &done);
+    s->latency[stream_latency_bucket(done.max_turnaround)]++;
+    s->last_activity = s->now;
+    stream_note_departure(s);
+
+    if (s->config.events != STREAM_EVENTS_NONE) {
+        fprintf(s->out, "complete %s arrival=%lld burst=%lld completion=%lld turnaround=%lld waiting=%lld response=%lld\n",
+            job->name, (long long)job->arrival, (long long)job->burst, (long long)s->now,
+            (long long)done.max_turnaround, (long long)done.waiting, (long long)done.response);
+    }
+
+    s->free_slots[s->free_count++] = slot;
+    s->live--;
+}
+
+// Returns 0 if the job was dropped
+int stream_submit(StreamScheduler* s, const char* name, int64_t arrival, int64_t burst, int priority) {
+    if (s->live >= s->config.max_live) {
+        s->dropped++;
+        return 0;
+    }
+
+    // A job stamped before what has already been read arrives now
+    if (arrival < s->horizon) {
+        arrival = s->horizon;
+        s->late++;
+    }
+
+    if (s->free_count == 0) {
+        int capacity = s->job_capacity ? s->job_capacity * 2 : 64;
+        s->jobs = realloc(s->jobs, capacity * sizeof(StreamJob));
+        s->free_slots = realloc(s->free_slots, capacity * sizeof(int));
+        s->heap = realloc(s->heap, capacity * sizeof(int));
+        for (int k = capacity - 1; k >= s->job_capacity; k--) {
+            s->free_slots[s->free_count++] = k;
+        }
+        s->job_capacity = capacity;
+    }
+
+    int slot = s->free_slots[--s->free_count];
+    StreamJob* job = &s->jobs[slot];
+    snprintf(job->name, MAX_NAME_LEN, "%.*s", MAX_NAME_LEN - 1, name);
+    job->arrival = arrival;
+    job->burst = burst;
+    job->remaining = burst;
+    job->first_run = -1;
+    job->priority = priority;
+    job->seq = s->next_seq++;
+
+    int_ring_push(&s->pending, slot);
+    s->horizon = arrival;
+    s->arrivals++;
+    s->live++;
+    if (s->live > s->peak_live) s->peak_live = s->live;
+    return 1;
+}
+
+// Makes every decision that no future input can change; with `final` set
+// there is no future input and the run is finished
+void stream_advance(StreamScheduler* s, int final) {
+    while (1) {
+        if (!final && s->now >= s->horizon) break;
+
+        while (s->pending.count > 0 && s->jobs[int_ring_front(&s->pending)].arrival <= s->now) {
+            int slot = int_ring_pop(&s->pending);
+            if (stream_admit(s, slot)) stream_make_ready(s, slot);
+        }
+        // Arrivals during a Round Robin slice queue ahead of the preempted job
+        if (s->held >= 0) {
+            int_ring_push(&s->queue, s->held);
+            s->held = -1;
+        }
+
+        if (s->heap_size == 0 && s->queue.count == 0) {
+            stream_close_segment(s);
+            if (s->pending.count == 0) {
+                // Idle, and nothing can arrive before the horizon
+                if (s->now < s->horizon) {
+                    stream_advance_clock(s, s->horizon, 0);
+                    s->now = s->horizon;
+                }
+                break;
+            }
+
+            int64_t next = s->jobs[int_ring_front(&s->pending)].arrival;
+            stream_advance_clock(s, next, 0);
+            s->now = next;
+            continue;
+        }
+
+        int slot;
+        int64_t until;
+        StreamJob* job;
+
+        switch (s->config.algo) {
+        case ROUND_ROBIN:
+            slot = int_ring_pop(&s->queue);
+            job = &s->jobs[slot];
+            until = s->now + (job->remaining < s->config.time_quantum ? job->remaining : s->config.time_quantum);
+            stream_run(s, slot, until);
+            if (job->remaining == 0) stream_complete(s, slot);
+            else s->held = slot;
+            break;
+        case SRTF:
+        case PREEMPTIVE_PRIORITY:
+            // Run until completion, the next known arrival, or the point
+            // beyond which an unread arrival could preempt
+            slot = stream_heap_pop(s);
+            job = &s->jobs[slot];
+            until = s->now + job->remaining;
+            if (s->pending.count > 0 && s->jobs[int_ring_front(&s->pending)].arrival < until) {
+                until = s->jobs[int_ring_front(&s->pending)].arrival;
+            }
+            if (!final && s->horizon < until) until = s->horizon;
+            stream_run(s, slot, until);
+            if (job->remaining == 0) stream_complete(s, slot);
+            else stream_heap_push(s, slot);
+            break;
+        default:
+            slot = stream_heap_pop(s);
+            stream_run(s, slot, s->now + s->jobs[slot].remaining);
+            stream_complete(s, slot);
+            break;
+        }
+    }
+}
+
+// Returns 0 for a malformed line
+int stream_read_line(StreamScheduler* s, char* line) {
+    char name[64], arrival_text[32], burst_text[32];
+    char *arrival_end, *burst_end;
+    SimTime arrival, burst;
+    int priority = 1;
+
+    char* hash = strchr(line, '#');
+    if (hash) *hash = '\0';
+    if (sscanf(line, " %63s", name) != 1) return 1;
+
+    if (strcmp(name, "advance") == 0) {
+        if (sscanf(line, " advance %31s", arrival_text) != 1) return 0;
+        arrival = parse_time(arrival_text, &arrival_end);
+        if (arrival_end == arrival_text || *arrival_end != '\0') return 0;
+        if (arrival > s->horizon) s->horizon = arrival;
+        stream_advance(s, 0);
+        return 1;
+    }
+
+    int fields = sscanf(line, " %63s %31s %31s %d", name, arrival_text, burst_text, &priority);
+    if (fields < 3) return 0;
+    arrival = parse_time(arrival_text, &arrival_end);
+    burst = parse_time(burst_text, &burst_end);
+    if (*arrival_end != '\0' || *burst_end != '\0' || arrival_end == arrival_text || burst_end == burst_text ||
+        arrival < 0 || burst < 1) return 0;
+
+    if (stream_submit(s, name, arrival, burst, priority)) {
+        stream_advance(s, 0);
+    }
+    return 1;
+}
+
+void format_stream_summary(StreamScheduler* s, FILE* out) {
+    double n = s->total.completed ? (double)s->total.completed : 1.0;
+
+    fprintf(out, "total algorithm=%s end=%lld arrivals=%ld completed=%lld late=%ld dropped=%ld malformed=%ld "
+        "peak_live=%d avg_turnaround=%.2f avg_waiting=%.2f avg_response=%.2f max_turnaround=%lld "
+        "utilization=%.4f rejected=%lld shed=%lld rejection_rate=%.4f goodput=%.6f wasted=%lld "
+        "p99_turnaround=%lld\n",
+        algorithm_keys[s->config.algo - 1], (long long)s->now, s->arrivals, (long long)s->total.completed,
+        s->late, s->dropped, s->malformed, s->peak_live, s->total.turnaround / n, s->total.waiting / n,
+        s->total.response / n, (long long)s->total.max_turnaround,
+        s->now > 0 ? (double)s->total.busy / s->now : 0.0, (long long)s->total.rejected,
+        (long long)s->total.shed, s->arrivals ? (double)s->total.rejected / s->arrivals : 0.0,
+        s->now > 0 ? s->total.completed / (double)s->now : 0.0, (long long)s->wasted,
+        (long long)stream_latency_percentile(s, 0.99));
+}
+
+int run_stream(const StreamConfig* config, const char* path) {
+    StreamScheduler s;
+    char line[TRACE_LINE_MAX];
+
+    FILE* in = strcmp(path, "-") == 0 ? stdin : fopen(path, "r");
+    if (!in) {
+        fprintf(stderr, "Cannot open %s: %s\n", path, strerror(errno));
+        return 1;
+    }
+
+    stream_init(&s, config, stdout);
+    long line_number = 0;
+    while (fgets(line, sizeof(line), in)) {
+        line_number++;
+        if (!stream_read_line(&s, line)) {
+            s.malformed++;
+            fprintf(stderr, "Line %ld: expected NAME ARRIVAL BURST [PRIORITY] or advance TIME\n", line_number);
+        }
+        // Hand the events to whoever is reading before blocking on the feed
+        fflush(s.out);
+    }
+
+    stream_advance(&s, 1);
+    stream_report(&s, s.clock);
+    format_stream_summary(&s, s.out);
+    fflush(s.out);
+
+    if (in != stdin) fclose(in);
+    stream_free(&s);
+    return 0;
+}
+
+// Admission control
+//
+// An overloaded scheduler otherwise lets its ready set grow without bound.
+// Arrivals go through a token bucket, then a limit on the admitted jobs in
+// the system; a full system either turns the arrival away or sheds the job
+// that has waited longest to make room for it. Rejected and shed jobs are
+// counted apart from completed ones: goodput counts only completions, and
+// CPU time given to a job that is later shed is reported as wasted. The
+// sweep runs one workload at a range of limits to size them offline.
+
+// Returns 0 if the job arriving in `slot` was turned away
+int stream_admit(StreamScheduler* s, int slot) {
+    const AdmissionConfig* admission = &s->config.admission;
+    const StreamJob* job = &s->jobs[slot];
+
+    if (admission->token_rate > 0) {
+        s->tokens += (job->arrival - s->token_time) * admission->token_rate;
+        if (s->tokens > admission->token_burst) s->tokens = admission->token_burst;
+        s->token_time = job->arrival;
+        if (s->tokens < 1) {
+            stream_turn_away(s, slot, "rate");
+            return 0;
+        }
+        s->tokens -= 1;
+    }
+
+    if (admission->queue_limit == 0) return 1;
+
+    // Arrivals during a slice or a non-preemptive run are admitted at its
+    // end, so jobs that finished after the arrival still count against it.
+    // live counts this job and the jobs read but not yet arrived.
+    while (s->departure_head < s->departure_count && s->departures[s->departure_head] <= job->arrival) {
+        s->departure_head++;
+    }
+    int in_system = s->live - s->pending.count - 1 + s->departure_count - s->departure_head;
+    if (in_system >= admission->queue_limit) {
+        if (admission->overflow == OVERFLOW_REJECT_NEW || !stream_shed_oldest(s, job->arrival)) {
+            stream_turn_away(s, slot, "queue");
+            return 0;
+        }
+    }
+    return 1;
+}
+
+void stream_turn_away(StreamScheduler* s, int slot, const char* reason) {
+    const StreamJob* job = &s->jobs[slot];
+
+    if (s->out && s->config.events != STREAM_EVENTS_NONE) {
+        fprintf(s->out, "reject %s arrival=%lld reason=%s\n", job->name, (long long)job->arrival, reason);
+    }
+    stream_bucket(s, s->now)->rejected++;
+    s->total.rejected++;
+    s->free_slots[s->free_count++] = slot;
+    s->live--;
+}
+
+// Sheds the ready job that arrived first, for an arrival at `time`; the job
+// that had the CPU up to now is not ready but running. Returns 0 if no job is
+// ready. The search is linear, but the ready set is bounded by the queue limit.
+int stream_shed_oldest(StreamScheduler* s, int64_t time) {
+    int oldest = -1, position = -1;
+    int size = s->config.algo == ROUND_ROBIN ? s->queue.count : s->heap_size;
+
+    for (int k = 0; k < size; k++) {
+        int slot = s->config.algo == ROUND_ROBIN ? s->queue.items[(s->queue.head + k) % s->queue.capacity] : s->heap[k];
+        if (slot == s->running) continue;
+        if (oldest < 0 || s->jobs[slot].seq < s->jobs[oldest].seq) {
+            oldest = slot;
+            position = k;
+        }
+    }
+    if (oldest < 0) return 0;
+
+    if (s->config.algo == ROUND_ROBIN) {
+        for (int k = position; k < s->queue.count - 1; k++) {
+            s->queue.items[(s->queue.head + k) % s->queue.capacity] =
+                s->queue.items[(s->queue.head + k + 1) % s->queue.capacity];
+        }
+        s->queue.count--;
+    }
+    else {
+        stream_heap_remove(s, position);
+    }
+
+    const StreamJob* job = &s->jobs[oldest];
+    if (s->out && s->config.events != STREAM_EVENTS_NONE) {
+        fprintf(s->out, "shed %s arrival=%lld time=%lld ran=%lld\n", job->name, (long long)job->arrival,
+            (long long)time, (long long)(job->burst - job->remaining));
+    }
+    stream_bucket(s, s->now)->shed++;
+    s->total.shed++;
+    s->wasted += job->burst - job->remaining;
+    s->free_slots[s->free_count++] = oldest;
+    s->live--;
+    return 1;
+}
 
-        if (gtk_dialog_run(GTK_DIALOG(dialog)) == GTK_RESPONSE_OK) {
-            time_quantum = atoi(gtk_entry_get_text(GTK_ENTRY(entry)));
-            if (time_quantum <= 0) time_quantum = 2;
+// Remembers that a job finished now, for arrivals admitted later that came
+// before it finished
+void stream_note_departure(StreamScheduler* s) {
+    if (s->config.admission.queue_limit == 0) return;
+
+    if (s->departure_head == s->departure_count) s->departure_head = s->departure_count = 0;
+    if (s->departure_count == s->departure_capacity) {
+        if (s->departure_head > 0) {
+            memmove(s->departures, s->departures + s->departure_head,
+                (s->departure_count - s->departure_head) * sizeof(int64_t));
+            s->departure_count -= s->departure_head;
+            s->departure_head = 0;
         }
         else {
-            gtk_widget_destroy(dialog);
-            return;
+            s->departure_capacity = s->departure_capacity ? s->departure_capacity * 2 : 64;
+            s->departures = realloc(s->departures, s->departure_capacity * sizeof(int64_t));
         }
-        gtk_widget_destroy(dialog);
     }
-
-    simulate_scheduling(algo);
-    update_process_list();
-    update_statistics();
-    gtk_widget_queue_draw(gantt_drawing_area);
-    gtk_widget_queue_draw(performance_drawing_area);
+    s->departures[s->departure_count++] = s->now;
 }
 
-void on_reset_clicked(GtkButton* button, gpointer user_data) {
-    reset_simulation();
-    update_process_list();
-    update_statistics();
-    gtk_widget_queue_draw(gantt_drawing_area);
-    gtk_widget_queue_draw(performance_drawing_area);
-}
+void stream_heap_remove(StreamScheduler* s, int position) {
+    int last = s->heap[--s->heap_size];
+    int i = position;
 
-void on_load_sample_clicked(GtkButton* button, gpointer user_data) {
-    load_sample_processes();
-    assign_process_colors();
-    update_process_list();
+    if (position == s->heap_size) return;
+    while (i > 0 && stream_before(s, last, s->heap[(i - 1) / 2])) {
+        s->heap[i] = s->heap[(i - 1) / 2];
+        i = (i - 1) / 2;
+    }
+    while (1) {
+        int child = 2 * i + 1;
+        if (child >= s->heap_size) break;
+        if (child + 1 < s->heap_size && stream_before(s, s->heap[child + 1], s->heap[child])) child++;
+        if (!stream_before(s, s->heap[child], last)) break;
+        s->heap[i] = s->heap[child];
+        i = child;
+    }
+    s->heap[i] = last;
 }
 
-void update_process_list() {
-    gtk_list_store_clear(process_list_store);
+// Values below 32 have a bucket each; above, each power of two is split
+// into 32 buckets, so a bucket is at most 1/32 of its values wide
+int stream_latency_bucket(int64_t value) {
+    int exponent = 5;
+    if (value < 32) return value < 0 ? 0 : (int)value;
+    while (exponent < 62 && value >> (exponent + 1)) exponent++;
+    return 32 * (exponent - 4) + (int)((value >> (exponent - 5)) & 31);
+}
 
-    for (int i = 0; i < process_count; i++) {
-        GtkTreeIter iter;
-        gtk_list_store_append(process_list_store, &iter);
-        gtk_list_store_set(process_list_store, &iter,
-            0, processes[i].name,
-            1, processes[i].arrival_time,
-            2, processes[i].burst_time,
-            3, processes[i].priority,
-            4, processes[i].start_time,
-            5, processes[i].completion_time,
-            6, processes[i].turnaround_time,
-            -1);
+// Nearest-rank percentile of the completed jobs' turnaround, rounded up to
+// the top of its bucket
+int64_t stream_latency_percentile(const StreamScheduler* s, double q) {
+    int64_t rank = (int64_t)ceil(q * s->total.completed);
+    int64_t seen = 0;
+
+    if (rank < 1) return 0;
+    for (int b = 0; b < STREAM_LATENCY_BUCKETS; b++) {
+        seen += s->latency[b];
+        if (seen < rank) continue;
+        if (b < 32) return b;
+        int exponent = b / 32 + 4;
+        return ((int64_t)(32 + b % 32) << (exponent - 5)) + ((int64_t)1 << (exponent - 5)) - 1;
     }
+    return 0;
 }
 
-void update_statistics() {
-    if (process_count == 0) return;
-
-    GtkTextBuffer* buffer = gtk_text_view_get_buffer(GTK_TEXT_VIEW(statistics_text_view));
-
-    char stats_text[2048];
-    strcpy(stats_text, "SCHEDULING STATISTICS\n");
-    strcat(stats_text, "====================\n\n");
+// Feeds a workload to the stream in arrival order, table order breaking ties,
+// and runs it to the end
+void stream_workload(StreamScheduler* s, const Process* procs, int count) {
+    SchedKey* order = malloc((count ? count : 1) * sizeof(SchedKey));
 
-    float total_tat = 0, total_wt = 0, total_rt = 0;
-
-    strcat(stats_text, "Process Details:\n");
-    strcat(stats_text, "Process\tAT\tBT\tCT\tTAT\tWT\tRT\n");
-    strcat(stats_text, "-------\t--\t--\t--\t---\t--\t--\n");
-
-    for (int i = 0; i < process_count; i++) {
-        Process* p = &processes[i];
-        char line[128];
-        snprintf(line, sizeof(line), "%s\t%d\t%d\t%d\t%d\t%d\t%d\n",
-            p->name, p->arrival_time, p->burst_time, p->completion_time,
-            p->turnaround_time, p->waiting_time, p->response_time);
-        strcat(stats_text, line);
+    for (int i = 0; i < count; i++) {
+        order[i] = make_key(procs[i].arrival_time, i);
+    }
+    qsort(order, count, sizeof(SchedKey), compare_key);
+    for (int k = 0; k < count; k++) {
+        const Process* p = &procs[key_index(order[k])];
+        if (stream_submit(s, p->name, p->arrival_time, p->burst_time, p->priority)) {
+            stream_advance(s, 0);
+        }
+    }
+    stream_advance(s, 1);
+    free(order);
+}
 
-        total_tat += p->turnaround_time;
-        total_wt += p->waiting_time;
-        total_rt += p->response_time;
+// Runs procs through the stream at queue limits from none down to 1, under
+// both overflow policies, with config's algorithm and token bucket
+void format_admission_sweep(const Process* procs, int count, const StreamConfig* config, char* out, size_t out_len) {
+    static const int limits[] = { 0, 256, 64, 32, 16, 8, 4, 2, 1 };
+    int64_t work = 0;
+    SimTime first = INT64_MAX, last = 0;
+    size_t used;
+
+    for (int i = 0; i < count; i++) {
+        work += procs[i].burst_time;
+        if (procs[i].arrival_time < first) first = procs[i].arrival_time;
+        if (procs[i].arrival_time > last) last = procs[i].arrival_time;
     }
 
-    char averages[256];
-    snprintf(averages, sizeof(averages),
-        "\nAVERAGES:\n"
-        "Average Turnaround Time: %.2f\n"
-        "Average Waiting Time: %.2f\n"
-        "Average Response Time: %.2f\n\n"
-        "Legend:\n"
-        "AT = Arrival Time\n"
-        "BT = Burst Time\n"
-        "CT = Completion Time\n"
-        "TAT = Turnaround Time\n"
-        "WT = Waiting Time\n"
-        "RT = Response Time\n",
-        total_tat / process_count,
-        total_wt / process_count,
-        total_rt / process_count);
+    used = snprintf(out, out_len,
+        "ADMISSION CONTROL\n"
+        "=================\n\n"
+        "%s on %d jobs, offered load %.2f\n",
+        algorithm_names[config->algo - 1], count, last > first ? (double)work / (last - first) : 0.0);
+    if (used < out_len && config->admission.token_rate > 0) {
+        used += snprintf(out + used, out_len - used, "Token bucket: %.4g tokens per unit, %.4g deep\n",
+            config->admission.token_rate, config->admission.token_burst);
+    }
 
-    strcat(stats_text, averages);
+    for (int policy = 0; policy < OVERFLOW_POLICIES && used < out_len; policy++) {
+        used += snprintf(out + used, out_len - used, "\n%s\n%-6s %9s %9s %7s %8s %9s %9s %8s %8s %8s\n",
+            policy == OVERFLOW_REJECT_NEW ? "Full system rejects the new job" : "Full system sheds the oldest waiting job",
+            "Limit", "Completed", "Rejected", "Shed", "Reject%", "Goodput", "Mean TAT", "p99 TAT", "Max TAT", "Wasted");
+
+        for (size_t k = 0; k < sizeof(limits) / sizeof(limits[0]) && used < out_len; k++) {
+            StreamConfig run = *config;
+            StreamScheduler s;
+            char limit[16];
+
+            run.events = STREAM_EVENTS_NONE;
+            run.admission.queue_limit = limits[k];
+            run.admission.overflow = (OverflowPolicy)policy;
+            stream_init(&s, &run, NULL);
+            stream_workload(&s, procs, count);
+
+            double n = s.total.completed ? (double)s.total.completed : 1.0;
+            if (limits[k] > 0) snprintf(limit, sizeof(limit), "%d", limits[k]);
+            else snprintf(limit, sizeof(limit), "none");
+            used += snprintf(out + used, out_len - used, "%-6s %9lld %9lld %7lld %7.2f%% %9.5f %9.2f %8lld %8lld %8lld\n",
+                limit, (long long)s.total.completed, (long long)s.total.rejected, (long long)s.total.shed,
+                s.arrivals ? 100.0 * s.total.rejected / s.arrivals : 0.0,
+                s.now > 0 ? s.total.completed / (double)s.now : 0.0, s.total.turnaround / n,
+                (long long)stream_latency_percentile(&s, 0.99), (long long)s.total.max_turnaround,
+                (long long)s.wasted);
+            stream_free(&s);
+        }
+    }
 
-    gtk_text_buffer_set_text(buffer, stats_text, -1);
+    if (used < out_len) {
+        snprintf(out + used, out_len - used,
+            "\nThe limit counts admitted jobs in the system, the one on the CPU included.\n"
+            "Goodput is completed jobs per time unit, and turnaround covers completed\n"
+            "jobs only. Wasted is CPU time given to jobs that were later shed.\n");
+    }
 }
 
-gboolean on_gantt_draw(GtkWidget* widget, cairo_t* cr, gpointer user_data) {
-    GtkAllocation allocation;
-    gtk_widget_get_allocation(widget, &allocation);
+// --admission-sweep: the sweep on a workload file or on one generated workload
+int run_admission_sweep(const ReplicationConfig* replication, const StreamConfig* config, const char* workload_path) {
+    Process* procs;
+    int count;
+    char error[1200];
+    size_t out_len = 16384;
+    char* out;
+
+    if (workload_path) {
+        if (load_workload(workload_path, &procs, &count, NULL, NULL, error, sizeof(error)) != 0) {
+            fprintf(stderr, "%s\n", error);
+            return 1;
+        }
+        if (workload_has_io(procs, count)) {
+            fprintf(stderr, "%s has I/O bursts; admission control takes CPU-only workloads\n", workload_path);
+            free(procs);
+            return 1;
+        }
+    }
+    else {
+        RngState rng;
+        count = replication->jobs;
+        procs = malloc(count * sizeof(Process));
+        rng_seed(&rng, replication->seed, 0);
+        generate_workload(procs, count, &rng, replication);
+    }
 
-    int width = allocation.width;
-    int height = allocation.height;
+    out = malloc(out_len);
+    format_admission_sweep(procs, count, config, out, out_len);
+    fputs(out, stdout);
 
-    // Clear background
-    cairo_set_source_rgb(cr, 1.0, 1.0, 1.0);
-    cairo_paint(cr);
+    free(out);
+    free(procs);
+    return 0;
+}
 
-    if (gantt_count == 0) {
-        cairo_set_source_rgb(cr, 0.0, 0.0, 0.0);
-        cairo_move_to(cr, 20, height / 2);
-        cairo_show_text(cr, "No simulation data available. Run an algorithm first.");
-        return FALSE;
+// Chart export
+//
+// Renders the Gantt or performance chart offscreen for reports produced by
+// batch jobs. A long timeline can be split into tiles, each covering an equal
+// slice of time: PDF puts one tile per page, PNG and SVG write one file per
+// tile. Each tile maps only the spilled Gantt chunks it covers, and sub-pixel
+// blocks are merged per pixel column, so the work per tile depends on its
+// width rather than on the number of segments.
+
+// Reads "NAME ARRIVAL BURST [PRIORITY [WEIGHT [GROUP]]]" lines, the format
+// streaming mode takes; BURST may be a CPU,I/O,CPU,... sequence. Where groups
+// is set, "group PATH QUOTA|max PERIOD [WEIGHT]" lines define the bandwidth
+// groups that GROUP names. Where resources is set, BURST may end in lock
+// spans, "8[db:2-5]", whose resource names go into the table. Times take
+// the suffixes parse_time accepts. Names must be unique; processes get ids
+// from 1 in file order.
+int load_workload(const char* path, Process** out, int* count, GroupConfig* groups, ResourceTable* resources,
+    char* error, size_t error_len) {
+    FILE* file = fopen(path, "r");
+    if (!file) {
+        snprintf(error, error_len, "Cannot open %s", path);
+        return -1;
     }
 
-    // Find total time
-    int total_time = 0;
-    for (int i = 0; i < gantt_count; i++) {
-        if (gantt_chart[i].end_time > total_time) {
-            total_time = gantt_chart[i].end_time;
+    char line[TRACE_LINE_MAX];
+    int capacity = 0;
+    long line_number = 0;
+    ProcessIndex names = { 0 };
+    *out = NULL;
+    *count = 0;
+    if (groups) groups->count = 0;
+    if (resources) resources->count = 0;
+
+    while (fgets(line, sizeof(line), file)) {
+        char name[MAX_NAME_LEN];
+        char bursts[TRACE_LINE_MAX];
+        char group_path[MAX_GROUP_PATH + 1] = "/";
+        char arrival_text[32];
+        char* arrival_end;
+        int priority = 1, weight = 0, group = 0;
+        SimTime arrival = -1;
+        Process parsed;
+        line_number++;
+
+        char* hash = strchr(line, '#');
+        if (hash) *hash = '\0';
+        if (sscanf(line, " %19s", name) != 1) continue;
+
+        char second[2];
+        if (strcmp(name, "group") == 0 && sscanf(line, " %*s %1s", second) == 1 && second[0] == '/') {
+            char message[256];
+            if (!groups) snprintf(message, sizeof(message), "bandwidth groups are not supported here");
+            if (!groups || !parse_group(line, groups, message, sizeof(message))) {
+                snprintf(error, error_len, "%s:%ld: %s", path, line_number, message);
+                fclose(file);
+                free(*out);
+                *out = NULL;
+                process_index_free(&names);
+                return -1;
+            }
+            continue;
         }
-    }
-
-    // Draw title
-    cairo_set_source_rgb(cr, 0.0, 0.0, 0.0);
-    cairo_select_font_face(cr, "Arial", CAIRO_FONT_SLANT_NORMAL, CAIRO_FONT_WEIGHT_BOLD);
-    cairo_set_font_size(cr, 16);
-    cairo_move_to(cr, 20, 25);
-    cairo_show_text(cr, "Gantt Chart");
 
-    // Calculate dimensions
-    int chart_start_y = 50;
-    int chart_height = 40;
-    int chart_width = width - 100;
-    double time_scale = (double)chart_width / total_time;
+        int fields = sscanf(line, " %19s %31s %s %d %d %64s", name, arrival_text, bursts, &priority, &weight,
+            group_path);
+        if (fields >= 2) arrival = parse_time(arrival_text, &arrival_end);
+        if (fields < 3 || arrival_end == arrival_text || *arrival_end != '\0' ||
+            arrival < 0 || weight < 0 || weight > MAX_WEIGHT) {
+            snprintf(error, error_len, "%s:%ld: expected NAME ARRIVAL BURST [PRIORITY [WEIGHT [GROUP]]], weight 0-%d",
+                path, line_number, MAX_WEIGHT);
+            fclose(file);
+            free(*out);
+            *out = NULL;
+            process_index_free(&names);
+            return -1;
+        }
+        char message[256];
+        if (!parse_process_bursts(bursts, &parsed, resources, message, sizeof(message))) {
+            snprintf(error, error_len, "%s:%ld: %s", path, line_number, message);
+            fclose(file);
+            free(*out);
+            *out = NULL;
+            process_index_free(&names);
+            return -1;
+        }
+        if (strcmp(group_path, "/") != 0 && (!groups || (group = find_group(groups, group_path)) < 0)) {
+            snprintf(error, error_len, "%s:%ld: %s", path, line_number,
+                groups ? "group must be defined before its processes" : "bandwidth groups are not supported here");
+            fclose(file);
+            free(*out);
+            *out = NULL;
+            process_index_free(&names);
+            return -1;
+        }
 
-    // Draw time axis
-    cairo_set_source_rgb(cr, 0.0, 0.0, 0.0);
-    cairo_set_line_width(cr, 1);
-    cairo_move_to(cr, 50, chart_start_y + chart_height);
-    cairo_line_to(cr, 50 + chart_width, chart_start_y + chart_height);
-    cairo_stroke(cr);
+        int previous = process_index_find_name(&names, *out, name);
+        if (previous >= 0) {
+            snprintf(error, error_len, "%s:%ld: name %s is already used by process %d", path, line_number, name,
+                (*out)[previous].process_id);
+            fclose(file);
+            free(*out);
+            *out = NULL;
+            process_index_free(&names);
+            return -1;
+        }
 
-    // Draw Gantt blocks
-    for (int i = 0; i < gantt_count; i++) {
-        GanttBlock* block = &gantt_chart[i];
+        if (*count == capacity) {
+            capacity = capacity ? capacity * 2 : 1024;
+            *out = realloc(*out, capacity * sizeof(Process));
+        }
+        Process* p = &(*out)[*count];
+        memset(p, 0, sizeof(*p));
+        strcpy(p->name, name);
+        p->arrival_time = arrival;
+        p->burst_time = parsed.burst_time;
+        p->io_count = parsed.io_count;
+        memcpy(p->io, parsed.io, parsed.io_count * sizeof(IoBurst));
+        p->lock_count = parsed.lock_count;
+        memcpy(p->locks, parsed.locks, parsed.lock_count * sizeof(LockSpan));
+        p->priority = priority;
+        p->weight = weight;
+        p->group = group;
+        p->process_id = *count + 1;
+        p->color = process_colors[*count % 10];
+        process_index_add(&names, *out, (*count)++);
+    }
 
-        double start_x = 50 + (block->start_time * time_scale);
-        double block_width = (block->end_time - block->start_time) * time_scale;
+    fclose(file);
+    process_index_free(&names);
+    if (*count == 0) {
+        snprintf(error, error_len, "%s has no processes", path);
+        return -1;
+    }
+    reset_process_state(*out, *count);
+    return 0;
+}
 
-        // Draw colored rectangle
-        cairo_set_source_rgba(cr, block->color.red, block->color.green,
-            block->color.blue, block->color.alpha);
-        cairo_rectangle(cr, start_x, chart_start_y, block_width, chart_height);
-        cairo_fill(cr);
+// chart.png -> chart-003.png when there is more than one tile
+void export_tile_path(const char* path, int tile, int tiles, char* out, size_t out_len) {
+    const char* dot = strrchr(path, '.');
+    if (tiles <= 1 || !dot) {
+        snprintf(out, out_len, "%s", path);
+        return;
+    }
+    snprintf(out, out_len, "%.*s-%03d%s", (int)(dot - path), path, tile + 1, dot);
+}
 
-        // Draw border
-        cairo_set_source_rgb(cr, 0.0, 0.0, 0.0);
-        cairo_set_line_width(cr, 1);
-        cairo_rectangle(cr, start_x, chart_start_y, block_width, chart_height);
-        cairo_stroke(cr);
+void render_export_page(cairo_t* cr, const ExportConfig* config, const Simulation* sim,
+    const TraceReplay* tr, int tile, int width, int height) {
+    if (config->chart == EXPORT_PERFORMANCE) {
+        render_performance_chart(cr, sim->processes, sim->process_count, width, height);
+        return;
+    }
 
-        // Draw process name
-        cairo_set_source_rgb(cr, 0.0, 0.0, 0.0);
-        cairo_set_font_size(cr, 10);
-        cairo_move_to(cr, start_x + 2, chart_start_y + chart_height / 2 + 3);
-        cairo_show_text(cr, block->process_name);
+    double total_time = tr ? trace_replay_end(tr) : sim->gantt[sim->gantt_count - 1].end_time;
+    double from = total_time * tile / config->tiles;
+    double to = total_time * (tile + 1) / config->tiles;
 
-        // Draw time labels
-        cairo_set_font_size(cr, 8);
-        char time_str[10];
-        snprintf(time_str, sizeof(time_str), "%d", block->start_time);
-        cairo_move_to(cr, start_x, chart_start_y + chart_height + 15);
-        cairo_show_text(cr, time_str);
+    if (tr) {
+        render_trace_gantt(cr, tr, from, to, width, height);
+        return;
     }
 
-    // Draw final time
-    if (gantt_count > 0) {
-        cairo_set_font_size(cr, 8);
-        char time_str[10];
-        snprintf(time_str, sizeof(time_str), "%d", total_time);
-        cairo_move_to(cr, 50 + chart_width - 10, chart_start_y + chart_height + 15);
-        cairo_show_text(cr, time_str);
+    char title[96];
+    if (config->tiles > 1) {
+        snprintf(title, sizeof(title), "Gantt Chart (%d of %d)", tile + 1, config->tiles);
     }
-
-    return FALSE;
+    else {
+        snprintf(title, sizeof(title), "Gantt Chart");
+    }
+    render_gantt_chart(cr, sim, title, from, to, width, height);
 }
 
-gboolean on_performance_draw(GtkWidget* widget, cairo_t* cr, gpointer user_data) {
-    GtkAllocation allocation;
-    gtk_widget_get_allocation(widget, &allocation);
+// Exports the run in sim, or the trace replay when tr is set
+int export_chart(const ExportConfig* config, const Simulation* sim, const TraceReplay* tr,
+    char* error, size_t error_len) {
+    const char* dot = strrchr(config->path, '.');
+    const char* extension = dot ? dot + 1 : "";
+    int is_png = strcasecmp(extension, "png") == 0;
+    int is_svg = strcasecmp(extension, "svg") == 0;
+    int is_pdf = strcasecmp(extension, "pdf") == 0;
+
+    if (!is_png && !is_svg && !is_pdf) {
+        snprintf(error, error_len, "Cannot tell the format of %s (use .png, .svg, .pdf or .json)", config->path);
+        return -1;
+    }
+    if (config->chart == EXPORT_GANTT && !tr && sim->gantt_count == 0) {
+        snprintf(error, error_len, "Nothing to draw");
+        return -1;
+    }
 
-    int width = allocation.width;
-    int height = allocation.height;
+    int width = config->width;
+    int height = config->height;
+    int tiles = config->chart == EXPORT_GANTT ? config->tiles : 1;
+    if (height <= 0) {
+        if (config->chart == EXPORT_PERFORMANCE) height = 120 + 30 * sim->process_count;
+        else if (tr) height = 260;
+        else height = gantt_chart_height(sim);
+    }
 
-    // Clear background
-    cairo_set_source_rgb(cr, 1.0, 1.0, 1.0);
-    cairo_paint(cr);
+    cairo_surface_t* pdf = NULL;
+    if (is_pdf) pdf = cairo_pdf_surface_create(config->path, width, height);
 
-    if (process_count == 0) {
-        cairo_set_source_rgb(cr, 0.0, 0.0, 0.0);
-        cairo_move_to(cr, 20, height / 2);
-        cairo_show_text(cr, "No process data available.");
-        return FALSE;
-    }
+    for (int tile = 0; tile < tiles; tile++) {
+        char path[PATH_MAX];
+        export_tile_path(config->path, tile, tiles, path, sizeof(path));
 
-    // Draw title
-    cairo_set_source_rgb(cr, 0.0, 0.0, 0.0);
-    cairo_select_font_face(cr, "Arial", CAIRO_FONT_SLANT_NORMAL, CAIRO_FONT_WEIGHT_BOLD);
-    cairo_set_font_size(cr, 16);
-    cairo_move_to(cr, 20, 25);
-    cairo_show_text(cr, "Performance Matrix");
+        cairo_surface_t* surface = pdf;
+        if (is_png) surface = cairo_image_surface_create(CAIRO_FORMAT_ARGB32, width, height);
+        if (is_svg) surface = cairo_svg_surface_create(path, width, height);
+        if (cairo_surface_status(surface) != CAIRO_STATUS_SUCCESS) {
+            snprintf(error, error_len, "Cannot create %s", path);
+            cairo_surface_destroy(surface);
+            return -1;
+        }
 
-    // Calculate chart dimensions
-    int chart_start_x = 80;
-    int chart_start_y = 60;
-    int chart_width = width - 150;
-    int chart_height = height - 120;
-    int bar_height = chart_height / (process_count * 3 + 2); // 3 metrics per process
+        cairo_t* cr = cairo_create(surface);
+        render_export_page(cr, config, sim, tr, tile, width, height);
+        if (is_pdf) cairo_show_page(cr);
+        cairo_destroy(cr);
+
+        int failed = 0;
+        if (is_png) failed = cairo_surface_write_to_png(surface, path) != CAIRO_STATUS_SUCCESS;
+        if (!is_pdf) {
+            cairo_surface_finish(surface);
+            failed = failed || cairo_surface_status(surface) != CAIRO_STATUS_SUCCESS;
+            cairo_surface_destroy(surface);
+        }
+        if (failed) {
+            snprintf(error, error_len, "Cannot write %s", path);
+            if (pdf) cairo_surface_destroy(pdf);
+            return -1;
+        }
+    }
 
-    // Find maximum values for scaling
-    int max_tat = 0, max_wt = 0, max_rt = 0;
-    for (int i = 0; i < process_count; i++) {
-        if (processes[i].turnaround_time > max_tat) max_tat = processes[i].turnaround_time;
-        if (processes[i].waiting_time > max_wt) max_wt = processes[i].waiting_time;
-        if (processes[i].response_time > max_rt) max_rt = processes[i].response_time;
+    if (pdf) {
+        cairo_surface_finish(pdf);
+        int failed = cairo_surface_status(pdf) != CAIRO_STATUS_SUCCESS;
+        cairo_surface_destroy(pdf);
+        if (failed) {
+            snprintf(error, error_len, "Cannot write %s", config->path);
+            return -1;
+        }
     }
-    int max_value = (max_tat > max_wt) ? ((max_tat > max_rt) ? max_tat : max_rt) :
-        ((max_wt > max_rt) ? max_wt : max_rt);
+    return 0;
+}
 
-    if (max_value == 0) max_value = 1; // Avoid division by zero
+// Exports a trace replay, a workload file, or one generated workload; a .json
+// path gets trace events instead of a chart
+int run_export(const ExportConfig* config, const ReplicationConfig* replication, const char* trace_path,
+    const TraceConfig* trace_config, const char* workload_path) {
+    char error[1200];
+    int status = 0;
+    const char* dot = strrchr(config->path, '.');
+    int is_json = dot && strcasecmp(dot + 1, "json") == 0;
+
+    if (trace_path) {
+        TraceReplay tr;
+        memset(&tr, 0, sizeof(tr));
+
+        status = import_trace(&tr, trace_path, trace_config, error, sizeof(error));
+        if (status == 0) {
+            replay_trace(&tr, replication->algo, replication->time_quantum);
+            if (is_json) status = export_trace_events(config->path, NULL, 0, &tr, error, sizeof(error));
+            else status = export_chart(config, &tr.simulated, config->chart == EXPORT_GANTT ? &tr : NULL,
+                error, sizeof(error));
+        }
+        trace_replay_free(&tr);
+    }
+    else {
+        Process* procs;
+        int count;
+        GroupConfig groups;
+        ResourceTable resources;
+
+        groups.count = 0;
+        resources.count = 0;
+        if (workload_path) {
+            status = load_workload(workload_path, &procs, &count, &groups, &resources, error, sizeof(error));
+        }
+        else {
+            RngState rng;
+            count = replication->jobs;
+            procs = malloc(count * sizeof(Process));
+            rng_seed(&rng, replication->seed, 0);
+            generate_workload(procs, count, &rng, replication);
+        }
 
-    double scale = (double)chart_width / max_value;
+        if (status == 0) {
+            Simulation sim;
+            init_simulation(&sim, procs, count, replication->time_quantum);
+            sim.spill = gantt_spill_create();
+            sim.cost = replication->cost;
+            sim.io = replication->io;
+            sim.aging_interval = replication->aging_interval;
+            sim.seed = replication->seed;
+            sim.groups = groups;
+            sim.resources = resources;
+            sim.lock_protocol = replication->lock_protocol;
+            run_fast_scheduler(&sim, replication->algo);
+
+            if (is_json) {
+                status = export_trace_events(config->path, &sim, replication->algo, NULL, error, sizeof(error));
+            }
+            else {
+                // A bar chart is only readable for a table's worth of processes
+                if (config->chart == EXPORT_PERFORMANCE && sim.process_count > MAX_PROCESSES) {
+                    sim.process_count = MAX_PROCESSES;
+                }
+                status = export_chart(config, &sim, NULL, error, sizeof(error));
+            }
+            free_simulation(&sim);
+            free(procs);
+        }
+    }
 
-    int y_pos = chart_start_y;
+    if (status != 0) {
+        fprintf(stderr, "%s\n", error);
+        return 1;
+    }
+    return 0;
+}
 
-    // Draw bars for each process
-    for (int i = 0; i < process_count; i++) {
-        Process* p = &processes[i];
+// Trace-event export
+//
+// Writes a run as Chrome trace-event JSON, which chrome://tracing, Perfetto
+// and other viewers built for long timelines can open. Process 1 holds the
+// CPU lane (the recorded and simulated lanes for a trace replay) and any
+// device lanes; process 2 holds one thread per scheduled process with its
+// arrival, wait, run slices, preemptions, I/O departures and completion.
+// Events go straight to the file as the Gantt log is visited, so a spilled
+// log is read one chunk at a time and the document is never held in memory.
+
+void json_write_string(FILE* file, const char* value) {
+    fputc('"', file);
+    for (const char* c = value; *c; c++) {
+        if (*c == '"' || *c == '\\') fprintf(file, "\\%c", *c);
+        else if ((unsigned char)*c < 0x20) fprintf(file, "\\u%04x", *c);
+        else fputc(*c, file);
+    }
+    fputc('"', file);
+}
 
-        // Process name label
-        cairo_set_source_rgb(cr, 0.0, 0.0, 0.0);
-        cairo_set_font_size(cr, 10);
-        cairo_move_to(cr, 10, y_pos + bar_height / 2 + 3);
-        cairo_show_text(cr, p->name);
+void trace_event_begin(TraceEventWriter* w) {
+    fputs(w->events++ ? ",\n" : "\n", w->file);
+}
 
-        // Turnaround Time bar
-        cairo_set_source_rgb(cr, 0.8, 0.2, 0.2); // Red
-        cairo_rectangle(cr, chart_start_x, y_pos, p->turnaround_time * scale, bar_height - 2);
-        cairo_fill(cr);
+void trace_event_metadata(TraceEventWriter* w, int pid, int tid, const char* kind, const char* name) {
+    trace_event_begin(w);
+    fprintf(w->file, "{\"ph\":\"M\",\"name\":\"%s_name\",\"pid\":%d,\"tid\":%d,\"args\":{\"name\":", kind, pid, tid);
+    json_write_string(w->file, name);
+    fputs("}}", w->file);
 
-        // Value label
-        cairo_set_source_rgb(cr, 0.0, 0.0, 0.0);
-        cairo_set_font_size(cr, 8);
-        char val_str[20];
-        snprintf(val_str, sizeof(val_str), "TAT: %d", p->turnaround_time);
-        cairo_move_to(cr, chart_start_x + p->turnaround_time * scale + 5, y_pos + bar_height / 2 + 3);
-        cairo_show_text(cr, val_str);
+    // Keep lanes in the order they are declared rather than sorted by name
+    trace_event_begin(w);
+    fprintf(w->file, "{\"ph\":\"M\",\"name\":\"%s_sort_index\",\"pid\":%d,\"tid\":%d,\"args\":{\"sort_index\":%d}}",
+        kind, pid, tid, tid ? tid : pid);
+}
 
-        y_pos += bar_height;
+// visit_gantt_log callback: one slice per block on the CPU lane and, with
+// lifecycle tracks, a run slice on the process's own thread. A slice that
+// ends before completion is marked as a preemption, or as a departure for
+// I/O when the process's CPU time has reached its next request.
+void write_trace_event_blocks(const GanttBlock* blocks, int count, void* data) {
+    TraceEventWriter* w = data;
+
+    for (int i = 0; i < count; i++) {
+        const GanttBlock* b = &blocks[i];
+        double ts = b->start_time * w->unit_us;
+        double dur = (b->end_time - b->start_time) * w->unit_us;
+
+        trace_event_begin(w);
+        fputs("{\"ph\":\"X\",\"cat\":\"cpu\",\"name\":", w->file);
+        json_write_string(w->file, b->process_name);
+        fprintf(w->file, ",\"ts\":%.*f,\"dur\":%.*f,\"pid\":%d,\"tid\":%d,\"args\":{\"process\":%d}}",
+            w->decimals, ts, w->decimals, dur, w->pid, w->tid, w->processes[b->process_index].process_id);
+
+        // Switch overhead nests at the start of the slice
+        if (b->overhead > 0) {
+            double overhead = b->overhead * w->unit_us;
+            trace_event_begin(w);
+            fprintf(w->file, "{\"ph\":\"X\",\"cat\":\"switch\",\"name\":\"switch\",\"ts\":%.*f,\"dur\":%.*f,"
+                "\"pid\":%d,\"tid\":%d}", w->decimals, ts, w->decimals, overhead, w->pid, w->tid);
+            ts += overhead;
+            dur -= overhead;
+        }
 
-        // Waiting Time bar
-        cairo_set_source_rgb(cr, 0.2, 0.8, 0.2); // Green
-        cairo_rectangle(cr, chart_start_x, y_pos, p->waiting_time * scale, bar_height - 2);
-        cairo_fill(cr);
+        if (!w->lifecycle) continue;
+        const Process* p = &w->lifecycle[b->process_index];
+        trace_event_begin(w);
+        fprintf(w->file, "{\"ph\":\"X\",\"cat\":\"process\",\"name\":\"run\",\"ts\":%.*f,\"dur\":%.*f,"
+            "\"pid\":2,\"tid\":%d}", w->decimals, ts, w->decimals, dur, p->process_id);
+
+        SimTime used = w->cpu_used[b->process_index] += b->end_time - b->start_time - b->overhead;
+        if (b->end_time < p->completion_time) {
+            const char* reason = "preempted";
+            for (int k = 0; k < p->io_count; k++) {
+                if (p->io[k].after == used) reason = "blocked on I/O";
+            }
+            trace_event_begin(w);
+            fprintf(w->file, "{\"ph\":\"i\",\"s\":\"t\",\"cat\":\"process\",\"name\":\"%s\",\"ts\":%.*f,"
+                "\"pid\":2,\"tid\":%d}", reason, w->decimals, ts + dur, p->process_id);
+        }
+    }
+}
 
-        snprintf(val_str, sizeof(val_str), "WT: %d", p->waiting_time);
-        cairo_move_to(cr, chart_start_x + p->waiting_time * scale + 5, y_pos + bar_height / 2 + 3);
-        cairo_show_text(cr, val_str);
+// Arrival, wait for the first run, first run and completion of each process,
+// on a thread numbered by its id
+void write_process_lifecycle(TraceEventWriter* w, const Process* processes, int count) {
+    for (int i = 0; i < count; i++) {
+        const Process* p = &processes[i];
+        int tid = p->process_id;
+        double arrival = p->arrival_time * w->unit_us;
+        trace_event_metadata(w, 2, tid, "thread", p->name);
+
+        trace_event_begin(w);
+        fprintf(w->file, "{\"ph\":\"i\",\"s\":\"t\",\"cat\":\"process\",\"name\":\"arrival\",\"ts\":%.*f,"
+            "\"pid\":2,\"tid\":%d,\"args\":{\"burst\":%lld,\"priority\":%d}}",
+            w->decimals, arrival, tid, (long long)p->burst_time, p->priority);
+        if (p->start_time < 0) continue;
+
+        double start = p->start_time * w->unit_us;
+        if (start > arrival) {
+            trace_event_begin(w);
+            fprintf(w->file, "{\"ph\":\"X\",\"cat\":\"process\",\"name\":\"waiting\",\"ts\":%.*f,\"dur\":%.*f,"
+                "\"pid\":2,\"tid\":%d}", w->decimals, arrival, w->decimals, start - arrival, tid);
+        }
 
-        y_pos += bar_height;
+        trace_event_begin(w);
+        fprintf(w->file, "{\"ph\":\"i\",\"s\":\"t\",\"cat\":\"process\",\"name\":\"first run\",\"ts\":%.*f,"
+            "\"pid\":2,\"tid\":%d}", w->decimals, start, tid);
 
-        // Response Time bar
-        cairo_set_source_rgb(cr, 0.2, 0.2, 0.8); // Blue
-        cairo_rectangle(cr, chart_start_x, y_pos, p->response_time * scale, bar_height - 2);
-        cairo_fill(cr);
+        trace_event_begin(w);
+        fprintf(w->file, "{\"ph\":\"i\",\"s\":\"t\",\"cat\":\"process\",\"name\":\"completion\",\"ts\":%.*f,"
+            "\"pid\":2,\"tid\":%d,\"args\":{\"turnaround\":%lld,\"waiting\":%lld,\"response\":%lld}}",
+            w->decimals, p->completion_time * w->unit_us, tid, (long long)p->turnaround_time,
+            (long long)p->waiting_time, (long long)p->response_time);
+    }
+}
 
-        snprintf(val_str, sizeof(val_str), "RT: %d", p->response_time);
-        cairo_move_to(cr, chart_start_x + p->response_time * scale + 5, y_pos + bar_height / 2 + 3);
-        cairo_show_text(cr, val_str);
+// Exports the run in sim made by algo, or the trace replay when tr is set.
+// Simulated time units are written as milliseconds, or as the trace's tick.
+int export_trace_events(const char* path, const Simulation* sim, SchedulingAlgorithm algo,
+    const TraceReplay* tr, char* error, size_t error_len) {
+    if (tr) {
+        sim = &tr->simulated;
+        algo = tr->algo;
+    }
+    if (gantt_log_length(sim->spill, sim->gantt_count) == 0) {
+        snprintf(error, error_len, "Nothing to export");
+        return -1;
+    }
 
-        y_pos += bar_height + 5;
+    FILE* file = fopen(path, "w");
+    if (!file) {
+        snprintf(error, error_len, "Cannot create %s", path);
+        return -1;
+    }
+    setvbuf(file, NULL, _IOFBF, 1 << 20);
+
+    // Abstract units show as milliseconds
+    double unit_us = tr ? tr->tick_ns / 1000.0 : time_unit == TIME_UNIT_NONE ? 1000 : time_unit_ns[time_unit] / 1000.0;
+    TraceEventWriter w = { file, 0, unit_us, unit_us < 1 ? 3 : 0, 1, 1, sim->processes, NULL,
+        calloc(sim->process_count, sizeof(SimTime)) };
+    char lane[64];
+    snprintf(lane, sizeof(lane), "%s (%s)", tr ? "Simulated" : "Schedule", algorithm_keys[algo - 1]);
+
+    fputs("{\"displayTimeUnit\":\"ms\",\"traceEvents\":[", file);
+    trace_event_metadata(&w, 1, 0, "process", "CPU");
+    trace_event_metadata(&w, 2, 0, "process", "Processes");
+
+    if (tr) {
+        trace_event_metadata(&w, 1, 1, "thread", "Recorded");
+        visit_gantt_log(tr->recorded_spill, tr->recorded, tr->recorded_count, 0, INT64_MAX,
+            write_trace_event_blocks, &w);
+        w.tid = 2;
+    }
+    trace_event_metadata(&w, 1, w.tid, "thread", lane);
+    w.lifecycle = sim->processes;
+    visit_gantt_log(sim->spill, sim->gantt, sim->gantt_count, 0, INT64_MAX, write_trace_event_blocks, &w);
+    write_process_lifecycle(&w, sim->processes, sim->process_count);
+
+    // Device lanes follow the CPU lane in process 1
+    w.lifecycle = NULL;
+    for (int d = 0; sim->io_log && d < sim->io_log->device_count; d++) {
+        w.tid++;
+        snprintf(lane, sizeof(lane), "Device %d (%s)", d + 1, io_discipline_keys[io_discipline(&sim->io, d)]);
+        trace_event_metadata(&w, 1, w.tid, "thread", lane);
+        visit_gantt_log(NULL, sim->io_log->gantt[d], sim->io_log->gantt_count[d], 0, INT64_MAX,
+            write_trace_event_blocks, &w);
+    }
+    fputs("\n]}\n", file);
+    free(w.cpu_used);
+
+    int failed = ferror(file);
+    failed = fclose(file) != 0 || failed;
+    if (failed) {
+        snprintf(error, error_len, "Cannot write %s", path);
+        return -1;
     }
+    return 0;
+}
 
-    // Draw legend
-    int legend_y = height - 40;
-    cairo_set_font_size(cr, 10);
+// Differential checking
+//
+// The tick-based loops are the reference the optimized engines must match.
+// Random small workloads with many tied arrivals, bursts and priorities, idle
+// gaps, and a table order that differs from arrival order are run through the
+// reference and through each engine, half of them with a random switch cost;
+// the Gantt blocks and calculate_times() metrics must agree exactly. A
+// mismatch is shrunk greedily (dropping processes, then lowering arrivals,
+// bursts, priorities and the quantum while it still fails, then the switch
+// cost) and printed as a workload file that reproduces it. Runs with
+// bandwidth groups whose quotas bind have no reference, so they are checked
+// against the rules of the quotas instead.
+
+const char* verify_engine_names[] = { "event-driven", "resumed after an add", "resumed after a delete", "I/O",
+    "grouped", "throttled", "locked" };
+
+// Groups of the grouped engines. Quotas of at least their period never bind,
+// and a chain of groups that only the last one holds processes in leaves
+// Stride and Lottery with a single choice at every level above it.
+const char* verify_group_lines[2][4] = {
+    { "group /a max 10", "group /a/b 7 7 3", "group /a/b/c 9 5 2", NULL },
+    { "group /a 2 5 2", "group /a/b 1 3 1", "group /c 4 7 3", "group /d max 4" },
+};
 
-    cairo_set_source_rgb(cr, 0.8, 0.2, 0.2);
-    cairo_rectangle(cr, 20, legend_y, 15, 10);
-    cairo_fill(cr);
-    cairo_set_source_rgb(cr, 0.0, 0.0, 0.0);
-    cairo_move_to(cr, 40, legend_y + 8);
-    cairo_show_text(cr, "Turnaround Time");
+// Sets up the groups of a grouped engine and puts the processes in them
+void verify_groups(const VerifyCase* c, Process* procs, GroupConfig* groups) {
+    int throttled = c->engine == VERIFY_THROTTLING;
+    char error[256];
 
-    cairo_set_source_rgb(cr, 0.2, 0.8, 0.2);
-    cairo_rectangle(cr, 150, legend_y, 15, 10);
-    cairo_fill(cr);
-    cairo_set_source_rgb(cr, 0.0, 0.0, 0.0);
-    cairo_move_to(cr, 170, legend_y + 8);
-    cairo_show_text(cr, "Waiting Time");
+    groups->count = 0;
+    for (int g = 0; g < 4 && verify_group_lines[throttled][g]; g++) {
+        parse_group(verify_group_lines[throttled][g], groups, error, sizeof(error));
+    }
+    for (int i = 0; i < c->count; i++) {
+        if (throttled) procs[i].group = i % 5;
+        else procs[i].group = proportional_share(c->algo) ? 3 : i % 4;
+    }
+}
 
-    cairo_set_source_rgb(cr, 0.2, 0.2, 0.8);
-    cairo_rectangle(cr, 260, legend_y, 15, 10);
-    cairo_fill(cr);
-    cairo_set_source_rgb(cr, 0.0, 0.0, 0.0);
-    cairo_move_to(cr, 280, legend_y + 8);
-    cairo_show_text(cr, "Response Time");
+// Gives two processes in three a lock, on r1 or r2 in turn, with r3 nested
+// inside when the span is long enough. The spans follow from the process's
+// fields, so they keep fitting as the shrinker cuts bursts down.
+void verify_locks(const VerifyCase* c, Process* procs, ResourceTable* resources) {
+    resources->count = 3;
+    for (int r = 0; r < resources->count; r++) {
+        snprintf(resources->name[r], MAX_RESOURCE_NAME, "r%d", r + 1);
+    }
+    for (int i = 0; i < c->count; i++) {
+        Process* p = &procs[i];
+        p->lock_count = 0;
+        if (i % 3 == 2) continue;
+
+        SimTime acquire = (p->priority - 1) % p->burst_time;
+        SimTime release = acquire + 1 + p->arrival_time % (p->burst_time - acquire);
+        p->locks[p->lock_count++] = (LockSpan){ i % 2, acquire, release };
+        if (release - acquire >= 3) p->locks[p->lock_count++] = (LockSpan){ 2, acquire + 1, release - 1 };
+    }
+}
 
-    return FALSE;
+// Half the arrivals tie with the one before, a fifth follow an idle gap
+void generate_verify_workload(Process* out, int count, RngState* rng) {
+    int clock = (int)(rng_next(rng) % 3);
+
+    for (int i = 0; i < count; i++) {
+        Process* p = &out[i];
+        uint64_t gap = rng_next(rng) % 10;
+        if (i > 0 && gap >= 8) clock += 4 + (int)(rng_next(rng) % 12);
+        else if (i > 0 && gap >= 5) clock += 1 + (int)(rng_next(rng) % 3);
+
+        memset(p, 0, sizeof(*p));
+        p->arrival_time = clock;
+        p->burst_time = 1 + (int)(rng_next(rng) % 8);
+        p->priority = 1 + (int)(rng_next(rng) % 3);
+        p->weight = rng_next(rng) % 2 ? 0 : 1 + (int)(rng_next(rng) % 4);
+    }
+
+    // Table order is what breaks ties, so it must not follow arrival order
+    for (int i = count - 1; i > 0; i--) {
+        int j = (int)(rng_next(rng) % (uint64_t)(i + 1));
+        Process swap = out[i];
+        out[i] = out[j];
+        out[j] = swap;
+    }
+    for (int i = 0; i < count; i++) {
+        snprintf(out[i].name, MAX_NAME_LEN, "P%d", i + 1);
+        out[i].process_id = i + 1;
+        out[i].color = process_colors[i % 10];
+    }
+    reset_process_state(out, count);
 }
 
-void simulate_scheduling(SchedulingAlgorithm algo) {
-    reset_simulation();
-    current_time = 0;
-    gantt_count = 0;
+// Both runners give sim its own copy of the workload; the caller frees
+// sim->processes after free_simulation
+void run_reference(const VerifyCase* c, Simulation* sim) {
+    Process* procs = malloc(c->count * sizeof(Process) + 1);
+    memcpy(procs, c->processes, c->count * sizeof(Process));
+    reset_process_state(procs, c->count);
+
+    init_simulation(sim, procs, c->count, c->time_quantum);
+    sim->cost = c->cost;
+    sim->aging_interval = c->aging_interval;
+    run_scheduler(sim, c->algo);
+}
 
-    switch (algo) {
-    case FCFS:
-        fcfs_scheduling();
+void run_verify_engine(const VerifyCase* c, Simulation* sim) {
+    int n = c->count;
+    Process* procs = malloc((n + 1) * sizeof(Process));
+    CheckpointLog log;
+    IncrementalReport report;
+    memset(&log, 0, sizeof(log));
+
+    switch (c->engine) {
+    case VERIFY_EVENT_DRIVEN:
+        memcpy(procs, c->processes, n * sizeof(Process));
+        init_simulation(sim, procs, n, c->time_quantum);
+        sim->cost = c->cost;
+        sim->aging_interval = c->aging_interval;
+        run_fast_scheduler(sim, c->algo);
         break;
-    case SJF:
-        sjf_scheduling();
-        break;
-    case SRTF:
-        srtf_scheduling();
+    case VERIFY_RESUME_ADD:
+        memcpy(procs, c->processes, n * sizeof(Process));
+        init_simulation(sim, procs, n - 1, c->time_quantum);
+        sim->cost = c->cost;
+        sim->aging_interval = c->aging_interval;
+        run_incremental(sim, c->algo, &log, &report);
+
+        sim->process_count = n;
+        invalidate_arrival_order(sim);
+        run_incremental(sim, c->algo, &log, &report);
         break;
-    case PRIORITY:
-        priority_scheduling();
+    case VERIFY_IO:
+    case VERIFY_GROUPS:
+    case VERIFY_THROTTLING:
+        memcpy(procs, c->processes, n * sizeof(Process));
+        init_simulation(sim, procs, n, c->time_quantum);
+        sim->cost = c->cost;
+        sim->aging_interval = c->aging_interval;
+        if (c->engine != VERIFY_IO) verify_groups(c, procs, &sim->groups);
+        run_io_scheduler(sim, c->algo);
         break;
-    case ROUND_ROBIN:
-        round_robin_scheduling();
+    case VERIFY_LOCKS:
+        memcpy(procs, c->processes, n * sizeof(Process));
+        init_simulation(sim, procs, n, c->time_quantum);
+        sim->cost = c->cost;
+        sim->aging_interval = c->aging_interval;
+        sim->lock_protocol = c->lock_protocol;
+        verify_locks(c, procs, &sim->resources);
+        run_fast_scheduler(sim, c->algo);
         break;
-    case PREEMPTIVE_PRIORITY:
-        preemptive_priority_scheduling();
+    default:
+        // A copy of the last process, under an id of its own, sits at the top
+        // of the table until it is deleted, so every other index shifts down by one
+        procs[0] = c->processes[n - 1];
+        procs[0].process_id = n + 1;
+        memcpy(procs + 1, c->processes, n * sizeof(Process));
+        init_simulation(sim, procs, n + 1, c->time_quantum);
+        sim->cost = c->cost;
+        sim->aging_interval = c->aging_interval;
+        run_incremental(sim, c->algo, &log, &report);
+
+        memmove(procs, procs + 1, n * sizeof(Process));
+        sim->process_count = n;
+        invalidate_arrival_order(sim);
+        run_incremental(sim, c->algo, &log, &report);
         break;
     }
 
-    calculate_times();
+    checkpoint_log_reset(&log);
 }
 
-void fcfs_scheduling() {
-    // Sort processes by arrival time
-    for (int i = 0; i < process_count - 1; i++) {
-        for (int j = 0; j < process_count - i - 1; j++) {
-            if (processes[j].arrival_time > processes[j + 1].arrival_time) {
-                Process temp = processes[j];
-                processes[j] = processes[j + 1];
-                processes[j + 1] = temp;
-            }
+// Returns 0 if both runs made the same schedule, or describes the first difference
+int compare_schedules(const Simulation* expected, const Simulation* actual, char* diff, size_t diff_len) {
+    int blocks = expected->gantt_count < actual->gantt_count ? expected->gantt_count : actual->gantt_count;
+
+    for (int i = 0; i < blocks; i++) {
+        const GanttBlock* a = &expected->gantt[i];
+        const GanttBlock* b = &actual->gantt[i];
+        if (a->start_time != b->start_time || a->end_time != b->end_time || a->process_index != b->process_index ||
+            a->overhead != b->overhead) {
+            snprintf(diff, diff_len, "Gantt block %d: reference runs %s (row %d) over %lld-%lld with %d overhead, "
+                "engine runs %s (row %d) over %lld-%lld with %d overhead", i + 1, a->process_name, a->process_index + 1,
+                (long long)a->start_time, (long long)a->end_time, a->overhead, b->process_name, b->process_index + 1,
+                (long long)b->start_time, (long long)b->end_time, b->overhead);
+            return 1;
         }
     }
+    if (expected->gantt_count != actual->gantt_count) {
+        snprintf(diff, diff_len, "Reference has %d Gantt blocks, engine has %d",
+            expected->gantt_count, actual->gantt_count);
+        return 1;
+    }
 
-    current_time = 0;
-    for (int i = 0; i < process_count; i++) {
-        Process* p = &processes[i];
-
-        if (current_time < p->arrival_time) {
-            current_time = p->arrival_time;
+    for (int i = 0; i < expected->process_count; i++) {
+        const Process* a = &expected->processes[i];
+        const Process* b = &actual->processes[i];
+        if (a->start_time != b->start_time || a->completion_time != b->completion_time ||
+            a->turnaround_time != b->turnaround_time || a->waiting_time != b->waiting_time ||
+            a->response_time != b->response_time) {
+            snprintf(diff, diff_len, "%s: start/completion/turnaround/waiting/response are "
+                "%lld/%lld/%lld/%lld/%lld in the reference, %lld/%lld/%lld/%lld/%lld in the engine", a->name,
+                (long long)a->start_time, (long long)a->completion_time, (long long)a->turnaround_time,
+                (long long)a->waiting_time, (long long)a->response_time,
+                (long long)b->start_time, (long long)b->completion_time, (long long)b->turnaround_time,
+                (long long)b->waiting_time, (long long)b->response_time);
+            return 1;
         }
-
-        p->start_time = current_time;
-        p->completion_time = current_time + p->burst_time;
-
-        // Add to Gantt chart
-        strcpy(gantt_chart[gantt_count].process_name, p->name);
-        gantt_chart[gantt_count].start_time = current_time;
-        gantt_chart[gantt_count].end_time = p->completion_time;
-        gantt_chart[gantt_count].color = p->color;
-        gantt_count++;
-
-        current_time = p->completion_time;
     }
+    return 0;
 }
 
-void sjf_scheduling() {
-    int completed = 0;
-    current_time = 0;
-
-    // Mark all processes as not completed
-    int is_completed[MAX_PROCESSES] = { 0 };
-
-    while (completed != process_count) {
-        int shortest = -1;
-        int min_burst = INT_MAX;
-
-        // Find shortest job among arrived processes
-        for (int i = 0; i < process_count; i++) {
-            if (!is_completed[i] && processes[i].arrival_time <= current_time) {
-                if (processes[i].burst_time < min_burst) {
-                    min_burst = processes[i].burst_time;
-                    shortest = i;
-                }
+// Binding quotas make a schedule the reference loops cannot, so it is checked
+// instead: every process runs for exactly its burst, no group uses more than
+// its quota in any period, and no process is held back for longer than it waits
+int check_throttling(const Simulation* sim, char* diff, size_t diff_len) {
+    const GroupConfig* groups = &sim->groups;
+    int n = sim->process_count;
+    SimTime end = sim->gantt_count ? sim->gantt[sim->gantt_count - 1].end_time : 0;
+    SimTime* ran = calloc(n + 1, sizeof(SimTime));
+    int* usage[MAX_GROUPS + 1] = { NULL };
+    int status = 0;
+
+    for (int g = 1; g <= groups->count; g++) {
+        usage[g] = calloc(end / groups->group[g].period + 1, sizeof(int));
+    }
+    for (int k = 0; k < sim->gantt_count; k++) {
+        const GanttBlock* b = &sim->gantt[k];
+        ran[b->process_index] += b->end_time - b->start_time - b->overhead;
+
+        for (int g = process_group(sim, &sim->processes[b->process_index]); g > 0; g = groups->group[g].parent) {
+            int period = groups->group[g].period;
+            for (SimTime t = b->start_time + b->overhead; t < b->end_time; t++) {
+                usage[g][t / period]++;
             }
         }
+    }
 
-        if (shortest == -1) {
-            current_time++;
-            continue;
+    for (int i = 0; i < n && status == 0; i++) {
+        const Process* p = &sim->processes[i];
+        if (ran[i] != p->burst_time || p->remaining_time != 0) {
+            snprintf(diff, diff_len, "%s ran for %lld of its %lld units", p->name, (long long)ran[i],
+                (long long)p->burst_time);
+            status = 1;
+        }
+        else if (p->throttled_time > p->waiting_time) {
+            snprintf(diff, diff_len, "%s was throttled for %lld units but waited only %lld",
+                p->name, (long long)p->throttled_time, (long long)p->waiting_time);
+            status = 1;
         }
-
-        Process* p = &processes[shortest];
-        p->start_time = current_time;
-        p->completion_time = current_time + p->burst_time;
-
-        // Add to Gantt chart
-        strcpy(gantt_chart[gantt_count].process_name, p->name);
-        gantt_chart[gantt_count].start_time = current_time;
-        gantt_chart[gantt_count].end_time = p->completion_time;
-        gantt_chart[gantt_count].color = p->color;
-        gantt_count++;
-
-        current_time = p->completion_time;
-        is_completed[shortest] = 1;
-        completed++;
     }
-}
-
-void srtf_scheduling() {
-    int completed = 0;
-    current_time = 0;
-    int is_completed[MAX_PROCESSES] = { 0 };
-
-    // Reset remaining times
-    for (int i = 0; i < process_count; i++) {
-        processes[i].remaining_time = processes[i].burst_time;
-        processes[i].start_time = -1;
+    for (int g = 1; g <= groups->count && status == 0; g++) {
+        const CpuGroup* group = &groups->group[g];
+        for (int k = 0; k <= end / group->period && group->quota > 0; k++) {
+            if (usage[g][k] <= group->quota) continue;
+            snprintf(diff, diff_len, "Group %s used %d units over %d-%d, its quota is %d", group->path,
+                usage[g][k], k * group->period, (k + 1) * group->period, group->quota);
+            status = 1;
+            break;
+        }
     }
 
-    while (completed != process_count) {
-        int shortest = -1;
-        int min_remaining = INT_MAX;
+    for (int g = 1; g <= groups->count; g++) {
+        free(usage[g]);
+    }
+    free(ran);
+    return status;
+}
 
-        // Find process with shortest remaining time
-        for (int i = 0; i < process_count; i++) {
-            if (!is_completed[i] && processes[i].arrival_time <= current_time) {
-                if (processes[i].remaining_time < min_remaining) {
-                    min_remaining = processes[i].remaining_time;
-                    shortest = i;
-                }
+// Under Preemptive Priority locks make a schedule the reference loops make
+// only with the same code, so it is checked instead: every process runs for
+// exactly its burst, no two processes hold a resource at once, the CPU is not
+// left idle while work is waiting, no process is blocked for longer than it
+// waits, and without aging neither protocol lets an unbounded inversion through
+int check_locking(const Simulation* sim, char* diff, size_t diff_len) {
+    int n = sim->process_count;
+    SimTime end = sim->gantt_count ? sim->gantt[sim->gantt_count - 1].end_time : 0;
+    SimTime* ran = calloc(n + 1, sizeof(SimTime));
+    char* busy = calloc(end + 1, 1);
+    SimTime (*held)[MAX_LOCKS][2] = calloc(n + 1, sizeof(*held));
+    int status = 0;
+
+    for (int k = 0; k < sim->gantt_count; k++) {
+        const GanttBlock* b = &sim->gantt[k];
+        const Process* p = &sim->processes[b->process_index];
+        for (SimTime t = b->start_time; t < b->end_time; t++) {
+            busy[t] = 1;
+            if (t < b->start_time + b->overhead) continue;
+
+            // The unit numbered `used` of the process runs over [t, t + 1)
+            SimTime used = ran[b->process_index]++;
+            for (int s = 0; s < p->lock_count; s++) {
+                if (p->locks[s].acquire == used) held[b->process_index][s][0] = t;
+                if (p->locks[s].release == used + 1) held[b->process_index][s][1] = t + 1;
             }
         }
+    }
 
-        if (shortest == -1) {
-            current_time++;
-            continue;
+    for (int i = 0; i < n && status == 0; i++) {
+        const Process* p = &sim->processes[i];
+        if (ran[i] != p->burst_time || p->remaining_time != 0) {
+            snprintf(diff, diff_len, "%s ran for %lld of its %lld units", p->name, (long long)ran[i],
+                (long long)p->burst_time);
+            status = 1;
         }
-
-        Process* p = &processes[shortest];
-
-        // Set start time if first execution
-        if (p->start_time == -1) {
-            p->start_time = current_time;
+        else if (p->lock_wait_time > p->waiting_time) {
+            snprintf(diff, diff_len, "%s was blocked for %lld units but waited only %lld",
+                p->name, (long long)p->lock_wait_time, (long long)p->waiting_time);
+            status = 1;
         }
-
-        // Execute for 1 time unit
-        p->remaining_time--;
-
-        // Add/update Gantt chart entry
-        if (gantt_count == 0 || strcmp(gantt_chart[gantt_count - 1].process_name, p->name) != 0) {
-            strcpy(gantt_chart[gantt_count].process_name, p->name);
-            gantt_chart[gantt_count].start_time = current_time;
-            gantt_chart[gantt_count].end_time = current_time + 1;
-            gantt_chart[gantt_count].color = p->color;
-            gantt_count++;
+    }
+    for (int i = 0; i < n && status == 0; i++) {
+        for (int j = i + 1; j < n && status == 0; j++) {
+            for (int a = 0; a < sim->processes[i].lock_count && status == 0; a++) {
+                for (int b = 0; b < sim->processes[j].lock_count && status == 0; b++) {
+                    if (sim->processes[i].locks[a].resource != sim->processes[j].locks[b].resource) continue;
+                    if (held[i][a][1] <= held[j][b][0] || held[j][b][1] <= held[i][a][0]) continue;
+                    snprintf(diff, diff_len, "%s holds %s over %lld-%lld and %s over %lld-%lld", sim->processes[i].name,
+                        sim->resources.name[sim->processes[i].locks[a].resource], (long long)held[i][a][0],
+                        (long long)held[i][a][1], sim->processes[j].name, (long long)held[j][b][0],
+                        (long long)held[j][b][1]);
+                    status = 1;
+                }
+            }
         }
-        else {
-            gantt_chart[gantt_count - 1].end_time = current_time + 1;
+    }
+    for (SimTime t = 0; t < end && status == 0; t++) {
+        for (int i = 0; i < n && !busy[t]; i++) {
+            const Process* p = &sim->processes[i];
+            if (p->arrival_time > t || p->completion_time <= t) continue;
+            snprintf(diff, diff_len, "The CPU is idle at %lld while %s waits", (long long)t, p->name);
+            status = 1;
+            break;
         }
+    }
+    for (int w = 0; sim->lock_log && w < sim->lock_log->wait_count && status == 0; w++) {
+        const LockWait* wait = &sim->lock_log->waits[w];
+        if (sim->lock_protocol == LOCK_NONE || sim->aging_interval > 0 || wait->unbounded == 0) continue;
+        snprintf(diff, diff_len, "%s suffers %lld units of unbounded inversion at %lld-%lld under %s",
+            sim->processes[wait->process].name, (long long)wait->unbounded, (long long)wait->start,
+            (long long)wait->end,
+            lock_protocol_names[sim->lock_protocol]);
+        status = 1;
+    }
 
-        current_time++;
+    free(held);
+    free(busy);
+    free(ran);
+    return status;
+}
 
-        // Mark as completed if finished
-        if (p->remaining_time == 0) {
-            p->completion_time = current_time;
-            is_completed[shortest] = 1;
-            completed++;
-        }
+int verify_case(const VerifyCase* c, char* diff, size_t diff_len) {
+    Simulation expected, actual;
+    if (c->engine == VERIFY_THROTTLING || (c->engine == VERIFY_LOCKS && c->algo == PREEMPTIVE_PRIORITY)) {
+        run_verify_engine(c, &actual);
+        int status = c->engine == VERIFY_THROTTLING ? check_throttling(&actual, diff, diff_len) :
+            check_locking(&actual, diff, diff_len);
+        free_simulation(&actual);
+        free(actual.processes);
+        return status;
     }
+    run_reference(c, &expected);
+    run_verify_engine(c, &actual);
+
+    int status = compare_schedules(&expected, &actual, diff, diff_len);
+
+    free_simulation(&expected);
+    free_simulation(&actual);
+    free(expected.processes);
+    free(actual.processes);
+    return status;
 }
 
-void priority_scheduling() {
-    int completed = 0;
-    current_time = 0;
-    int is_completed[MAX_PROCESSES] = { 0 };
+// Repeats until no single change keeps the case failing
+void shrink_verify_case(VerifyCase* c) {
+    char diff[512];
+    int progress = 1;
+
+    while (progress) {
+        progress = 0;
+
+        for (int i = 0; i < c->count && c->count > 1; i++) {
+            Process removed = c->processes[i];
+            memmove(&c->processes[i], &c->processes[i + 1], (c->count - i - 1) * sizeof(Process));
+            c->count--;
+            if (verify_case(c, diff, sizeof(diff)) != 0) {
+                progress = 1;
+                i--;
+                continue;
+            }
+            c->count++;
+            memmove(&c->processes[i + 1], &c->processes[i], (c->count - i - 1) * sizeof(Process));
+            c->processes[i] = removed;
+        }
 
-    while (completed != process_count) {
-        int highest_priority = -1;
-        int min_priority = INT_MAX;
+        for (int i = 0; i < c->count; i++) {
+            SimTime* fields[2] = { &c->processes[i].arrival_time, &c->processes[i].burst_time };
+            SimTime floors[2] = { 0, 1 };
+
+            for (int f = 0; f < 2; f++) {
+                SimTime value = *fields[f];
+
+                // Straight to the floor if that still fails, otherwise one step down
+                while (*fields[f] > floors[f]) {
+                    SimTime old = *fields[f];
+                    *fields[f] = floors[f];
+                    if (verify_case(c, diff, sizeof(diff)) != 0) break;
+                    *fields[f] = old - 1;
+                    if (verify_case(c, diff, sizeof(diff)) != 0) continue;
+                    *fields[f] = old;
+                    break;
+                }
+                if (*fields[f] != value) progress = 1;
+            }
 
-        // Find highest priority process (lower number = higher priority)
-        for (int i = 0; i < process_count; i++) {
-            if (!is_completed[i] && processes[i].arrival_time <= current_time) {
-                if (processes[i].priority < min_priority) {
-                    min_priority = processes[i].priority;
-                    highest_priority = i;
+            while (c->processes[i].priority > 1) {
+                c->processes[i].priority--;
+                if (verify_case(c, diff, sizeof(diff)) == 0) {
+                    c->processes[i].priority++;
+                    break;
                 }
+                progress = 1;
             }
         }
 
-        if (highest_priority == -1) {
-            current_time++;
-            continue;
+        while (c->time_quantum > 1) {
+            c->time_quantum--;
+            if (verify_case(c, diff, sizeof(diff)) == 0) {
+                c->time_quantum++;
+                break;
+            }
+            progress = 1;
         }
 
-        Process* p = &processes[highest_priority];
-        p->start_time = current_time;
-        p->completion_time = current_time + p->burst_time;
-
-        // Add to Gantt chart
-        strcpy(gantt_chart[gantt_count].process_name, p->name);
-        gantt_chart[gantt_count].start_time = current_time;
-        gantt_chart[gantt_count].end_time = p->completion_time;
-        gantt_chart[gantt_count].color = p->color;
-        gantt_count++;
+        while (c->aging_interval > 1) {
+            c->aging_interval--;
+            if (verify_case(c, diff, sizeof(diff)) == 0) {
+                c->aging_interval++;
+                break;
+            }
+            progress = 1;
+        }
 
-        current_time = p->completion_time;
-        is_completed[highest_priority] = 1;
-        completed++;
+        int* costs[3] = { &c->cost.dispatch, &c->cost.cache_penalty, &c->cost.cache_decay };
+        for (int f = 0; f < 3; f++) {
+            while (*costs[f] > 0) {
+                (*costs[f])--;
+                if (verify_case(c, diff, sizeof(diff)) == 0) {
+                    (*costs[f])++;
+                    break;
+                }
+                progress = 1;
+            }
+        }
     }
 }
 
-void round_robin_scheduling() {
-    int completed = 0;
-    current_time = 0;
-    int queue[MAX_PROCESSES];
-    int front = 0, rear = 0;
-    int in_queue[MAX_PROCESSES] = { 0 };
+void format_verify_case(const VerifyCase* c, FILE* out) {
+    fprintf(out, "# %s, quantum %d, %s engine, switch cost %d, cache penalty %d, cache decay %d, aging %d\n",
+        algorithm_keys[c->algo - 1], c->time_quantum, verify_engine_names[c->engine],
+        c->cost.dispatch, c->cost.cache_penalty, c->cost.cache_decay, c->aging_interval);
+    // The grouped engines set up their groups themselves
+    int grouped = c->engine == VERIFY_GROUPS || c->engine == VERIFY_THROTTLING;
+    GroupConfig groups;
+    Process* procs = malloc((c->count + 1) * sizeof(Process));
+    memcpy(procs, c->processes, c->count * sizeof(Process));
+    if (grouped) {
+        verify_groups(c, procs, &groups);
+        for (int g = 1; g <= groups.count; g++) {
+            fprintf(out, "# %s\n", verify_group_lines[c->engine == VERIFY_THROTTLING][g - 1]);
+        }
+    }
+    // The locked engine's spans are printed as a workload takes them
+    ResourceTable resources = { 0 };
+    if (c->engine == VERIFY_LOCKS) {
+        verify_locks(c, procs, &resources);
+        fprintf(out, "# --lock-protocol %s\n", lock_protocol_keys[c->lock_protocol]);
+    }
 
-    // Reset remaining times
-    for (int i = 0; i < process_count; i++) {
-        processes[i].remaining_time = processes[i].burst_time;
-        processes[i].start_time = -1;
+    for (int i = 0; i < c->count; i++) {
+        const Process* p = &procs[i];
+        char spans[128];
+        format_lock_spans(p, &resources, spans, sizeof(spans));
+        fprintf(out, "%s %lld %lld%s %d", p->name, (long long)p->arrival_time, (long long)p->burst_time,
+            spans, p->priority);
+        if (p->weight > 0) fprintf(out, " %d", p->weight);
+        if (grouped && p->group > 0) fprintf(out, " # in %s", groups.group[p->group].path);
+        fputc('\n', out);
     }
+    free(procs);
+}
 
-    // Add processes that arrive at time 0
-    for (int i = 0; i < process_count; i++) {
-        if (processes[i].arrival_time == 0) {
-            queue[rear++] = i;
-            in_queue[i] = 1;
+// Checks the workload file, or config->cases random ones, with every algorithm
+// and engine (Round Robin with quanta 1-4 for a workload file). Returns the
+// exit status: 1 after printing the first mismatch, shrunk.
+int run_verify(const VerifyConfig* config, const char* workload_path) {
+    Process* procs = NULL;
+    int count = 0;
+    long checks = 0;
+    int cases = workload_path ? 1 : config->cases;
+    char diff[512];
+
+    if (workload_path) {
+        if (load_workload(workload_path, &procs, &count, NULL, NULL, diff, sizeof(diff)) != 0) {
+            fprintf(stderr, "%s\n", diff);
+            return 1;
         }
+        // The reference loops know nothing of I/O
+        if (workload_has_io(procs, count)) {
+            fprintf(stderr, "%s has I/O bursts; only CPU-only workloads can be verified\n", workload_path);
+            free(procs);
+            return 1;
+        }
+    }
+    else {
+        procs = malloc(config->max_jobs * sizeof(Process));
     }
 
-    while (completed != process_count) {
-        if (front == rear) {
-            // Find next arriving process
-            int next_arrival = INT_MAX;
-            for (int i = 0; i < process_count; i++) {
-                if (processes[i].arrival_time > current_time &&
-                    processes[i].arrival_time < next_arrival &&
-                    processes[i].remaining_time > 0) {
-                    next_arrival = processes[i].arrival_time;
-                }
+    for (int k = 0; k < cases; k++) {
+        int quantum = 1;
+        SwitchCost cost = config->cost;
+        int aging = config->aging_interval;
+        LockProtocol protocol = LOCK_INHERIT;
+        if (!workload_path) {
+            RngState rng;
+            rng_seed(&rng, config->seed, (uint64_t)k);
+            count = 1 + (int)(rng_next(&rng) % (uint64_t)config->max_jobs);
+            quantum = 1 + (int)(rng_next(&rng) % 4);
+            if (rng_next(&rng) % 2) {
+                cost.dispatch = (int)(rng_next(&rng) % 3);
+                cost.cache_penalty = (int)(rng_next(&rng) % 4);
+                cost.cache_decay = (int)(rng_next(&rng) % 7);
             }
-            if (next_arrival != INT_MAX) {
-                current_time = next_arrival;
-                for (int i = 0; i < process_count; i++) {
-                    if (processes[i].arrival_time <= current_time &&
-                        !in_queue[i] && processes[i].remaining_time > 0) {
-                        queue[rear++] = i;
-                        in_queue[i] = 1;
-                    }
-                }
+            else {
+                memset(&cost, 0, sizeof(cost));
             }
-            continue;
-        }
-
-        int current_process = queue[front++];
-        Process* p = &processes[current_process];
+            generate_verify_workload(procs, count, &rng);
 
-        // Set start time if first execution
-        if (p->start_time == -1) {
-            p->start_time = current_time;
+            // A third of the cases age the priority policies
+            aging = rng_next(&rng) % 3 ? 0 : 1 + (int)(rng_next(&rng) % 6);
+            protocol = (LockProtocol)(rng_next(&rng) % LOCK_PROTOCOLS);
         }
 
-        // Execute for time quantum or remaining time, whichever is smaller
-        int execution_time = (p->remaining_time < time_quantum) ? p->remaining_time : time_quantum;
+        for (int algo = FCFS; algo <= ALGORITHM_COUNT; algo++) {
+            int sliced = algo == ROUND_ROBIN || proportional_share(algo);
+            for (int q = quantum; q <= (workload_path && sliced ? 4 : quantum); q++) {
+                for (int engine = 0; engine < VERIFY_ENGINES; engine++) {
+                    VerifyCase c = { procs, count, algo, q, engine, cost, aging, protocol };
+                    checks++;
+                    if (verify_case(&c, diff, sizeof(diff)) == 0) continue;
+
+                    printf("Mismatch: %s, quantum %d, %s engine, switch cost %d/%d/%d, aging %d", algorithm_keys[algo - 1],
+                        q, verify_engine_names[engine], cost.dispatch, cost.cache_penalty, cost.cache_decay, aging);
+                    if (workload_path) printf(", %s\n", workload_path);
+                    else printf(", case %d of seed %llu\n", k, (unsigned long long)config->seed);
+                    printf("%s\n\n", diff);
+
+                    // Shrink a copy; the names stay those of the original case
+                    c.processes = malloc(count * sizeof(Process));
+                    memcpy(c.processes, procs, count * sizeof(Process));
+                    shrink_verify_case(&c);
+                    verify_case(&c, diff, sizeof(diff));
+                    printf("Smallest failing workload (%d processes):\n", c.count);
+                    format_verify_case(&c, stdout);
+                    printf("%s\n", diff);
+
+                    free(c.processes);
+                    free(procs);
+                    return 1;
+                }
+            }
+        }
+    }
 
-        // Add to Gantt chart
-        strcpy(gantt_chart[gantt_count].process_name, p->name);
-        gantt_chart[gantt_count].start_time = current_time;
-        gantt_chart[gantt_count].end_time = current_time + execution_time;
-        gantt_chart[gantt_count].color = p->color;
-        gantt_count++;
+    printf("%ld checks passed: %d workload%s, %d algorithms, %d engines\n",
+        checks, cases, cases == 1 ? "" : "s", ALGORITHM_COUNT, VERIFY_ENGINES);
+    free(procs);
+    return 0;
+}
 
-        current_time += execution_time;
-        p->remaining_time -= execution_time;
+// Headless mode
+
+int headless_mode_requested(int argc, char* argv[]) {
+    for (int i = 1; i < argc; i++) {
+        if (strncmp(argv[i], "--replicate", 11) == 0 || strncmp(argv[i], "--trace", 7) == 0 ||
+            strncmp(argv[i], "--serve", 7) == 0 || strncmp(argv[i], "--stream", 8) == 0 ||
+            strncmp(argv[i], "--export", 8) == 0 || strncmp(argv[i], "--verify", 8) == 0 ||
+            strncmp(argv[i], "--io-compare", 12) == 0 || strncmp(argv[i], "--aging-sweep", 13) == 0 ||
+            strncmp(argv[i], "--share-report", 14) == 0 || strncmp(argv[i], "--group-report", 14) == 0 ||
+            strncmp(argv[i], "--lock-report", 13) == 0 || strncmp(argv[i], "--admission-sweep", 17) == 0 ||
+            strncmp(argv[i], "--tune", 6) == 0 || strncmp(argv[i], "--estimate", 10) == 0 ||
+            strncmp(argv[i], "--plugin-compare", 16) == 0 || strncmp(argv[i], "--plugin-match", 14) == 0 ||
+            strncmp(argv[i], "--bench", 7) == 0) {
+            return 1;
+        }
+    }
+    return 0;
+}
 
-        // Add newly arrived processes to queue
-        for (int i = 0; i < process_count; i++) {
-            if (processes[i].arrival_time <= current_time &&
-                !in_queue[i] && processes[i].remaining_time > 0) {
-                queue[rear++] = i;
-                in_queue[i] = 1;
+int run_headless(int argc, char* argv[]) {
+    static struct option long_options[] = {
+        { "replicate",    required_argument, NULL, 'k' },
+        { "jobs",         required_argument, NULL, 'n' },
+        { "algorithm",    required_argument, NULL, 'a' },
+        { "seed",         required_argument, NULL, 's' },
+        { "threads",      required_argument, NULL, 't' },
+        { "quantum",      required_argument, NULL, 'q' },
+        { "arrival-rate", required_argument, NULL, 'r' },
+        { "mean-burst",   required_argument, NULL, 'b' },
+        { "trace",        required_argument, NULL, 'T' },
+        { "trace-format", required_argument, NULL, 'f' },
+        { "cpu",          required_argument, NULL, 'c' },
+        { "tick-us",      required_argument, NULL, 'u' },
+        { "start",        required_argument, NULL, 'S' },
+        { "max-jobs",     required_argument, NULL, 'm' },
+        { "serve",        required_argument, NULL, 'P' },
+        { "max-queue",    required_argument, NULL, 'Q' },
+        { "max-request-jobs", required_argument, NULL, 'J' },
+        { "stream",       required_argument, NULL, 'O' },
+        { "window",       required_argument, NULL, 'w' },
+        { "report-every", required_argument, NULL, 'R' },
+        { "max-live",     required_argument, NULL, 'L' },
+        { "events",       required_argument, NULL, 'e' },
+        { "export",       required_argument, NULL, 'X' },
+        { "chart",        required_argument, NULL, 'C' },
+        { "width",        required_argument, NULL, 'W' },
+        { "height",       required_argument, NULL, 'H' },
+        { "tiles",        required_argument, NULL, 'N' },
+        { "workload",     required_argument, NULL, 'F' },
+        { "verify",       required_argument, NULL, 'V' },
+        { "case-jobs",    required_argument, NULL, 'j' },
+        { "switch-cost",  required_argument, NULL, 'D' },
+        { "cache-penalty", required_argument, NULL, 'G' },
+        { "cache-decay",  required_argument, NULL, 'Y' },
+        { "io-compare",   no_argument,       NULL, 'I' },
+        { "devices",      required_argument, NULL, 'd' },
+        { "io-mix",       required_argument, NULL, 'x' },
+        { "aging",        required_argument, NULL, 'g' },
+        { "aging-sweep",  no_argument,       NULL, 'A' },
+        { "share-report", no_argument,       NULL, 'p' },
+        { "share-window", required_argument, NULL, 'y' },
+        { "group-report", no_argument,       NULL, 'B' },
+        { "lock-protocol", required_argument, NULL, 'l' },
+        { "lock-report",  no_argument,       NULL, 'E' },
+        { "queue-limit",  required_argument, NULL, 'K' },
+        { "overflow",     required_argument, NULL, 'o' },
+        { "token-rate",   required_argument, NULL, 'z' },
+        { "token-burst",  required_argument, NULL, 'Z' },
+        { "admission-sweep", no_argument,    NULL, 'M' },
+        { "tune",         required_argument, NULL, 'U' },
+        { "objective",    required_argument, NULL, 'v' },
+        { "min-throughput", required_argument, NULL, 'h' },
+        { "estimate",     required_argument, NULL, 'i' },
+        { "time-unit",    required_argument, NULL, '1' },
+        { "plugin-compare", no_argument,     NULL, '2' },
+        { "plugin-match", required_argument, NULL, '3' },
+        { "bench",        required_argument, NULL, '4' },
+        { NULL, 0, NULL, 0 }
+    };
+    ReplicationConfig config = { FCFS, 100, 1000, 0, 2, 1, 0.09, 10.0, { 0, 0, 0 }, 0.0, { 1, { IO_FCFS } } };
+    TraceConfig trace_config = { TRACE_FORMAT_AUTO, -1, 100, 0, 100000 };
+    const char* trace_path = NULL;
+    ServiceConfig service_config = { NULL, 0, 1024, 1000000, 64 * 1024 * 1024 };
+    StreamConfig stream_config = { FCFS, 2, 1000, 0, 1000000, STREAM_EVENTS_ALL, { 0, OVERFLOW_REJECT_NEW, 0, 1 } };
+    const char* stream_path = NULL;
+    ExportConfig export_config = { NULL, EXPORT_GANTT, 1200, 0, 1 };
+    const char* workload_path = NULL;
+    VerifyConfig verify_config = { 0, 12, 1, { 0, 0, 0 } };
+    int io_compare = 0;
+    int aging_sweep = 0;
+    int share_report = 0;
+    int share_window = 100;
+    int group_report = 0;
+    int lock_report = 0;
+    int admission_sweep = 0;
+    TuneConfig tune_config = { 0, OBJECTIVE_P99_RESPONSE, 0 };
+    int estimate = -1;
+    int plugin_compare = 0;
+    SchedulingAlgorithm plugin_match = 0;
+    int bench_runs = -1;
+    int opt;
+
+    while ((opt = getopt_long(argc, argv, "", long_options, NULL)) != -1) {
+        switch (opt) {
+        case 'k': config.replications = atoi(optarg); break;
+        case 'n': config.jobs = atoi(optarg); break;
+        case 's': config.seed = strtoull(optarg, NULL, 10); break;
+        case 't': config.threads = atoi(optarg); break;
+        case 'q': config.time_quantum = atoi(optarg); break;
+        case 'r': config.arrival_rate = atof(optarg); break;
+        case 'b': config.mean_burst = atof(optarg); break;
+        case 'T': trace_path = optarg; break;
+        case 'P': service_config.socket_path = optarg; break;
+        case 'Q': service_config.max_queue = atoi(optarg); break;
+        case 'J': service_config.max_request_jobs = atoi(optarg); break;
+        case 'O': stream_path = optarg; break;
+        case 'w': stream_config.window = atoll(optarg); break;
+        case 'R': stream_config.report_every = atoll(optarg); break;
+        case 'L': stream_config.max_live = atoi(optarg); break;
+        case 'X': export_config.path = optarg; break;
+        case 'W': export_config.width = atoi(optarg); break;
+        case 'H': export_config.height = atoi(optarg); break;
+        case 'N': export_config.tiles = atoi(optarg); break;
+        case 'F': workload_path = optarg; break;
+        case 'V': verify_config.cases = atoi(optarg); break;
+        case 'j': verify_config.max_jobs = atoi(optarg); break;
+        case 'D': config.cost.dispatch = atoi(optarg); break;
+        case 'G': config.cost.cache_penalty = atoi(optarg); break;
+        case 'Y': config.cost.cache_decay = atoi(optarg); break;
+        case 'I': io_compare = 1; break;
+        case 'x': config.io_mix = atof(optarg); break;
+        case 'g': config.aging_interval = atoi(optarg); break;
+        case 'A': aging_sweep = 1; break;
+        case 'p': share_report = 1; break;
+        case 'y': share_window = atoi(optarg); break;
+        case 'B': group_report = 1; break;
+        case 'E': lock_report = 1; break;
+        case 'K': stream_config.admission.queue_limit = atoi(optarg); break;
+        case 'o':
+            if (strcmp(optarg, "reject-new") == 0) stream_config.admission.overflow = OVERFLOW_REJECT_NEW;
+            else if (strcmp(optarg, "drop-oldest") == 0) stream_config.admission.overflow = OVERFLOW_DROP_OLDEST;
+            else {
+                fprintf(stderr, "Unknown overflow policy '%s' (reject-new or drop-oldest)\n", optarg);
+                return 1;
             }
+            break;
+        case 'z': stream_config.admission.token_rate = atof(optarg); break;
+        case 'Z': stream_config.admission.token_burst = atof(optarg); break;
+        case 'M': admission_sweep = 1; break;
+        case 'U': tune_config.candidates = atoi(optarg); break;
+        case 'v':
+            for (tune_config.objective = 0; tune_config.objective < OBJECTIVES; tune_config.objective++) {
+                if (strcmp(optarg, tune_objective_keys[tune_config.objective]) == 0) break;
+            }
+            if (tune_config.objective == OBJECTIVES) {
+                fprintf(stderr, "Unknown objective '%s' (p99-response, mean-response, p99-waiting, "
+                    "mean-waiting or mean-turnaround)\n", optarg);
+                return 1;
+            }
+            break;
+        case 'h': tune_config.min_throughput = atof(optarg); break;
+        case '2': plugin_compare = 1; break;
+        case '3':
+            plugin_match = algorithm_from_key(optarg);
+            if (plugin_match == 0 || algorithm_plugin(plugin_match)) {
+                fprintf(stderr, "Unknown built-in algorithm '%s'\n", optarg);
+                return 1;
+            }
+            break;
+        case '4':
+            bench_runs = atoi(optarg);
+            if (bench_runs < 1) bench_runs = 0;
+            break;
+        case 'i':
+            if (strcmp(optarg, "model") == 0) estimate = 0;
+            else if (strcmp(optarg, "compare") == 0) estimate = 1;
+            else {
+                fprintf(stderr, "Unknown estimate mode '%s' (model or compare)\n", optarg);
+                return 1;
+            }
+            break;
+        case '1':
+            for (time_unit = TIME_UNIT_NONE; time_unit < TIME_UNITS; time_unit++) {
+                if (strcmp(optarg, time_unit_keys[time_unit]) == 0) break;
+            }
+            if (time_unit == TIME_UNITS) {
+                fprintf(stderr, "Unknown time unit '%s' (units, ns, us or ms)\n", optarg);
+                return 1;
+            }
+            break;
+        case 'l':
+            for (config.lock_protocol = LOCK_NONE; config.lock_protocol < LOCK_PROTOCOLS; config.lock_protocol++) {
+                if (strcmp(optarg, lock_protocol_keys[config.lock_protocol]) == 0) break;
+            }
+            if (config.lock_protocol == LOCK_PROTOCOLS) {
+                fprintf(stderr, "Unknown lock protocol '%s' (none, inherit or ceiling)\n", optarg);
+                return 1;
+            }
+            break;
+        case 'd':
+            if (!parse_io_devices(optarg, &config.io)) {
+                fprintf(stderr, "Bad device list '%s' (1-4 of fcfs, sjf or priority, comma-separated)\n", optarg);
+                return 1;
+            }
+            break;
+        case 'C':
+            if (strcmp(optarg, "gantt") == 0) export_config.chart = EXPORT_GANTT;
+            else if (strcmp(optarg, "performance") == 0) export_config.chart = EXPORT_PERFORMANCE;
+            else {
+                fprintf(stderr, "Unknown chart '%s' (gantt or performance)\n", optarg);
+                return 1;
+            }
+            break;
+        case 'e':
+            if (strcmp(optarg, "all") == 0) stream_config.events = STREAM_EVENTS_ALL;
+            else if (strcmp(optarg, "completions") == 0) stream_config.events = STREAM_EVENTS_COMPLETIONS;
+            else if (strcmp(optarg, "none") == 0) stream_config.events = STREAM_EVENTS_NONE;
+            else {
+                fprintf(stderr, "Unknown event level '%s' (all, completions or none)\n", optarg);
+                return 1;
+            }
+            break;
+        case 'c': trace_config.cpu = atoi(optarg); break;
+        case 'u': trace_config.tick_us = atoi(optarg); break;
+        case 'S': trace_config.start = atof(optarg); break;
+        case 'm': trace_config.max_jobs = atoi(optarg); break;
+        case 'f':
+            if (strcmp(optarg, "perf") == 0) trace_config.format = TRACE_FORMAT_PERF;
+            else if (strcmp(optarg, "ftrace") == 0) trace_config.format = TRACE_FORMAT_FTRACE;
+            else {
+                fprintf(stderr, "Unknown trace format '%s' (perf or ftrace)\n", optarg);
+                return 1;
+            }
+            break;
+        case 'a':
+            config.algo = algorithm_from_key(optarg);
+            if (config.algo == 0) {
+                fprintf(stderr, "Unknown algorithm '%s'\n", optarg);
+                return 1;
+            }
+            break;
+        default:
+            return 1;
         }
+    }
 
-        if (p->remaining_time == 0) {
-            p->completion_time = current_time;
-            in_queue[current_process] = 0;
-            completed++;
-        }
-        else {
-            // Add back to queue if not completed
-            queue[rear++] = current_process;
+    if (config.cost.dispatch < 0 || config.cost.cache_penalty < 0 || config.cost.cache_decay < 0) {
+        fprintf(stderr, "Switch cost, cache penalty and cache decay must not be negative\n");
+        return 1;
+    }
+    if (config.io_mix < 0 || config.io_mix > 1) {
+        fprintf(stderr, "I/O mix must be between 0 and 1\n");
+        return 1;
+    }
+    if (config.aging_interval < 0 || config.aging_interval > 10000) {
+        fprintf(stderr, "Aging interval must be between 0 and 10000\n");
+        return 1;
+    }
+    if (config.algo == STRIDE && config.time_quantum > MAX_STRIDE_QUANTUM) {
+        fprintf(stderr, "Stride quantum must be at most %d\n", MAX_STRIDE_QUANTUM);
+        return 1;
+    }
+
+    if (service_config.socket_path) {
+        if (service_config.max_queue < 1 || service_config.max_request_jobs < 1) {
+            fprintf(stderr, "Queue and request limits must be positive\n");
+            return 1;
         }
+        service_config.threads = config.threads;
+        return run_service(&service_config);
     }
-}
 
-void preemptive_priority_scheduling() {
-    int completed = 0;
-    current_time = 0;
-    int is_completed[MAX_PROCESSES] = { 0 };
+    if (stream_config.admission.queue_limit < 0 || stream_config.admission.token_rate < 0 ||
+        stream_config.admission.token_burst < 1) {
+        fprintf(stderr, "Queue limit and token rate must not be negative, and the token burst must be at least 1\n");
+        return 1;
+    }
 
-    // Reset remaining times
-    for (int i = 0; i < process_count; i++) {
-        processes[i].remaining_time = processes[i].burst_time;
-        processes[i].start_time = -1;
+    if (tune_config.candidates != 0) {
+        if (tune_config.candidates < 1 || config.jobs < 1 || config.arrival_rate <= 0 || config.mean_burst <= 0) {
+            fprintf(stderr, "Configuration count, job count, arrival rate and mean burst must be positive\n");
+            return 1;
+        }
+        return run_tune(&config, &tune_config, workload_path);
     }
 
-    while (completed != process_count) {
-        int highest_priority = -1;
-        int min_priority = INT_MAX;
+    if (estimate >= 0) {
+        if (config.time_quantum < 1 || config.jobs < 1 || config.arrival_rate <= 0 || config.mean_burst <= 0) {
+            fprintf(stderr, "Jobs, quantum, arrival rate and mean burst must be positive\n");
+            return 1;
+        }
+        return run_estimate(&config, workload_path, estimate);
+    }
 
-        // Find highest priority process among arrived processes
-        for (int i = 0; i < process_count; i++) {
-            if (!is_completed[i] && processes[i].arrival_time <= current_time) {
-                if (processes[i].priority < min_priority) {
-                    min_priority = processes[i].priority;
-                    highest_priority = i;
-                }
-            }
+    if (admission_sweep) {
+        stream_config.algo = config.algo;
+        stream_config.time_quantum = config.time_quantum;
+        stream_config.report_every = stream_config.window;
+        if (config.time_quantum < 1 || config.jobs < 1 || config.arrival_rate <= 0 || config.mean_burst <= 0) {
+            fprintf(stderr, "Quantum, job count, arrival rate and mean burst must be positive\n");
+            return 1;
+        }
+        if (proportional_share(config.algo) || algorithm_plugin(config.algo)) {
+            fprintf(stderr, "Admission control does not run %s\n", algorithm_names[config.algo - 1]);
+            return 1;
         }
+        return run_admission_sweep(&config, &stream_config, workload_path);
+    }
 
-        if (highest_priority == -1) {
-            current_time++;
-            continue;
+    if (stream_path) {
+        stream_config.algo = config.algo;
+        stream_config.time_quantum = config.time_quantum;
+        if (stream_config.report_every == 0) stream_config.report_every = stream_config.window;
+        if (config.time_quantum < 1 || stream_config.window < 1 || stream_config.report_every < 1 ||
+            stream_config.max_live < 1) {
+            fprintf(stderr, "Quantum, window, report interval and live job limit must be positive\n");
+            return 1;
+        }
+        if (proportional_share(config.algo) || algorithm_plugin(config.algo)) {
+            fprintf(stderr, "Streaming mode does not run %s\n", algorithm_names[config.algo - 1]);
+            return 1;
         }
+        int64_t width = stream_bucket_width(stream_config.window, stream_config.report_every);
+        if (stream_config.report_every % width != 0) {
+            fprintf(stderr, "Reporting every %lld time units, a multiple of the %lld-unit statistics buckets\n",
+                (long long)((stream_config.report_every + width - 1) / width * width), (long long)width);
+        }
+        return run_stream(&stream_config, stream_path);
+    }
 
-        Process* p = &processes[highest_priority];
+    if (verify_config.cases > 0) {
+        if (verify_config.max_jobs < 1) {
+            fprintf(stderr, "Case size must be positive\n");
+            return 1;
+        }
+        verify_config.seed = config.seed;
+        verify_config.cost = config.cost;
+        verify_config.aging_interval = config.aging_interval;
+        return run_verify(&verify_config, workload_path);
+    }
 
-        // Set start time if first execution
-        if (p->start_time == -1) {
-            p->start_time = current_time;
+    if (aging_sweep) {
+        if (config.jobs < 1 || config.arrival_rate <= 0 || config.mean_burst <= 0) {
+            fprintf(stderr, "Jobs, arrival rate and mean burst must be positive\n");
+            return 1;
         }
+        return run_aging_sweep(&config, workload_path);
+    }
 
-        // Execute for 1 time unit
-        p->remaining_time--;
+    if (share_report) {
+        if (share_window < 1 || config.time_quantum < 1 || config.jobs < 1 ||
+            config.arrival_rate <= 0 || config.mean_burst <= 0) {
+            fprintf(stderr, "Share window, jobs, quantum, arrival rate and mean burst must be positive\n");
+            return 1;
+        }
+        return run_share_report(&config, workload_path, share_window);
+    }
 
-        // Add/update Gantt chart entry
-        if (gantt_count == 0 || strcmp(gantt_chart[gantt_count - 1].process_name, p->name) != 0) {
-            strcpy(gantt_chart[gantt_count].process_name, p->name);
-            gantt_chart[gantt_count].start_time = current_time;
-            gantt_chart[gantt_count].end_time = current_time + 1;
-            gantt_chart[gantt_count].color = p->color;
-            gantt_count++;
+    if (group_report) {
+        if (!workload_path || config.time_quantum < 1) {
+            fprintf(stderr, "The group report needs --workload and a positive quantum\n");
+            return 1;
         }
-        else {
-            gantt_chart[gantt_count - 1].end_time = current_time + 1;
+        if (algorithm_plugin(config.algo)) {
+            fprintf(stderr, "Plugins do not model bandwidth groups\n");
+            return 1;
         }
+        return run_group_report(&config, workload_path);
+    }
 
-        current_time++;
+    if (lock_report) {
+        if (!workload_path) {
+            fprintf(stderr, "The lock report needs --workload\n");
+            return 1;
+        }
+        return run_lock_report(&config, workload_path);
+    }
 
-        // Mark as completed if finished
-        if (p->remaining_time == 0) {
-            p->completion_time = current_time;
-            is_completed[highest_priority] = 1;
-            completed++;
+    if (plugin_compare) {
+        if (config.time_quantum < 1 || config.jobs < 1 || config.arrival_rate <= 0 || config.mean_burst <= 0) {
+            fprintf(stderr, "Jobs, quantum, arrival rate and mean burst must be positive\n");
+            return 1;
         }
+        return run_plugin_compare(&config, workload_path);
     }
-}
 
-void calculate_times() {
-    for (int i = 0; i < process_count; i++) {
-        Process* p = &processes[i];
-        p->turnaround_time = p->completion_time - p->arrival_time;
-        p->waiting_time = p->turnaround_time - p->burst_time;
+    if (bench_runs >= 0) {
+        if (bench_runs < 1 || config.time_quantum < 1 || config.jobs < 1 || config.arrival_rate <= 0 ||
+            config.mean_burst <= 0) {
+            fprintf(stderr, "Runs, jobs, quantum, arrival rate and mean burst must be positive\n");
+            return 1;
+        }
+        return run_bench(&config, workload_path, bench_runs);
+    }
 
-        // Response time is start time - arrival time
-        if (p->start_time != -1) {
-            p->response_time = p->start_time - p->arrival_time;
+    if (plugin_match) {
+        if (!algorithm_plugin(config.algo)) {
+            fprintf(stderr, "--plugin-match needs --algorithm to name a loaded plugin\n");
+            return 1;
         }
-        else {
-            p->response_time = 0;
+        if (config.time_quantum < 1 || config.jobs < 1 || config.arrival_rate <= 0 || config.mean_burst <= 0) {
+            fprintf(stderr, "Jobs, quantum, arrival rate and mean burst must be positive\n");
+            return 1;
         }
-
-        // Ensure non-negative values
-        if (p->waiting_time < 0) p->waiting_time = 0;
-        if (p->response_time < 0) p->response_time = 0;
+        return run_plugin_match(&config, workload_path, plugin_match);
     }
-}
 
-void reset_simulation() {
-    gantt_count = 0;
-    current_time = 0;
+    if (io_compare) {
+        if (config.time_quantum < 1 || config.jobs < 1 || config.arrival_rate <= 0 || config.mean_burst <= 0) {
+            fprintf(stderr, "Jobs, quantum, arrival rate and mean burst must be positive\n");
+            return 1;
+        }
+        // Without a workload file, compare on an even mix of CPU-bound and I/O-bound jobs
+        if (!workload_path && config.io_mix == 0) config.io_mix = 0.5;
+        return run_io_compare(&config, workload_path);
+    }
 
-    for (int i = 0; i < process_count; i++) {
-        processes[i].remaining_time = processes[i].burst_time;
-        processes[i].start_time = -1;
-        processes[i].completion_time = 0;
-        processes[i].waiting_time = 0;
-        processes[i].turnaround_time = 0;
-        processes[i].response_time = -1;
+    if (export_config.path) {
+        if (export_config.width < 200 || export_config.height < 0 || export_config.tiles < 1 ||
+            config.time_quantum < 1 || config.jobs < 1 || config.arrival_rate <= 0 || config.mean_burst <= 0) {
+            fprintf(stderr, "Width must be at least 200; tiles, jobs, quantum, arrival rate and mean burst must be positive\n");
+            return 1;
+        }
+        return run_export(&export_config, &config, trace_path, &trace_config, workload_path);
     }
 
-    // Clear statistics
-    GtkTextBuffer* buffer = gtk_text_view_get_buffer(GTK_TEXT_VIEW(statistics_text_view));
-    gtk_text_buffer_set_text(buffer, "Run a scheduling algorithm to see statistics.", -1);
-}
+    if (trace_path) {
+        TraceReplay tr;
+        char error[1200];
+        memset(&tr, 0, sizeof(tr));
 
-void load_sample_processes() {
-    process_count = 5;
-
-    // Sample process data
-    strcpy(processes[0].name, "P1");
-    processes[0].arrival_time = 0;
-    processes[0].burst_time = 6;
-    processes[0].priority = 3;
-
-    strcpy(processes[1].name, "P2");
-    processes[1].arrival_time = 1;
-    processes[1].burst_time = 4;
-    processes[1].priority = 1;
-
-    strcpy(processes[2].name, "P3");
-    processes[2].arrival_time = 2;
-    processes[2].burst_time = 3;
-    processes[2].priority = 4;
-
-    strcpy(processes[3].name, "P4");
-    processes[3].arrival_time = 3;
-    processes[3].burst_time = 2;
-    processes[3].priority = 2;
-
-    strcpy(processes[4].name, "P5");
-    processes[4].arrival_time = 4;
-    processes[4].burst_time = 5;
-    processes[4].priority = 5;
-
-    // Initialize other fields
-    for (int i = 0; i < process_count; i++) {
-        processes[i].remaining_time = processes[i].burst_time;
-        processes[i].process_id = i + 1;
-        processes[i].start_time = -1;
-        processes[i].completion_time = 0;
-        processes[i].waiting_time = 0;
-        processes[i].turnaround_time = 0;
-        processes[i].response_time = -1;
-        processes[i].color = process_colors[i % 10];
+        if (config.time_quantum < 1 || import_trace(&tr, trace_path, &trace_config, error, sizeof(error)) != 0) {
+            fprintf(stderr, "%s\n", config.time_quantum < 1 ? "Quantum must be positive" : error);
+            trace_replay_free(&tr);
+            return 1;
+        }
+        replay_trace(&tr, config.algo, config.time_quantum);
+
+        size_t report_len = 4096 + TRACE_REPORT_TASKS * 80;
+        char* report = malloc(report_len);
+        format_trace_report(&tr, report, report_len);
+        fputs(report, stdout);
+        free(report);
+        trace_replay_free(&tr);
+        return 0;
     }
+
+    if (config.replications < 1 || config.jobs < 1 || config.time_quantum < 1 ||
+        config.arrival_rate <= 0 || config.mean_burst <= 0) {
+        fprintf(stderr, "Replications, jobs, quantum, arrival rate and mean burst must be positive\n");
+        return 1;
+    }
+
+    ReplicationResult result;
+    char report[4096];
+    run_replications(&config, &result);
+    format_replication_report(&config, &result, report, sizeof(report));
+    fputs(report, stdout);
+    return 0;
 }
@@ -0,0 +1,73 @@
+// Shortest Job First as a scheduler plugin
+//
+// A minimal plugin that makes the same schedule as the built-in SJF: of the
+// ready processes it runs the one with the shortest burst to completion, ties
+// going to the process that comes first in the table. `make check` loads it
+// with --plugin-match sjf to test the plugin ABI end to end.
+//
+//     gcc -O2 -shared -fPIC -I. -o examples/sjf_plugin.so examples/sjf_plugin.c
+//     ./cpu_scheduler --plugin examples/sjf_plugin.so --algorithm sjf-plugin --plugin-match sjf
+
+#include <stdlib.h>
+#include "scheduler_plugin.h"
+
+typedef struct {
+    int id;
+    int index;
+    int64_t burst_time;
+} ReadyProcess;
+
+// Run state: the ready processes, unordered
+typedef struct {
+    ReadyProcess* ready;
+    int count;
+} SjfRun;
+
+static void* sjf_init(const SchedPluginConfig* config) {
+    SjfRun* run = calloc(1, sizeof(SjfRun));
+    if (run) run->ready = malloc((config->process_count + 1) * sizeof(ReadyProcess));
+    return run;
+}
+
+static void sjf_arrival(void* data, const SchedPluginProcess* p, int64_t now) {
+    SjfRun* run = data;
+    ReadyProcess* r = &run->ready[run->count++];
+
+    (void)now;
+    r->id = p->id;
+    r->index = p->index;
+    r->burst_time = p->burst_time;
+}
+
+static int sjf_pick_next(void* data, int64_t now, int64_t* slice) {
+    SjfRun* run = data;
+    int best = 0;
+
+    (void)now;
+    for (int k = 1; k < run->count; k++) {
+        const ReadyProcess* a = &run->ready[k];
+        const ReadyProcess* b = &run->ready[best];
+        if (a->burst_time < b->burst_time || (a->burst_time == b->burst_time && a->index < b->index)) best = k;
+    }
+
+    int id = run->ready[best].id;
+    run->ready[best] = run->ready[--run->count];
+    *slice = 0;
+    return id;
+}
+
+static void sjf_finish(void* data) {
+    SjfRun* run = data;
+    free(run->ready);
+    free(run);
+}
+
+// A slice always runs to completion, so slice_end is never called
+static const SchedPluginOps sjf_ops = {
+    SCHED_PLUGIN_ABI_VERSION, "sjf-plugin", "SJF (plugin)", 0,
+    sjf_init, sjf_arrival, sjf_pick_next, NULL, NULL, sjf_finish
+};
+
+const SchedPluginOps* sched_plugin_entry(void) {
+    return &sjf_ops;
+}
@@ -0,0 +1,74 @@
+// Scheduler plugin ABI
+//
+// A plugin is a shared object that exports sched_plugin_entry(), returning a
+// SchedPluginOps table that stays valid until the program exits. Build one with
+//
+//     gcc -O2 -shared -fPIC -o my_policy.so my_policy.c
+//
+// and load it with --plugin my_policy.so. The simulator keeps the clock and
+// the process table; the plugin only decides what runs next and for how long.
+//
+// Every run calls init first and finish last. In between, a process is
+// handed to arrival once, when it arrives (in arrival order, ties by table
+// order).
+// Whenever the CPU is free and some process is ready, pick_next chooses one
+// of the ready processes. The chosen process runs until its slice is up, then
+// comes back through slice_end if it has work left or complete if not. Arrivals
+// during a slice are reported before the slice ends.
+//
+// Runs on different threads call the hooks concurrently, each with the state
+// its own init returned, so a plugin must not keep run state in globals.
+// Any hook except pick_next may be NULL.
+
+#ifndef SCHEDULER_PLUGIN_H
+#define SCHEDULER_PLUGIN_H
+
+#include <stdint.h>
+
+#define SCHED_PLUGIN_ABI_VERSION 3
+#define SCHED_PLUGIN_ENTRY "sched_plugin_entry"
+
+// What a run looks like to init
+typedef struct {
+    int process_count;
+    int time_quantum;           // as set for the run; the plugin may ignore it
+    uint64_t seed;              // for plugins that draw random numbers
+} SchedPluginConfig;
+
+// What a plugin sees of one process. Times are in ticks. Priorities are 1
+// (highest) to 10 for processes from the window and from service requests,
+// 1 to 40 in trace replays, which map nice -20..19 to 1..40 (real-time tasks
+// are 1), and whatever integer a workload file gives.
+typedef struct {
+    int id;                     // the process's id, which pick_next returns
+    int index;                  // place in the table, 0 to process_count - 1; fixed for the run
+    const char* name;
+    int priority;               // lower runs first; see below for the range
+    int weight;                 // CPU share, 1 to 100
+    int64_t arrival_time;
+    int64_t burst_time;         // total CPU demand
+    int64_t remaining_time;     // CPU demand not served yet
+} SchedPluginProcess;
+
+typedef struct {
+    uint32_t abi_version;       // SCHED_PLUGIN_ABI_VERSION
+    const char* key;            // name for --algorithm: letters, digits and dashes
+    const char* name;           // button label
+    int preempt_on_arrival;     // nonzero: an arrival also ends the running slice
+
+    // Returns the run's state, passed to every other hook
+    void* (*init)(const SchedPluginConfig* config);
+    void (*arrival)(void* run, const SchedPluginProcess* p, int64_t now);
+    // Returns the id of a ready process and sets *slice to the most ticks it
+    // may run, 0 for until it completes. The process is not ready again until
+    // slice_end. A pick that is not ready runs the ready process that comes
+    // first in the table instead, and counts as an invalid pick.
+    int (*pick_next)(void* run, int64_t now, int64_t* slice);
+    void (*slice_end)(void* run, const SchedPluginProcess* p, int64_t now);
+    void (*complete)(void* run, const SchedPluginProcess* p, int64_t now);
+    void (*finish)(void* run);
+} SchedPluginOps;
+
+typedef const SchedPluginOps* (*SchedPluginEntry)(void);
+
+#endif